@@ -0,0 +1,1158 @@
+// wolf3d_bench: headless benchmark for the software raycaster.
+//
+// Replays scripted camera paths over the built-in map, generated maps and
+// level files built by wolf3d_levelc, sweeping resolutions and thread counts,
+// and prints the results as JSON.
+// No window or GL context is created, so it runs on GPU-less machines.
+//
+// --sprites N scatters N billboards over each map and draws them on top of
+// the walls every frame, gathering and sorting included in the frame time.
+// --flats flat fills floors and ceilings with plain colours instead of
+// casting textured ones, to see what the texturing costs.
+//
+// --mode collision instead moves a crowd of circles through the same maps
+// with swept collision and reports the cost per move.
+//
+// --mode flowfield times the shared enemy flow field: a full search per goal
+// tile, the updates while that search is spread over ticks, local
+// repairs when doorways open and close, and the per-agent cost of chasing for
+// crowds of 64, 256, ... up to --entities agents.
+//
+// --mode los has --entities agents check their line of sight to a player
+// walking through the map, one batch per frame, for every thread count and
+// line-of-sight kernel, next to a plain single-threaded tile DDA. The run
+// fails (exit status 1) if any batch disagrees with that baseline, or if the
+// kernel GetBestLOSKernel picks is not faster than it.
+//
+// --mode drawlist builds the GPU path's draw list along the walk path (floor,
+// ceiling, visible wall chunks and moving doors) and submits it to a recording
+// backend twice: sorted with the uniform shadow copy, and in order with all
+// state set per draw like plain DrawMesh calls, reporting the state changes of
+// both per frame.
+//
+// Usage: wolf3d_bench [--mode raycast|collision|flowfield|los|drawlist]
+//                     [--maps builtin,maze:256,pillars:1024,level:e1m1.w3dl]
+//                     [--resolutions 1280x720,3840x2160] [--threads 1,2,4,8]
+//                     [--frames 120] [--warmup 10] [--kernel scalar|sse2|avx2]
+//                     [--sprites 0] [--flats textured|flat] [--entities 4096] [--out results.json]
+
+#include "raylib.h"
+#include "raymath.h"
+#include "Core/timing.h"
+#include "Core/worker_pool.h"
+#include "Rendering/draw_list.h"
+#include "Rendering/framebuffer.h"
+#include "Rendering/raycaster.h"
+#include "Rendering/sprite_renderer.h"
+#include "Rendering/shading.h"
+#include "Rendering/wall_mesh.h"
+#include "World/map.h"
+#include "World/player.h"
+#include "World/collision.h"
+#include "World/flow_field.h"
+#include "World/enemies.h"
+#include "World/grid_ray.h"
+#include "World/los.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BENCH_ITEMS 16
+#define MAX_BENCH_ITEM_LENGTH 128 // Room for level file paths
+#define FIELD_OF_VIEW_PLANE 0.66f // Matches the camera plane set by InitPlayer
+#define BENCH_PVS_MAX_TILES 16384 // Bigger maps skip the PVS build (minutes) and cull sprites by frustum only
+#define BENCH_DOOR_PERIOD 90      // Frames between toggling the doors near the camera in drawlist mode
+#define BENCH_WALL_CHUNK_RADIUS 1 // Wall chunks drawn around the camera's, like the renderer
+
+typedef struct BenchResolution {
+    int width;
+    int height;
+} BenchResolution;
+
+typedef enum {
+    BENCH_MODE_RAYCAST,
+    BENCH_MODE_COLLISION,
+    BENCH_MODE_FLOWFIELD,
+    BENCH_MODE_LOS,
+    BENCH_MODE_DRAWLIST
+} BenchMode;
+
+typedef struct BenchOptions {
+    BenchMode mode;
+    char maps[MAX_BENCH_ITEMS][MAX_BENCH_ITEM_LENGTH];
+    int mapCount;
+    BenchResolution resolutions[MAX_BENCH_ITEMS];
+    int resolutionCount;
+    int threads[MAX_BENCH_ITEMS];
+    int threadCount;
+    int frames;
+    int warmup;
+    int sprites;    // Billboards drawn per frame in raycast mode
+    bool texturedFlats; // Textured floors and ceilings in raycast mode
+    int entities;   // Moving circles in collision mode, largest crowd in flowfield mode, queries per batch in los mode
+    const char* outPath;
+} BenchOptions;
+
+// One sampled camera pose per frame
+typedef struct CameraPose {
+    float x, y;   // Position in tiles
+    float angle;  // View angle in radians
+} CameraPose;
+
+typedef enum {
+    CAMERA_PATH_SPIN,  // Rotate 360 degrees in place
+    CAMERA_PATH_WALK,  // Walk through corridors, turning at walls
+    CAMERA_PATH_COUNT
+} CameraPathType;
+
+static const char* CAMERA_PATH_NAMES[CAMERA_PATH_COUNT] = { "spin", "walk" };
+
+// Small deterministic generator so runs are reproducible everywhere
+static unsigned int NextRandom(unsigned int* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+//----------------------------------------------------------------------------------
+// Map generation
+//----------------------------------------------------------------------------------
+
+// Classic recursive-backtracker maze on odd cells (iterative, explicit stack)
+static void GenerateMaze(Map* map, unsigned int seed) {
+    int width = map->width;
+    int height = map->height;
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            SetMapTile(map, x, y, TILE_WALL);
+        }
+    }
+    
+    int cellsX = (width - 1) / 2;
+    int cellsY = (height - 1) / 2;
+    if (cellsX <= 0 || cellsY <= 0) return;
+    
+    int* stack = (int*)malloc((size_t)cellsX * cellsY * sizeof(int));
+    int top = 0;
+    stack[top++] = 0;
+    SetMapTile(map, 1, 1, TILE_EMPTY);
+    
+    static const int DIRS[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    
+    while (top > 0) {
+        int cell = stack[top - 1];
+        int cx = cell % cellsX;
+        int cy = cell / cellsX;
+        
+        // Collect unvisited neighbours
+        int options[4];
+        int optionCount = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = cx + DIRS[d][0];
+            int ny = cy + DIRS[d][1];
+            if (nx < 0 || ny < 0 || nx >= cellsX || ny >= cellsY) continue;
+            if (GetMapTile(map, nx * 2 + 1, ny * 2 + 1) == TILE_EMPTY) continue;
+            options[optionCount++] = d;
+        }
+        
+        if (optionCount == 0) {
+            top--;
+            continue;
+        }
+        
+        int d = options[NextRandom(&seed) % optionCount];
+        int nx = cx + DIRS[d][0];
+        int ny = cy + DIRS[d][1];
+        SetMapTile(map, cx * 2 + 1 + DIRS[d][0], cy * 2 + 1 + DIRS[d][1], TILE_EMPTY);
+        SetMapTile(map, nx * 2 + 1, ny * 2 + 1, TILE_EMPTY);
+        stack[top++] = ny * cellsX + nx;
+    }
+    
+    free(stack);
+}
+
+// Open hall with scattered pillars: long sight lines, lots of DDA steps per ray
+static void GeneratePillars(Map* map, unsigned int seed) {
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            bool border = (x == 0 || y == 0 || x == map->width - 1 || y == map->height - 1);
+            bool pillar = (NextRandom(&seed) % 100) < 3;
+            SetMapTile(map, x, y, (border || pillar) ? TILE_WALL : TILE_EMPTY);
+        }
+    }
+}
+
+// Build the map named by spec ("builtin", "maze:N", "pillars:N" or "level:PATH")
+static bool LoadBenchMap(Map* map, const char* spec) {
+    InitMapHeadless(map, NULL);
+    if (strcmp(spec, "builtin") == 0) return true;
+    
+    if (strncmp(spec, "level:", 6) == 0) {
+        UnloadMapGrid(map);
+        return LoadMapGrid(map, spec + 6);
+    }
+    
+    const char* colon = strchr(spec, ':');
+    int size = colon ? atoi(colon + 1) : 0;
+    if (size < 8 || size > MAP_MAX_SIZE) {
+        fprintf(stderr, "Invalid map spec '%s'\n", spec);
+        return false;
+    }
+    
+    // Swap the built-in grid for a generated one, keeping the wall images
+    UnloadMapGrid(map);
+    if (!InitMapGrid(map, size, size)) return false;
+    
+    if (strncmp(spec, "maze", 4) == 0) {
+        GenerateMaze(map, 12345u);
+    } else if (strncmp(spec, "pillars", 7) == 0) {
+        GeneratePillars(map, 12345u);
+    } else {
+        fprintf(stderr, "Unknown map generator '%s'\n", spec);
+        return false;
+    }
+    
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Camera paths
+//----------------------------------------------------------------------------------
+
+// First empty cell, scanning outward from the map centre
+static void FindStartCell(const Map* map, int* outX, int* outY) {
+    int cx = map->width / 2;
+    int cy = map->height / 2;
+    int maxRadius = (map->width > map->height) ? map->width : map->height;
+    
+    for (int r = 0; r < maxRadius; r++) {
+        for (int y = cy - r; y <= cy + r; y++) {
+            for (int x = cx - r; x <= cx + r; x++) {
+                if (GetMapTile(map, x, y) == TILE_EMPTY) {
+                    *outX = x;
+                    *outY = y;
+                    return;
+                }
+            }
+        }
+    }
+    
+    *outX = 1;
+    *outY = 1;
+}
+
+static void BuildCameraPath(const Map* map, CameraPathType type, int frames, CameraPose* poses) {
+    int startX, startY;
+    FindStartCell(map, &startX, &startY);
+    
+    if (type == CAMERA_PATH_SPIN) {
+        for (int f = 0; f < frames; f++) {
+            poses[f] = (CameraPose){ startX + 0.5f, startY + 0.5f, 2.0f * PI * f / frames };
+        }
+        return;
+    }
+    
+    // Walk cell centre to cell centre at 0.125 tiles per frame, carrying on
+    // straight while possible and picking a random open turn otherwise
+    static const int DIRS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    unsigned int seed = 777u;
+    int cellX = startX, cellY = startY;
+    int dir = 0;
+    float progress = 0.0f;
+    
+    for (int f = 0; f < frames; f++) {
+        if (progress >= 1.0f || f == 0) {
+            if (f > 0) {
+                cellX += DIRS[dir][0];
+                cellY += DIRS[dir][1];
+            }
+            progress = 0.0f;
+            
+            if (GetMapTile(map, cellX + DIRS[dir][0], cellY + DIRS[dir][1]) != TILE_EMPTY || NextRandom(&seed) % 8 == 0) {
+                int options[4];
+                int optionCount = 0;
+                for (int d = 0; d < 4; d++) {
+                    if (GetMapTile(map, cellX + DIRS[d][0], cellY + DIRS[d][1]) == TILE_EMPTY) options[optionCount++] = d;
+                }
+                if (optionCount > 0) dir = options[NextRandom(&seed) % optionCount];
+            }
+        }
+        
+        bool canMove = GetMapTile(map, cellX + DIRS[dir][0], cellY + DIRS[dir][1]) == TILE_EMPTY;
+        float t = canMove ? progress : 0.0f;
+        poses[f] = (CameraPose){
+            cellX + 0.5f + DIRS[dir][0] * t,
+            cellY + 0.5f + DIRS[dir][1] * t,
+            atan2f((float)DIRS[dir][1], (float)DIRS[dir][0]) + 0.3f * sinf(f * 0.05f)
+        };
+        progress += 0.125f;
+    }
+}
+
+static void ApplyCameraPose(Player* player, CameraPose pose) {
+    player->position = (Vector2){ pose.x * TILE_SIZE, pose.y * TILE_SIZE };
+    player->angle = pose.angle;
+    player->direction = (Vector2){ cosf(pose.angle), sinf(pose.angle) };
+    player->plane = (Vector2){ -player->direction.y * FIELD_OF_VIEW_PLANE, player->direction.x * FIELD_OF_VIEW_PLANE };
+}
+
+//----------------------------------------------------------------------------------
+// Measurement
+//----------------------------------------------------------------------------------
+
+static int CompareU64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double Percentile(const uint64_t* sorted, int count, double p) {
+    int index = (int)ceil(p * count) - 1;
+    if (index < 0) index = 0;
+    if (index >= count) index = count - 1;
+    return sorted[index] / 1e6;
+}
+
+// Renders one frame: walls, then sprites if the case has any
+static void RenderBenchFrame(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables,
+                             const SpriteList* sprites, const Image* spriteImages, SpriteView* view, WorkerPool* pool) {
+    RenderWorldSoftware(fb, player, map, tables, pool);
+    
+    if (sprites->activeCount > 0) {
+        GatherVisibleSprites(view, sprites, map, player, fb->width, fb->height);
+        DrawSpritesSoftware(fb, view, sprites, spriteImages, pool);
+    }
+}
+
+static void RunCase(FILE* out, bool* firstResult, const Map* map, const char* mapName, CameraPathType pathType,
+                    const CameraPose* poses, const BenchOptions* options, BenchResolution res, WorkerPool* pool,
+                    const ShadeTables* tables, const SpriteList* sprites, const Image* spriteImages) {
+    Framebuffer fb;
+    if (!InitFramebuffer(&fb, res.width, res.height)) return;
+    
+    SpriteView view = { 0 };
+    long long spritesDrawn = 0;
+    
+    Player player = { 0 };
+    uint64_t* frameNs = (uint64_t*)malloc((size_t)options->frames * sizeof(uint64_t));
+    
+    // Warm caches and wake the worker threads
+    for (int f = 0; f < options->warmup; f++) {
+        ApplyCameraPose(&player, poses[f % options->frames]);
+        RenderBenchFrame(&fb, &player, map, tables, sprites, spriteImages, &view, pool);
+    }
+    
+    uint64_t totalNs = 0;
+    for (int f = 0; f < options->frames; f++) {
+        ApplyCameraPose(&player, poses[f]);
+        
+        uint64_t start = GetTimestampNs();
+        RenderBenchFrame(&fb, &player, map, tables, sprites, spriteImages, &view, pool);
+        frameNs[f] = GetTimestampNs() - start;
+        spritesDrawn += view.count;
+        totalNs += frameNs[f];
+    }
+    
+    qsort(frameNs, options->frames, sizeof(uint64_t), CompareU64);
+    
+    double seconds = totalNs / 1e9;
+    double columns = (double)options->frames * res.width;
+    
+    fprintf(out, "%s\n    {\"map\": \"%s\", \"map_width\": %d, \"map_height\": %d, \"path\": \"%s\", "
+                 "\"width\": %d, \"height\": %d, \"threads\": %d, \"frames\": %d, \"flats\": \"%s\", "
+                 "\"sprites\": %d, \"sprites_drawn_mean\": %.1f, "
+                 "\"ns_per_column\": %.2f, \"rays_per_second\": %.0f, \"frames_per_second\": %.2f, "
+                 "\"frame_ms_mean\": %.4f, \"frame_ms_p50\": %.4f, \"frame_ms_p99\": %.4f}",
+            *firstResult ? "" : ",", mapName, map->width, map->height, CAMERA_PATH_NAMES[pathType],
+            res.width, res.height, pool->threadCount, options->frames, options->texturedFlats ? "textured" : "flat",
+            sprites->activeCount, (double)spritesDrawn / options->frames,
+            totalNs / columns, columns / seconds, options->frames / seconds,
+            totalNs / 1e6 / options->frames, Percentile(frameNs, options->frames, 0.50), Percentile(frameNs, options->frames, 0.99));
+    fflush(out);
+    *firstResult = false;
+    
+    fprintf(stderr, "%-14s %-5s %4dx%-4d %2d threads: %8.3f ms p50, %8.3f ms p99\n", mapName, CAMERA_PATH_NAMES[pathType],
+            res.width, res.height, pool->threadCount,
+            Percentile(frameNs, options->frames, 0.50), Percentile(frameNs, options->frames, 0.99));
+    
+    free(frameNs);
+    UnloadSpriteView(&view);
+    UnloadFramebuffer(&fb);
+}
+
+// Moves options->entities circles for options->frames ticks at walking and
+// running speeds with random turns; every tenth tick is a long dash so the
+// multi-tile sweep path is exercised too
+static void RunCollisionCase(FILE* out, bool* firstResult, const Map* map, const char* mapName, const BenchOptions* options) {
+    typedef struct Mover {
+        Vector2 position;
+        float angle;
+    } Mover;
+    
+    int count = options->entities;
+    Mover* movers = (Mover*)malloc((size_t)count * sizeof(Mover));
+    float radius = PLAYER_COLLISION_RADIUS * TILE_SIZE;
+    unsigned int seed = 4242u;
+    
+    // Spawn on random empty cells
+    for (int i = 0; i < count; i++) {
+        int x, y, attempts = 0;
+        do {
+            x = NextRandom(&seed) % map->width;
+            y = NextRandom(&seed) % map->height;
+        } while (GetMapTile(map, x, y) != TILE_EMPTY && ++attempts < 1000);
+        movers[i] = (Mover){ { (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE }, (NextRandom(&seed) % 628) / 100.0f };
+    }
+    
+    long long moves = 0;
+    long long contacts = 0;
+    uint64_t start = GetTimestampNs();
+    
+    for (int f = 0; f < options->frames; f++) {
+        float speed = (f % 10 == 9) ? 3.0f * TILE_SIZE : PLAYER_MOVE_SPEED * TILE_SIZE / 60.0f;
+        
+        for (int i = 0; i < count; i++) {
+            Mover* mover = &movers[i];
+            Vector2 delta = { cosf(mover->angle) * speed, sinf(mover->angle) * speed };
+            
+            CollisionHit hit;
+            mover->position = SlideCircle(map, mover->position, delta, radius, &hit);
+            moves++;
+            
+            // Turn away from walls, wander a little otherwise
+            if (hit.hit) {
+                contacts++;
+                mover->angle = atan2f(hit.normal.y, hit.normal.x) + ((NextRandom(&seed) % 200) - 100) / 100.0f;
+            } else {
+                mover->angle += ((NextRandom(&seed) % 100) - 50) / 1000.0f;
+            }
+        }
+    }
+    
+    double seconds = (GetTimestampNs() - start) / 1e9;
+    
+    fprintf(out, "%s\n    {\"map\": \"%s\", \"map_width\": %d, \"map_height\": %d, \"mode\": \"collision\", "
+                 "\"entities\": %d, \"ticks\": %d, \"ns_per_move\": %.2f, \"moves_per_second\": %.0f, "
+                 "\"contact_ratio\": %.4f}",
+            *firstResult ? "" : ",", mapName, map->width, map->height, count, options->frames,
+            seconds * 1e9 / moves, moves / seconds, (double)contacts / moves);
+    fflush(out);
+    *firstResult = false;
+    
+    fprintf(stderr, "%-14s collision %6d entities: %8.2f ns/move, %5.1f%% contacts\n", mapName, count,
+            seconds * 1e9 / moves, 100.0 * contacts / moves);
+    
+    free(movers);
+}
+
+// Random open orthogonal neighbour of a tile, or the tile itself when boxed in
+static void StepGoal(const Map* map, int* x, int* y, unsigned int* seed) {
+    static const int STEPS[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    int first = NextRandom(seed) % 4;
+    
+    for (int i = 0; i < 4; i++) {
+        int s = (first + i) % 4;
+        if (!IsMapCellBlocking(map, *x + STEPS[s][0], *y + STEPS[s][1])) {
+            *x += STEPS[s][0];
+            *y += STEPS[s][1];
+            return;
+        }
+    }
+}
+
+// One shared flow field toward a goal that wanders through the map:
+// - a full search in one go, and the average and slowest update while
+//   UpdateFlowField spreads that search over ticks
+// - the local repair when a doorway (a wall between two open tiles) opens or closes
+// - the per-agent cost of following the field, for crowds growing by 4x up to options->entities
+static void RunFlowFieldCase(FILE* out, bool* firstResult, Map* map, const char* mapName, const BenchOptions* options) {
+    FlowField field;
+    if (!InitFlowField(&field, map->width, map->height, FLOW_FIELD_DEFAULT_RANGE)) return;
+    
+    int goalX, goalY;
+    FindStartCell(map, &goalX, &goalY);
+    unsigned int seed = 777u;
+    
+    // Full searches along a random walk
+    long long reached = 0;
+    uint64_t rebuildNs = 0;
+    for (int f = 0; f < options->frames; f++) {
+        StepGoal(map, &goalX, &goalY, &seed);
+        field.goalX = goalX;
+        field.goalY = goalY;
+        uint64_t start = GetTimestampNs();
+        RebuildFlowField(&field, map);
+        rebuildNs += GetTimestampNs() - start;
+        reached += field.tilesTouched;
+    }
+    
+    // The same walk at a tile every 20 ticks, the new searches spread over
+    // ticks: the average and the worst of the updates that did search work
+    UpdateFlowField(&field, map, goalX, goalY);
+    uint64_t updateNs = 0, updateMaxNs = 0;
+    int searchUpdates = 0;
+    for (int f = 0; f < options->frames * 20; f++) {
+        if (f % 20 == 0) StepGoal(map, &goalX, &goalY, &seed);
+        uint64_t start = GetTimestampNs();
+        UpdateFlowField(&field, map, goalX, goalY);
+        uint64_t ns = GetTimestampNs() - start;
+        if (field.tilesTouched == 0) continue;
+        updateNs += ns;
+        searchUpdates++;
+        if (ns > updateMaxNs) updateMaxNs = ns;
+    }
+    double updateMs = searchUpdates ? updateNs / 1e6 / searchUpdates : 0.0;
+    while (field.goalX != goalX || field.goalY != goalY) {
+        UpdateFlowField(&field, map, goalX, goalY);
+    }
+    
+    // Doorways in range of the goal, toggled open and shut again
+    int* doorways = (int*)malloc((size_t)map->width * map->height * sizeof(int));
+    int doorwayCount = 0;
+    for (int y = 1; y < map->height - 1; y++) {
+        for (int x = 1; x < map->width - 1; x++) {
+            if (GetMapTile(map, x, y) != TILE_WALL) continue;
+            bool acrossX = GetFlowDistance(&field, x - 1, y) != FLOW_DISTANCE_UNREACHED && !IsMapCellBlocking(map, x + 1, y);
+            bool acrossY = GetFlowDistance(&field, x, y - 1) != FLOW_DISTANCE_UNREACHED && !IsMapCellBlocking(map, x, y + 1);
+            if (acrossX || acrossY) doorways[doorwayCount++] = y * map->width + x;
+        }
+    }
+    
+    long long repairTouched = 0;
+    int repairs = 0, fallbacks = 0;
+    uint64_t openNs = 0, closeNs = 0;
+    for (int f = 0; f < options->frames && doorwayCount > 0; f++) {
+        int door = doorways[NextRandom(&seed) % doorwayCount];
+        
+        SetMapTile(map, door % map->width, door / map->width, TILE_EMPTY);
+        uint64_t start = GetTimestampNs();
+        UpdateFlowField(&field, map, goalX, goalY);
+        openNs += GetTimestampNs() - start;
+        repairTouched += field.tilesTouched;
+        fallbacks += field.rebuilt;
+        
+        SetMapTile(map, door % map->width, door / map->width, TILE_WALL);
+        start = GetTimestampNs();
+        UpdateFlowField(&field, map, goalX, goalY);
+        closeNs += GetTimestampNs() - start;
+        repairTouched += field.tilesTouched;
+        fallbacks += field.rebuilt;
+        repairs += 2;
+    }
+    free(doorways);
+    
+    double rebuildMs = rebuildNs / 1e6 / options->frames;
+    double openMs = repairs ? openNs / 1e6 / (repairs / 2) : 0.0;
+    double closeMs = repairs ? closeNs / 1e6 / (repairs / 2) : 0.0;
+    
+    fprintf(stderr, "%-14s flowfield: search %.3f ms (%lld tiles), updates %.3f ms (worst %.3f), door open %.4f ms, close %.4f ms "
+            "(%.0f tiles, %d fallbacks)\n", mapName, rebuildMs, reached / options->frames, updateMs, updateMaxNs / 1e6, openMs, closeMs,
+            repairs ? (double)repairTouched / repairs : 0.0, fallbacks);
+    
+    // Crowds chasing the wandering goal, which changes tile every 20 ticks
+    // like a walking player at 60 ticks per second
+    int count = (options->entities < 64) ? options->entities : 64;
+    for (;;) {
+        SpriteList sprites;
+        EnemyList enemies;
+        InitSpriteList(&sprites, map->width, map->height);
+        InitEnemyList(&enemies);
+        
+        unsigned int spawnSeed = 4242u;
+        for (int i = 0, attempts = 0; i < count && attempts < count * 1000; attempts++) {
+            int x = NextRandom(&spawnSeed) % map->width;
+            int y = NextRandom(&spawnSeed) % map->height;
+            if (IsMapCellBlocking(map, x, y)) continue;
+            int enemy = AddEnemy(&enemies, &sprites, (Vector2){ (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE });
+            if (enemy >= 0) enemies.enemies[enemy].alerted = true;
+            i++;
+        }
+        
+        uint64_t fieldNs = 0, agentNs = 0;
+        for (int f = 0; f < options->frames; f++) {
+            if (f % 20 == 0) StepGoal(map, &goalX, &goalY, &seed);
+            
+            uint64_t start = GetTimestampNs();
+            UpdateFlowField(&field, map, goalX, goalY);
+            uint64_t mid = GetTimestampNs();
+            UpdateEnemies(&enemies, &sprites, &field, map, 1.0f / 60.0f);
+            agentNs += GetTimestampNs() - mid;
+            fieldNs += mid - start;
+        }
+        
+        double nsPerAgent = (double)agentNs / options->frames / enemies.count;
+        double tickMs = (fieldNs + agentNs) / 1e6 / options->frames;
+        
+        fprintf(out, "%s\n    {\"map\": \"%s\", \"map_width\": %d, \"map_height\": %d, \"mode\": \"flowfield\", "
+                     "\"range\": %d, \"agents\": %d, \"ticks\": %d, \"search_ms\": %.4f, \"search_tiles\": %lld, "
+                     "\"update_ms\": %.4f, \"update_max_ms\": %.4f, "
+                     "\"door_open_ms\": %.4f, \"door_close_ms\": %.4f, \"repair_tiles\": %.1f, \"repair_fallbacks\": %d, "
+                     "\"ns_per_agent\": %.2f, \"tick_ms\": %.4f}",
+                *firstResult ? "" : ",", mapName, map->width, map->height, field.range, enemies.count, options->frames,
+                rebuildMs, reached / options->frames, updateMs, updateMaxNs / 1e6, openMs, closeMs, repairs ? (double)repairTouched / repairs : 0.0,
+                fallbacks, nsPerAgent, tickMs);
+        fflush(out);
+        *firstResult = false;
+        
+        fprintf(stderr, "%-14s flowfield %6d agents: %7.2f ns/agent, %.4f ms/tick including the field\n", mapName,
+                enemies.count, nsPerAgent, tickMs);
+        
+        UnloadEnemyList(&enemies, NULL);
+        UnloadSpriteList(&sprites);
+        
+        if (count == options->entities) break;
+        count = (count * 4 < options->entities) ? count * 4 : options->entities;
+    }
+    
+    UnloadFlowField(&field);
+}
+
+// Plain tile DDA over the whole segment, without the block pass: the
+// baseline the batched queries are compared against
+static bool PlainLineOfSight(const Map* map, Vector2 from, Vector2 to) {
+    float ax = from.x / TILE_SIZE;
+    float ay = from.y / TILE_SIZE;
+    int endX = (int)floorf(to.x / TILE_SIZE);
+    int endY = (int)floorf(to.y / TILE_SIZE);
+    if ((int)ax == endX && (int)ay == endY) return true;
+    
+    float dx = to.x / TILE_SIZE - ax;
+    float dy = to.y / TILE_SIZE - ay;
+    float length = sqrtf(dx * dx + dy * dy);
+    GridRay ray;
+    InitGridRay(&ray, ax, ay, dx / length, dy / length);
+    
+    for (;;) {
+        if (GetGridRayExit(&ray) >= length) return true;
+        StepGridRay(&ray);
+        if (ray.mapX == endX && ray.mapY == endY) return true;
+        if (IsMapCellSolid(map, ray.mapX, ray.mapY)) return false;
+    }
+}
+
+// options->entities agents on random open tiles check their line of sight to
+// a player walking the camera path, one batch per frame. Returns false if the
+// answers disagree with the baseline, or the default kernel is slower than it.
+static bool RunLOSCase(FILE* out, bool* firstResult, const Map* map, const char* mapName, const CameraPose* poses,
+                       const BenchOptions* options, WorkerPool* pool, LOSKernel kernel) {
+    int count = options->entities;
+    LOSQuery* queries = (LOSQuery*)malloc((size_t)count * sizeof(LOSQuery));
+    bool* visible = (bool*)malloc((size_t)count * sizeof(bool));
+    uint64_t* batchNs = (uint64_t*)malloc((size_t)options->frames * sizeof(uint64_t));
+    
+    unsigned int seed = 4242u;
+    for (int i = 0; i < count; i++) {
+        int x, y, attempts = 0;
+        do {
+            x = NextRandom(&seed) % map->width;
+            y = NextRandom(&seed) % map->height;
+        } while (GetMapTile(map, x, y) != TILE_EMPTY && ++attempts < 1000);
+        queries[i].from = (Vector2){ (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE };
+    }
+    
+    // Warm caches and wake the worker threads
+    for (int f = 0; f < options->warmup; f++) {
+        CheckLineOfSight(map, queries, count, visible, kernel, pool, NULL);
+    }
+    
+    LOSStats stats, totals = { 0 };
+    uint64_t totalNs = 0, baselineNs = 0;
+    long long disagreements = 0;
+    for (int f = 0; f < options->frames; f++) {
+        Vector2 player = { poses[f].x * TILE_SIZE, poses[f].y * TILE_SIZE };
+        for (int i = 0; i < count; i++) {
+            queries[i].to = player;
+        }
+        
+        uint64_t start = GetTimestampNs();
+        CheckLineOfSight(map, queries, count, visible, kernel, pool, &stats);
+        batchNs[f] = GetTimestampNs() - start;
+        totalNs += batchNs[f];
+        
+        totals.visible += stats.visible;
+        
+        // Single-threaded baseline, which the batched answers have to match
+        start = GetTimestampNs();
+        for (int i = 0; i < count; i++) {
+            disagreements += PlainLineOfSight(map, queries[i].from, queries[i].to) != visible[i];
+        }
+        baselineNs += GetTimestampNs() - start;
+    }
+    
+    qsort(batchNs, options->frames, sizeof(uint64_t), CompareU64);
+    double queriesTotal = (double)count * options->frames;
+    
+    fprintf(out, "%s\n    {\"map\": \"%s\", \"map_width\": %d, \"map_height\": %d, \"mode\": \"los\", "
+                 "\"threads\": %d, \"kernel\": \"%s\", \"queries\": %d, \"batches\": %d, "
+                 "\"batch_ms_mean\": %.4f, \"batch_ms_p50\": %.4f, \"batch_ms_p99\": %.4f, \"ns_per_query\": %.2f, "
+                 "\"baseline_ns_per_query\": %.2f, \"baseline_speedup\": %.3f, \"visible_ratio\": %.4f, "
+                 "\"baseline_disagreements\": %lld}",
+            *firstResult ? "" : ",", mapName, map->width, map->height, pool->threadCount, GetLOSKernelName(kernel),
+            count, options->frames, totalNs / 1e6 / options->frames, Percentile(batchNs, options->frames, 0.50),
+            Percentile(batchNs, options->frames, 0.99), totalNs / queriesTotal, baselineNs / queriesTotal,
+            (double)baselineNs / totalNs, totals.visible / queriesTotal, disagreements);
+    fflush(out);
+    *firstResult = false;
+    
+    fprintf(stderr, "%-14s los %-6s %2d threads %6d queries: %8.3f ms p50 (%6.1f ns/query, baseline %6.1f, %.2fx)\n",
+            mapName, GetLOSKernelName(kernel), pool->threadCount, count, Percentile(batchNs, options->frames, 0.50),
+            totalNs / queriesTotal, baselineNs / queriesTotal, (double)baselineNs / totalNs);
+    
+    bool passed = disagreements == 0;
+    if (!passed) {
+        fprintf(stderr, "%s: %s los kernel disagrees with the baseline %lld times\n", mapName, GetLOSKernelName(kernel),
+                disagreements);
+    }
+    if (kernel == GetBestLOSKernel() && totalNs >= baselineNs) {
+        fprintf(stderr, "%s: %s los kernel is slower than the baseline\n", mapName, GetLOSKernelName(kernel));
+        passed = false;
+    }
+    
+    free(batchNs);
+    free(visible);
+    free(queries);
+    return passed;
+}
+
+// Stand-ins for the GPU path's shaders, textures and floor planes; the
+// recording backend only looks at ids, locations and triangle counts
+typedef struct BenchGPUScene {
+    int wallLocs[32];
+    int flatLocs[32];
+    MaterialMap wallMap;
+    MaterialMap floorMap;
+    MaterialMap ceilingMap;
+    Material wallMaterial;
+    Material floorMaterial;
+    Material ceilingMaterial;
+    Mesh floorMesh;
+    Mesh ceilingMesh;
+} BenchGPUScene;
+
+// Uniform locations past the standard ones, as GetShaderLocation might hand them out
+enum { BENCH_LOC_WALL_HEIGHT = SHADER_LOC_MAP_EMISSION + 1, BENCH_LOC_FOG, BENCH_LOC_DARKNESS,
+       BENCH_LOC_CAMERA, BENCH_LOC_IS_CEILING, BENCH_LOC_TEXTURE_SCALE, BENCH_LOC_MIN_LIGHT,
+       BENCH_LOC_FOG_COLOR, BENCH_LOC_FLOOR_FOG_COLOR };
+
+static void InitBenchGPUScene(BenchGPUScene* scene) {
+    memset(scene, 0, sizeof(*scene));
+    for (int i = 0; i < 32; i++) {
+        scene->wallLocs[i] = (i <= SHADER_LOC_MAP_EMISSION) ? i : -1;
+        scene->flatLocs[i] = (i <= SHADER_LOC_MAP_EMISSION) ? i : -1;
+    }
+    
+    // Texture ids: 1 is raylib's default white texture, 2 the wall atlas
+    scene->wallMap = (MaterialMap){ .texture = { .id = 2 }, .color = WHITE };
+    scene->floorMap = (MaterialMap){ .texture = { .id = 0 }, .color = WHITE };
+    scene->ceilingMap = (MaterialMap){ .texture = { .id = 1 }, .color = WHITE };
+    scene->wallMaterial = (Material){ .shader = { 1, scene->wallLocs }, .maps = &scene->wallMap };
+    scene->floorMaterial = (Material){ .shader = { 2, scene->flatLocs }, .maps = &scene->floorMap };
+    scene->ceilingMaterial = (Material){ .shader = { 2, scene->flatLocs }, .maps = &scene->ceilingMap };
+    
+    // GenMeshPlane(100, 100, 10, 10)
+    scene->floorMesh = (Mesh){ .vertexCount = 121, .triangleCount = 200 };
+    scene->ceilingMesh = scene->floorMesh;
+}
+
+// The same draws and uniforms RenderWorldGPU queues for a frame
+static void BuildBenchDrawList(DrawList* list, const BenchGPUScene* scene, const Map* map, const WallMesh* walls,
+                               WallMeshGroup* doors, const unsigned char* chunkVisible, const Player* player) {
+    ClearDrawList(list);
+    
+    Shader wallShader = scene->wallMaterial.shader;
+    Shader flatShader = scene->floorMaterial.shader;
+    float cameraPos[3] = { player->position.x, 0.5f, player->position.y };
+    Vector3 skyFog = SHADE_SKY_FOG;
+    Vector3 floorFog = SHADE_FLOOR_FOG;
+    SetDrawListUniform(list, wallShader, BENCH_LOC_WALL_HEIGHT, (float[1]){ 1.0f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, wallShader, BENCH_LOC_FOG, (float[1]){ SHADE_FOG_DENSITY }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, wallShader, BENCH_LOC_DARKNESS, (float[1]){ SHADE_WALL_DARKNESS }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, wallShader, BENCH_LOC_MIN_LIGHT, (float[1]){ SHADE_MIN_LIGHT }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, wallShader, BENCH_LOC_FOG_COLOR, &skyFog, SHADER_UNIFORM_VEC3);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_CAMERA, cameraPos, SHADER_UNIFORM_VEC3);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_TEXTURE_SCALE, (float[1]){ 0.1f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_FOG, (float[1]){ SHADE_FOG_DENSITY }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_DARKNESS, (float[1]){ SHADE_FLAT_DARKNESS }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_MIN_LIGHT, (float[1]){ SHADE_MIN_LIGHT }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_FOG_COLOR, &skyFog, SHADER_UNIFORM_VEC3);
+    SetDrawListUniform(list, flatShader, BENCH_LOC_FLOOR_FOG_COLOR, &floorFog, SHADER_UNIFORM_VEC3);
+    
+    Matrix floorTransform = MatrixTranslate(player->position.x, 0.0f, player->position.y);
+    DrawItem* floorDraw = AddDrawListMesh(list, &scene->floorMesh, scene->floorMaterial, floorTransform);
+    if (floorDraw != NULL) SetDrawItemUniform(floorDraw, BENCH_LOC_IS_CEILING, (int[1]){ 0 }, SHADER_UNIFORM_INT);
+    
+    Matrix ceilingTransform = MatrixTranslate(player->position.x, 1.0f, player->position.y);
+    DrawItem* ceilingDraw = AddDrawListMesh(list, &scene->ceilingMesh, scene->ceilingMaterial, ceilingTransform);
+    if (ceilingDraw != NULL) SetDrawItemUniform(ceilingDraw, BENCH_LOC_IS_CEILING, (int[1]){ 1 }, SHADER_UNIFORM_INT);
+    
+    AddWallMeshDraws(list, walls, scene->wallMaterial, scene->wallMap.texture, chunkVisible);
+    if (map->activeDoorCount > 0) {
+        BuildDoorMesh(doors, map, walls, chunkVisible);
+        if (doors->faceCount > 0) AddDrawListMesh(list, &doors->mesh, scene->wallMaterial, MatrixIdentity());
+    }
+}
+
+// Opens (or closes) every door within a few tiles of the camera
+static void ToggleNearbyDoors(Map* map, const Player* player) {
+    int playerX = (int)(player->position.x / TILE_SIZE);
+    int playerY = (int)(player->position.y / TILE_SIZE);
+    
+    for (int y = playerY - 4; y <= playerY + 4; y++) {
+        for (int x = playerX - 4; x <= playerX + 4; x++) {
+            if (IsDoor(map, x, y)) ToggleDoor(map, x, y);
+        }
+    }
+}
+
+// Walks the camera path, building the frame's draw list and submitting it to
+// a recorder both batched and unbatched, and times building plus the batched
+// submission
+static void RunDrawListCase(FILE* out, bool* firstResult, Map* map, const char* mapName, const CameraPose* poses,
+                            const BenchOptions* options) {
+    WallMesh walls;
+    WallMeshGroup doors;
+    if (!InitWallMesh(&walls, map, WALL_MESH_DEFAULT_RADIUS, false)) return;
+    if (!InitDoorMesh(&doors, false)) {
+        UnloadWallMesh(&walls);
+        return;
+    }
+    
+    BenchGPUScene scene;
+    InitBenchGPUScene(&scene);
+    unsigned char* chunkVisible = (unsigned char*)malloc((size_t)walls.chunksX * walls.chunksY);
+    
+    DrawList batched, unbatched;
+    InitDrawList(&batched, 32);
+    InitDrawList(&unbatched, 32);
+    unbatched.batch = false;
+    
+    DrawRecorder batchedCalls = { 0 }, unbatchedCalls = { 0 };
+    DrawBackend batchedBackend = GetRecordingDrawBackend(&batchedCalls);
+    DrawBackend unbatchedBackend = GetRecordingDrawBackend(&unbatchedCalls);
+    DrawStats totals = { 0 };
+    long long doorFrames = 0;
+    uint64_t totalNs = 0;
+    
+    Player player = { 0 };
+    for (int f = 0; f < options->frames; f++) {
+        ApplyCameraPose(&player, poses[f]);
+        if (f % BENCH_DOOR_PERIOD == 0) ToggleNearbyDoors(map, &player);
+        UpdateMap(map, 1.0f / 60.0f);
+        SetWallMeshFocus(&walls, (int)poses[f].x, (int)poses[f].y);
+        UpdateWallMesh(&walls, map);
+        GetVisibleWallChunks(&walls, map, (int)poses[f].x, (int)poses[f].y, BENCH_WALL_CHUNK_RADIUS, chunkVisible);
+        doorFrames += map->activeDoorCount > 0;
+        
+        uint64_t start = GetTimestampNs();
+        BuildBenchDrawList(&batched, &scene, map, &walls, &doors, chunkVisible, &player);
+        SubmitDrawList(&batched, &batchedBackend);
+        totalNs += GetTimestampNs() - start;
+        
+        totals.draws += batched.stats.draws;
+        totals.batches += batched.stats.batches;
+        totals.uniformsSkipped += batched.stats.uniformsSkipped;
+        
+        BuildBenchDrawList(&unbatched, &scene, map, &walls, &doors, chunkVisible, &player);
+        SubmitDrawList(&unbatched, &unbatchedBackend);
+    }
+    
+    double frames = options->frames;
+    double batchedChanges = (batchedCalls.shaderBinds + batchedCalls.textureBinds + batchedCalls.uniformUploads) / frames;
+    double unbatchedChanges = (unbatchedCalls.shaderBinds + unbatchedCalls.textureBinds + unbatchedCalls.uniformUploads) / frames;
+    
+    fprintf(out, "%s\n    {\"map\": \"%s\", \"map_width\": %d, \"map_height\": %d, \"mode\": \"drawlist\", "
+                 "\"frames\": %d, \"door_frames\": %lld, \"draws_per_frame\": %.2f, \"batches_per_frame\": %.2f, "
+                 "\"shader_binds_per_frame\": %.2f, \"texture_binds_per_frame\": %.2f, \"uniform_uploads_per_frame\": %.2f, "
+                 "\"uniforms_skipped_per_frame\": %.2f, \"redundant_binds\": %d, "
+                 "\"unbatched_shader_binds_per_frame\": %.2f, \"unbatched_texture_binds_per_frame\": %.2f, "
+                 "\"unbatched_uniform_uploads_per_frame\": %.2f, \"state_changes_per_frame\": %.2f, "
+                 "\"unbatched_state_changes_per_frame\": %.2f, \"build_submit_us_per_frame\": %.3f}",
+            *firstResult ? "" : ",", mapName, map->width, map->height, options->frames, doorFrames,
+            totals.draws / frames, totals.batches / frames, batchedCalls.shaderBinds / frames,
+            batchedCalls.textureBinds / frames, batchedCalls.uniformUploads / frames, totals.uniformsSkipped / frames,
+            batchedCalls.redundantBinds, unbatchedCalls.shaderBinds / frames, unbatchedCalls.textureBinds / frames,
+            unbatchedCalls.uniformUploads / frames, batchedChanges, unbatchedChanges, totalNs / 1e3 / frames);
+    fflush(out);
+    *firstResult = false;
+    
+    fprintf(stderr, "%-14s drawlist: %.1f draws in %.1f batches, %.1f state changes per frame (%.1f unbatched), %.2f us\n",
+            mapName, totals.draws / frames, totals.batches / frames, batchedChanges, unbatchedChanges, totalNs / 1e3 / frames);
+    
+    UnloadDrawList(&unbatched);
+    UnloadDrawList(&batched);
+    free(chunkVisible);
+    UnloadDoorMesh(&doors);
+    UnloadWallMesh(&walls);
+}
+
+//----------------------------------------------------------------------------------
+// Command line
+//----------------------------------------------------------------------------------
+
+// Split a comma separated list into fixed-size string slots
+static int SplitList(const char* list, char items[][MAX_BENCH_ITEM_LENGTH], int maxItems) {
+    int count = 0;
+    const char* start = list;
+    
+    while (*start && count < maxItems) {
+        const char* end = strchr(start, ',');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        if (length > MAX_BENCH_ITEM_LENGTH - 1) length = MAX_BENCH_ITEM_LENGTH - 1;
+        memcpy(items[count], start, length);
+        items[count][length] = '\0';
+        count++;
+        if (!end) break;
+        start = end + 1;
+    }
+    
+    return count;
+}
+
+static void SetDefaultOptions(BenchOptions* options) {
+    memset(options, 0, sizeof(*options));
+    
+    options->mapCount = SplitList("builtin,maze:255,pillars:1024", options->maps, MAX_BENCH_ITEMS);
+    
+    static const BenchResolution DEFAULT_RESOLUTIONS[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    options->resolutionCount = 4;
+    memcpy(options->resolutions, DEFAULT_RESOLUTIONS, sizeof(DEFAULT_RESOLUTIONS));
+    
+    // Powers of two up to the core count, plus the core count itself
+    int cores = GetCPUCoreCount();
+    for (int t = 1; t < cores && options->threadCount < MAX_BENCH_ITEMS - 1; t *= 2) {
+        options->threads[options->threadCount++] = t;
+    }
+    options->threads[options->threadCount++] = cores;
+    
+    options->frames = 120;
+    options->warmup = 10;
+    options->sprites = 0;
+    options->texturedFlats = true;
+    options->entities = 4096;
+    options->outPath = NULL;
+}
+
+static bool ParseOptions(BenchOptions* options, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        char items[MAX_BENCH_ITEMS][MAX_BENCH_ITEM_LENGTH];
+        
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        
+        if (strcmp(arg, "--mode") == 0) {
+            if (strcmp(value, "raycast") == 0) {
+                options->mode = BENCH_MODE_RAYCAST;
+            } else if (strcmp(value, "collision") == 0) {
+                options->mode = BENCH_MODE_COLLISION;
+            } else if (strcmp(value, "flowfield") == 0) {
+                options->mode = BENCH_MODE_FLOWFIELD;
+            } else if (strcmp(value, "los") == 0) {
+                options->mode = BENCH_MODE_LOS;
+            } else if (strcmp(value, "drawlist") == 0) {
+                options->mode = BENCH_MODE_DRAWLIST;
+            } else {
+                fprintf(stderr, "Unknown mode '%s'\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--maps") == 0) {
+            options->mapCount = SplitList(value, options->maps, MAX_BENCH_ITEMS);
+        } else if (strcmp(arg, "--resolutions") == 0) {
+            int count = SplitList(value, items, MAX_BENCH_ITEMS);
+            options->resolutionCount = 0;
+            for (int j = 0; j < count; j++) {
+                BenchResolution res;
+                if (sscanf(items[j], "%dx%d", &res.width, &res.height) == 2 && res.width > 0 && res.height > 0) {
+                    options->resolutions[options->resolutionCount++] = res;
+                }
+            }
+        } else if (strcmp(arg, "--threads") == 0) {
+            int count = SplitList(value, items, MAX_BENCH_ITEMS);
+            options->threadCount = 0;
+            for (int j = 0; j < count; j++) {
+                int threads = atoi(items[j]);
+                options->threads[options->threadCount++] = (threads > 0) ? threads : GetCPUCoreCount();
+            }
+        } else if (strcmp(arg, "--frames") == 0) {
+            options->frames = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            options->warmup = atoi(value);
+        } else if (strcmp(arg, "--kernel") == 0) {
+            bool found = false;
+            for (int k = 0; k < RAY_KERNEL_COUNT; k++) {
+                if (strcmp(value, GetRayKernelName((RayKernel)k)) == 0) found = SetRayKernel((RayKernel)k);
+            }
+            if (!found) {
+                fprintf(stderr, "Ray kernel '%s' not available\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--sprites") == 0) {
+            options->sprites = atoi(value);
+        } else if (strcmp(arg, "--flats") == 0) {
+            if (strcmp(value, "textured") == 0) {
+                options->texturedFlats = true;
+            } else if (strcmp(value, "flat") == 0) {
+                options->texturedFlats = false;
+            } else {
+                fprintf(stderr, "Unknown flats '%s'\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--entities") == 0) {
+            options->entities = atoi(value);
+        } else if (strcmp(arg, "--out") == 0) {
+            options->outPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    
+    if (options->frames < 1) options->frames = 1;
+    if (options->warmup < 0) options->warmup = 0;
+    if (options->sprites < 0) options->sprites = 0;
+    if (options->entities < 1) options->entities = 1;
+    return options->mapCount > 0 && options->resolutionCount > 0 && options->threadCount > 0;
+}
+
+int main(int argc, char* argv[]) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    BenchOptions options;
+    SetDefaultOptions(&options);
+    if (!ParseOptions(&options, argc, argv)) return 1;
+    
+    FILE* out = stdout;
+    if (options.outPath != NULL) {
+        out = fopen(options.outPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Cannot open %s\n", options.outPath);
+            return 1;
+        }
+    }
+    
+    fprintf(out, "{\n  \"cpu_cores\": %d,\n  \"ray_kernel\": \"%s\",\n  \"results\": [",
+            GetCPUCoreCount(), GetRayKernelName(GetRayKernel()));
+    
+    bool firstResult = true;
+    bool losPassed = true;
+    CameraPose* poses = (CameraPose*)malloc((size_t)options.frames * sizeof(CameraPose));
+    
+    // Placeholder sprite images like the game's: a box on the floor
+    Image spriteImages[SPRITE_TEXTURE_COUNT];
+    for (int i = 0; i < SPRITE_TEXTURE_COUNT; i++) {
+        spriteImages[i] = GenImageColor(64, 64, BLANK);
+        ImageDrawRectangle(&spriteImages[i], 16, 32, 32, 32, ORANGE);
+    }
+    
+    // Floor and ceiling like the game's
+    Image floorImage = GenImageChecked(64, 64, 16, 16, DARKGRAY, GRAY);
+    Image ceilingImage = GenImageChecked(64, 64, 32, 32, SKYBLUE, BLUE);
+    FlatTextures flats = { &floorImage, &ceilingImage };
+    
+    for (int m = 0; m < options.mapCount; m++) {
+        Map map;
+        if (!LoadBenchMap(&map, options.maps[m])) {
+            UnloadMap(&map);
+            continue;
+        }
+        
+        // The PVS lets the sprite gather skip hidden tiles and culls wall chunks in drawlist mode
+        if ((options.sprites > 0 || options.mode == BENCH_MODE_DRAWLIST) && map.width * map.height <= BENCH_PVS_MAX_TILES) {
+            WorkerPool pvsPool;
+            InitWorkerPool(&pvsPool, 0);
+            BuildMapPVS(&map, &pvsPool);
+            UnloadWorkerPool(&pvsPool);
+        }
+        
+        // Sprites on random empty tiles
+        SpriteList sprites;
+        InitSpriteList(&sprites, map.width, map.height);
+        if (options.sprites > 0) {
+            unsigned int seed = 99u;
+            for (int placed = 0, attempts = 0; placed < options.sprites && attempts < options.sprites * 100; attempts++) {
+                int x = NextRandom(&seed) % map.width;
+                int y = NextRandom(&seed) % map.height;
+                if (GetMapTile(&map, x, y) != TILE_EMPTY) continue;
+                float offsetX = (NextRandom(&seed) % 1000) / 1000.0f;
+                float offsetY = (NextRandom(&seed) % 1000) / 1000.0f;
+                AddSprite(&sprites, (Vector2){ (x + offsetX) * TILE_SIZE, (y + offsetY) * TILE_SIZE }, placed % SPRITE_TEXTURE_COUNT, 0.6f);
+                placed++;
+            }
+        }
+        
+        if (options.mode == BENCH_MODE_COLLISION) {
+            RunCollisionCase(out, &firstResult, &map, options.maps[m], &options);
+            UnloadSpriteList(&sprites);
+            UnloadMap(&map);
+            continue;
+        }
+        
+        if (options.mode == BENCH_MODE_FLOWFIELD) {
+            RunFlowFieldCase(out, &firstResult, &map, options.maps[m], &options);
+            UnloadSpriteList(&sprites);
+            UnloadMap(&map);
+            continue;
+        }
+        
+        if (options.mode == BENCH_MODE_DRAWLIST) {
+            BuildCameraPath(&map, CAMERA_PATH_WALK, options.frames, poses);
+            RunDrawListCase(out, &firstResult, &map, options.maps[m], poses, &options);
+            UnloadSpriteList(&sprites);
+            UnloadMap(&map);
+            continue;
+        }
+        
+        ShadeTables tables;
+        if (!BuildShadeTables(&tables, map.wallImages, options.texturedFlats ? &flats : NULL)) {
+            UnloadSpriteList(&sprites);
+            UnloadMap(&map);
+            continue;
+        }
+        
+        for (int t = 0; t < options.threadCount; t++) {
+            WorkerPool pool;
+            InitWorkerPool(&pool, options.threads[t]);
+            
+            if (options.mode == BENCH_MODE_LOS) {
+                BuildCameraPath(&map, CAMERA_PATH_WALK, options.frames, poses);
+                for (int k = 0; k < LOS_KERNEL_COUNT; k++) {
+                    if (!IsLOSKernelSupported((LOSKernel)k)) continue;
+                    losPassed &= RunLOSCase(out, &firstResult, &map, options.maps[m], poses, &options, &pool, (LOSKernel)k);
+                }
+                UnloadWorkerPool(&pool);
+                continue;
+            }
+            
+            for (int p = 0; p < CAMERA_PATH_COUNT; p++) {
+                BuildCameraPath(&map, (CameraPathType)p, options.frames, poses);
+                
+                for (int r = 0; r < options.resolutionCount; r++) {
+                    RunCase(out, &firstResult, &map, options.maps[m], (CameraPathType)p, poses, &options, options.resolutions[r], &pool,
+                            &tables, &sprites, spriteImages);
+                }
+            }
+            
+            UnloadWorkerPool(&pool);
+        }
+        
+        UnloadShadeTables(&tables);
+        UnloadSpriteList(&sprites);
+        UnloadMap(&map);
+    }
+    
+    fprintf(out, "\n  ]\n}\n");
+    
+    for (int i = 0; i < SPRITE_TEXTURE_COUNT; i++) {
+        UnloadImage(spriteImages[i]);
+    }
+    UnloadImage(floorImage);
+    UnloadImage(ceilingImage);
+    free(poses);
+    if (out != stdout) fclose(out);
+    return losPassed ? 0 : 1;
+}
@@ -15,6 +15,9 @@ uniform vec4 colDiffuse;
 uniform vec3 cameraPosition;
 uniform float fogDensity;
 uniform float floorCeilingDarkness;
+uniform float minLight;     // Floor of the darkening
+uniform vec3 skyFogColor;   // Ceiling fog
+uniform vec3 floorFogColor;
 
 // Floor/ceiling specific uniforms
 uniform bool isCeiling;     // true for ceiling, false for floor
@@ -56,7 +59,7 @@ void main() {
     
     // Apply distance-based darkening
     float darkening = 1.0 - (distance * floorCeilingDarkness);
-    darkening = clamp(darkening, 0.2, 1.0);
+    darkening = clamp(darkening, minLight, 1.0);
     texelColor.rgb *= darkening;
     
     // Apply fog effect based on distance
@@ -64,12 +67,7 @@ void main() {
     fogFactor = clamp(fogFactor, 0.0, 1.0);
     
     // Fog color (sky blue for ceiling, darker for floor)
-    vec3 fogColor;
-    if (isCeiling) {
-        fogColor = vec3(0.4, 0.6, 0.8); // Sky blue
-    } else {
-        fogColor = vec3(0.2, 0.2, 0.3); // Darker color for floor fog
-    }
+    vec3 fogColor = isCeiling ? skyFogColor : floorFogColor;
     
     // Mix texture color with fog
     texelColor.rgb = mix(fogColor, texelColor.rgb, fogFactor);
@@ -1,37 +1,188 @@
 #include "game.h"
 #include "resources.h"
+#include "profiler.h"
+#include "timing.h"
 #include "../Rendering/renderer.h"
+#include "../Rendering/raycaster.h"
 #include "../World/player.h"
 #include "../World/map.h"
+#include "../World/map_stream.h"
+#include "../World/pvs.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static void InitSimulation(GameState* state) {
+    state->tickRate = SIM_DEFAULT_TICK_RATE;
+    state->tickAccumulator = 0.0;
+    state->tickCount = 0;
+    state->ticksThisFrame = 0;
+    state->previousPlayer = state->player;
+    state->interpolation = 1.0f;
+    state->pendingInput = (PlayerInput){ 0 };
+    state->isIdle = false;
+    
+    memset(&state->recorder, 0, sizeof(state->recorder));
+    memset(&state->playback, 0, sizeof(state->playback));
+    state->verifyReplay = false;
+}
 
-void InitGame(GameState* state) {
+void InitGame(GameState* state, const char* levelPath) {
     // Initialize game state
     state->isRunning = true;
     state->mouseLookEnabled = true;
     state->previousMousePosition = (Vector2){ 0, 0 };
     state->mouseSensitivity = 0.1f;
     state->screenshotCounter = 1; // Start screenshot numbering from 1
+    uint64_t startupStart = GetTimestampNs();
 
-    // Initialize resources
+    // Initialize resources, generated images come from the disk cache after the first run
+    InitResources(RESOURCE_CACHE_DIR);
     LoadGameResources(&state->textures);
 
     // Initialize renderer
     InitRenderer();
 
     // Initialize map
-    InitMap(&state->map);
+    InitMap(&state->map, levelPath);
+    
+    // Populate the map with sprites and the enemies that chase the player
+    InitSpriteList(&state->sprites, state->map.width, state->map.height);
+    SpawnMapSprites(&state->sprites, &state->map);
+    InitEnemyList(&state->enemies);
+    SpawnMapEnemies(&state->enemies, &state->sprites, &state->map);
+    InitFlowField(&state->flowField, state->map.width, state->map.height, FLOW_FIELD_DEFAULT_RANGE);
 
     // Initialize player
-    InitPlayer(&state->player, state->map);
+    InitPlayer(&state->player, &state->map);
+
+    // Initialize the fixed-timestep simulation
+    InitSimulation(state);
+    state->isHeadless = false;
 
     // Initialize debug info
     state->showDebugInfo = true;
+    state->overlayStats = (RenderStats){ 0 };
+    state->overlayFPS = 0;
+    state->overlayTicks = 0;
+    state->overlayRefreshTime = 0.0;
+    state->overlayHash = 0;
+
+    TraceLog(LOG_INFO, "Startup took %.2f ms", (GetTimestampNs() - startupStart) / 1e6);
+    LogResourceStats();
+}
+
+void InitGameHeadless(GameState* state, const char* levelPath) {
+    state->isRunning = true;
+    state->mouseLookEnabled = false;
+    state->previousMousePosition = (Vector2){ 0, 0 };
+    state->mouseSensitivity = 0.1f;
+    state->screenshotCounter = 1;
+    state->showDebugInfo = false;
+    state->overlayHash = 0;
+    state->textures = (GameTextures){ 0 };
+
+    InitMapHeadless(&state->map, levelPath);
+    InitSpriteList(&state->sprites, state->map.width, state->map.height);
+    SpawnMapSprites(&state->sprites, &state->map);
+    InitEnemyList(&state->enemies);
+    SpawnMapEnemies(&state->enemies, &state->sprites, &state->map);
+    InitFlowField(&state->flowField, state->map.width, state->map.height, FLOW_FIELD_DEFAULT_RANGE);
+    InitPlayer(&state->player, &state->map);
+
+    InitSimulation(state);
+    state->isHeadless = true;
+}
+
+bool StartGameRecording(GameState* state, const char* path) {
+    ReplayHeader header = {
+        .tickRate = state->tickRate,
+        .mapWidth = state->map.width,
+        .mapHeight = state->map.height,
+        .startPosition = state->player.position,
+        .startAngle = state->player.angle
+    };
+    return BeginReplayRecording(&state->recorder, path, &header);
+}
+
+bool StartGameReplay(GameState* state, const char* path, bool verify) {
+    if (!LoadReplay(&state->playback, path)) return false;
+
+    if (!CheckReplayStart(&state->playback.header, &state->map, &state->player)) {
+        TraceLog(LOG_WARNING, "Replay %s was recorded on a different map", path);
+        UnloadReplay(&state->playback);
+        return false;
+    }
+
+    // The replay only reproduces the run at the tick rate it was recorded at
+    state->tickRate = state->playback.header.tickRate;
+    state->verifyReplay = verify;
+    return true;
+}
+
+// Called when playback runs out: check the end state, then hand control back
+static void FinishGameReplay(GameState* state) {
+    ReplayPlayback* playback = &state->playback;
+
+    if (state->verifyReplay) {
+        ReplayFinalState actual = GetReplayFinalState(&state->player, &state->map, playback->tickCount);
+        if (!playback->hasFinalState) {
+            TraceLog(LOG_WARNING, "Replay has no final state to verify against");
+        } else if (CompareReplayFinalState(&playback->finalState, &actual)) {
+            TraceLog(LOG_INFO, "Replay verified: final state matches after %llu ticks", actual.tickCount);
+        } else {
+            TraceLog(LOG_WARNING, "Replay diverged from the recording");
+        }
+    }
+
+    TraceLog(LOG_INFO, "Replay finished, live input resumed");
+    UnloadReplay(playback);
+}
+
+// Samples the keyboard and mouse into the input for the next tick. Held keys
+// are re-read every frame; presses and mouse motion accumulate until a tick
+// consumes them, so nothing is lost on frames that run no ticks.
+static void LatchPlayerInput(GameState* state) {
+    PlayerInput* input = &state->pendingInput;
+
+    input->buttons &= PLAYER_INPUT_USE;
+    if (IsKeyDown(KEY_W)) input->buttons |= PLAYER_INPUT_FORWARD;
+    if (IsKeyDown(KEY_S)) input->buttons |= PLAYER_INPUT_BACKWARD;
+    if (IsKeyDown(KEY_A)) input->buttons |= PLAYER_INPUT_STRAFE_LEFT;
+    if (IsKeyDown(KEY_D)) input->buttons |= PLAYER_INPUT_STRAFE_RIGHT;
+    if (IsKeyDown(KEY_LEFT)) input->buttons |= PLAYER_INPUT_TURN_LEFT;
+    if (IsKeyDown(KEY_RIGHT)) input->buttons |= PLAYER_INPUT_TURN_RIGHT;
+    if (IsKeyPressed(KEY_SPACE)) input->buttons |= PLAYER_INPUT_USE;
+
+    // Process mouse look if enabled
+    if (state->mouseLookEnabled && IsCursorHidden()) {
+        // Get mouse delta
+        Vector2 mousePosition = GetMousePosition();
+        Vector2 mouseDelta = {
+            mousePosition.x - state->previousMousePosition.x,
+            mousePosition.y - state->previousMousePosition.y
+        };
+
+        // Queue rotation based on mouse movement
+        if ((mouseDelta.x != 0 || mouseDelta.y != 0) && IsWindowFocused()) {
+            input->mouseTurn += -mouseDelta.x * state->mouseSensitivity / MOUSE_LOOK_REFERENCE_FPS;
+
+            // Reset mouse position to center of screen to allow continuous rotation
+            int screenWidth = GetScreenWidth();
+            int screenHeight = GetScreenHeight();
+            SetMousePosition(screenWidth / 2, screenHeight / 2);
+            mousePosition = (Vector2){ screenWidth / 2, screenHeight / 2 };
+        }
+
+        state->previousMousePosition = mousePosition;
+    }
 }
 
 void UpdateGame(GameState* state) {
     float deltaTime = GetFrameTime();
 
+    PROFILE_BEGIN(PROFILE_ZONE_INPUT);
+
     // Toggle debug info with F1
     if (IsKeyPressed(KEY_F1)) {
         state->showDebugInfo = !state->showDebugInfo;
@@ -42,6 +193,32 @@ void UpdateGame(GameState* state) {
         ToggleRenderMode();
     }
 
+    // Minimap zoom with + / -
+    if (IsKeyPressed(KEY_EQUAL)) {
+        SetMinimapZoom(GetMinimapZoom() + 1);
+    }
+    if (IsKeyPressed(KEY_MINUS)) {
+        SetMinimapZoom(GetMinimapZoom() - 1);
+    }
+
+    // Dump a Chrome/Perfetto trace of the next frames with F3
+    if (IsKeyPressed(KEY_F3)) {
+        ProfilerRequestTrace();
+    }
+
+    // Pin the CPU render scale where it is with F4 (again to hand it back to
+    // the controller), or step a pinned scale with [ / ]
+    const ResolutionController* resolution = GetResolutionController();
+    if (IsKeyPressed(KEY_F4)) {
+        PinRenderScale((resolution->pinnedScale > 0.0f) ? 0.0f : resolution->scale);
+    }
+    if (IsKeyPressed(KEY_LEFT_BRACKET)) {
+        PinRenderScale(resolution->scale - RESOLUTION_SCALE_STEP);
+    }
+    if (IsKeyPressed(KEY_RIGHT_BRACKET)) {
+        PinRenderScale(resolution->scale + RESOLUTION_SCALE_STEP);
+    }
+
     // Take screenshot with P key
     if (IsKeyPressed(KEY_P)) {
         // Create a filename with the counter
@@ -55,41 +232,108 @@ void UpdateGame(GameState* state) {
         TraceLog(LOG_INFO, "Screenshot saved: %s", screenshotFilename);
     }
 
-    // Process mouse look if enabled
-    if (state->mouseLookEnabled && IsCursorHidden()) {
-        // Get mouse delta
-        Vector2 mousePosition = GetMousePosition();
-        Vector2 mouseDelta = {
-            mousePosition.x - state->previousMousePosition.x,
-            mousePosition.y - state->previousMousePosition.y
-        };
+    LatchPlayerInput(state);
 
-        // Apply rotation based on mouse movement
-        if ((mouseDelta.x != 0 || mouseDelta.y != 0) && IsWindowFocused()) {
-            float rotationAmount = -mouseDelta.x * state->mouseSensitivity * deltaTime;
-            RotatePlayer(&state->player, rotationAmount);
+    PROFILE_END(PROFILE_ZONE_INPUT);
 
-            // Reset mouse position to center of screen to allow continuous rotation
-            int screenWidth = GetScreenWidth();
-            int screenHeight = GetScreenHeight();
-            SetMousePosition(screenWidth / 2, screenHeight / 2);
-            mousePosition = (Vector2){ screenWidth / 2, screenHeight / 2 };
+    // Run as many fixed ticks as the elapsed time covers; rendering then
+    // interpolates between the last two, so results do not depend on frame rate
+    double tickTime = 1.0 / state->tickRate;
+
+    // Nothing was moving while the loop slept, so the time asleep is owed no
+    // ticks; one tick lets the input that woke it take effect at once
+    if (state->isIdle) deltaTime = (float)tickTime;
+    state->tickAccumulator += deltaTime;
+    state->ticksThisFrame = 0;
+
+    while (state->tickAccumulator >= tickTime) {
+        if (state->ticksThisFrame == SIM_MAX_TICKS_PER_FRAME) {
+            // Too far behind (debugger, window drag): skip the backlog
+            state->tickAccumulator = fmod(state->tickAccumulator, tickTime);
+            break;
         }
 
-        state->previousMousePosition = mousePosition;
+        // A loaded replay supplies the input instead of the keyboard and mouse
+        PlayerInput replayInput;
+        if (state->playback.data != NULL) {
+            if (NextReplayInput(&state->playback, &replayInput)) {
+                SimulateGameTick(state, &replayInput);
+            } else {
+                FinishGameReplay(state);
+                SimulateGameTick(state, &state->pendingInput);
+            }
+        } else {
+            SimulateGameTick(state, &state->pendingInput);
+        }
+        state->tickAccumulator -= tickTime;
+        state->ticksThisFrame++;
+
+        // Presses and mouse motion belong to the first tick that sees them
+        state->pendingInput.buttons &= ~PLAYER_INPUT_USE;
+        state->pendingInput.mouseTurn = 0.0f;
     }
 
-    // Update player
-    UpdatePlayer(&state->player, state->map, deltaTime);
+    state->interpolation = (float)(state->tickAccumulator / tickTime);
+}
 
-    // Update map (animations, etc.)
-    UpdateMap(&state->map, deltaTime);
+void SimulateGameTick(GameState* state, const PlayerInput* input) {
+    float tickTime = 1.0f / state->tickRate;
+    state->previousPlayer = state->player;
+
+    RecordReplayTick(&state->recorder, input);
+
+    // Update player
+    PROFILE_BEGIN(PROFILE_ZONE_UPDATE_PLAYER);
+    UpdatePlayer(&state->player, &state->map, input, tickTime);
+    PROFILE_END(PROFILE_ZONE_UPDATE_PLAYER);
+
+    // Update map (streamed chunks around the player, animations, etc.).
+    // Replays, recorded or played back, and headless runs wait for the chunks
+    // they want so they see the same tiles whatever the loader's timing.
+    PROFILE_BEGIN(PROFILE_ZONE_UPDATE_MAP);
+    UpdateMapStream(&state->map, state->player.position);
+    if (state->isHeadless || state->recorder.file != NULL || state->playback.data != NULL) {
+        FlushMapStream(&state->map);
+    }
+    UpdateMap(&state->map, tickTime);
 
     // Test key bindings for door manipulation (for testing)
-    ProcessMapInteractions(state);
+    ProcessMapInteractions(state, input);
+    PROFILE_END(PROFILE_ZONE_UPDATE_MAP);
+
+    // Enemies that have seen the player follow one flow field toward its tile
+    PROFILE_BEGIN(PROFILE_ZONE_UPDATE_AI);
+    int playerTileX = (int)(state->player.position.x / TILE_SIZE);
+    int playerTileY = (int)(state->player.position.y / TILE_SIZE);
+    UpdateFlowField(&state->flowField, &state->map, playerTileX, playerTileY);
+    // Sight checks share the raycaster's threads, which sit idle between frames
+    UpdateEnemyAwareness(&state->enemies, &state->map, state->player.position, GetRenderWorkerPool());
+    UpdateEnemies(&state->enemies, &state->sprites, &state->flowField, &state->map, tickTime);
+    PROFILE_END(PROFILE_ZONE_UPDATE_AI);
+
+    state->tickCount++;
+}
+
+// Nothing that changes the picture without input: no replay feeding input,
+// no door moving and no visibility left to recompute
+static bool IsSimulationSettled(const GameState* state) {
+    if (state->playback.data != NULL) return false;
+    if (state->map.activeDoorCount > 0) return false;
+    return state->map.pvs == NULL || state->map.pvs->dirtyCount == 0;
 }
 
-void ProcessMapInteractions(GameState* state) {
+// Whether the player or an enemy reaches into the tile
+static bool IsTileOccupied(const GameState* state, int x, int y) {
+    Rectangle tile = { x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE };
+    if (CheckCollisionCircleRec(state->player.position, state->player.collisionRadius, tile)) return true;
+
+    for (int i = 0; i < state->enemies.count; i++) {
+        if (CheckCollisionCircleRec(state->enemies.enemies[i].position, ENEMY_COLLISION_RADIUS * TILE_SIZE, tile)) return true;
+    }
+    return false;
+}
+
+void ProcessMapInteractions(GameState* state, const PlayerInput* input) {
     // Get player's current map position
     int playerX = (int)(state->player.position.x / TILE_SIZE);
     int playerY = (int)(state->player.position.y / TILE_SIZE);
@@ -99,62 +343,136 @@ void ProcessMapInteractions(GameState* state) {
     int frontY = playerY + (int)(state->player.direction.y * 1.5f);
 
     // For testing: Space key to open/close doors in front of the player
-    if (IsKeyPressed(KEY_SPACE)) {
-        int tileType = GetMapTile(state->map, frontX, frontY);
+    if (input->buttons & PLAYER_INPUT_USE) {
+        int tileType = GetMapTile(&state->map, frontX, frontY);
 
         if (tileType == TILE_WALL) {
             // For testing: Turn walls into doors
             SetMapTile(&state->map, frontX, frontY, TILE_DOOR);
         }
-        else if (tileType == TILE_DOOR) {
-            // Open doors (replace with empty space)
-            SetMapTile(&state->map, frontX, frontY, TILE_EMPTY);
+        else if (tileType == TILE_DOOR || tileType == TILE_DOOR_OPEN) {
+            // Slide the door; an open door cannot close on someone standing in it
+            if (tileType == TILE_DOOR_OPEN && IsTileOccupied(state, frontX, frontY)) return;
+            ToggleDoor(&state->map, frontX, frontY);
         }
     }
 }
 
+// Draws a line of the debug overlay and folds it into hash, so a frame whose
+// overlay reads the same as the last one can count as unchanged
+static void DrawOverlayText(unsigned int* hash, const char* text, int x, int y, int fontSize, Color color) {
+    DrawText(text, x, y, fontSize, color);
+    for (const char* c = text; *c != '\0'; c++) {
+        *hash = (*hash ^ (unsigned char)*c) * 16777619u;
+    }
+}
+
 void RenderGame(GameState* state) {
-    // Render the 3D world
-    RenderWorld(state->player, state->map);
+    // Upload this frame's tile changes to the map texture in one go
+    UpdateMapGPUTexture(&state->map);
+
+    // Render the 3D world from the player blended between the last two ticks
+    Player viewPlayer = LerpPlayer(&state->previousPlayer, &state->player, state->interpolation);
+
+    PROFILE_BEGIN(PROFILE_ZONE_RENDER_WORLD);
+    RenderWorld(&viewPlayer, &state->map, &state->sprites, &state->textures);
+    PROFILE_END(PROFILE_ZONE_RENDER_WORLD);
 
     // Draw debug information
+    PROFILE_BEGIN(PROFILE_ZONE_HUD);
+    unsigned int overlayHash = 0;
     if (state->showDebugInfo) {
         // Get screen dimensions
         int screenWidth = GetScreenWidth();
         int screenHeight = GetScreenHeight();
 
+        // Timings jitter every frame; sampling them a few times a second keeps
+        // them readable and lets an otherwise unchanged frame go idle
+        double now = GetTime();
+        if (now >= state->overlayRefreshTime) {
+            state->overlayStats = *GetRenderStats();
+            state->overlayFPS = GetFPS();
+            state->overlayTicks = state->ticksThisFrame;
+            state->overlayRefreshTime = now + 1.0 / DEBUG_OVERLAY_REFRESH_HZ;
+        }
+        const RenderStats* stats = &state->overlayStats;
+        overlayHash = 2166136261u;
+
         // Draw FPS
-        DrawFPS(10, 10);
+        char fpsText[32];
+        sprintf(fpsText, "%2d FPS", state->overlayFPS);
+        DrawOverlayText(&overlayHash, fpsText, 10, 10, 20, (state->overlayFPS < 30) ? ORANGE : LIME);
+
+        // Simulation rate next to it
+        char tickText[64];
+        sprintf(tickText, "Sim: %.0f Hz, %d ticks", state->tickRate, state->overlayTicks);
+        DrawOverlayText(&overlayHash, tickText, 120, 10, 20, RAYWHITE);
 
         // Player position and angle - with more vertical spacing
         char positionText[64];
         sprintf(positionText, "Position: (%.1f, %.1f)", state->player.position.x, state->player.position.y);
-        DrawText(positionText, 10, 40, 20, RAYWHITE);
+        DrawOverlayText(&overlayHash, positionText, 10, 40, 20, RAYWHITE);
 
         char angleText[64];
         sprintf(angleText, "Angle: %.2f degrees", state->player.angle * RAD2DEG);
-        DrawText(angleText, 10, 70, 20, RAYWHITE);
+        DrawOverlayText(&overlayHash, angleText, 10, 70, 20, RAYWHITE);
 
         // Map information
         char mapText[64];
         int playerMapX = (int)(state->player.position.x / TILE_SIZE);
         int playerMapY = (int)(state->player.position.y / TILE_SIZE);
         sprintf(mapText, "Map position: (%d, %d)", playerMapX, playerMapY);
-        DrawText(mapText, 10, 100, 20, RAYWHITE);
+        DrawOverlayText(&overlayHash, mapText, 10, 100, 20, RAYWHITE);
 
         // Add wall information
         char wallText[128];
         int frontX = playerMapX + (int)(state->player.direction.x * 1.5f);
         int frontY = playerMapY + (int)(state->player.direction.y * 1.5f);
-        int tileType = GetMapTile(state->map, frontX, frontY);
+        int tileType = GetMapTile(&state->map, frontX, frontY);
         sprintf(wallText, "Looking at: (%d,%d) Type: %d", frontX, frontY, tileType);
-        DrawText(wallText, 10, 130, 20, GREEN);
+        DrawOverlayText(&overlayHash, wallText, 10, 130, 20, GREEN);
+
+        // CPU raycaster timing with a per-thread breakdown to spot imbalance
+        if (currentRenderMode == RENDER_MODE_CPU) {
+            char raycastText[128];
+            sprintf(raycastText, "Raycast: %.2f ms on %d threads (%s) at %dx%d%s", stats->raycastMs, stats->threadCount,
+                    GetRayKernelName(GetRayKernel()), stats->renderWidth, stats->renderHeight,
+                    stats->frameReused ? ", frame reused" : "");
+            DrawOverlayText(&overlayHash, raycastText, 10, 160, 20, RAYWHITE);
+
+            // Four threads per line: "T0 1.20ms/12"
+            for (int i = 0; i < stats->threadCount; i += 4) {
+                char threadText[128];
+                int length = 0;
+                for (int j = i; j < i + 4 && j < stats->threadCount; j++) {
+                    length += sprintf(threadText + length, "T%d %.2fms/%d  ", j, stats->threadMs[j], stats->threadBands[j]);
+                }
+                DrawOverlayText(&overlayHash, threadText, 10, 185 + (i / 4) * 18, 16, LIGHTGRAY);
+            }
+        } else {
+            // What the sorted draw list still asks of GL per frame
+            const DrawStats* draws = &stats->draws;
+
+            char drawText[160];
+            sprintf(drawText, "Draws: %d in %d batches, %d shader / %d texture binds, uniforms %d sent / %d skipped",
+                    draws->draws, draws->batches, draws->shaderBinds, draws->textureBinds,
+                    draws->uniformUploads, draws->uniformsSkipped);
+            DrawOverlayText(&overlayHash, drawText, 10, 160, 20, RAYWHITE);
+        }
+        
+        // Sprites that survived frustum and PVS culling
+        char spriteText[96];
+        sprintf(spriteText, "Sprites: %d of %d drawn, %.2f ms", stats->spritesDrawn, state->sprites.activeCount, stats->spritesMs);
+        DrawOverlayText(&overlayHash, spriteText, screenWidth - MeasureText(spriteText, 20) - 10, 40, 20, RAYWHITE);
 
         // Controls help
-        DrawText("Controls:", 10, screenHeight - 190, 20, YELLOW);
+        DrawText("Controls:", 10, screenHeight - 250, 20, YELLOW);
+        DrawText("F4, [ ]: Pin render scale", 10, screenHeight - 220, 20, RAYWHITE);
+        DrawText("F3: Profile trace", 10, screenHeight - 200, 20, RAYWHITE);
+        DrawText("+/-: Minimap zoom", 10, screenHeight - 180, 20, RAYWHITE);
         DrawText("WASD: Move", 10, screenHeight - 160, 20, RAYWHITE);
         DrawText("Mouse/Arrows: Look", 10, screenHeight - 140, 20, RAYWHITE);
-        DrawText("Space: Open door", 10, screenHeight - 120, 20, RAYWHITE);
+        DrawText("Space: Open/close door", 10, screenHeight - 120, 20, RAYWHITE);
         DrawText("ESC: Toggle mouse", 10, screenHeight - 100, 20, RAYWHITE);
         DrawText("F: Fullscreen", 10, screenHeight - 80, 20, RAYWHITE);
         DrawText("P: Take screenshot", 10, screenHeight - 60, 20, RAYWHITE);
@@ -164,13 +482,51 @@ void RenderGame(GameState* state) {
         // Render status info at top right
         char statusInfo[64];
         sprintf(statusInfo, "Render Mode: %s", GetRenderModeName());
-        DrawText(statusInfo, screenWidth - MeasureText(statusInfo, 45) - 10, 10, 20, YELLOW);
+        DrawOverlayText(&overlayHash, statusInfo, screenWidth - MeasureText(statusInfo, 45) - 10, 10, 20, YELLOW);
+
+        // Per-phase timings below the minimap, the CPU render scale below them.
+        // Both chart the frames themselves, so they have nothing new to show
+        // once frames stop and stay out of the hash.
+        DrawProfilerOverlay(screenWidth - 310, 175);
+        if (currentRenderMode == RENDER_MODE_CPU) {
+            DrawResolutionOverlay(GetResolutionController(), screenWidth - 310, 175 + (PROFILE_ZONE_COUNT + 1) * 18 + 40, 300);
+        }
+    }
+    PROFILE_END(PROFILE_ZONE_HUD);
+
+    // A simulated frame that changed nothing on screen, with nothing moving on
+    // its own, means the next one would look the same: let EndDrawing sleep
+    // until an input event instead of presenting it again. The debug overlay
+    // counts as part of the frame, its sampled numbers settle along with it.
+    bool overlayChanged = overlayHash != state->overlayHash;
+    state->overlayHash = overlayHash;
+    bool idle = state->ticksThisFrame > 0 && !GetRenderStats()->frameChanged && IsSimulationSettled(state) &&
+                !overlayChanged;
+    if (idle != state->isIdle) {
+        if (idle) {
+            EnableEventWaiting();
+        } else {
+            DisableEventWaiting();
+        }
+        state->isIdle = idle;
     }
 }
 
 void UnloadGame(GameState* state) {
+    // Finish the recording with the state a replay has to reproduce
+    if (state->recorder.file != NULL) {
+        ReplayFinalState finalState = GetReplayFinalState(&state->player, &state->map, state->tickCount);
+        EndReplayRecording(&state->recorder, &finalState);
+    }
+    UnloadReplay(&state->playback);
+
     // Unload resources
+    UnloadFlowField(&state->flowField);
+    UnloadEnemyList(&state->enemies, NULL);
+    UnloadSpriteList(&state->sprites);
     UnloadMap(&state->map);
+    if (state->isHeadless) return;
     UnloadGameResources(&state->textures);
+    UnloadResources();
     UnloadRenderer();
 }
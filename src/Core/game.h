@@ -3,13 +3,25 @@
 
 #include "raylib.h"
 #include "resources.h"
+#include "replay.h"
 #include "../World/player.h"
 #include "../World/map.h"
+#include "../World/sprites.h"
+#include "../World/flow_field.h"
+#include "../World/enemies.h"
 #include "../Rendering/renderer.h"
 
+#define SIM_DEFAULT_TICK_RATE 120.0f   // Simulation ticks per second
+#define SIM_MAX_TICKS_PER_FRAME 8      // After a long stall, drop time instead of spiralling
+#define MOUSE_LOOK_REFERENCE_FPS 60.0f // Mouse look used to scale with frame time at this rate
+#define DEBUG_OVERLAY_REFRESH_HZ 4.0   // Live numbers on the debug overlay change at most this often
+
 typedef struct GameState {
     Player player;
     Map map;
+    SpriteList sprites;         // Pickups, decorations and enemies, bucketed per tile
+    FlowField flowField;        // Shared path toward the player for every enemy
+    EnemyList enemies;
     GameTextures textures;
     bool isRunning;
     bool mouseLookEnabled;
@@ -17,12 +29,39 @@ typedef struct GameState {
     Vector2 previousMousePosition;
     float mouseSensitivity;
     int screenshotCounter; // Counter for tracking screenshot numbers
+    
+    // Fixed-timestep simulation
+    float tickRate;             // Simulation ticks per second
+    double tickAccumulator;     // Frame time not yet simulated
+    unsigned long long tickCount;
+    int ticksThisFrame;
+    Player previousPlayer;      // Player as of the previous tick
+    float interpolation;        // Where rendering sits between previousPlayer (0) and player (1)
+    PlayerInput pendingInput;   // Controls latched since the last tick
+    bool isIdle;                // The last frame changed nothing; EndDrawing waits for input
+    
+    // Debug overlay
+    RenderStats overlayStats;   // Timings the overlay shows, sampled every 1 / DEBUG_OVERLAY_REFRESH_HZ
+    int overlayFPS;
+    int overlayTicks;
+    double overlayRefreshTime;  // When the samples are taken next
+    unsigned int overlayHash;   // Of the overlay text drawn last frame, 0 while hidden
+    
+    // Input recording and playback
+    ReplayRecorder recorder;    // Writes every tick's input while recording
+    ReplayPlayback playback;    // Supplies tick input instead of the keyboard while loaded
+    bool verifyReplay;          // Compare the end state once playback runs out
+    bool isHeadless;            // No window, renderer or textures (headless replay)
 } GameState;
 
 // Game state management functions
-void InitGame(GameState* state);
+void InitGame(GameState* state, const char* levelPath);         // levelPath NULL = built-in map
+void InitGameHeadless(GameState* state, const char* levelPath); // Map and player only, no window needed
+bool StartGameRecording(GameState* state, const char* path);
+bool StartGameReplay(GameState* state, const char* path, bool verify);
 void UpdateGame(GameState* state);
-void ProcessMapInteractions(GameState* state);
+void SimulateGameTick(GameState* state, const PlayerInput* input); // Advance by one 1 / tickRate step
+void ProcessMapInteractions(GameState* state, const PlayerInput* input);
 void RenderGame(GameState* state);
 void UnloadGame(GameState* state);
 
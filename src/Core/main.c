@@ -1,7 +1,11 @@
 #include "raylib.h"
 #include "game.h"
 #include "resources.h"
+#include "profiler.h"
+#include "../Rendering/raycaster.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define SCREEN_WIDTH 1280 
 #define SCREEN_HEIGHT 720
@@ -11,13 +15,72 @@
 void ProcessInput(GameState* gameState);
 void HandleWindowResize(void);
 
-int main(void) {
-    // Set up window configuration
-    SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_VSYNC_HINT);
+int main(int argc, char* argv[]) {
+    float tickRate = SIM_DEFAULT_TICK_RATE;
+    int targetFPS = 60;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* levelPath = NULL;
+    bool replayHeadless = false;
+    bool verifyReplay = false;
+    
+    // Command line options
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            // Number of CPU raycaster threads (0 = one per core)
+            SetRenderThreadCount(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--ray-kernel") == 0 && i + 1 < argc) {
+            // Force a DDA kernel: scalar, sse2 or avx2
+            const char* name = argv[++i];
+            bool found = false;
+            for (int k = 0; k < RAY_KERNEL_COUNT; k++) {
+                if (strcmp(name, GetRayKernelName((RayKernel)k)) == 0) {
+                    found = SetRayKernel((RayKernel)k);
+                }
+            }
+            if (!found) TraceLog(LOG_WARNING, "Ray kernel '%s' not available, using %s", name, GetRayKernelName(GetRayKernel()));
+        } else if (strcmp(argv[i], "--render-budget") == 0 && i + 1 < argc) {
+            // CPU render time in ms the dynamic resolution holds, 0 = always full resolution
+            SetRenderBudget((float)atof(argv[++i]));
+        } else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            // Fixed CPU render scale (0.25 to 1) instead of the dynamic one
+            PinRenderScale((float)atof(argv[++i]));
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            // Simulation ticks per second, independent of the frame rate
+            tickRate = (float)atof(argv[++i]);
+            if (tickRate < 1.0f) tickRate = SIM_DEFAULT_TICK_RATE;
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            // Frame rate cap, 0 = uncapped
+            targetFPS = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            // Write every simulation tick's input to a replay file
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            // Play a recorded run back in real time, then hand over to the keyboard
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay-headless") == 0 && i + 1 < argc) {
+            // Simulate a recorded run without a window as fast as possible
+            replayPath = argv[++i];
+            replayHeadless = true;
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            // Play a level file built by wolf3d_levelc instead of the built-in map
+            levelPath = argv[++i];
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            // Check that a replay reproduces the recorded final state
+            verifyReplay = true;
+        }
+    }
+    
+    if (replayHeadless) {
+        return RunReplayHeadless(replayPath, levelPath, verifyReplay);
+    }
+    
+    // Set up window configuration (no vsync when running uncapped)
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | ((targetFPS > 0) ? FLAG_VSYNC_HINT : 0));
     
     // Initialize window and game
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, GAME_TITLE);
-    SetTargetFPS(60);
+    SetTargetFPS(targetFPS);
     
     // Hide cursor for mouse look
     HideCursor();
@@ -27,14 +90,22 @@ int main(void) {
         DisableCursor();
     }
     
+    // Main thread owns the first profiler ring
+    InitProfiler();
+    
     // Initialize game state
     GameState gameState;
-    InitGame(&gameState);
+    InitGame(&gameState, levelPath);
+    gameState.tickRate = tickRate;
+    if (replayPath != NULL) StartGameReplay(&gameState, replayPath, verifyReplay);
+    if (recordPath != NULL) StartGameRecording(&gameState, recordPath);
     
     // Main game loop
     while (!WindowShouldClose()) {
         // Handle input
+        PROFILE_BEGIN(PROFILE_ZONE_INPUT);
         ProcessInput(&gameState);
+        PROFILE_END(PROFILE_ZONE_INPUT);
         
         // Handle window resize if needed
         HandleWindowResize();
@@ -51,11 +122,17 @@ int main(void) {
             if (!gameState.showDebugInfo) {
                 DrawText("WASD: Move, Mouse/Arrows: Look, ESC: Exit", 10, 40, 20, RAYWHITE);
             }
+            
+            PROFILE_BEGIN(PROFILE_ZONE_PRESENT);
         EndDrawing();
+        PROFILE_END(PROFILE_ZONE_PRESENT);
+        
+        ProfilerEndFrame();
     }
     
     // Clean up
     UnloadGame(&gameState);
+    UnloadProfiler();
     CloseWindow();
     
     return 0;
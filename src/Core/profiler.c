@@ -0,0 +1,264 @@
+#include "profiler.h"
+#include "raylib.h"
+#include <stdio.h>
+
+#ifdef WOLF3D_PROFILE
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ProfileEvent {
+    uint64_t startNs;
+    uint64_t endNs;
+    int zone;
+} ProfileEvent;
+
+// Single-producer ring: only the owning thread writes events and advances
+// head, only the main thread reads behind it and advances tail. A thread that
+// exits gives its ring back, and the next new thread takes it over where the
+// last one left off.
+typedef struct ProfileRing {
+    ProfileEvent events[PROFILER_RING_SIZE];
+    atomic_uint head;
+    unsigned int tail;
+    atomic_bool owned;
+} ProfileRing;
+
+typedef struct TraceEvent {
+    ProfileEvent event;
+    int thread;
+} TraceEvent;
+
+static const char* ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+    "Frame", "Input", "UpdatePlayer", "UpdateMap", "UpdateAI", "RenderWorld",
+    "Raycast", "RaycastBand", "Sprites", "Minimap", "HUD", "Present"
+};
+
+static ProfileRing rings[PROFILER_MAX_THREADS];
+static atomic_int ringCount = 0;    // Rings ever handed out; the drain visits all of them
+static _Thread_local int threadRing = -1;
+
+// Per-frame totals, in ms, for the last PROFILER_HISTORY frames
+static float history[PROFILER_HISTORY][PROFILE_ZONE_COUNT];
+static int historyFrames = 0;
+static uint64_t lastFrameEndNs = 0;
+
+// Trace capture
+static TraceEvent* traceEvents = NULL;
+static int traceCount = 0;
+static int traceCapacity = 0;
+static int traceFramesLeft = 0;
+static uint64_t traceStartNs = 0;
+static int traceFileCounter = 1;
+
+static ProfileRing* GetThreadRing(void) {
+    if (threadRing >= 0) return &rings[threadRing];
+
+    // A ring given back by a thread that has exited, else a fresh one
+    int count = atomic_load(&ringCount);
+    for (int i = 0; i < count; i++) {
+        bool owned = false;
+        if (atomic_compare_exchange_strong(&rings[i].owned, &owned, true)) {
+            threadRing = i;
+            return &rings[i];
+        }
+    }
+
+    int index = atomic_fetch_add(&ringCount, 1);
+    if (index >= PROFILER_MAX_THREADS) {
+        atomic_fetch_sub(&ringCount, 1);
+        return NULL;
+    }
+    atomic_store(&rings[index].owned, true);
+    threadRing = index;
+    return &rings[index];
+}
+
+void ProfilerReleaseThread(void) {
+    if (threadRing < 0) return;
+
+    // Events already recorded stay in the ring until the next drain
+    atomic_store_explicit(&rings[threadRing].owned, false, memory_order_release);
+    threadRing = -1;
+}
+
+void ProfilerRecord(ProfileZone zone, uint64_t startNs, uint64_t endNs) {
+    ProfileRing* ring = GetThreadRing();
+    if (ring == NULL) return;
+
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->events[head & (PROFILER_RING_SIZE - 1)] = (ProfileEvent){ startNs, endNs, zone };
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void AppendTraceEvent(const ProfileEvent* event, int thread) {
+    if (traceCount == traceCapacity) {
+        int capacity = (traceCapacity > 0) ? traceCapacity * 2 : 4096;
+        TraceEvent* events = realloc(traceEvents, capacity * sizeof(TraceEvent));
+        if (events == NULL) return;
+        traceEvents = events;
+        traceCapacity = capacity;
+    }
+
+    traceEvents[traceCount++] = (TraceEvent){ *event, thread };
+}
+
+static void WriteTraceFile(void) {
+    char filename[64];
+    sprintf(filename, "profile_trace_%03d.json", traceFileCounter++);
+
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "Failed to open %s for writing", filename);
+        return;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    // Name the thread tracks; ring 0 belongs to the main thread (InitProfiler)
+    int threads = atomic_load(&ringCount);
+    for (int t = 0; t < threads; t++) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}},\n",
+                t, (t == 0) ? "Main" : "Worker", t);
+    }
+
+    // Complete events, timestamps in microseconds from the start of the capture
+    for (int i = 0; i < traceCount; i++) {
+        const TraceEvent* trace = &traceEvents[i];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+                ZONE_NAMES[trace->event.zone], trace->thread,
+                (double)(int64_t)(trace->event.startNs - traceStartNs) / 1000.0,
+                (double)(trace->event.endNs - trace->event.startNs) / 1000.0,
+                (i + 1 < traceCount) ? "," : "");
+    }
+
+    fprintf(file, "]}\n");
+    fclose(file);
+
+    TraceLog(LOG_INFO, "Profile trace saved: %s (%d events)", filename, traceCount);
+}
+
+void InitProfiler(void) {
+    // Claim ring 0 for the main thread
+    GetThreadRing();
+    lastFrameEndNs = GetTimestampNs();
+}
+
+void ProfilerEndFrame(void) {
+    uint64_t now = GetTimestampNs();
+    float* frame = history[historyFrames % PROFILER_HISTORY];
+    memset(frame, 0, sizeof(history[0]));
+
+    bool tracing = traceFramesLeft > 0;
+    ProfileEvent frameEvent = { lastFrameEndNs, now, PROFILE_ZONE_FRAME };
+    frame[PROFILE_ZONE_FRAME] = (now - lastFrameEndNs) / 1e6f;
+    if (tracing) AppendTraceEvent(&frameEvent, 0);
+    lastFrameEndNs = now;
+
+    // Drain every ring; zones recorded on several threads add up
+    int threads = atomic_load(&ringCount);
+    for (int t = 0; t < threads; t++) {
+        ProfileRing* ring = &rings[t];
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        // The writer lapped us: the oldest events are gone
+        if (head - ring->tail > PROFILER_RING_SIZE) ring->tail = head - PROFILER_RING_SIZE;
+
+        for (unsigned int i = ring->tail; i != head; i++) {
+            ProfileEvent event = ring->events[i & (PROFILER_RING_SIZE - 1)];
+
+            // Skip slots the writer may have overwritten while we copied them:
+            // event i + PROFILER_RING_SIZE goes into the same slot, and is
+            // written while head still reads i + PROFILER_RING_SIZE
+            unsigned int latest = atomic_load_explicit(&ring->head, memory_order_acquire);
+            if (latest - i >= PROFILER_RING_SIZE) continue;
+
+            frame[event.zone] += (event.endNs - event.startNs) / 1e6f;
+            if (tracing) AppendTraceEvent(&event, t);
+        }
+        ring->tail = head;
+    }
+
+    historyFrames++;
+
+    if (tracing && --traceFramesLeft == 0) {
+        WriteTraceFile();
+        traceCount = 0;
+    }
+}
+
+void ProfilerRequestTrace(void) {
+    if (traceFramesLeft > 0) return;
+
+    traceFramesLeft = PROFILER_TRACE_FRAMES;
+    traceStartNs = GetTimestampNs();
+    traceCount = 0;
+    TraceLog(LOG_INFO, "Capturing %d frames for a profile trace", PROFILER_TRACE_FRAMES);
+}
+
+void DrawProfilerOverlay(int x, int y) {
+    int frames = (historyFrames < PROFILER_HISTORY) ? historyFrames : PROFILER_HISTORY;
+    if (frames == 0) return;
+
+    int lineHeight = 18;
+    DrawRectangle(x - 5, y - 5, 300, (PROFILE_ZONE_COUNT + 1) * lineHeight + 10, ColorAlpha(BLACK, 0.6f));
+
+    char text[96];
+    sprintf(text, "%-13s %7s %7s", "Zone", "avg ms", "max ms");
+    DrawText(text, x, y, 16, YELLOW);
+
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        float sum = 0.0f;
+        float max = 0.0f;
+        for (int f = 0; f < frames; f++) {
+            float ms = history[f][zone];
+            sum += ms;
+            if (ms > max) max = ms;
+        }
+        float avg = sum / frames;
+
+        // Spikes well above the rolling average stand out in red
+        bool spike = max > 2.0f * avg && max > 1.0f;
+        sprintf(text, "%-13s %7.2f %7.2f", ZONE_NAMES[zone], avg, max);
+        DrawText(text, x, y + (zone + 1) * lineHeight, 16, spike ? RED : LIGHTGRAY);
+    }
+
+    if (traceFramesLeft > 0) {
+        DrawText("Recording trace...", x, y + (PROFILE_ZONE_COUNT + 1) * lineHeight + 6, 16, RED);
+    }
+}
+
+void UnloadProfiler(void) {
+    free(traceEvents);
+    traceEvents = NULL;
+    traceCount = 0;
+    traceCapacity = 0;
+    traceFramesLeft = 0;
+}
+
+#else
+
+// Profiling compiled out: keep the frame-level hooks so callers need no #ifdefs
+
+void InitProfiler(void) {
+}
+
+void ProfilerEndFrame(void) {
+}
+
+void ProfilerReleaseThread(void) {
+}
+
+void ProfilerRequestTrace(void) {
+    TraceLog(LOG_WARNING, "Profiler not built in, reconfigure with a Debug or RelWithDebInfo build");
+}
+
+void DrawProfilerOverlay(int x, int y) {
+    DrawText("Profiler off (release build)", x, y, 16, GRAY);
+}
+
+void UnloadProfiler(void) {
+}
+
+#endif // WOLF3D_PROFILE
@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timing.h"
+
+// Frame profiler. Scoped timers record into a lock-free ring per thread that
+// the main thread drains once per frame into rolling per-zone statistics and,
+// on request, into a Chrome trace (chrome://tracing / ui.perfetto.dev).
+//
+// The PROFILE_* macros only exist in builds with WOLF3D_PROFILE defined
+// (CMake enables it for Debug and RelWithDebInfo); in release builds they
+// compile to nothing and the frame-level functions are empty stubs.
+
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_RING_SIZE 4096     // Events per thread ring, power of two
+#define PROFILER_HISTORY 120        // Frames behind the overlay's averages and spikes
+#define PROFILER_TRACE_FRAMES 300   // Frames captured per trace dump
+
+typedef enum ProfileZone {
+    PROFILE_ZONE_FRAME,             // Whole frame, measured between ProfilerEndFrame calls
+    PROFILE_ZONE_INPUT,
+    PROFILE_ZONE_UPDATE_PLAYER,
+    PROFILE_ZONE_UPDATE_MAP,
+    PROFILE_ZONE_UPDATE_AI,         // Flow field upkeep and enemy movement
+    PROFILE_ZONE_RENDER_WORLD,
+    PROFILE_ZONE_RAYCAST,
+    PROFILE_ZONE_RAYCAST_BAND,      // One column band or block of rows on a worker thread
+    PROFILE_ZONE_SPRITES,           // Gathering, sorting and drawing billboards
+    PROFILE_ZONE_MINIMAP,
+    PROFILE_ZONE_HUD,
+    PROFILE_ZONE_PRESENT,
+    PROFILE_ZONE_COUNT
+} ProfileZone;
+
+#ifdef WOLF3D_PROFILE
+#define PROFILE_BEGIN(zone) uint64_t profileStart_##zone = GetTimestampNs()
+#define PROFILE_END(zone) ProfilerRecord(zone, profileStart_##zone, GetTimestampNs())
+void ProfilerRecord(ProfileZone zone, uint64_t startNs, uint64_t endNs);
+#else
+#define PROFILE_BEGIN(zone) ((void)0)
+#define PROFILE_END(zone) ((void)0)
+#endif
+
+void InitProfiler(void);            // Call from the main thread before any other thread records
+void ProfilerEndFrame(void);        // Main thread, once per frame after presenting
+void ProfilerReleaseThread(void);   // Hands the calling thread's ring back; call before a thread exits
+void ProfilerRequestTrace(void);    // Capture the next PROFILER_TRACE_FRAMES frames to a JSON file
+void DrawProfilerOverlay(int x, int y);
+void UnloadProfiler(void);
+
+#endif // PROFILER_H
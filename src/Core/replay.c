@@ -0,0 +1,364 @@
+#include "replay.h"
+#include "game.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define REPLAY_HEADER_SIZE 32
+#define REPLAY_FOOTER_SIZE 40
+
+//----------------------------------------------------------------------------------
+// Little-endian encoding
+//----------------------------------------------------------------------------------
+
+static void PutU16(unsigned char* out, uint16_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void PutU32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void PutU64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void PutF32(unsigned char* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutU32(out, bits);
+}
+
+static uint16_t GetU16(const unsigned char* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t GetU32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+    return value;
+}
+
+static uint64_t GetU64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+static float GetF32(const unsigned char* in) {
+    uint32_t bits = GetU32(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//----------------------------------------------------------------------------------
+// Recording
+//----------------------------------------------------------------------------------
+
+static void WriteReplayRun(ReplayRecorder* recorder, const PlayerInput* input, unsigned int length) {
+    unsigned char buffer[16];
+    int size = 0;
+    
+    unsigned char flags = (unsigned char)(input->buttons & 0x7f);
+    if (input->mouseTurn != 0.0f) flags |= REPLAY_FLAG_MOUSE;
+    buffer[size++] = flags;
+    
+    if (flags & REPLAY_FLAG_MOUSE) {
+        PutF32(buffer + size, input->mouseTurn);
+        size += 4;
+    }
+    
+    // ULEB128 run length
+    do {
+        unsigned char byte = length & 0x7f;
+        length >>= 7;
+        buffer[size++] = byte | (length ? 0x80 : 0);
+    } while (length);
+    
+    fwrite(buffer, 1, size, recorder->file);
+}
+
+bool BeginReplayRecording(ReplayRecorder* recorder, const char* path, const ReplayHeader* header) {
+    memset(recorder, 0, sizeof(*recorder));
+    
+    recorder->file = fopen(path, "wb");
+    if (recorder->file == NULL) {
+        TraceLog(LOG_WARNING, "Failed to open replay %s for writing", path);
+        return false;
+    }
+    
+    unsigned char buffer[REPLAY_HEADER_SIZE];
+    memcpy(buffer, "W3DR", 4);
+    PutU16(buffer + 4, REPLAY_VERSION);
+    PutU16(buffer + 6, 0);
+    PutF32(buffer + 8, header->tickRate);
+    PutU32(buffer + 12, (uint32_t)header->mapWidth);
+    PutU32(buffer + 16, (uint32_t)header->mapHeight);
+    PutF32(buffer + 20, header->startPosition.x);
+    PutF32(buffer + 24, header->startPosition.y);
+    PutF32(buffer + 28, header->startAngle);
+    fwrite(buffer, 1, sizeof(buffer), recorder->file);
+    
+    TraceLog(LOG_INFO, "Recording input to %s", path);
+    return true;
+}
+
+void RecordReplayTick(ReplayRecorder* recorder, const PlayerInput* input) {
+    if (recorder->file == NULL) return;
+    
+    // Extend the current run while the input repeats (mouse turns compare bit for bit)
+    bool same = recorder->runLength > 0 &&
+                recorder->runInput.buttons == input->buttons &&
+                memcmp(&recorder->runInput.mouseTurn, &input->mouseTurn, sizeof(float)) == 0;
+    
+    if (!same || recorder->runLength == UINT32_MAX) {
+        if (recorder->runLength > 0) WriteReplayRun(recorder, &recorder->runInput, recorder->runLength);
+        recorder->runInput = *input;
+        recorder->runLength = 0;
+    }
+    
+    recorder->runLength++;
+    recorder->tickCount++;
+}
+
+void EndReplayRecording(ReplayRecorder* recorder, const ReplayFinalState* finalState) {
+    if (recorder->file == NULL) return;
+    
+    if (recorder->runLength > 0) WriteReplayRun(recorder, &recorder->runInput, recorder->runLength);
+    
+    // End marker: a run of zero ticks
+    unsigned char buffer[2 + REPLAY_FOOTER_SIZE] = { 0, 0 };
+    unsigned char* footer = buffer + 2;
+    memcpy(footer, "W3DE", 4);
+    PutU64(footer + 4, finalState->tickCount);
+    PutF32(footer + 12, finalState->position.x);
+    PutF32(footer + 16, finalState->position.y);
+    PutF32(footer + 20, finalState->direction.x);
+    PutF32(footer + 24, finalState->direction.y);
+    PutF32(footer + 28, finalState->angle);
+    PutU32(footer + 32, finalState->mapRevision);
+    PutU32(footer + 36, 0);
+    fwrite(buffer, 1, sizeof(buffer), recorder->file);
+    
+    fclose(recorder->file);
+    TraceLog(LOG_INFO, "Replay recording finished: %llu ticks", recorder->tickCount);
+    memset(recorder, 0, sizeof(*recorder));
+}
+
+//----------------------------------------------------------------------------------
+// Playback
+//----------------------------------------------------------------------------------
+
+bool LoadReplay(ReplayPlayback* playback, const char* path) {
+    memset(playback, 0, sizeof(*playback));
+    
+    playback->data = LoadFileData(path, &playback->size);
+    if (playback->data == NULL) {
+        TraceLog(LOG_WARNING, "Failed to load replay %s", path);
+        return false;
+    }
+    
+    const unsigned char* in = playback->data;
+    if (playback->size < REPLAY_HEADER_SIZE || memcmp(in, "W3DR", 4) != 0 || GetU16(in + 4) != REPLAY_VERSION) {
+        TraceLog(LOG_WARNING, "%s is not a version %d replay", path, REPLAY_VERSION);
+        UnloadReplay(playback);
+        return false;
+    }
+    
+    playback->header.tickRate = GetF32(in + 8);
+    playback->header.mapWidth = (int)GetU32(in + 12);
+    playback->header.mapHeight = (int)GetU32(in + 16);
+    playback->header.startPosition = (Vector2){ GetF32(in + 20), GetF32(in + 24) };
+    playback->header.startAngle = GetF32(in + 28);
+    playback->offset = REPLAY_HEADER_SIZE;
+    
+    // The tick rate becomes the fixed timestep's divisor
+    if (!isfinite(playback->header.tickRate) || playback->header.tickRate <= 0.0f) {
+        TraceLog(LOG_WARNING, "%s has an invalid tick rate (%g)", path, playback->header.tickRate);
+        UnloadReplay(playback);
+        return false;
+    }
+    
+    TraceLog(LOG_INFO, "Replaying %s (%.0f Hz, %dx%d map)", path,
+             playback->header.tickRate, playback->header.mapWidth, playback->header.mapHeight);
+    return true;
+}
+
+// Reads the next run; false at the end marker or a truncated file
+static bool ReadReplayRun(ReplayPlayback* playback) {
+    const unsigned char* in = playback->data;
+    unsigned int offset = playback->offset;
+    
+    if (offset >= playback->size) return false;
+    unsigned char flags = in[offset++];
+    
+    PlayerInput input = { flags & 0x7f, 0.0f };
+    if (flags & REPLAY_FLAG_MOUSE) {
+        if (offset + 4 > playback->size) return false;
+        input.mouseTurn = GetF32(in + offset);
+        offset += 4;
+    }
+    
+    unsigned long long length = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (offset >= playback->size || shift > 63) return false;
+        unsigned char byte = in[offset++];
+        length |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    
+    playback->offset = offset;
+    
+    if (length == 0) {
+        // End marker, the footer follows
+        if (offset + REPLAY_FOOTER_SIZE <= playback->size && memcmp(in + offset, "W3DE", 4) == 0) {
+            const unsigned char* footer = in + offset;
+            playback->finalState.tickCount = GetU64(footer + 4);
+            playback->finalState.position = (Vector2){ GetF32(footer + 12), GetF32(footer + 16) };
+            playback->finalState.direction = (Vector2){ GetF32(footer + 20), GetF32(footer + 24) };
+            playback->finalState.angle = GetF32(footer + 28);
+            playback->finalState.mapRevision = GetU32(footer + 32);
+            playback->hasFinalState = true;
+        }
+        playback->offset = playback->size;
+        return false;
+    }
+    
+    playback->runInput = input;
+    playback->runLeft = length;
+    return true;
+}
+
+bool NextReplayInput(ReplayPlayback* playback, PlayerInput* input) {
+    if (playback->data == NULL) return false;
+    if (playback->runLeft == 0 && !ReadReplayRun(playback)) return false;
+    
+    *input = playback->runInput;
+    playback->runLeft--;
+    playback->tickCount++;
+    return true;
+}
+
+void UnloadReplay(ReplayPlayback* playback) {
+    if (playback->data != NULL) UnloadFileData(playback->data);
+    memset(playback, 0, sizeof(*playback));
+}
+
+//----------------------------------------------------------------------------------
+// Verification
+//----------------------------------------------------------------------------------
+
+ReplayFinalState GetReplayFinalState(const Player* player, const Map* map, unsigned long long tickCount) {
+    ReplayFinalState state = {
+        .tickCount = tickCount,
+        .position = player->position,
+        .direction = player->direction,
+        .angle = player->angle,
+        .mapRevision = map->revision
+    };
+    return state;
+}
+
+static bool SameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+bool CheckReplayStart(const ReplayHeader* header, const Map* map, const Player* player) {
+    if (header->mapWidth != map->width || header->mapHeight != map->height) {
+        TraceLog(LOG_WARNING, "Replay was recorded on a %dx%d map, current map is %dx%d",
+                 header->mapWidth, header->mapHeight, map->width, map->height);
+        return false;
+    }
+    
+    // Same size is not the same level: the run must also begin where it was recorded
+    if (!SameFloat(header->startPosition.x, player->position.x) || !SameFloat(header->startPosition.y, player->position.y) ||
+        !SameFloat(header->startAngle, player->angle)) {
+        TraceLog(LOG_WARNING, "Replay starts at (%.9g, %.9g) angle %.9g, the player starts at (%.9g, %.9g) angle %.9g",
+                 header->startPosition.x, header->startPosition.y, header->startAngle,
+                 player->position.x, player->position.y, player->angle);
+        return false;
+    }
+    return true;
+}
+
+bool CompareReplayFinalState(const ReplayFinalState* expected, const ReplayFinalState* actual) {
+    bool match = true;
+    
+    if (expected->tickCount != actual->tickCount) {
+        TraceLog(LOG_WARNING, "Replay ticks: expected %llu, got %llu", expected->tickCount, actual->tickCount);
+        match = false;
+    }
+    if (!SameFloat(expected->position.x, actual->position.x) || !SameFloat(expected->position.y, actual->position.y)) {
+        TraceLog(LOG_WARNING, "Replay position: expected (%.9g, %.9g), got (%.9g, %.9g)",
+                 expected->position.x, expected->position.y, actual->position.x, actual->position.y);
+        match = false;
+    }
+    if (!SameFloat(expected->direction.x, actual->direction.x) || !SameFloat(expected->direction.y, actual->direction.y) ||
+        !SameFloat(expected->angle, actual->angle)) {
+        TraceLog(LOG_WARNING, "Replay view: expected angle %.9g, got %.9g", expected->angle, actual->angle);
+        match = false;
+    }
+    if (expected->mapRevision != actual->mapRevision) {
+        TraceLog(LOG_WARNING, "Replay map revision: expected %u, got %u", expected->mapRevision, actual->mapRevision);
+        match = false;
+    }
+    
+    return match;
+}
+
+//----------------------------------------------------------------------------------
+// Headless playback
+//----------------------------------------------------------------------------------
+
+int RunReplayHeadless(const char* path, const char* levelPath, bool verify) {
+    ReplayPlayback playback;
+    if (!LoadReplay(&playback, path)) return 1;
+    
+    GameState state;
+    InitGameHeadless(&state, levelPath);
+    
+    if (!CheckReplayStart(&playback.header, &state.map, &state.player)) {
+        UnloadReplay(&playback);
+        UnloadGame(&state);
+        return 1;
+    }
+    state.tickRate = playback.header.tickRate;
+    
+    // Simulate every tick back to back
+    PlayerInput input;
+    uint64_t start = GetTimestampNs();
+    while (NextReplayInput(&playback, &input)) {
+        SimulateGameTick(&state, &input);
+    }
+    double seconds = (GetTimestampNs() - start) / 1e9;
+    
+    double gameSeconds = state.tickCount / state.tickRate;
+    printf("replay: %llu ticks (%.1f s of play) in %.3f ms, %.0f ticks/s, %.0fx real time\n",
+           state.tickCount, gameSeconds, seconds * 1000.0,
+           (seconds > 0.0) ? state.tickCount / seconds : 0.0,
+           (seconds > 0.0) ? gameSeconds / seconds : 0.0);
+    
+    ReplayFinalState actual = GetReplayFinalState(&state.player, &state.map, state.tickCount);
+    printf("final: position (%.3f, %.3f) angle %.4f map revision %u\n",
+           actual.position.x, actual.position.y, actual.angle, actual.mapRevision);
+    
+    int result = 0;
+    if (verify) {
+        if (!playback.hasFinalState) {
+            printf("verify: FAILED (replay has no final state, was the recording cut short?)\n");
+            result = 2;
+        } else if (CompareReplayFinalState(&playback.finalState, &actual)) {
+            printf("verify: OK\n");
+        } else {
+            printf("verify: FAILED\n");
+            result = 2;
+        }
+    }
+    
+    UnloadReplay(&playback);
+    UnloadGame(&state);
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "raylib.h"
+#include "../World/player.h"
+#include "../World/map.h"
+
+// Input replays: the PlayerInput of every simulation tick, run-length encoded.
+//
+// File layout (little endian):
+//   header  "W3DR", u16 version, u16 reserved, f32 tickRate, i32 mapWidth,
+//           i32 mapHeight, f32 startX, f32 startY, f32 startAngle
+//   runs    u8 flags (PLAYER_INPUT_* buttons, bit 7 = f32 mouseTurn follows),
+//           [f32 mouseTurn], uleb128 tick count (>= 1)
+//   end     u8 0, uleb128 0
+//   footer  "W3DE", u64 ticks, f32 x, f32 y, f32 dirX, f32 dirY, f32 angle, u32 mapRevision
+//
+// A file cut short (crash, kill) still replays; it just has no footer to verify against.
+
+#define REPLAY_VERSION 1
+#define REPLAY_FLAG_MOUSE 0x80
+
+typedef struct ReplayHeader {
+    float tickRate;
+    int mapWidth;
+    int mapHeight;
+    Vector2 startPosition;
+    float startAngle;
+} ReplayHeader;
+
+// Simulation state a replay must reproduce exactly
+typedef struct ReplayFinalState {
+    unsigned long long tickCount;
+    Vector2 position;
+    Vector2 direction;
+    float angle;
+    unsigned int mapRevision;
+} ReplayFinalState;
+
+typedef struct ReplayRecorder {
+    FILE* file;                 // NULL when not recording
+    PlayerInput runInput;       // Input of the run being accumulated
+    unsigned int runLength;
+    unsigned long long tickCount;
+} ReplayRecorder;
+
+typedef struct ReplayPlayback {
+    unsigned char* data;        // Whole file, NULL when not replaying
+    unsigned int size;
+    unsigned int offset;
+    ReplayHeader header;
+    PlayerInput runInput;
+    unsigned long long runLeft;
+    unsigned long long tickCount; // Ticks handed out so far
+    bool hasFinalState;         // Set once the end marker and footer have been read
+    ReplayFinalState finalState;
+} ReplayPlayback;
+
+bool BeginReplayRecording(ReplayRecorder* recorder, const char* path, const ReplayHeader* header);
+void RecordReplayTick(ReplayRecorder* recorder, const PlayerInput* input);
+void EndReplayRecording(ReplayRecorder* recorder, const ReplayFinalState* finalState);
+
+bool LoadReplay(ReplayPlayback* playback, const char* path);
+bool NextReplayInput(ReplayPlayback* playback, PlayerInput* input); // False once the replay is exhausted
+void UnloadReplay(ReplayPlayback* playback);
+
+ReplayFinalState GetReplayFinalState(const Player* player, const Map* map, unsigned long long tickCount);
+bool CompareReplayFinalState(const ReplayFinalState* expected, const ReplayFinalState* actual); // Logs every mismatch
+
+// False (and logs why) unless the replay was recorded on a map of this size
+// with the player starting at exactly this position and angle
+bool CheckReplayStart(const ReplayHeader* header, const Map* map, const Player* player);
+
+// Runs a replay without a window as fast as possible on the built-in map or
+// the level it was recorded on; returns a process exit code
+int RunReplayHeadless(const char* path, const char* levelPath, bool verify);
+
+#endif // REPLAY_H
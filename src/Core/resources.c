@@ -1,56 +1,489 @@
 #include "resources.h"
 #include "raylib.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
-void LoadGameResources(GameTextures* textures) {
-    // For now, generate placeholder textures
-    // In a real implementation, you would load textures from files
+#define CACHE_FILE_MAGIC "RIMG"
+#define CACHE_FILE_VERSION 1
+#define CACHE_MAX_IMAGE_SIZE 8192
+#define MAX_RESOURCE_ALIASES 4 // Keys remembered per entry besides the one it was made from
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+// A cache file: this header, then the RGBA8 pixels
+typedef struct CachedImageHeader {
+    char magic[4];              // CACHE_FILE_MAGIC
+    uint32_t version;           // CACHE_FILE_VERSION
+    int32_t width;
+    int32_t height;
+    int32_t format;             // Always PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    uint32_t reserved;
+    uint64_t contentHash;       // FNV-1a over the pixels
+} CachedImageHeader;
+
+typedef struct ResourceEntry {
+    uint64_t key;               // Hash of what the image was made from
+    uint64_t aliases[MAX_RESOURCE_ALIASES]; // Other keys that produced the same pixels
+    int aliasCount;
+    uint64_t contentHash;       // Hash of its pixels
+    ResourceCategory category;
+    int refCount;               // 0 for a free slot
+    unsigned short generation;  // Bumped when the slot is freed, so old handles go stale
+    Image image;                // RGBA8
+    Texture2D texture;          // id 0 until the first GetResourceTexture
+} ResourceEntry;
+
+static ResourceEntry entries[MAX_RESOURCES];
+static char cacheDirectory[256] = "";   // Empty when there is no disk cache
+static bool cacheDirectoryMade = false;
+static ResourceStats stats = { 0 };
+
+static const char* CATEGORY_NAMES[RESOURCE_CATEGORY_COUNT] = { "walls", "flats", "sprites", "atlases" };
+
+//----------------------------------------------------------------------------------
+// Hashing
+//----------------------------------------------------------------------------------
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t HashInt(uint64_t hash, int64_t value) {
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t HashColor(uint64_t hash, Color color) {
+    return HashInt(hash, ((int64_t)color.r << 24) | (color.g << 16) | (color.b << 8) | color.a);
+}
+
+// Field by field, so struct padding never reaches the key
+static uint64_t HashRecipe(const ImageRecipe* recipe) {
+    uint64_t hash = HashBytes(FNV_OFFSET_BASIS, "recipe", 6);
+    hash = HashInt(hash, recipe->type);
+    hash = HashInt(hash, recipe->width);
+    hash = HashInt(hash, recipe->height);
+    if (recipe->type == IMAGE_RECIPE_CHECKED) {
+        hash = HashInt(hash, recipe->checkSize);
+    } else {
+        hash = HashInt(hash, (int64_t)recipe->shape.x);
+        hash = HashInt(hash, (int64_t)recipe->shape.y);
+        hash = HashInt(hash, (int64_t)recipe->shape.width);
+        hash = HashInt(hash, (int64_t)recipe->shape.height);
+    }
+    hash = HashColor(hash, recipe->color1);
+    return HashColor(hash, recipe->color2);
+}
+
+static size_t GetImageBytes(Image image) {
+    return (size_t)GetPixelDataSize(image.width, image.height, image.format);
+}
+
+static uint64_t HashPixels(Image image) {
+    return HashBytes(FNV_OFFSET_BASIS, image.data, GetImageBytes(image));
+}
+
+//----------------------------------------------------------------------------------
+// Disk cache
+//----------------------------------------------------------------------------------
+
+static void GetCachePath(uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.img", cacheDirectory, (unsigned long long)key);
+}
+
+static bool ReadCachedImage(uint64_t key, Image* image) {
+    if (cacheDirectory[0] == '\0') return false;
     
-    // Create checkerboard patterns for different wall textures
-    for (int i = 0; i < 8; i++) {
-        Color color1 = BLACK;
-        Color color2 = WHITE;
+    char path[512];
+    GetCachePath(key, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    
+    CachedImageHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, CACHE_FILE_MAGIC, 4) == 0 && header.version == CACHE_FILE_VERSION &&
+              header.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 &&
+              header.width > 0 && header.width <= CACHE_MAX_IMAGE_SIZE &&
+              header.height > 0 && header.height <= CACHE_MAX_IMAGE_SIZE;
+    
+    // A file that does not hash to what its header says is thrown away and regenerated
+    unsigned char* pixels = NULL;
+    size_t size = 0;
+    if (ok) {
+        size = (size_t)header.width * header.height * 4;
+        pixels = (unsigned char*)MemAlloc((unsigned int)size);
+        ok = pixels != NULL && fread(pixels, 1, size, file) == size &&
+             HashBytes(FNV_OFFSET_BASIS, pixels, size) == header.contentHash;
+    }
+    fclose(file);
+    
+    if (!ok) {
+        TraceLog(LOG_WARNING, "Ignoring damaged image cache file %s", path);
+        MemFree(pixels);
+        return false;
+    }
+    
+    *image = (Image){ pixels, header.width, header.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    return true;
+}
+
+static void WriteCachedImage(uint64_t key, Image image) {
+    if (cacheDirectory[0] == '\0') return;
+    
+    if (!cacheDirectoryMade) {
+#ifdef _WIN32
+        _mkdir(cacheDirectory);
+#else
+        mkdir(cacheDirectory, 0755);
+#endif
+        cacheDirectoryMade = true;
+    }
+    
+    CachedImageHeader header = { 0 };
+    memcpy(header.magic, CACHE_FILE_MAGIC, 4);
+    header.version = CACHE_FILE_VERSION;
+    header.width = image.width;
+    header.height = image.height;
+    header.format = image.format;
+    header.contentHash = HashPixels(image);
+    
+    // Written aside and renamed into place, so a crash never leaves a half file under the real name
+    char path[512];
+    char tempPath[520];
+    GetCachePath(key, path, sizeof(path));
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    
+    FILE* file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "Failed to write image cache file %s", tempPath);
+        return;
+    }
+    size_t size = GetImageBytes(image);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(image.data, 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tempPath, path) != 0) {
+        TraceLog(LOG_WARNING, "Failed to write image cache file %s", path);
+        remove(tempPath);
+    }
+}
+
+//----------------------------------------------------------------------------------
+// Entries
+//----------------------------------------------------------------------------------
+
+static ResourceHandle MakeHandle(int index) {
+    return ((ResourceHandle)entries[index].generation << 16) | (ResourceHandle)(index + 1);
+}
+
+static ResourceEntry* GetEntry(ResourceHandle handle) {
+    unsigned int index = (handle & 0xffff) - 1; // Handle 0 wraps to an out of range index
+    if (index >= MAX_RESOURCES) return NULL;
+    
+    ResourceEntry* entry = &entries[index];
+    if (entry->refCount == 0 || entry->generation != (handle >> 16)) return NULL;
+    return entry;
+}
+
+static void FreeEntry(ResourceEntry* entry) {
+    if (entry->texture.id != 0) UnloadTexture(entry->texture);
+    UnloadImage(entry->image);
+    
+    unsigned short generation = entry->generation + 1;
+    memset(entry, 0, sizeof(*entry));
+    entry->generation = generation;
+}
+
+static bool IsResourceKey(const ResourceEntry* entry, uint64_t key) {
+    if (entry->key == key) return true;
+    for (int i = 0; i < entry->aliasCount; i++) {
+        if (entry->aliases[i] == key) return true;
+    }
+    return false;
+}
+
+// Another reference to the entry made from `key`, 0 if there is none
+static ResourceHandle ShareResource(uint64_t key) {
+    for (int i = 0; i < MAX_RESOURCES; i++) {
+        if (entries[i].refCount == 0 || !IsResourceKey(&entries[i], key)) continue;
         
-        switch (i % 4) {
-            case 0: color1 = RED; color2 = MAROON; break;
-            case 1: color1 = GREEN; color2 = DARKGREEN; break;
-            case 2: color1 = BLUE; color2 = DARKBLUE; break;
-            case 3: color1 = YELLOW; color2 = GOLD; break;
+        entries[i].refCount++;
+        stats.sharedHits++;
+        return MakeHandle(i);
+    }
+    return 0;
+}
+
+// Takes ownership of the image. An image with the same pixels as an entry
+// already held is dropped and that entry shared instead, and `key` is
+// remembered as an alias so the next request for it is shared straight away.
+static ResourceHandle StoreResource(uint64_t key, Image image, ResourceCategory category) {
+    if (image.data == NULL) return 0;
+    
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    uint64_t contentHash = HashPixels(image);
+    
+    int freeSlot = -1;
+    for (int i = 0; i < MAX_RESOURCES; i++) {
+        ResourceEntry* entry = &entries[i];
+        if (entry->refCount == 0) {
+            if (freeSlot < 0) freeSlot = i;
+            continue;
         }
+        if (entry->contentHash != contentHash || entry->image.width != image.width ||
+            entry->image.height != image.height) continue;
         
-        Image img = GenImageChecked(64, 64, 8, 8, color1, color2);
-        textures->walls[i] = LoadTextureFromImage(img);
-        UnloadImage(img);
+        UnloadImage(image);
+        if (!IsResourceKey(entry, key) && entry->aliasCount < MAX_RESOURCE_ALIASES) {
+            entry->aliases[entry->aliasCount++] = key;
+        }
+        entry->refCount++;
+        stats.sharedHits++;
+        return MakeHandle(i);
     }
     
-    // Floor texture
-    Image floorImg = GenImageChecked(64, 64, 16, 16, DARKGRAY, GRAY);
-    textures->floor = LoadTextureFromImage(floorImg);
-    UnloadImage(floorImg);
+    if (freeSlot < 0) {
+        TraceLog(LOG_WARNING, "Out of resource slots (%d), an image was not loaded", MAX_RESOURCES);
+        UnloadImage(image);
+        return 0;
+    }
     
-    // Ceiling texture
-    Image ceilingImg = GenImageChecked(64, 64, 32, 32, SKYBLUE, BLUE);
-    textures->ceiling = LoadTextureFromImage(ceilingImg);
-    UnloadImage(ceilingImg);
+    ResourceEntry* entry = &entries[freeSlot];
+    entry->key = key;
+    entry->aliasCount = 0;
+    entry->contentHash = contentHash;
+    entry->category = category;
+    entry->refCount = 1;
+    entry->image = image;
+    entry->texture = (Texture2D){ 0 };
+    return MakeHandle(freeSlot);
+}
+
+static Image GenerateImage(const ImageRecipe* recipe) {
+    if (recipe->type == IMAGE_RECIPE_CHECKED) {
+        return GenImageChecked(recipe->width, recipe->height, recipe->checkSize, recipe->checkSize,
+                               recipe->color1, recipe->color2);
+    }
     
-    // Placeholder sprite textures
-    for (int i = 0; i < 8; i++) {
-        Image spriteImg = GenImageColor(64, 64, ColorAlpha(PURPLE, 0.0f));
+    Image image = GenImageColor(recipe->width, recipe->height, recipe->color2);
+    ImageDrawRectangle(&image, (int)recipe->shape.x, (int)recipe->shape.y,
+                       (int)recipe->shape.width, (int)recipe->shape.height, recipe->color1);
+    return image;
+}
+
+//----------------------------------------------------------------------------------
+// Resource manager
+//----------------------------------------------------------------------------------
+
+void InitResources(const char* cacheDir) {
+    snprintf(cacheDirectory, sizeof(cacheDirectory), "%s", (cacheDir != NULL) ? cacheDir : "");
+    cacheDirectoryMade = false;
+    stats = (ResourceStats){ 0 };
+}
+
+void UnloadResources(void) {
+    for (int i = 0; i < MAX_RESOURCES; i++) {
+        ResourceEntry* entry = &entries[i];
+        if (entry->refCount == 0) continue;
+        
+        TraceLog(LOG_WARNING, "Resource %d (%s, %dx%d) still held %d times at shutdown", i,
+                 CATEGORY_NAMES[entry->category], entry->image.width, entry->image.height, entry->refCount);
+        FreeEntry(entry);
+    }
+}
+
+ResourceHandle AcquireGeneratedImage(const ImageRecipe* recipe, ResourceCategory category) {
+    stats.requests++;
+    uint64_t key = HashRecipe(recipe);
+    ResourceHandle handle = ShareResource(key);
+    if (handle != 0) return handle;
+    
+    uint64_t start = GetTimestampNs();
+    Image image;
+    if (ReadCachedImage(key, &image)) {
+        stats.cacheHits++;
+    } else {
+        image = GenerateImage(recipe);
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        WriteCachedImage(key, image);
+        stats.cacheMisses++;
+    }
+    
+    handle = StoreResource(key, image, category);
+    stats.produceMs += (GetTimestampNs() - start) / 1e6;
+    return handle;
+}
+
+ResourceHandle AcquireImageFile(const char* path, ResourceCategory category) {
+    stats.requests++;
+    uint64_t start = GetTimestampNs();
+    unsigned int size = 0;
+    unsigned char* data = LoadFileData(path, &size);
+    if (data == NULL) return 0;
+    
+    // Keyed by the file's bytes, so an edited file is decoded again
+    uint64_t key = HashBytes(HashBytes(FNV_OFFSET_BASIS, "file", 4), data, size);
+    ResourceHandle handle = ShareResource(key);
+    
+    if (handle == 0) {
+        Image image;
+        if (ReadCachedImage(key, &image)) {
+            stats.cacheHits++;
+        } else {
+            image = LoadImageFromMemory(GetFileExtension(path), data, (int)size);
+            if (image.data != NULL) {
+                ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+                WriteCachedImage(key, image);
+            }
+            stats.cacheMisses++;
+        }
+        handle = StoreResource(key, image, category);
+    }
+    
+    UnloadFileData(data);
+    stats.produceMs += (GetTimestampNs() - start) / 1e6;
+    return handle;
+}
+
+ResourceHandle AcquireImageAtlas(const ResourceHandle* cells, int count, ResourceCategory category) {
+    stats.requests++;
+    if (count <= 0) return 0;
+    
+    // Keyed by the cells' pixels, whatever handles they came through
+    const ResourceEntry* first = GetEntry(cells[0]);
+    uint64_t key = HashBytes(FNV_OFFSET_BASIS, "atlas", 5);
+    for (int i = 0; i < count; i++) {
+        const ResourceEntry* cell = GetEntry(cells[i]);
+        if (cell == NULL || first == NULL || cell->image.width != first->image.width ||
+            cell->image.height != first->image.height) {
+            TraceLog(LOG_WARNING, "Atlas cells have to be live images of the same size");
+            return 0;
+        }
+        key = HashInt(key, (int64_t)cell->contentHash);
+    }
+    ResourceHandle handle = ShareResource(key);
+    if (handle != 0) return handle;
+    
+    // Packing is a row copy per cell, not worth a cache file
+    uint64_t start = GetTimestampNs();
+    int cellWidth = first->image.width;
+    int height = first->image.height;
+    Image atlas = GenImageColor(cellWidth * count, height, BLANK);
+    for (int i = 0; i < count; i++) {
+        const Image* cell = &GetEntry(cells[i])->image;
+        for (int y = 0; y < height; y++) {
+            memcpy((unsigned char*)atlas.data + ((size_t)y * atlas.width + (size_t)i * cellWidth) * 4,
+                   (const unsigned char*)cell->data + (size_t)y * cellWidth * 4, (size_t)cellWidth * 4);
+        }
+    }
+    
+    handle = StoreResource(key, atlas, category);
+    stats.produceMs += (GetTimestampNs() - start) / 1e6;
+    return handle;
+}
+
+void RetainResource(ResourceHandle handle) {
+    ResourceEntry* entry = GetEntry(handle);
+    if (entry != NULL) entry->refCount++;
+}
+
+void ReleaseResource(ResourceHandle handle) {
+    if (handle == 0) return;
+    
+    ResourceEntry* entry = GetEntry(handle);
+    if (entry == NULL) {
+        TraceLog(LOG_WARNING, "Released a stale resource handle %08x", handle);
+        return;
+    }
+    if (--entry->refCount == 0) FreeEntry(entry);
+}
+
+const Image* GetResourceImage(ResourceHandle handle) {
+    const ResourceEntry* entry = GetEntry(handle);
+    return (entry != NULL) ? &entry->image : NULL;
+}
+
+Texture2D GetResourceTexture(ResourceHandle handle) {
+    ResourceEntry* entry = GetEntry(handle);
+    if (entry == NULL) return (Texture2D){ 0 };
+    
+    if (entry->texture.id == 0) entry->texture = LoadTextureFromImage(entry->image);
+    return entry->texture;
+}
+
+ResourceStats GetResourceStats(void) {
+    ResourceStats result = stats;
+    for (int i = 0; i < MAX_RESOURCES; i++) {
+        const ResourceEntry* entry = &entries[i];
+        if (entry->refCount == 0) continue;
         
-        // Draw a simple shape in the center
-        ImageDrawRectangle(&spriteImg, 16, 16, 32, 32, ColorAlpha(PURPLE, 1.0f));
+        result.count[entry->category]++;
+        result.cpuBytes[entry->category] += GetImageBytes(entry->image);
+        if (entry->texture.id != 0) {
+            result.gpuBytes[entry->category] +=
+                (size_t)GetPixelDataSize(entry->texture.width, entry->texture.height, entry->texture.format);
+        }
+    }
+    return result;
+}
+
+void LogResourceStats(void) {
+    ResourceStats current = GetResourceStats();
+    for (int c = 0; c < RESOURCE_CATEGORY_COUNT; c++) {
+        TraceLog(LOG_INFO, "Resources: %-8s %3d images, %8.1f KB CPU, %8.1f KB GPU", CATEGORY_NAMES[c],
+                 current.count[c], current.cpuBytes[c] / 1024.0, current.gpuBytes[c] / 1024.0);
+    }
+    TraceLog(LOG_INFO, "Resources: %d requests, %d shared, %d read from the cache, %d generated or decoded, %.2f ms",
+             current.requests, current.sharedHits, current.cacheHits, current.cacheMisses, current.produceMs);
+}
+
+//----------------------------------------------------------------------------------
+// Game textures
+//----------------------------------------------------------------------------------
+
+void LoadGameResources(GameTextures* textures) {
+    // Placeholder textures; in a real implementation these would be AcquireImageFile calls
+    const ImageRecipe floorRecipe = { IMAGE_RECIPE_CHECKED, 64, 64, 16, { 0, 0, 0, 0 }, DARKGRAY, GRAY };
+    const ImageRecipe ceilingRecipe = { IMAGE_RECIPE_CHECKED, 64, 64, 32, { 0, 0, 0, 0 }, SKYBLUE, BLUE };
+    textures->handles[0] = AcquireGeneratedImage(&floorRecipe, RESOURCE_FLAT);
+    textures->handles[1] = AcquireGeneratedImage(&ceilingRecipe, RESOURCE_FLAT);
+    textures->floor = GetResourceTexture(textures->handles[0]);
+    textures->ceiling = GetResourceTexture(textures->handles[1]);
+    const Image* floorImage = GetResourceImage(textures->handles[0]);
+    const Image* ceilingImage = GetResourceImage(textures->handles[1]);
+    textures->floorImage = (floorImage != NULL) ? *floorImage : (Image){ 0 }; // The raycaster falls back to flat colours
+    textures->ceilingImage = (ceilingImage != NULL) ? *ceilingImage : (Image){ 0 };
+    
+    // Placeholder sprite textures, kept on the CPU as well for the software renderer:
+    // a simple shape standing on the bottom edge, boxes and pillars
+    static const Color SPRITE_COLORS[8] = { PURPLE, GOLD, LIME, ORANGE, SKYBLUE, PINK, BEIGE, MAROON };
+    for (int i = 0; i < 8; i++) {
+        ImageRecipe recipe = { IMAGE_RECIPE_SHAPE, 64, 64, 0, { 16, 32, 32, 32 }, SPRITE_COLORS[i], ColorAlpha(SPRITE_COLORS[i], 0.0f) };
+        if (i % 2 != 0) recipe.shape = (Rectangle){ 24, 8, 16, 56 };
         
-        textures->sprites[i] = LoadTextureFromImage(spriteImg);
-        UnloadImage(spriteImg);
+        ResourceHandle handle = AcquireGeneratedImage(&recipe, RESOURCE_SPRITE);
+        const Image* image = GetResourceImage(handle);
+        textures->handles[2 + i] = handle;
+        textures->sprites[i] = GetResourceTexture(handle);
+        textures->spriteImages[i] = (image != NULL) ? *image : GenImageColor(64, 64, BLANK);
     }
 }
 
 void UnloadGameResources(GameTextures* textures) {
-    // Unload all textures
-    for (int i = 0; i < 8; i++) {
-        UnloadTexture(textures->walls[i]);
-        UnloadTexture(textures->sprites[i]);
+    // Images and textures belong to the resource manager
+    for (int i = 0; i < 10; i++) {
+        if (textures->handles[i] == 0 && i >= 2) UnloadImage(textures->spriteImages[i - 2]);
+        ReleaseResource(textures->handles[i]);
+        textures->handles[i] = 0;
     }
-    
-    UnloadTexture(textures->floor);
-    UnloadTexture(textures->ceiling);
-}
\ No newline at end of file
+}
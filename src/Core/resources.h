@@ -2,17 +2,92 @@
 #define RESOURCES_H
 
 #include "raylib.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Resource manager: every image the game uses is acquired here and shared.
+//
+// An image is requested by what it is made from (a generation recipe or the
+// bytes of an image file). A request the manager has seen before returns the
+// same entry, and an image whose pixels match an entry already held is
+// dropped in favour of that entry, so each distinct image exists once on the
+// CPU and once on the GPU. Handles are reference counted; the last
+// ReleaseResource frees the image and its texture.
+//
+// With a cache directory, every generated or decoded image is also written
+// there under the hash of what it was made from, and later launches read the
+// pixels back instead of generating or decoding them again.
+
+#define MAX_RESOURCES 128
+#define RESOURCE_CACHE_DIR "cache"  // Default cache directory, relative to the working directory
+
+// Slot index + 1 in the low 16 bits, the slot's generation above; 0 is no resource
+typedef unsigned int ResourceHandle;
+
+typedef enum {
+    RESOURCE_WALL,
+    RESOURCE_FLAT,                  // Floor and ceiling
+    RESOURCE_SPRITE,
+    RESOURCE_ATLAS,
+    RESOURCE_CATEGORY_COUNT
+} ResourceCategory;
+
+typedef enum {
+    IMAGE_RECIPE_CHECKED,           // Checkerboard of color1 and color2 squares
+    IMAGE_RECIPE_SHAPE              // color1 rectangle on a color2 background
+} ImageRecipeType;
+
+// How to generate an image; its hash is the cache key
+typedef struct ImageRecipe {
+    ImageRecipeType type;
+    int width, height;
+    int checkSize;                  // CHECKED: side of one square in pixels
+    Rectangle shape;                // SHAPE: the rectangle, in pixels
+    Color color1, color2;
+} ImageRecipe;
+
+typedef struct ResourceStats {
+    int count[RESOURCE_CATEGORY_COUNT];      // Entries held
+    size_t cpuBytes[RESOURCE_CATEGORY_COUNT];
+    size_t gpuBytes[RESOURCE_CATEGORY_COUNT];
+    int requests;                   // Acquire calls
+    int sharedHits;                 // Requests answered by an entry already held
+    int cacheHits;                  // Images read back from the disk cache
+    int cacheMisses;                // Images generated or decoded (and written to the cache)
+    double produceMs;               // Spent generating, decoding and reading the cache
+} ResourceStats;
+
+// Starts counting statistics afresh; cacheDir NULL disables the disk cache.
+// Acquiring works without this call, just without a disk cache.
+void InitResources(const char* cacheDir);
+void UnloadResources(void);         // Frees whatever is still held, logging each leak
+
+ResourceHandle AcquireGeneratedImage(const ImageRecipe* recipe, ResourceCategory category);
+ResourceHandle AcquireImageFile(const char* path, ResourceCategory category);
+// Same-size cells side by side in one row, cell i at u in [i / count, (i + 1) / count)
+ResourceHandle AcquireImageAtlas(const ResourceHandle* cells, int count, ResourceCategory category);
+void RetainResource(ResourceHandle handle);
+void ReleaseResource(ResourceHandle handle); // Ignores 0
+
+const Image* GetResourceImage(ResourceHandle handle); // RGBA8, NULL for a stale handle
+Texture2D GetResourceTexture(ResourceHandle handle);  // Uploaded on first use, needs a GL context
+
+ResourceStats GetResourceStats(void);
+void LogResourceStats(void);        // One line per category, then the request counters
 
 // Textures
 typedef struct {
-    Texture2D walls[8];  // Wall textures
     Texture2D floor;     // Floor texture
     Texture2D ceiling;   // Ceiling texture
+    Image floorImage;    // CPU copies of the floor and ceiling (RGBA8, for software rendering)
+    Image ceilingImage;
     Texture2D sprites[8]; // Sprite textures
+    Image spriteImages[8]; // CPU copies of the sprite textures (RGBA8, for software rendering)
+    ResourceHandle handles[10]; // Floor, ceiling and sprites, held until UnloadGameResources
 } GameTextures;
 
 // Resource management functions
 void LoadGameResources(GameTextures* textures);
 void UnloadGameResources(GameTextures* textures);
 
-#endif // RESOURCES_H
\ No newline at end of file
+#endif // RESOURCES_H
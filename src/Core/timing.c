@@ -0,0 +1,9 @@
+#define _POSIX_C_SOURCE 200809L
+#include "timing.h"
+#include <time.h>
+
+uint64_t GetTimestampNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
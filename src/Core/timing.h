@@ -0,0 +1,9 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+// Monotonic high-resolution clock in nanoseconds (independent of the window/GL context)
+uint64_t GetTimestampNs(void);
+
+#endif // TIMING_H
@@ -0,0 +1,142 @@
+#define _POSIX_C_SOURCE 200809L
+#include "worker_pool.h"
+#include "timing.h"
+#include "profiler.h"
+#include "raylib.h"
+#include <unistd.h>
+
+int GetCPUCoreCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) return 1;
+    if (count > MAX_WORKER_THREADS) return MAX_WORKER_THREADS;
+    return (int)count;
+}
+
+// Pull jobs until the shared counter runs out and record how long it took
+static void RunJobsOnThread(WorkerPool* pool, int threadIndex) {
+    uint64_t start = GetTimestampNs();
+    int jobs = 0;
+    
+    for (;;) {
+        int job = atomic_fetch_add_explicit(&pool->nextJob, 1, memory_order_relaxed);
+        if (job >= pool->jobCount) break;
+        
+        pool->func(pool->userData, job, threadIndex);
+        jobs++;
+    }
+    
+    pool->threadTimeNs[threadIndex] = GetTimestampNs() - start;
+    pool->threadJobs[threadIndex] = jobs;
+}
+
+static void* WorkerThreadMain(void* arg) {
+    WorkerThreadArg* threadArg = (WorkerThreadArg*)arg;
+    WorkerPool* pool = threadArg->pool;
+    unsigned int seenGeneration = 0;
+    
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        // Sleep until a new run is published or the pool shuts down
+        while (!pool->shuttingDown && pool->generation == seenGeneration) {
+            pthread_cond_wait(&pool->startCond, &pool->mutex);
+        }
+        if (pool->shuttingDown) break;
+        seenGeneration = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+        
+        RunJobsOnThread(pool, threadArg->threadIndex);
+        
+        // Report completion; the last worker wakes the caller
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->activeWorkers == 0) {
+            pthread_cond_signal(&pool->doneCond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    
+    // Pools are re-created when the thread count changes; the next pool's
+    // workers record into this thread's ring
+    ProfilerReleaseThread();
+    return NULL;
+}
+
+bool InitWorkerPool(WorkerPool* pool, int threadCount) {
+    if (threadCount <= 0) threadCount = GetCPUCoreCount();
+    if (threadCount > MAX_WORKER_THREADS) threadCount = MAX_WORKER_THREADS;
+    
+    pool->threadCount = 1;
+    pool->generation = 0;
+    pool->activeWorkers = 0;
+    pool->shuttingDown = false;
+    pool->func = NULL;
+    pool->userData = NULL;
+    pool->jobCount = 0;
+    atomic_init(&pool->nextJob, 0);
+    
+    for (int i = 0; i < MAX_WORKER_THREADS; i++) {
+        pool->threadTimeNs[i] = 0;
+        pool->threadJobs[i] = 0;
+    }
+    
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->startCond, NULL);
+    pthread_cond_init(&pool->doneCond, NULL);
+    
+    // Thread 0 is the caller, spawn the rest
+    for (int i = 1; i < threadCount; i++) {
+        pool->threadArgs[i] = (WorkerThreadArg){ pool, i };
+        if (pthread_create(&pool->threads[i], NULL, WorkerThreadMain, &pool->threadArgs[i]) != 0) {
+            TraceLog(LOG_WARNING, "Failed to create worker thread %d, using %d threads", i, pool->threadCount);
+            break;
+        }
+        pool->threadCount++;
+    }
+    
+    return pool->threadCount == threadCount;
+}
+
+void RunWorkerJobs(WorkerPool* pool, WorkerJobFunc func, void* userData, int jobCount) {
+    pool->func = func;
+    pool->userData = userData;
+    pool->jobCount = jobCount;
+    atomic_store_explicit(&pool->nextJob, 0, memory_order_relaxed);
+    
+    // Single-threaded pools run inline without touching the lock
+    if (pool->threadCount == 1) {
+        RunJobsOnThread(pool, 0);
+        return;
+    }
+    
+    // Publish the run and wake every worker
+    pthread_mutex_lock(&pool->mutex);
+    pool->activeWorkers = pool->threadCount - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->mutex);
+    
+    // The caller works too
+    RunJobsOnThread(pool, 0);
+    
+    // Wait for the stragglers
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->activeWorkers > 0) {
+        pthread_cond_wait(&pool->doneCond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void UnloadWorkerPool(WorkerPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->shuttingDown = true;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->mutex);
+    
+    for (int i = 1; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    
+    pthread_cond_destroy(&pool->startCond);
+    pthread_cond_destroy(&pool->doneCond);
+    pthread_mutex_destroy(&pool->mutex);
+    pool->threadCount = 0;
+}
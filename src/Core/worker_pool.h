@@ -0,0 +1,52 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define MAX_WORKER_THREADS 64
+
+// Job callback: called once per job index, from whichever thread picked it up
+typedef void (*WorkerJobFunc)(void* userData, int jobIndex, int threadIndex);
+
+struct WorkerPool;
+
+typedef struct WorkerThreadArg {
+    struct WorkerPool* pool;
+    int threadIndex;
+} WorkerThreadArg;
+
+// Persistent pool of worker threads. The calling thread takes part in every
+// run as thread 0, so a pool of N threads spawns N - 1 workers.
+// The pool must not be moved in memory after InitWorkerPool.
+typedef struct WorkerPool {
+    int threadCount;
+    pthread_t threads[MAX_WORKER_THREADS];
+    WorkerThreadArg threadArgs[MAX_WORKER_THREADS];
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t startCond;   // Signalled when a new run is published
+    pthread_cond_t doneCond;    // Signalled when the last worker finishes a run
+    unsigned int generation;    // Incremented for every run
+    int activeWorkers;          // Workers still busy with the current run
+    bool shuttingDown;
+    
+    // Current run
+    WorkerJobFunc func;
+    void* userData;
+    int jobCount;
+    atomic_int nextJob;
+    
+    // Stats from the last run
+    uint64_t threadTimeNs[MAX_WORKER_THREADS]; // Time each thread spent running jobs
+    int threadJobs[MAX_WORKER_THREADS];        // Jobs each thread completed
+} WorkerPool;
+
+int GetCPUCoreCount(void);
+bool InitWorkerPool(WorkerPool* pool, int threadCount); // threadCount <= 0 uses all cores
+void RunWorkerJobs(WorkerPool* pool, WorkerJobFunc func, void* userData, int jobCount); // Blocks until all jobs finish
+void UnloadWorkerPool(WorkerPool* pool);
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,197 @@
+#include "colormap.h"
+#include "shading.h"
+
+// Flat colours used without a floor or ceiling texture
+static const Color CEILING_COLOR = SKYBLUE;
+static const Color FLOOR_COLOR = DARKGRAY;
+
+#define SIDE_SHADE 0.7f            // y-side walls, a software renderer tradition the shaders lack
+
+// Tint per colormap tint slot, in GetWallColormap order (matches the GPU path)
+static const Color WALL_TINTS[COLORMAP_WALL_TINTS] = { WHITE, RED, GREEN, BLUE, PURPLE };
+
+static bool IsPowerOfTwo(int value) {
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+static bool IsUsableImage(const Image* image) {
+    return image != NULL && image->data != NULL && image->format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 &&
+           image->width > 0 && image->height > 0;
+}
+
+static bool IsUsableFlat(const Image* image) {
+    return IsUsableImage(image) && IsPowerOfTwo(image->width) && IsPowerOfTwo(image->height);
+}
+
+static const void* GetImageData(const Image* image) {
+    return image ? image->data : NULL;
+}
+
+static unsigned int PackColor(Color color) {
+    return (unsigned int)color.r | (unsigned int)color.g << 8 | (unsigned int)color.b << 16;
+}
+
+// Index of color in the palette, adding it if there is room; -1 if there is not
+static int FindPaletteColor(ShadeTables* tables, Color color, int* last) {
+    unsigned int packed = PackColor(color);
+    if (*last >= 0 && PackColor(tables->palette[*last]) == packed) return *last;
+    
+    for (int i = 0; i < tables->paletteSize; i++) {
+        if (PackColor(tables->palette[i]) == packed) return *last = i;
+    }
+    if (tables->paletteSize == COLORMAP_SIZE) return -1;
+    
+    tables->palette[tables->paletteSize] = (Color){ color.r, color.g, color.b, 255 };
+    return *last = tables->paletteSize++;
+}
+
+static int QuantizeColor(Color color) {
+    return ((color.r * 7 + 127) / 255) << 5 | ((color.g * 7 + 127) / 255) << 2 | (color.b * 3 + 127) / 255;
+}
+
+// Palette indices of an image's pixels, or of a single pixel of color
+static bool IndexImage(ShadeTables* tables, IndexedImage* out, const Image* image, Color color, bool quantize) {
+    int width = image ? image->width : 1;
+    int height = image ? image->height : 1;
+    out->indices = (unsigned char*)MemAlloc((unsigned int)(width * height));
+    if (out->indices == NULL) return false;
+    out->width = width;
+    out->height = height;
+    
+    const Color* pixels = image ? (const Color*)image->data : &color;
+    int last = -1;
+    for (int i = 0; i < width * height; i++) {
+        out->indices[i] = (unsigned char)(quantize ? QuantizeColor(pixels[i]) : FindPaletteColor(tables, pixels[i], &last));
+    }
+    return true;
+}
+
+// Adds an image's colours to the palette; false once it is full
+static bool CollectColors(ShadeTables* tables, const Image* image, Color color) {
+    const Color* pixels = image ? (const Color*)image->data : &color;
+    int count = image ? image->width * image->height : 1;
+    int last = -1;
+    for (int i = 0; i < count; i++) {
+        if (FindPaletteColor(tables, pixels[i], &last) < 0) return false;
+    }
+    return true;
+}
+
+// The shader maths for one palette entry: tint, darken with distance, then
+// mix towards the fog colour
+static Color ShadeColor(Color color, Vector3 tint, float darkness, Vector3 fog, float distance) {
+    float light = 1.0f - distance * darkness;
+    if (light < SHADE_MIN_LIGHT) light = SHADE_MIN_LIGHT;
+    if (light > 1.0f) light = 1.0f;
+    float fogFactor = expf(-distance * SHADE_FOG_DENSITY);
+    
+    float r = color.r / 255.0f * tint.x * light;
+    float g = color.g / 255.0f * tint.y * light;
+    float b = color.b / 255.0f * tint.z * light;
+    r = fog.x + (r - fog.x) * fogFactor;
+    g = fog.y + (g - fog.y) * fogFactor;
+    b = fog.z + (b - fog.z) * fogFactor;
+    
+    return (Color){ (unsigned char)(r * 255.0f + 0.5f), (unsigned char)(g * 255.0f + 0.5f), (unsigned char)(b * 255.0f + 0.5f), 255 };
+}
+
+static void FillColormap(ShadeTables* tables, int colormap, Vector3 tint, float darkness, Vector3 fog) {
+    for (int band = 0; band < COLORMAP_BANDS; band++) {
+        // Shade each band as at its middle distance
+        float root = (band + 0.5f) / COLORMAP_BAND_SCALE;
+        Color* row = tables->colormaps + ((size_t)colormap * COLORMAP_BANDS + band) * COLORMAP_SIZE;
+        for (int i = 0; i < COLORMAP_SIZE; i++) {
+            row[i] = ShadeColor(tables->palette[i], tint, darkness, fog, root * root);
+        }
+    }
+}
+
+// A flat's palette indices through every band of its colormap
+static Color* ShadeFlat(const ShadeTables* tables, const IndexedImage* image, int colormap) {
+    int texels = image->width * image->height;
+    Color* shades = (Color*)MemAlloc((unsigned int)(COLORMAP_BANDS * texels * sizeof(Color)));
+    if (shades == NULL) return NULL;
+    
+    for (int band = 0; band < COLORMAP_BANDS; band++) {
+        const Color* row = tables->colormaps + ((size_t)colormap * COLORMAP_BANDS + band) * COLORMAP_SIZE;
+        for (int i = 0; i < texels; i++) {
+            shades[band * texels + i] = row[image->indices[i]];
+        }
+    }
+    return shades;
+}
+
+bool BuildShadeTables(ShadeTables* tables, const Image* walls, const FlatTextures* flats) {
+    *tables = (ShadeTables){ 0 };
+    
+    const Image* floor = (flats && IsUsableFlat(flats->floor)) ? flats->floor : NULL;
+    const Image* ceiling = (flats && IsUsableFlat(flats->ceiling)) ? flats->ceiling : NULL;
+    
+    // Exact palette if the colours fit, the fixed 3-3-2 one if they do not
+    bool fits = CollectColors(tables, floor, FLOOR_COLOR) && CollectColors(tables, ceiling, CEILING_COLOR);
+    for (int i = 0; fits && i < COLORMAP_WALL_TEXTURES; i++) {
+        if (IsUsableImage(&walls[i])) fits = CollectColors(tables, &walls[i], BLACK);
+    }
+    if (!fits) {
+        for (int i = 0; i < COLORMAP_SIZE; i++) {
+            tables->palette[i] = (Color){ (unsigned char)((i >> 5) * 255 / 7), (unsigned char)(((i >> 2) & 7) * 255 / 7),
+                                          (unsigned char)((i & 3) * 255 / 3), 255 };
+        }
+        tables->paletteSize = COLORMAP_SIZE;
+        TraceLog(LOG_INFO, "Software textures use more than %d colours, quantizing to 3-3-2", COLORMAP_SIZE);
+    }
+    
+    bool ok = IndexImage(tables, &tables->floor, floor, FLOOR_COLOR, !fits) &&
+              IndexImage(tables, &tables->ceiling, ceiling, CEILING_COLOR, !fits);
+    for (int i = 0; ok && i < COLORMAP_WALL_TEXTURES; i++) {
+        ok = IndexImage(tables, &tables->walls[i], IsUsableImage(&walls[i]) ? &walls[i] : NULL, BLACK, !fits);
+        tables->sources[i] = walls[i].data;
+    }
+    tables->sources[COLORMAP_WALL_TEXTURES] = GetImageData(flats ? flats->floor : NULL);
+    tables->sources[COLORMAP_WALL_TEXTURES + 1] = GetImageData(flats ? flats->ceiling : NULL);
+    
+    tables->colormaps = ok ? (Color*)MemAlloc(COLORMAP_COUNT * COLORMAP_BANDS * COLORMAP_SIZE * sizeof(Color)) : NULL;
+    if (tables->colormaps == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate the software shading tables");
+        UnloadShadeTables(tables);
+        return false;
+    }
+    
+    for (int tint = 0; tint < COLORMAP_WALL_TINTS; tint++) {
+        Color color = WALL_TINTS[tint];
+        Vector3 shade = { color.r / 255.0f, color.g / 255.0f, color.b / 255.0f };
+        FillColormap(tables, tint * 2, shade, SHADE_WALL_DARKNESS, SHADE_SKY_FOG);
+        shade = (Vector3){ shade.x * SIDE_SHADE, shade.y * SIDE_SHADE, shade.z * SIDE_SHADE };
+        FillColormap(tables, tint * 2 + 1, shade, SHADE_WALL_DARKNESS, SHADE_SKY_FOG);
+    }
+    FillColormap(tables, COLORMAP_FLOOR, (Vector3){ 1.0f, 1.0f, 1.0f }, SHADE_FLAT_DARKNESS, SHADE_FLOOR_FOG);
+    FillColormap(tables, COLORMAP_CEILING, (Vector3){ 1.0f, 1.0f, 1.0f }, SHADE_FLAT_DARKNESS, SHADE_SKY_FOG);
+    
+    tables->floorShades = ShadeFlat(tables, &tables->floor, COLORMAP_FLOOR);
+    tables->ceilingShades = ShadeFlat(tables, &tables->ceiling, COLORMAP_CEILING);
+    if (tables->floorShades == NULL || tables->ceilingShades == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate the software shading tables");
+        UnloadShadeTables(tables);
+        return false;
+    }
+    return true;
+}
+
+void UnloadShadeTables(ShadeTables* tables) {
+    for (int i = 0; i < COLORMAP_WALL_TEXTURES; i++) MemFree(tables->walls[i].indices);
+    MemFree(tables->floor.indices);
+    MemFree(tables->ceiling.indices);
+    MemFree(tables->colormaps);
+    MemFree(tables->floorShades);
+    MemFree(tables->ceilingShades);
+    *tables = (ShadeTables){ 0 };
+}
+
+bool AreShadeTablesCurrent(const ShadeTables* tables, const Image* walls, const FlatTextures* flats) {
+    if (tables->colormaps == NULL) return false;
+    for (int i = 0; i < COLORMAP_WALL_TEXTURES; i++) {
+        if (tables->sources[i] != walls[i].data) return false;
+    }
+    return tables->sources[COLORMAP_WALL_TEXTURES] == GetImageData(flats ? flats->floor : NULL) &&
+           tables->sources[COLORMAP_WALL_TEXTURES + 1] == GetImageData(flats ? flats->ceiling : NULL);
+}
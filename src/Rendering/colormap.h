@@ -0,0 +1,92 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include "raylib.h"
+#include "../World/map.h"
+#include <math.h>
+
+// Lookup-table shading for the software renderer, in the manner of classic
+// software renderers: every texture is stored as indices into one shared
+// palette, and a colormap per distance band holds the palette already tinted,
+// darkened and fogged the way the GPU shaders would do it at that distance.
+// Shading a pixel is then a single load from the colormap row of its band.
+
+#define COLORMAP_SIZE 256          // Palette entries
+#define COLORMAP_BANDS 64          // Distance bands per colormap
+#define COLORMAP_BAND_SCALE 10.0f  // band = sqrt(distance in tiles) * scale: finest near the camera, where
+                                   // darkening changes fastest; the last band starts ~40 tiles out
+#define COLORMAP_WALL_TINTS 5      // Walls, doors, secret walls, obstacles, anything else
+#define COLORMAP_WALL_TEXTURES 8
+
+// Colormaps: one per wall tint and side, then the floor and the ceiling
+#define COLORMAP_FLOOR (COLORMAP_WALL_TINTS * 2)
+#define COLORMAP_CEILING (COLORMAP_FLOOR + 1)
+#define COLORMAP_COUNT (COLORMAP_CEILING + 1)
+
+// Floor and ceiling textures for the software renderer: RGBA8, power-of-two
+// sizes, one repeat per tile. A NULL (or unusable) texture is filled with the
+// flat floor or ceiling colour instead.
+typedef struct FlatTextures {
+    const Image* floor;
+    const Image* ceiling;
+} FlatTextures;
+
+// A texture as palette indices, row-major
+typedef struct IndexedImage {
+    unsigned char* indices;
+    int width;
+    int height;
+} IndexedImage;
+
+typedef struct ShadeTables {
+    Color palette[COLORMAP_SIZE];
+    int paletteSize;               // Distinct colours found; COLORMAP_SIZE when the images needed quantizing
+    IndexedImage walls[COLORMAP_WALL_TEXTURES]; // Map.wallImages, indexed
+    IndexedImage floor;            // 1x1 of the flat colour without a usable texture
+    IndexedImage ceiling;
+    Color* colormaps;              // [COLORMAP_COUNT][COLORMAP_BANDS][COLORMAP_SIZE]
+    Color* floorShades;            // [COLORMAP_BANDS][width * height]: the floor through each band of its colormap
+    Color* ceilingShades;
+    const void* sources[COLORMAP_WALL_TEXTURES + 2]; // Pixel data the tables were built from
+} ShadeTables;
+
+// Builds the palette, the indexed textures and every colormap from the map's
+// wall images and the flat textures (flats may be NULL for flat colours).
+// More than COLORMAP_SIZE distinct colours are quantized to a fixed 3-3-2
+// palette. Returns false if out of memory.
+bool BuildShadeTables(ShadeTables* tables, const Image* walls, const FlatTextures* flats);
+void UnloadShadeTables(ShadeTables* tables);
+
+// True if the tables were built from exactly these images
+bool AreShadeTablesCurrent(const ShadeTables* tables, const Image* walls, const FlatTextures* flats);
+
+// Colormap for a wall of tile type tile hit on side (0 = x-side, 1 = y-side)
+static inline int GetWallColormap(int tile, int side) {
+    switch (tile) {
+        case TILE_WALL:        return side;
+        case TILE_DOOR:        return 2 + side;
+        case TILE_SECRET_WALL: return 4 + side;
+        case TILE_OBSTACLE:    return 6 + side;
+        default:               return 8 + side;
+    }
+}
+
+static inline int GetColormapBand(float distance) {
+    int band = (distance > 0.0f) ? (int)(sqrtf(distance) * COLORMAP_BAND_SCALE) : 0;
+    return (band < COLORMAP_BANDS) ? band : COLORMAP_BANDS - 1;
+}
+
+// Palette shaded for a distance in tiles
+static inline const Color* GetColormapRow(const ShadeTables* tables, int colormap, float distance) {
+    return tables->colormaps + ((size_t)colormap * COLORMAP_BANDS + GetColormapBand(distance)) * COLORMAP_SIZE;
+}
+
+// Floor or ceiling texture already shaded for a distance in tiles, so a flat
+// pixel is one load instead of a texel and a colormap load
+static inline const Color* GetFlatShades(const ShadeTables* tables, bool ceiling, float distance) {
+    const IndexedImage* image = ceiling ? &tables->ceiling : &tables->floor;
+    const Color* shades = ceiling ? tables->ceilingShades : tables->floorShades;
+    return shades + (size_t)GetColormapBand(distance) * image->width * image->height;
+}
+
+#endif // COLORMAP_H
@@ -0,0 +1,342 @@
+#include "draw_list.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int GetUniformSize(int type) {
+    switch (type) {
+        case SHADER_UNIFORM_VEC2:
+        case SHADER_UNIFORM_IVEC2: return 8;
+        case SHADER_UNIFORM_VEC3:
+        case SHADER_UNIFORM_IVEC3: return 12;
+        case SHADER_UNIFORM_VEC4:
+        case SHADER_UNIFORM_IVEC4: return 16;
+        default:                   return 4;
+    }
+}
+
+// Unused bytes stay zero so uniforms can be compared whole
+static DrawUniform MakeUniform(unsigned int shader, int location, const void* value, int type) {
+    DrawUniform uniform;
+    memset(&uniform, 0, sizeof(uniform));
+    uniform.shader = shader;
+    uniform.location = location;
+    uniform.type = type;
+    memcpy(uniform.value, value, GetUniformSize(type));
+    return uniform;
+}
+
+bool InitDrawList(DrawList* list, int capacity) {
+    memset(list, 0, sizeof(*list));
+    list->batch = true;
+    if (capacity < 1) capacity = 1;
+    
+    list->items = (DrawItem*)malloc((size_t)capacity * sizeof(DrawItem));
+    if (list->items == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate a draw list of %d items", capacity);
+        return false;
+    }
+    list->capacity = capacity;
+    return true;
+}
+
+void UnloadDrawList(DrawList* list) {
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+void ClearDrawList(DrawList* list) {
+    list->count = 0;
+    list->shaderUniformCount = 0;
+}
+
+void ResetUniformCache(DrawList* list) {
+    list->cacheCount = 0;
+}
+
+DrawItem* AddDrawListMesh(DrawList* list, const Mesh* mesh, Material material, Matrix transform) {
+    if (list->count == list->capacity) {
+        int capacity = (list->capacity > 0) ? list->capacity * 2 : 16;
+        DrawItem* items = (DrawItem*)realloc(list->items, (size_t)capacity * sizeof(DrawItem));
+        if (items == NULL) return NULL;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    
+    DrawItem* item = &list->items[list->count];
+    memset(item, 0, sizeof(*item));
+    item->shader = material.shader;
+    item->texture = material.maps[MATERIAL_MAP_DIFFUSE].texture;
+    item->color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+    item->mesh = mesh;
+    item->transform = transform;
+    item->order = list->count++;
+    return item;
+}
+
+void SetDrawItemUniform(DrawItem* item, int location, const void* value, int type) {
+    if (location < 0 || item->uniformCount == DRAW_ITEM_UNIFORMS) return;
+    item->uniforms[item->uniformCount++] = MakeUniform(item->shader.id, location, value, type);
+}
+
+void SetDrawListUniform(DrawList* list, Shader shader, int location, const void* value, int type) {
+    if (location < 0) return;
+    
+    DrawUniform uniform = MakeUniform(shader.id, location, value, type);
+    for (int i = 0; i < list->shaderUniformCount; i++) {
+        if (list->shaderUniforms[i].shader == shader.id && list->shaderUniforms[i].location == location) {
+            list->shaderUniforms[i] = uniform;
+            return;
+        }
+    }
+    if (list->shaderUniformCount < DRAW_LIST_SHADER_UNIFORMS) list->shaderUniforms[list->shaderUniformCount++] = uniform;
+}
+
+static unsigned int PackColor(Color color) {
+    return ((unsigned int)color.r << 24) | ((unsigned int)color.g << 16) | ((unsigned int)color.b << 8) | color.a;
+}
+
+// Shader first since binding one is the most expensive change, then texture,
+// then the uniforms, then the order the draws were added in
+static int CompareDrawItems(const void* a, const void* b) {
+    const DrawItem* x = (const DrawItem*)a;
+    const DrawItem* y = (const DrawItem*)b;
+    
+    if (x->shader.id != y->shader.id) return (x->shader.id < y->shader.id) ? -1 : 1;
+    if (x->texture.id != y->texture.id) return (x->texture.id < y->texture.id) ? -1 : 1;
+    if (PackColor(x->color) != PackColor(y->color)) return (PackColor(x->color) < PackColor(y->color)) ? -1 : 1;
+    if (x->uniformCount != y->uniformCount) return x->uniformCount - y->uniformCount;
+    
+    int uniforms = memcmp(x->uniforms, y->uniforms, (size_t)x->uniformCount * sizeof(DrawUniform));
+    if (uniforms != 0) return uniforms;
+    return x->order - y->order;
+}
+
+static bool IsSameDrawState(const DrawItem* a, const DrawItem* b) {
+    return a->shader.id == b->shader.id && a->texture.id == b->texture.id && PackColor(a->color) == PackColor(b->color) &&
+           a->uniformCount == b->uniformCount &&
+           memcmp(a->uniforms, b->uniforms, (size_t)a->uniformCount * sizeof(DrawUniform)) == 0;
+}
+
+// Uploads a value to the bound shader unless the shadow copy shows it is
+// already there. Without batching everything is uploaded, but the shadow copy
+// is still kept current.
+static void UploadUniform(DrawList* list, const DrawBackend* backend, const DrawUniform* uniform) {
+    if (uniform->location < 0) return;
+    
+    DrawUniform* entry = NULL;
+    for (int i = 0; i < list->cacheCount; i++) {
+        if (list->cache[i].shader == uniform->shader && list->cache[i].location == uniform->location) {
+            entry = &list->cache[i];
+            break;
+        }
+    }
+    
+    if (list->batch && entry != NULL && memcmp(entry, uniform, sizeof(DrawUniform)) == 0) {
+        list->stats.uniformsSkipped++;
+        return;
+    }
+    
+    // A full cache only means values past it are always uploaded
+    if (entry == NULL && list->cacheCount < UNIFORM_CACHE_SIZE) entry = &list->cache[list->cacheCount++];
+    if (entry != NULL) *entry = *uniform;
+    
+    backend->setUniform(backend->context, uniform->location, uniform->value, uniform->type);
+    list->stats.uniformUploads++;
+}
+
+static void ApplyDrawState(DrawList* list, const DrawBackend* backend, const DrawItem* item,
+                           unsigned int* boundShader, unsigned int* boundTexture) {
+    unsigned int shader = item->shader.id;
+    
+    if (!list->batch || shader != *boundShader) {
+        backend->bindShader(backend->context, item->shader);
+        list->stats.shaderBinds++;
+        *boundShader = shader;
+        
+        for (int i = 0; i < list->shaderUniformCount; i++) {
+            if (list->shaderUniforms[i].shader == shader) UploadUniform(list, backend, &list->shaderUniforms[i]);
+        }
+        
+        int unit = 0;
+        DrawUniform sampler = MakeUniform(shader, item->shader.locs[SHADER_LOC_MAP_DIFFUSE], &unit, SHADER_UNIFORM_INT);
+        UploadUniform(list, backend, &sampler);
+    }
+    
+    if (item->texture.id != 0 && (!list->batch || item->texture.id != *boundTexture)) {
+        backend->bindTexture(backend->context, item->texture);
+        list->stats.textureBinds++;
+        *boundTexture = item->texture.id;
+    }
+    
+    float color[4] = { item->color.r / 255.0f, item->color.g / 255.0f, item->color.b / 255.0f, item->color.a / 255.0f };
+    DrawUniform diffuse = MakeUniform(shader, item->shader.locs[SHADER_LOC_COLOR_DIFFUSE], color, SHADER_UNIFORM_VEC4);
+    UploadUniform(list, backend, &diffuse);
+    
+    for (int i = 0; i < item->uniformCount; i++) {
+        UploadUniform(list, backend, &item->uniforms[i]);
+    }
+}
+
+void SubmitDrawList(DrawList* list, const DrawBackend* backend) {
+    list->stats = (DrawStats){ 0 };
+    if (list->count == 0) return;
+    
+    if (list->batch) qsort(list->items, list->count, sizeof(DrawItem), CompareDrawItems);
+    
+    backend->begin(backend->context);
+    
+    unsigned int boundShader = 0;
+    unsigned int boundTexture = 0;
+    const DrawItem* previous = NULL;
+    
+    for (int i = 0; i < list->count; i++) {
+        const DrawItem* item = &list->items[i];
+        
+        if (!list->batch || previous == NULL || !IsSameDrawState(previous, item)) {
+            ApplyDrawState(list, backend, item, &boundShader, &boundTexture);
+            list->stats.batches++;
+        }
+        
+        backend->drawMesh(backend->context, item->shader, item->mesh, item->transform);
+        list->stats.draws++;
+        previous = item;
+    }
+    
+    backend->end(backend->context);
+}
+
+//----------------------------------------------------------------------------------
+// rlgl backend
+//----------------------------------------------------------------------------------
+
+typedef struct RaylibDrawState {
+    Matrix view;
+    Matrix projection;
+} RaylibDrawState;
+
+static RaylibDrawState raylibDrawState;
+
+static void RaylibBegin(void* context) {
+    RaylibDrawState* state = (RaylibDrawState*)context;
+    
+    // Whatever raylib has batched so far goes first, with its own shader
+    rlDrawRenderBatchActive();
+    state->view = rlGetMatrixModelview();
+    state->projection = rlGetMatrixProjection();
+}
+
+static void RaylibBindShader(void* context, Shader shader) {
+    (void)context;
+    rlEnableShader(shader.id);
+}
+
+static void RaylibBindTexture(void* context, Texture2D texture) {
+    (void)context;
+    rlActiveTextureSlot(0);
+    rlEnableTexture(texture.id);
+}
+
+static void RaylibSetUniform(void* context, int location, const void* value, int type) {
+    (void)context;
+    rlSetUniform(location, value, type, 1);
+}
+
+// The part of DrawMesh that has to happen per draw; the GPU path's shaders
+// only take the combined matrix
+static void RaylibDrawMesh(void* context, Shader shader, const Mesh* mesh, Matrix transform) {
+    RaylibDrawState* state = (RaylibDrawState*)context;
+    
+    if (shader.locs[SHADER_LOC_MATRIX_MVP] != -1) {
+        Matrix model = MatrixMultiply(transform, rlGetMatrixTransform());
+        Matrix mvp = MatrixMultiply(MatrixMultiply(model, state->view), state->projection);
+        rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+    }
+    
+    // The shaders need GL 3.3, which always has vertex array objects
+    if (!rlEnableVertexArray(mesh->vaoId)) return;
+    
+    if (mesh->indices != NULL) {
+        rlDrawVertexArrayElements(0, mesh->triangleCount * 3, 0);
+    } else {
+        rlDrawVertexArray(0, mesh->vertexCount);
+    }
+}
+
+static void RaylibEnd(void* context) {
+    (void)context;
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+    rlDisableVertexBufferElement();
+    rlActiveTextureSlot(0);
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+DrawBackend GetRaylibDrawBackend(void) {
+    return (DrawBackend){
+        .context = &raylibDrawState,
+        .begin = RaylibBegin,
+        .bindShader = RaylibBindShader,
+        .bindTexture = RaylibBindTexture,
+        .setUniform = RaylibSetUniform,
+        .drawMesh = RaylibDrawMesh,
+        .end = RaylibEnd,
+    };
+}
+
+//----------------------------------------------------------------------------------
+// Recording backend
+//----------------------------------------------------------------------------------
+
+static void RecordBegin(void* context) {
+    DrawRecorder* recorder = (DrawRecorder*)context;
+    recorder->boundShader = 0;
+    recorder->boundTexture = 0;
+}
+
+static void RecordBindShader(void* context, Shader shader) {
+    DrawRecorder* recorder = (DrawRecorder*)context;
+    if (shader.id == recorder->boundShader) recorder->redundantBinds++;
+    recorder->boundShader = shader.id;
+    recorder->shaderBinds++;
+}
+
+static void RecordBindTexture(void* context, Texture2D texture) {
+    DrawRecorder* recorder = (DrawRecorder*)context;
+    if (texture.id == recorder->boundTexture) recorder->redundantBinds++;
+    recorder->boundTexture = texture.id;
+    recorder->textureBinds++;
+}
+
+static void RecordSetUniform(void* context, int location, const void* value, int type) {
+    (void)location;
+    (void)value;
+    (void)type;
+    ((DrawRecorder*)context)->uniformUploads++;
+}
+
+static void RecordDrawMesh(void* context, Shader shader, const Mesh* mesh, Matrix transform) {
+    (void)shader;
+    (void)transform;
+    DrawRecorder* recorder = (DrawRecorder*)context;
+    recorder->draws++;
+    recorder->triangles += mesh->triangleCount;
+}
+
+static void RecordEnd(void* context) {
+    (void)context;
+}
+
+DrawBackend GetRecordingDrawBackend(DrawRecorder* recorder) {
+    return (DrawBackend){
+        .context = recorder,
+        .begin = RecordBegin,
+        .bindShader = RecordBindShader,
+        .bindTexture = RecordBindTexture,
+        .setUniform = RecordSetUniform,
+        .drawMesh = RecordDrawMesh,
+        .end = RecordEnd,
+    };
+}
@@ -0,0 +1,110 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+// Sorted draw submission for the GPU path. The mesh draws of a frame are
+// collected together with the state each one needs (shader, diffuse texture,
+// colour and a few uniforms), sorted so draws sharing that state end up next
+// to each other, and submitted through a backend that is only told about state
+// that actually changes: a run of compatible draws binds once and then only
+// issues draws. A shadow copy of every uniform value uploaded so far skips
+// uploads of values the shader already holds, across frames too.
+//
+// The backend is a table of functions, so the same submission can drive GL
+// through rlgl or a recorder that just counts what it was asked to do, which
+// lets the batching be checked without a GL context.
+
+#define DRAW_ITEM_UNIFORMS 2        // Uniforms a single draw can set
+#define DRAW_LIST_SHADER_UNIFORMS 16 // Uniforms set once per shader for the whole list
+#define UNIFORM_CACHE_SIZE 32       // Shader/location pairs whose last value is shadowed
+
+typedef struct DrawUniform {
+    unsigned int shader;       // Shader program id
+    int location;
+    int type;                  // SHADER_UNIFORM_FLOAT, _VEC2..4, _INT or _IVEC2..4
+    unsigned char value[16];
+} DrawUniform;
+
+typedef struct DrawItem {
+    Shader shader;
+    Texture2D texture;         // Diffuse map, texture unit 0; id 0 leaves the unit alone like DrawMesh
+    Color color;               // Uploaded as colDiffuse
+    DrawUniform uniforms[DRAW_ITEM_UNIFORMS]; // Stay set for later draws with the same shader that do not set them
+    int uniformCount;
+    const Mesh* mesh;          // Has to stay valid until the list is submitted
+    Matrix transform;
+    int order;                 // Position in the list, keeps the sort stable
+} DrawItem;
+
+// What a submission asked of the backend
+typedef struct DrawStats {
+    int draws;
+    int batches;               // Runs of draws sharing all state
+    int shaderBinds;
+    int textureBinds;
+    int uniformUploads;
+    int uniformsSkipped;       // Values the shadow copy showed were already set
+} DrawStats;
+
+typedef struct DrawBackend {
+    void* context;
+    void (*begin)(void* context);
+    void (*bindShader)(void* context, Shader shader);
+    void (*bindTexture)(void* context, Texture2D texture);
+    void (*setUniform)(void* context, int location, const void* value, int type); // For the bound shader
+    void (*drawMesh)(void* context, Shader shader, const Mesh* mesh, Matrix transform);
+    void (*end)(void* context); // Leaves GL the way raylib expects it
+} DrawBackend;
+
+typedef struct DrawList {
+    DrawItem* items;
+    int count;
+    int capacity;
+    DrawUniform shaderUniforms[DRAW_LIST_SHADER_UNIFORMS]; // Applied whenever their shader is bound
+    int shaderUniformCount;
+    DrawUniform cache[UNIFORM_CACHE_SIZE]; // Shadow copy of the values the shaders hold
+    int cacheCount;
+    bool batch;                // False submits every draw in order with all of its state, like DrawMesh
+    DrawStats stats;           // Of the last submission
+} DrawList;
+
+bool InitDrawList(DrawList* list, int capacity); // Returns false if out of memory
+void UnloadDrawList(DrawList* list);
+
+// Drops the items and shader uniforms but keeps the shadow copy
+void ClearDrawList(DrawList* list);
+
+// Forgets the shadowed values, e.g. after the shaders were reloaded
+void ResetUniformCache(DrawList* list);
+
+// Queues a mesh with the shader and diffuse map of material. Returns the item
+// to add uniforms to, or NULL if out of memory.
+DrawItem* AddDrawListMesh(DrawList* list, const Mesh* mesh, Material material, Matrix transform);
+void SetDrawItemUniform(DrawItem* item, int location, const void* value, int type);
+
+// Sets a uniform of shader for every draw in the list, replacing an earlier value
+void SetDrawListUniform(DrawList* list, Shader shader, int location, const void* value, int type);
+
+// Sorts (when batching) and draws the list through backend, filling list->stats
+void SubmitDrawList(DrawList* list, const DrawBackend* backend);
+
+// Draws through rlgl; call between BeginMode3D and EndMode3D
+DrawBackend GetRaylibDrawBackend(void);
+
+// Counts the calls it receives instead of drawing
+typedef struct DrawRecorder {
+    int shaderBinds;
+    int textureBinds;
+    int uniformUploads;
+    int draws;
+    int triangles;
+    int redundantBinds;        // Binds of the shader or texture that was already bound
+    unsigned int boundShader;
+    unsigned int boundTexture;
+} DrawRecorder;
+
+DrawBackend GetRecordingDrawBackend(DrawRecorder* recorder);
+
+#endif // DRAW_LIST_H
@@ -0,0 +1,56 @@
+#include "framebuffer.h"
+#include <stdlib.h>
+
+bool InitFramebuffer(Framebuffer* fb, int width, int height) {
+    fb->pixels = NULL;
+    fb->depth = NULL;
+    fb->width = 0;
+    fb->height = 0;
+    
+    return ResizeFramebuffer(fb, width, height);
+}
+
+bool ResizeFramebuffer(Framebuffer* fb, int width, int height) {
+    if (width <= 0 || height <= 0) return false;
+    
+    // Nothing to do if the size did not change
+    if (fb->pixels != NULL && fb->width == width && fb->height == height) return true;
+    
+    Color* pixels = (Color*)malloc((size_t)width * (size_t)height * sizeof(Color));
+    float* depth = (float*)malloc((size_t)width * sizeof(float));
+    if (pixels == NULL || depth == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate %dx%d framebuffer", width, height);
+        free(pixels);
+        free(depth);
+        return false;
+    }
+    
+    free(fb->pixels);
+    free(fb->depth);
+    fb->pixels = pixels;
+    fb->depth = depth;
+    fb->width = width;
+    fb->height = height;
+    
+    ClearFramebuffer(fb, BLACK);
+    for (int x = 0; x < width; x++) {
+        fb->depth[x] = 1e30f;
+    }
+    return true;
+}
+
+void ClearFramebuffer(Framebuffer* fb, Color color) {
+    size_t count = (size_t)fb->width * (size_t)fb->height;
+    for (size_t i = 0; i < count; i++) {
+        fb->pixels[i] = color;
+    }
+}
+
+void UnloadFramebuffer(Framebuffer* fb) {
+    free(fb->pixels);
+    free(fb->depth);
+    fb->pixels = NULL;
+    fb->depth = NULL;
+    fb->width = 0;
+    fb->height = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "raylib.h"
+
+// CPU-side RGBA8 render target used by the software renderer.
+// Pixels are stored row-major and match PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+// so the whole buffer can be uploaded with a single UpdateTexture call.
+typedef struct Framebuffer {
+    Color* pixels; // width * height pixels, row-major
+    float* depth;  // Per-column wall distance (RayHit.perpDist) from the last raycast
+    int width;
+    int height;
+} Framebuffer;
+
+bool InitFramebuffer(Framebuffer* fb, int width, int height);
+bool ResizeFramebuffer(Framebuffer* fb, int width, int height); // Reallocates only if size changed
+void ClearFramebuffer(Framebuffer* fb, Color color);
+void UnloadFramebuffer(Framebuffer* fb);
+
+#endif // FRAMEBUFFER_H
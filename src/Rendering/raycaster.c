@@ -0,0 +1,626 @@
+#include "raycaster.h"
+#include "../Core/profiler.h"
+#include "../World/grid_ray.h"
+#include <math.h>
+#include <string.h>
+
+// A ray entering a door tile hits the slab recessed halfway through it,
+// unless it meets the middle of the tile outside the tile (entering from a
+// side) or in the gap the slab has slid away from. Only the active door list
+// is searched, so closed doors cost the same as walls.
+static bool HitDoor(const Map* map, const GridRay* ray, Vector2 rayPos, Vector2 rayDir, RayHit* hit) {
+    const MapDoor* door = GetActiveDoor(map, ray->mapX, ray->mapY);
+    float open = (door != NULL) ? door->open : 0.0f;
+    
+    float enter = (ray->side == 0) ? ray->sideDistX - ray->deltaDistX : ray->sideDistY - ray->deltaDistY;
+    float exit = GetGridRayExit(ray);
+    float dist, along;
+    int side;
+    
+    if (IsDoorVertical(map, ray->mapX, ray->mapY)) {
+        dist = (ray->mapX - rayPos.x / TILE_SIZE + 0.5f) / rayDir.x;
+        along = rayPos.y / TILE_SIZE + dist * rayDir.y - ray->mapY;
+        side = 0;
+    } else {
+        dist = (ray->mapY - rayPos.y / TILE_SIZE + 0.5f) / rayDir.y;
+        along = rayPos.x / TILE_SIZE + dist * rayDir.x - ray->mapX;
+        side = 1;
+    }
+    
+    // Written so rays parallel to the slab (NaN or infinite dist) pass
+    if (!(dist >= enter && dist < exit) || along < open) return false;
+    
+    hit->perpDist = dist;
+    hit->side = side;
+    hit->doorOpen = open;
+    return true;
+}
+
+void CastRay(const Map* map, Vector2 rayPos, Vector2 rayDir, RayHit* hit) {
+    // DDA from the ray origin in tile units until an occupied tile is entered;
+    // only the occupancy bit is read per step
+    GridRay ray;
+    InitGridRay(&ray, rayPos.x / TILE_SIZE, rayPos.y / TILE_SIZE, rayDir.x, rayDir.y);
+    
+    for (;;) {
+        do {
+            StepGridRay(&ray);
+        } while (!IsMapCellSolid(map, ray.mapX, ray.mapY));
+        
+        hit->tile = GetMapTile(map, ray.mapX, ray.mapY);
+        hit->mapX = ray.mapX;
+        hit->mapY = ray.mapY;
+        if (hit->tile != TILE_DOOR) break;
+        if (HitDoor(map, &ray, rayPos, rayDir, hit)) return;
+    }
+    
+    // Calculate distance projected on camera direction
+    if (ray.side == 0) {
+        hit->perpDist = (ray.mapX - rayPos.x / TILE_SIZE + (1 - ray.stepX) / 2) / rayDir.x;
+    } else {
+        hit->perpDist = (ray.mapY - rayPos.y / TILE_SIZE + (1 - ray.stepY) / 2) / rayDir.y;
+    }
+    
+    hit->side = ray.side;
+    hit->doorOpen = 0.0f;
+}
+
+// Everything needed to fill one screen column once its ray has been cast
+typedef struct ColumnSpan {
+    int drawStart;         // First wall pixel
+    int drawEnd;           // Last wall pixel (inclusive)
+    const unsigned char* texels; // First texel (palette index) of the sampled texture column
+    int texStride;         // Texels between consecutive texture rows
+    int texMaxY;           // Last valid texture row
+    long long texPos;      // Texture y at drawStart, 16.16 fixed point
+    int texStep;           // Texture y step per screen pixel, 16.16 fixed point
+    const Color* shade;    // Colormap row for the tint, side and distance
+} ColumnSpan;
+
+// Project a ray hit into a textured wall slice
+static void SetupColumn(const Framebuffer* fb, const ShadeTables* tables, Vector2 rayPos, Vector2 rayDir, const RayHit* hit, ColumnSpan* span) {
+    int screenHeight = fb->height;
+    
+    // Scale the grid distance the same way the original line renderer did
+    float perpWallDist = hit->perpDist * TILE_SIZE * WALL_DISTANCE_SCALE;
+    if (perpWallDist < 0.0001f) perpWallDist = 0.0001f;
+    
+    // Calculate height of the slice, clamped so the int conversion stays defined
+    float lineHeightF = screenHeight / perpWallDist * WALL_HEIGHT_FACTOR;
+    if (lineHeightF > screenHeight * 64.0f) lineHeightF = screenHeight * 64.0f;
+    int lineHeight = (int)lineHeightF;
+    if (lineHeight < 1) lineHeight = 1;
+    
+    // Calculate lowest and highest pixel to fill in current stripe
+    int drawStart = -lineHeight / 2 + screenHeight / 2;
+    if (drawStart < 0) drawStart = 0;
+    
+    int drawEnd = lineHeight / 2 + screenHeight / 2;
+    if (drawEnd >= screenHeight) drawEnd = screenHeight - 1;
+    
+    // Pick the same texture the GPU path uses for this tile
+    int texIndex = (hit->tile == TILE_WALL) ? (hit->mapX + hit->mapY) % 8 : hit->tile % 8;
+    const IndexedImage* tex = &tables->walls[texIndex];
+    
+    // Exact position where the wall was hit, in tile units
+    float wallX;
+    if (hit->side == 0) {
+        wallX = rayPos.y / TILE_SIZE + hit->perpDist * rayDir.y;
+    } else {
+        wallX = rayPos.x / TILE_SIZE + hit->perpDist * rayDir.x;
+    }
+    wallX -= floorf(wallX);
+    
+    // Texture column, mirrored so textures never appear flipped. A door's
+    // texture slides with the slab and reads the same from both sides.
+    int texX;
+    if (hit->tile == TILE_DOOR) {
+        texX = (int)((wallX - hit->doorOpen) * tex->width);
+        if (texX < 0) texX = 0;
+        if (texX >= tex->width) texX = tex->width - 1;
+    } else {
+        texX = (int)(wallX * tex->width);
+        if (texX >= tex->width) texX = tex->width - 1;
+        if ((hit->side == 0 && rayDir.x > 0) || (hit->side == 1 && rayDir.y < 0)) {
+            texX = tex->width - texX - 1;
+        }
+    }
+    
+    span->drawStart = drawStart;
+    span->drawEnd = drawEnd;
+    span->texels = tex->indices + texX;
+    span->texStride = tex->width;
+    span->texMaxY = tex->height - 1;
+    span->texStep = (int)(((long long)tex->height << 16) / lineHeight);
+    span->texPos = (long long)(drawStart - screenHeight / 2 + lineHeight / 2) * span->texStep;
+    span->shade = GetColormapRow(tables, GetWallColormap(hit->tile, hit->side), hit->perpDist);
+}
+
+// Where the samples of a floor or ceiling row cross from one texel into the
+// next along one texture axis. Crossings are a whole texel apart, so after
+// one division per row the pixels between them follow by adding pixels and
+// carrying the remainder, as a line is stepped across a grid.
+typedef struct FlatRunAxis {
+    unsigned int mask;      // Coordinate bits within a texel
+    unsigned int step;      // Size of the coordinate step; 0 if the texel never changes
+    unsigned int pixels;    // Whole steps per texel: (mask + 1) / step
+    unsigned int remainder; // (mask + 1) % step
+    bool backwards;         // The coordinate steps down
+    unsigned int indexStep; // Added to this axis' part of the texel index at a crossing
+    unsigned int indexMask; // Wraps that part around the texture
+} FlatRunAxis;
+
+// One floor or ceiling row of the frame: the texture shaded for the row's
+// distance, and where along it each column samples. Coordinates are 0.32
+// fixed point fractions of the texture, so they wrap around for free. The
+// texel index is (u >> columnShift) | ((v >> rowShift) & rowMask): the top
+// bits of u pick the column, and v is shifted straight to the texel row's
+// offset, which saves a shift per pixel.
+//
+// Away from the horizon one texel covers several pixels of the row, so the
+// row is drawn as runs of one texel (see DrawFlatRuns) instead.
+typedef struct FlatRow {
+    const Color* shades;   // Texels through the row's colormap band, row-major
+    unsigned int u, v;     // Sample of column 0
+    unsigned int du, dv;   // From one column to the next
+    int columnShift;       // 32 - log2(width); power-of-two sizes only
+    int rowShift;          // 32 - log2(height) - log2(width)
+    unsigned int rowMask;  // (height - 1) * width
+    FlatRunAxis runU;      // Crossings into the next texel column
+    FlatRunAxis runV;      // Crossings into the next texel row
+    bool runs;             // Both steps are at most half a texel
+} FlatRow;
+
+// Rows of a band that are wall in some of its columns: every column from
+// lastStart to firstEnd, and none above firstStart or below lastEnd
+typedef struct BandRows {
+    int firstStart;
+    int lastStart;
+    int firstEnd;
+    int lastEnd;
+} BandRows;
+
+// What a frame is drawn from. Every column is cast before anything is drawn,
+// so that floors and ceilings can be drawn a whole row at a time: a row's
+// runs of one texel then only end where the texels do, not at band edges.
+typedef struct FrameCaster {
+    FlatRow* rows;         // One per framebuffer row
+    ColumnSpan* spans;     // One per framebuffer column
+    BandRows* bands;       // One per RENDER_BAND_WIDTH columns, by x / RENDER_BAND_WIDTH
+    RayKernel kernel;      // Instruction set the rays and flat spans use
+} FrameCaster;
+
+static void UnloadFrameCaster(FrameCaster* caster) {
+    MemFree(caster->rows);
+    MemFree(caster->spans);
+    MemFree(caster->bands);
+    caster->rows = NULL;
+    caster->spans = NULL;
+    caster->bands = NULL;
+}
+
+static int Log2(int value) {
+    int shift = 0;
+    while ((1 << shift) < value) shift++;
+    return shift;
+}
+
+// A coordinate in tiles as a fraction of the texture, which repeats once per tile
+static unsigned int ToFlatFraction(double tiles) {
+    return (unsigned int)((tiles - floor(tiles)) * 4294967296.0);
+}
+
+// step is the signed coordinate step, shift the bits below the texel
+// (32 - log2 of the texels along the axis), and indexUnit and indexMask this
+// axis' part of the texel index: 1 and width - 1 for columns, width and
+// rowMask for rows
+static void InitFlatRunAxis(FlatRunAxis* axis, unsigned int step, int shift, unsigned int indexUnit,
+                            unsigned int indexMask) {
+    unsigned long long texel = 1ull << shift;
+    axis->backwards = (int)step < 0;
+    axis->mask = (unsigned int)(texel - 1);
+    axis->step = axis->backwards ? 0u - step : step;
+    if (shift == 32) axis->step = 0; // One texel across
+    axis->pixels = (axis->step > 0) ? (unsigned int)(texel / axis->step) : 0;
+    axis->remainder = (axis->step > 0) ? (unsigned int)(texel % axis->step) : 0;
+    axis->indexStep = axis->backwards ? indexMask : indexUnit; // Minus one unit, wrapped
+    axis->indexMask = indexMask;
+}
+
+// The same projection as SetupColumn run backwards: a floor row p pixels
+// below the horizon (or a ceiling row p above it) shows the plane where a
+// wall's bottom (or top) edge would be p pixels from the horizon. Returns
+// false if out of memory.
+static bool InitFrameCaster(FrameCaster* caster, const Framebuffer* fb, const Player* player, const ShadeTables* tables,
+                            RayKernel kernel) {
+    int bandCount = fb->width / RENDER_BAND_WIDTH + 1;
+    caster->rows = (FlatRow*)MemAlloc((unsigned int)(fb->height * sizeof(FlatRow)));
+    caster->spans = (ColumnSpan*)MemAlloc((unsigned int)(fb->width * sizeof(ColumnSpan)));
+    caster->bands = (BandRows*)MemAlloc((unsigned int)(bandCount * sizeof(BandRows)));
+    caster->kernel = kernel;
+    if (caster->rows == NULL || caster->spans == NULL || caster->bands == NULL) {
+        UnloadFrameCaster(caster);
+        return false;
+    }
+    
+    double positionX = player->position.x / TILE_SIZE;
+    double positionY = player->position.y / TILE_SIZE;
+    double rayDirX = player->direction.x - player->plane.x; // Column 0
+    double rayDirY = player->direction.y - player->plane.y;
+    double pixelStepX = player->plane.x * 2.0 / fb->width;
+    double pixelStepY = player->plane.y * 2.0 / fb->width;
+    float rowScale = fb->height * WALL_HEIGHT_FACTOR / (TILE_SIZE * WALL_DISTANCE_SCALE) * 0.5f;
+    int horizon = fb->height / 2;
+    
+    for (int y = 0; y < fb->height; y++) {
+        bool ceiling = y < horizon;
+        const IndexedImage* image = ceiling ? &tables->ceiling : &tables->floor;
+        int pixels = ceiling ? horizon - y : y - horizon;
+        float rowDist = rowScale / (float)((pixels > 0) ? pixels : 1);
+        
+        FlatRow* row = &caster->rows[y];
+        row->shades = GetFlatShades(tables, ceiling, rowDist);
+        row->u = ToFlatFraction(positionX + rowDist * rayDirX);
+        row->v = ToFlatFraction(positionY + rowDist * rayDirY);
+        row->du = ToFlatFraction(rowDist * pixelStepX);
+        row->dv = ToFlatFraction(rowDist * pixelStepY);
+        int shiftW = Log2(image->width);
+        int shiftH = Log2(image->height);
+        row->columnShift = 32 - shiftW;
+        row->rowShift = 32 - shiftH - shiftW;
+        row->rowMask = (unsigned int)(image->height - 1) << shiftW;
+        
+        InitFlatRunAxis(&row->runU, row->du, 32 - shiftW, 1, (unsigned int)image->width - 1);
+        InitFlatRunAxis(&row->runV, row->dv, 32 - shiftH, (unsigned int)image->width, row->rowMask);
+        row->runs = row->runU.step <= row->runU.mask / 2 && row->runV.step <= row->runV.mask / 2;
+    }
+    return true;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYCASTER_HAS_FLAT_SIMD 1
+#include <immintrin.h>
+
+// Four pixels at a time: the texel indices in lanes, then four loads since
+// SSE2 has no gather. Returns the pixels drawn, a multiple of four.
+__attribute__((target("sse2")))
+static int DrawFlatSpanSSE2(const FlatRow* row, unsigned int u, unsigned int v, int count, Color* out) {
+    __m128i u4 = _mm_setr_epi32((int)u, (int)(u + row->du), (int)(u + 2 * row->du), (int)(u + 3 * row->du));
+    __m128i v4 = _mm_setr_epi32((int)v, (int)(v + row->dv), (int)(v + 2 * row->dv), (int)(v + 3 * row->dv));
+    __m128i du4 = _mm_set1_epi32((int)(4 * row->du));
+    __m128i dv4 = _mm_set1_epi32((int)(4 * row->dv));
+    __m128i columnShift = _mm_cvtsi32_si128(row->columnShift);
+    __m128i rowShift = _mm_cvtsi32_si128(row->rowShift);
+    __m128i rowMask = _mm_set1_epi32((int)row->rowMask);
+    const int* shades = (const int*)row->shades;
+    
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i index = _mm_or_si128(_mm_srl_epi32(u4, columnShift), _mm_and_si128(_mm_srl_epi32(v4, rowShift), rowMask));
+        int i0 = _mm_cvtsi128_si32(index);
+        int i1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, 1));
+        int i2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, 2));
+        int i3 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, 3));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_setr_epi32(shades[i0], shades[i1], shades[i2], shades[i3]));
+        
+        u4 = _mm_add_epi32(u4, du4);
+        v4 = _mm_add_epi32(v4, dv4);
+    }
+    return i;
+}
+
+// Eight pixels at a time, the indices as above and then one gather from the
+// shaded texture. Returns the pixels drawn, a multiple of eight.
+__attribute__((target("avx2")))
+static int DrawFlatSpanAVX2(const FlatRow* row, unsigned int u, unsigned int v, int count, Color* out) {
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i u8 = _mm256_add_epi32(_mm256_set1_epi32((int)u), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)row->du)));
+    __m256i v8 = _mm256_add_epi32(_mm256_set1_epi32((int)v), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)row->dv)));
+    __m256i du8 = _mm256_set1_epi32((int)(8 * row->du));
+    __m256i dv8 = _mm256_set1_epi32((int)(8 * row->dv));
+    __m128i columnShift = _mm_cvtsi32_si128(row->columnShift);
+    __m128i rowShift = _mm_cvtsi32_si128(row->rowShift);
+    __m256i rowMask = _mm256_set1_epi32((int)row->rowMask);
+    const int* shades = (const int*)row->shades;
+    
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_or_si256(_mm256_srl_epi32(u8, columnShift), _mm256_and_si256(_mm256_srl_epi32(v8, rowShift), rowMask));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_i32gather_epi32(shades, index, 4));
+        
+        u8 = _mm256_add_epi32(u8, du8);
+        v8 = _mm256_add_epi32(v8, dv8);
+    }
+    return i;
+}
+#endif
+
+// First pixel at which a row's samples from position cross into the next
+// texel along one axis, and the remainder carried to the crossing after it.
+// The first crossing comes once the steps pass the rest of the start texel,
+// distance, and each later one a texel's worth of steps after that.
+static inline void StartFlatRunAxis(const FlatRunAxis* axis, unsigned int position, unsigned int* next,
+                                    unsigned int* carry) {
+    if (axis->step == 0) {
+        *next = 0xffffffffu;
+        *carry = 0;
+        return;
+    }
+    
+    unsigned int fraction = position & axis->mask;
+    unsigned int distance = axis->backwards ? fraction : axis->mask - fraction;
+    *next = distance / axis->step + 1;
+    *carry = distance % axis->step;
+}
+
+// Moves past a crossing: the next one, and the neighbouring texel's index
+static inline void NextFlatRunAxis(const FlatRunAxis* axis, unsigned int* next, unsigned int* carry,
+                                   unsigned int* index) {
+    *carry += axis->remainder;
+    unsigned int over = *carry >= axis->step;
+    *carry -= over ? axis->step : 0;
+    *next += axis->pixels + over;
+    *index = (*index + axis->indexStep) & axis->indexMask;
+}
+
+// Draws count pixels of a row from the sample (u, v) as runs of one texel,
+// each ending where the first of u and v crosses into the next texel. The
+// crossings are found exactly, with integers, so every pixel gets the texel
+// the pixel by pixel loop would give it. Runs are filled 16 pixels at a
+// time, the last stores spilling into the next run, which overwrites them.
+// The texel is copied as a 32-bit word so the fill compiles to vector stores.
+static void DrawFlatRuns(const FlatRow* row, unsigned int u, unsigned int v, int count, Color* out) {
+    unsigned int column = (unsigned int)((unsigned long long)u >> row->columnShift);
+    unsigned int rowOffset = (v >> row->rowShift) & row->rowMask;
+    unsigned int nextU, carryU, nextV, carryV;
+    StartFlatRunAxis(&row->runU, u, &nextU, &carryU);
+    StartFlatRunAxis(&row->runV, v, &nextV, &carryV);
+    
+    unsigned int i = 0;
+    unsigned int total = (unsigned int)count;
+    while (i < total) {
+        unsigned int end = (nextU < nextV) ? nextU : nextV;
+        if (end > total) end = total;
+        
+        unsigned int color;
+        memcpy(&color, &row->shades[rowOffset | column], sizeof(color));
+        if (end + 16 <= total) {
+            Color* fill = out + i;
+            do {
+                for (int j = 0; j < 16; j++) memcpy(&fill[j], &color, sizeof(color));
+                fill += 16;
+            } while (fill < out + end);
+        } else {
+            for (; i < end; i++) memcpy(&out[i], &color, sizeof(color));
+        }
+        i = end;
+        
+        if (nextU == end) NextFlatRunAxis(&row->runU, &nextU, &carryU, &column);
+        if (nextV == end) NextFlatRunAxis(&row->runV, &nextV, &carryV, &rowOffset);
+    }
+}
+
+// Floor or ceiling pixels of row y for count columns starting at column startX
+static void DrawFlatRow(const FrameCaster* caster, int y, int startX, int count, Color* out) {
+    const FlatRow* row = &caster->rows[y];
+    unsigned int u = row->u + (unsigned int)startX * row->du;
+    unsigned int v = row->v + (unsigned int)startX * row->dv;
+    int i = 0;
+    
+    // Flat colour, as a 1x1 texture
+    if (row->columnShift == 32 && row->rowMask == 0) {
+        Color color = row->shades[0];
+        for (; i < count; i++) out[i] = color;
+        return;
+    }
+    
+    if (row->runs) {
+        DrawFlatRuns(row, u, v, count, out);
+        return;
+    }
+
+#ifdef RAYCASTER_HAS_FLAT_SIMD
+    if (caster->kernel == RAY_KERNEL_AVX2) i = DrawFlatSpanAVX2(row, u, v, count, out);
+    else if (caster->kernel == RAY_KERNEL_SSE2) i = DrawFlatSpanSSE2(row, u, v, count, out);
+    u += (unsigned int)i * row->du;
+    v += (unsigned int)i * row->dv;
+#endif
+    
+    // Locals, since out could alias the row as far as the compiler knows. A
+    // shift by 32 of the 64-bit coordinate leaves 0 for textures 1 texel wide.
+    const Color* shades = row->shades;
+    unsigned int du = row->du, dv = row->dv, rowMask = row->rowMask;
+    int columnShift = row->columnShift, rowShift = row->rowShift;
+    for (; i < count; i++) {
+        unsigned int column = (unsigned int)((unsigned long long)u >> columnShift);
+        out[i] = shades[((v >> rowShift) & rowMask) | column];
+        u += du;
+        v += dv;
+    }
+}
+
+// Fill the wall rows among [y0, y1) of one column into a tile column
+static void DrawSpanSegment(const ColumnSpan* span, int y0, int y1, Color* out) {
+    int y = (span->drawStart > y0) ? span->drawStart : y0;
+    long long texPos = span->texPos + (long long)(y - span->drawStart) * span->texStep;
+    
+    // Wall slice
+    int wallEnd = (span->drawEnd + 1 < y1) ? span->drawEnd + 1 : y1;
+    for (; y < wallEnd; y++) {
+        int texY = (int)(texPos >> 16);
+        if (texY > span->texMaxY) texY = span->texMaxY;
+        texPos += span->texStep;
+        
+        out[y - y0] = span->shade[span->texels[texY * span->texStride]];
+    }
+}
+
+// Lay the wall slices of a band of columns over rows [y0, y1), at most
+// RENDER_TILE_HEIGHT of them. Slices are drawn top to bottom into a small
+// column-major tile that stays in L1, then the tile is transposed into the
+// row-major framebuffer. Writing the framebuffer a column at a time touches a
+// new cache line per pixel and is several times slower.
+static void DrawBand(Framebuffer* fb, const ColumnSpan* spans, const BandRows* band, int startX, int count, int y0, int y1) {
+    Color tile[RENDER_BAND_WIDTH][RENDER_TILE_HEIGHT];
+    if (y0 < band->firstStart) y0 = band->firstStart;
+    if (y1 > band->lastEnd + 1) y1 = band->lastEnd + 1;
+    if (y0 >= y1) return;
+    
+    for (int i = 0; i < count; i++) {
+        DrawSpanSegment(&spans[i], y0, y1, tile[i]);
+    }
+    
+    for (int y = y0; y < y1; y++) {
+        Color* row = fb->pixels + (size_t)y * fb->width + startX;
+        if (y >= band->lastStart && y <= band->firstEnd) {
+            for (int i = 0; i < count; i++) {
+                row[i] = tile[i][y - y0];
+            }
+            continue;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            if (y >= spans[i].drawStart && y <= spans[i].drawEnd) row[i] = tile[i][y - y0];
+        }
+    }
+}
+
+// Cast the columns [startX, endX) into the caster's spans, band by band
+static void CastColumns(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables,
+                        FrameCaster* caster, int startX, int endX) {
+    int screenWidth = fb->width;
+    
+    // Use exact player position as ray origin to match minimap
+    Vector2 rayPos = player->position;
+    
+    // Cast rays one band at a time so the packet kernels see adjacent columns
+    float rayDirX[RENDER_BAND_WIDTH];
+    float rayDirY[RENDER_BAND_WIDTH];
+    RayHit hits[RENDER_BAND_WIDTH];
+    
+    for (int bandX = startX; bandX < endX; bandX += RENDER_BAND_WIDTH) {
+        int count = endX - bandX;
+        if (count > RENDER_BAND_WIDTH) count = RENDER_BAND_WIDTH;
+        
+        for (int i = 0; i < count; i++) {
+            // x-coordinate in camera space
+            float cameraX = 2.0f * (bandX + i) / (float)screenWidth - 1.0f;
+            rayDirX[i] = player->direction.x + player->plane.x * cameraX;
+            rayDirY[i] = player->direction.y + player->plane.y * cameraX;
+        }
+        
+        CastRays(caster->kernel, map, rayPos, rayDirX, rayDirY, count, hits);
+        
+        ColumnSpan* spans = caster->spans + bandX;
+        BandRows band = { fb->height, 0, fb->height, -1 };
+        for (int i = 0; i < count; i++) {
+            SetupColumn(fb, tables, rayPos, (Vector2){ rayDirX[i], rayDirY[i] }, &hits[i], &spans[i]);
+            fb->depth[bandX + i] = hits[i].perpDist; // Occlusion for the sprite pass
+            
+            if (spans[i].drawStart < band.firstStart) band.firstStart = spans[i].drawStart;
+            if (spans[i].drawStart > band.lastStart) band.lastStart = spans[i].drawStart;
+            if (spans[i].drawEnd < band.firstEnd) band.firstEnd = spans[i].drawEnd;
+            if (spans[i].drawEnd > band.lastEnd) band.lastEnd = spans[i].drawEnd;
+        }
+        caster->bands[bandX / RENDER_BAND_WIDTH] = band;
+    }
+}
+
+// Draw rows [y0, y1) of the columns [startX, endX) cast by CastColumns, in
+// blocks of RENDER_TILE_HEIGHT rows: first the floor and ceiling, a row at a
+// time across every run of bands not walled over on that row, then the walls
+// over them band by band
+static void DrawRows(Framebuffer* fb, const FrameCaster* caster, int startX, int endX, int y0, int y1) {
+    for (int blockY = y0; blockY < y1; blockY += RENDER_TILE_HEIGHT) {
+        int blockEnd = (blockY + RENDER_TILE_HEIGHT < y1) ? blockY + RENDER_TILE_HEIGHT : y1;
+        
+        for (int y = blockY; y < blockEnd; y++) {
+            Color* row = fb->pixels + (size_t)y * fb->width;
+            int flatStart = -1;
+            for (int bandX = startX; bandX < endX; bandX += RENDER_BAND_WIDTH) {
+                const BandRows* band = &caster->bands[bandX / RENDER_BAND_WIDTH];
+                bool walled = y >= band->lastStart && y <= band->firstEnd;
+                if (!walled && flatStart < 0) flatStart = bandX;
+                if (walled && flatStart >= 0) {
+                    DrawFlatRow(caster, y, flatStart, bandX - flatStart, row + flatStart);
+                    flatStart = -1;
+                }
+            }
+            if (flatStart >= 0) DrawFlatRow(caster, y, flatStart, endX - flatStart, row + flatStart);
+        }
+        
+        for (int bandX = startX; bandX < endX; bandX += RENDER_BAND_WIDTH) {
+            int count = (endX - bandX < RENDER_BAND_WIDTH) ? endX - bandX : RENDER_BAND_WIDTH;
+            DrawBand(fb, caster->spans + bandX, &caster->bands[bandX / RENDER_BAND_WIDTH], bandX, count, blockY, blockEnd);
+        }
+    }
+}
+
+void RenderColumns(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables, int startX, int endX) {
+    FrameCaster caster;
+    if (!InitFrameCaster(&caster, fb, player, tables, GetRayKernel())) return;
+    
+    CastColumns(fb, player, map, tables, &caster, startX, endX);
+    DrawRows(fb, &caster, startX, endX, 0, fb->height);
+    UnloadFrameCaster(&caster);
+}
+
+// Rows per drawing job on the worker pool, so a frame's rows spread over
+// many threads
+#define RENDER_ROW_JOB_HEIGHT 16
+
+// Shared state for one parallel frame
+typedef struct FrameJob {
+    Framebuffer* fb;
+    const Player* player;
+    const Map* map;
+    const ShadeTables* tables;
+    FrameCaster* caster;
+} FrameJob;
+
+static void CastColumnBand(void* userData, int jobIndex, int threadIndex) {
+    FrameJob* job = (FrameJob*)userData;
+    (void)threadIndex;
+    
+    int startX = jobIndex * RENDER_BAND_WIDTH;
+    int endX = startX + RENDER_BAND_WIDTH;
+    if (endX > job->fb->width) endX = job->fb->width;
+    
+    PROFILE_BEGIN(PROFILE_ZONE_RAYCAST_BAND);
+    CastColumns(job->fb, job->player, job->map, job->tables, job->caster, startX, endX);
+    PROFILE_END(PROFILE_ZONE_RAYCAST_BAND);
+}
+
+static void DrawRowBlock(void* userData, int jobIndex, int threadIndex) {
+    FrameJob* job = (FrameJob*)userData;
+    (void)threadIndex;
+    
+    int y0 = jobIndex * RENDER_ROW_JOB_HEIGHT;
+    int y1 = y0 + RENDER_ROW_JOB_HEIGHT;
+    if (y1 > job->fb->height) y1 = job->fb->height;
+    
+    PROFILE_BEGIN(PROFILE_ZONE_RAYCAST_BAND);
+    DrawRows(job->fb, job->caster, 0, job->fb->width, y0, y1);
+    PROFILE_END(PROFILE_ZONE_RAYCAST_BAND);
+}
+
+void RenderWorldSoftware(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables, WorkerPool* pool) {
+    // Floor and ceiling rows are set up once for the whole frame
+    FrameCaster caster;
+    if (!InitFrameCaster(&caster, fb, player, tables, GetRayKernel())) {
+        TraceLog(LOG_WARNING, "Failed to allocate the floor, ceiling and column setup of a %dx%d frame", fb->width, fb->height);
+        return;
+    }
+    
+    if (pool == NULL) {
+        CastColumns(fb, player, map, tables, &caster, 0, fb->width);
+        DrawRows(fb, &caster, 0, fb->width, 0, fb->height);
+    } else {
+        FrameJob job = { fb, player, map, tables, &caster };
+        int bandCount = (fb->width + RENDER_BAND_WIDTH - 1) / RENDER_BAND_WIDTH;
+        int blockCount = (fb->height + RENDER_ROW_JOB_HEIGHT - 1) / RENDER_ROW_JOB_HEIGHT;
+        RunWorkerJobs(pool, CastColumnBand, &job, bandCount);
+        RunWorkerJobs(pool, DrawRowBlock, &job, blockCount);
+    }
+    UnloadFrameCaster(&caster);
+}
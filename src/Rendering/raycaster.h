@@ -0,0 +1,61 @@
+#ifndef RAYCASTER_H
+#define RAYCASTER_H
+
+#include "raylib.h"
+#include "framebuffer.h"
+#include "colormap.h"
+#include "../World/player.h"
+#include "../World/map.h"
+#include "../Core/worker_pool.h"
+
+// Projection constants shared by every CPU render path
+#define WALL_DISTANCE_SCALE 0.4f // Distance reduction factor (makes walls appear closer)
+#define WALL_HEIGHT_FACTOR 2.0f  // Perceived wall height multiplier
+
+// Width of the column bands handed to worker threads. 32 RGBA8 pixels span
+// two cache lines, so neighbouring bands never share a line.
+#define RENDER_BAND_WIDTH 32
+#define RENDER_TILE_HEIGHT 64 // Rows per band tile (32x64 RGBA8 = 8 KB, fits in L1)
+
+// Result of casting one ray through the tile grid
+typedef struct RayHit {
+    float perpDist; // Distance to the wall projected on the camera direction (in tiles)
+    int side;       // 0 = x-side (EW wall) hit, 1 = y-side (NS wall) hit
+    int tile;       // Tile type that was hit
+    int mapX;       // Grid coordinates of the hit tile
+    int mapY;
+    float doorOpen; // How far a door that was hit has slid open, 0 otherwise
+} RayHit;
+
+// DDA traversal kernels. The packet kernels march 4/8 adjacent rays together
+// with masked stepping and produce the same RayHit as the scalar path; rays
+// that end on a door tile are finished by the scalar path.
+typedef enum {
+    RAY_KERNEL_SCALAR,
+    RAY_KERNEL_SSE2,
+    RAY_KERNEL_AVX2,
+    RAY_KERNEL_COUNT
+} RayKernel;
+
+bool IsRayKernelSupported(RayKernel kernel);
+RayKernel GetBestRayKernel(void);      // Widest kernel the CPU supports
+bool SetRayKernel(RayKernel kernel);   // Override the runtime choice
+RayKernel GetRayKernel(void);          // Kernel used by RenderColumns
+const char* GetRayKernelName(RayKernel kernel);
+void CastRays(RayKernel kernel, const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, int count, RayHit* hits);
+
+// Software raycaster. None of these functions touch the GPU, so they can run
+// headless on a framebuffer that is never presented.
+void CastRay(const Map* map, Vector2 rayPos, Vector2 rayDir, RayHit* hit);
+void RenderColumns(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables, int startX, int endX);
+
+// Renders a full frame. Columns are split into RENDER_BAND_WIDTH bands and
+// raycast on the pool's threads, then the rows are drawn in blocks: floors
+// and ceilings a whole row at a time, from rows set up once per frame, and
+// the wall slices over them. Pass NULL to render on the calling thread.
+// Every pixel is computed independently, so the output does not depend on
+// the thread count or the kernel. Textures and shading come from tables, built from
+// map->wallImages (see colormap.h).
+void RenderWorldSoftware(Framebuffer* fb, const Player* player, const Map* map, const ShadeTables* tables, WorkerPool* pool);
+
+#endif // RAYCASTER_H
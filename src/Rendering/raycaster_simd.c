@@ -0,0 +1,320 @@
+#include "raycaster.h"
+#include <math.h>
+
+// Packet DDA kernels. Each kernel marches 4 (SSE2) or 8 (AVX2) rays that
+// share an origin in lock-step. Lanes that already hit a wall are masked off
+// and keep their state while the rest of the packet keeps stepping.
+//
+// Every lane performs the same IEEE single precision operations, in the same
+// order, as the scalar CastRay, so perpDist/side/tile/mapX/mapY match the
+// scalar path bit for bit. This relies on the build not contracting a*b+c
+// into FMA (-ffp-contract=off). Rays that stop on a door tile are rare and
+// are cast again by CastRay, which knows how to pass or hit the door.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYCASTER_HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// Kernel picked by the first call to GetRayKernel
+static RayKernel activeKernel = RAY_KERNEL_COUNT;
+
+// Scalar reference: one ray at a time
+static void CastRaysScalar(const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, int count, RayHit* hits) {
+    for (int i = 0; i < count; i++) {
+        CastRay(map, rayPos, (Vector2){ rayDirX[i], rayDirY[i] }, &hits[i]);
+    }
+}
+
+#ifdef RAYCASTER_HAS_X86_KERNELS
+
+// Lane-wise select: mask ? a : b (mask lanes are all ones or all zeros)
+__attribute__((target("sse2")))
+static inline __m128 SelectPs(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i SelectEpi32(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("sse2")))
+static void CastRayPacketSSE2(const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, RayHit* hits) {
+    // Origin in tile units and its map cell, shared by every lane
+    float posXs = rayPos.x / TILE_SIZE;
+    float posYs = rayPos.y / TILE_SIZE;
+    int mapXs = (int)(rayPos.x / TILE_SIZE);
+    int mapYs = (int)(rayPos.y / TILE_SIZE);
+    
+    __m128 posX = _mm_set1_ps(posXs);
+    __m128 posY = _mm_set1_ps(posYs);
+    __m128i mapX = _mm_set1_epi32(mapXs);
+    __m128i mapY = _mm_set1_epi32(mapYs);
+    __m128 mapXf = _mm_cvtepi32_ps(mapX);
+    __m128 mapYf = _mm_cvtepi32_ps(mapY);
+    
+    __m128 dirX = _mm_loadu_ps(rayDirX);
+    __m128 dirY = _mm_loadu_ps(rayDirY);
+    
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(0.0001f);
+    const __m128 huge = _mm_set1_ps(1e30f);
+    const __m128i oneI = _mm_set1_epi32(1);
+    
+    // Length of ray from one side to the next
+    __m128 deltaX = SelectPs(_mm_cmplt_ps(_mm_and_ps(dirX, absMask), epsilon), huge,
+                             _mm_and_ps(_mm_div_ps(one, dirX), absMask));
+    __m128 deltaY = SelectPs(_mm_cmplt_ps(_mm_and_ps(dirY, absMask), epsilon), huge,
+                             _mm_and_ps(_mm_div_ps(one, dirY), absMask));
+    
+    // Step direction and distance to the first side
+    __m128 negX = _mm_cmplt_ps(dirX, zero);
+    __m128 negY = _mm_cmplt_ps(dirY, zero);
+    __m128i stepX = SelectEpi32(_mm_castps_si128(negX), _mm_set1_epi32(-1), oneI);
+    __m128i stepY = SelectEpi32(_mm_castps_si128(negY), _mm_set1_epi32(-1), oneI);
+    __m128 sideDistX = SelectPs(negX, _mm_mul_ps(_mm_sub_ps(posX, mapXf), deltaX),
+                                _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapXf, one), posX), deltaX));
+    __m128 sideDistY = SelectPs(negY, _mm_mul_ps(_mm_sub_ps(posY, mapYf), deltaY),
+                                _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapYf, one), posY), deltaY));
+    
+    __m128i side = _mm_setzero_si128();
+    __m128i active = _mm_set1_epi32(-1);
+    
+    while (_mm_movemask_epi8(active) != 0) {
+        // Branch-free step: x where sideDistX < sideDistY, y elsewhere
+        __m128i takeX = _mm_castps_si128(_mm_cmplt_ps(sideDistX, sideDistY));
+        __m128i stepXMask = _mm_and_si128(takeX, active);
+        __m128i stepYMask = _mm_andnot_si128(takeX, active);
+        
+        sideDistX = SelectPs(_mm_castsi128_ps(stepXMask), _mm_add_ps(sideDistX, deltaX), sideDistX);
+        sideDistY = SelectPs(_mm_castsi128_ps(stepYMask), _mm_add_ps(sideDistY, deltaY), sideDistY);
+        mapX = _mm_add_epi32(mapX, _mm_and_si128(stepX, stepXMask));
+        mapY = _mm_add_epi32(mapY, _mm_and_si128(stepY, stepYMask));
+        side = SelectEpi32(stepXMask, _mm_setzero_si128(), side);
+        side = SelectEpi32(stepYMask, oneI, side);
+        
+        // SSE2 has no gather, test occupancy bits lane by lane
+        int laneX[4], laneY[4], laneActive[4], laneSolid[4];
+        _mm_storeu_si128((__m128i*)laneX, mapX);
+        _mm_storeu_si128((__m128i*)laneY, mapY);
+        _mm_storeu_si128((__m128i*)laneActive, active);
+        for (int i = 0; i < 4; i++) {
+            laneSolid[i] = (laneActive[i] && IsMapCellSolid(map, laneX[i], laneY[i])) ? -1 : 0;
+        }
+        
+        // Lanes that hit something stop stepping
+        active = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)laneSolid), active);
+    }
+    
+    // Distance projected on camera direction, same expression as CastRay
+    __m128 halfStepX = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_sub_epi32(oneI, stepX), 1));
+    __m128 halfStepY = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_sub_epi32(oneI, stepY), 1));
+    __m128 perpX = _mm_div_ps(_mm_add_ps(_mm_sub_ps(_mm_cvtepi32_ps(mapX), posX), halfStepX), dirX);
+    __m128 perpY = _mm_div_ps(_mm_add_ps(_mm_sub_ps(_mm_cvtepi32_ps(mapY), posY), halfStepY), dirY);
+    __m128 perp = SelectPs(_mm_castsi128_ps(_mm_cmpeq_epi32(side, _mm_setzero_si128())), perpX, perpY);
+    
+    float outPerp[4];
+    int outSide[4], outX[4], outY[4];
+    _mm_storeu_ps(outPerp, perp);
+    _mm_storeu_si128((__m128i*)outSide, side);
+    _mm_storeu_si128((__m128i*)outX, mapX);
+    _mm_storeu_si128((__m128i*)outY, mapY);
+    
+    // Tile types are only needed once per ray, at the hit cell
+    for (int i = 0; i < 4; i++) {
+        hits[i] = (RayHit){ outPerp[i], outSide[i], GetMapTile(map, outX[i], outY[i]), outX[i], outY[i], 0.0f };
+        if (hits[i].tile == TILE_DOOR) CastRay(map, rayPos, (Vector2){ rayDirX[i], rayDirY[i] }, &hits[i]);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256 SelectPs256(__m256 mask, __m256 a, __m256 b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i SelectEpi32x8(__m256i mask, __m256i a, __m256i b) {
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+__attribute__((target("avx2")))
+static void CastRayPacketAVX2(const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, RayHit* hits) {
+    float posXs = rayPos.x / TILE_SIZE;
+    float posYs = rayPos.y / TILE_SIZE;
+    int mapXs = (int)(rayPos.x / TILE_SIZE);
+    int mapYs = (int)(rayPos.y / TILE_SIZE);
+    
+    __m256 posX = _mm256_set1_ps(posXs);
+    __m256 posY = _mm256_set1_ps(posYs);
+    __m256i mapX = _mm256_set1_epi32(mapXs);
+    __m256i mapY = _mm256_set1_epi32(mapYs);
+    __m256 mapXf = _mm256_cvtepi32_ps(mapX);
+    __m256 mapYf = _mm256_cvtepi32_ps(mapY);
+    
+    __m256 dirX = _mm256_loadu_ps(rayDirX);
+    __m256 dirY = _mm256_loadu_ps(rayDirY);
+    
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 epsilon = _mm256_set1_ps(0.0001f);
+    const __m256 huge = _mm256_set1_ps(1e30f);
+    const __m256i zeroI = _mm256_setzero_si256();
+    const __m256i oneI = _mm256_set1_epi32(1);
+    
+    // Bounds and origin of the occupancy bits, and the bitset viewed as 32-bit
+    // words for the gather (bit n of the uint64 words is bit n & 31 of word
+    // n >> 5 on x86)
+    const __m256i width = _mm256_set1_epi32(map->solidWidth);
+    const __m256i height = _mm256_set1_epi32(map->solidHeight);
+    const __m256i originX = _mm256_set1_epi32(map->solidX);
+    const __m256i originY = _mm256_set1_epi32(map->solidY);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i bitMask = _mm256_set1_epi32(31);
+    const int* solidWords = (const int*)map->solid;
+    
+    __m256 deltaX = SelectPs256(_mm256_cmp_ps(_mm256_and_ps(dirX, absMask), epsilon, _CMP_LT_OQ), huge,
+                                _mm256_and_ps(_mm256_div_ps(one, dirX), absMask));
+    __m256 deltaY = SelectPs256(_mm256_cmp_ps(_mm256_and_ps(dirY, absMask), epsilon, _CMP_LT_OQ), huge,
+                                _mm256_and_ps(_mm256_div_ps(one, dirY), absMask));
+    
+    __m256 negX = _mm256_cmp_ps(dirX, zero, _CMP_LT_OQ);
+    __m256 negY = _mm256_cmp_ps(dirY, zero, _CMP_LT_OQ);
+    __m256i stepX = SelectEpi32x8(_mm256_castps_si256(negX), minusOne, oneI);
+    __m256i stepY = SelectEpi32x8(_mm256_castps_si256(negY), minusOne, oneI);
+    __m256 sideDistX = SelectPs256(negX, _mm256_mul_ps(_mm256_sub_ps(posX, mapXf), deltaX),
+                                   _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(mapXf, one), posX), deltaX));
+    __m256 sideDistY = SelectPs256(negY, _mm256_mul_ps(_mm256_sub_ps(posY, mapYf), deltaY),
+                                   _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(mapYf, one), posY), deltaY));
+    
+    __m256i side = zeroI;
+    __m256i active = minusOne;
+    
+    while (!_mm256_testz_si256(active, active)) {
+        __m256i takeX = _mm256_castps_si256(_mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ));
+        __m256i stepXMask = _mm256_and_si256(takeX, active);
+        __m256i stepYMask = _mm256_andnot_si256(takeX, active);
+        
+        sideDistX = SelectPs256(_mm256_castsi256_ps(stepXMask), _mm256_add_ps(sideDistX, deltaX), sideDistX);
+        sideDistY = SelectPs256(_mm256_castsi256_ps(stepYMask), _mm256_add_ps(sideDistY, deltaY), sideDistY);
+        mapX = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, stepXMask));
+        mapY = _mm256_add_epi32(mapY, _mm256_and_si256(stepY, stepYMask));
+        side = SelectEpi32x8(stepXMask, zeroI, side);
+        side = SelectEpi32x8(stepYMask, oneI, side);
+        
+        // Out-of-bounds cells count as walls, in-bounds ones are gathered
+        __m256i cellX = _mm256_sub_epi32(mapX, originX);
+        __m256i cellY = _mm256_sub_epi32(mapY, originY);
+        __m256i inBounds = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(cellX, minusOne), _mm256_cmpgt_epi32(width, cellX)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(cellY, minusOne), _mm256_cmpgt_epi32(height, cellY)));
+        __m256i gatherMask = _mm256_and_si256(inBounds, active);
+        __m256i bit = _mm256_add_epi32(_mm256_mullo_epi32(cellY, width), cellX);
+        __m256i words = _mm256_mask_i32gather_epi32(minusOne, solidWords, _mm256_srli_epi32(bit, 5), gatherMask, 4);
+        __m256i solidBit = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(bit, bitMask)), oneI);
+        
+        // Lanes that hit something stop stepping
+        __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi32(solidBit, oneI), active);
+        active = _mm256_andnot_si256(hit, active);
+    }
+    
+    __m256 halfStepX = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_sub_epi32(oneI, stepX), 1));
+    __m256 halfStepY = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_sub_epi32(oneI, stepY), 1));
+    __m256 perpX = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(mapX), posX), halfStepX), dirX);
+    __m256 perpY = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(mapY), posY), halfStepY), dirY);
+    __m256 perp = SelectPs256(_mm256_castsi256_ps(_mm256_cmpeq_epi32(side, zeroI)), perpX, perpY);
+    
+    float outPerp[8];
+    int outSide[8], outX[8], outY[8];
+    _mm256_storeu_ps(outPerp, perp);
+    _mm256_storeu_si256((__m256i*)outSide, side);
+    _mm256_storeu_si256((__m256i*)outX, mapX);
+    _mm256_storeu_si256((__m256i*)outY, mapY);
+    
+    for (int i = 0; i < 8; i++) {
+        hits[i] = (RayHit){ outPerp[i], outSide[i], GetMapTile(map, outX[i], outY[i]), outX[i], outY[i], 0.0f };
+        if (hits[i].tile == TILE_DOOR) CastRay(map, rayPos, (Vector2){ rayDirX[i], rayDirY[i] }, &hits[i]);
+    }
+}
+
+// Run a fixed-width packet kernel over count rays, padding the last packet
+// by repeating the final ray
+static void CastRaysPacketed(const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, int count, RayHit* hits,
+                             int width, void (*kernel)(const Map*, Vector2, const float*, const float*, RayHit*)) {
+    int i = 0;
+    for (; i + width <= count; i += width) {
+        kernel(map, rayPos, rayDirX + i, rayDirY + i, hits + i);
+    }
+    
+    if (i < count) {
+        float tailX[8], tailY[8];
+        RayHit tailHits[8];
+        for (int j = 0; j < width; j++) {
+            int src = (i + j < count) ? i + j : count - 1;
+            tailX[j] = rayDirX[src];
+            tailY[j] = rayDirY[src];
+        }
+        kernel(map, rayPos, tailX, tailY, tailHits);
+        for (int j = 0; i + j < count; j++) {
+            hits[i + j] = tailHits[j];
+        }
+    }
+}
+
+#endif // RAYCASTER_HAS_X86_KERNELS
+
+bool IsRayKernelSupported(RayKernel kernel) {
+    switch (kernel) {
+        case RAY_KERNEL_SCALAR: return true;
+#ifdef RAYCASTER_HAS_X86_KERNELS
+        case RAY_KERNEL_SSE2:   return __builtin_cpu_supports("sse2");
+        case RAY_KERNEL_AVX2:   return __builtin_cpu_supports("avx2");
+#endif
+        default:                return false;
+    }
+}
+
+RayKernel GetBestRayKernel(void) {
+    if (IsRayKernelSupported(RAY_KERNEL_AVX2)) return RAY_KERNEL_AVX2;
+    if (IsRayKernelSupported(RAY_KERNEL_SSE2)) return RAY_KERNEL_SSE2;
+    return RAY_KERNEL_SCALAR;
+}
+
+bool SetRayKernel(RayKernel kernel) {
+    if (kernel >= RAY_KERNEL_COUNT || !IsRayKernelSupported(kernel)) return false;
+    activeKernel = kernel;
+    return true;
+}
+
+RayKernel GetRayKernel(void) {
+    if (activeKernel == RAY_KERNEL_COUNT) activeKernel = GetBestRayKernel();
+    return activeKernel;
+}
+
+const char* GetRayKernelName(RayKernel kernel) {
+    switch (kernel) {
+        case RAY_KERNEL_SCALAR: return "scalar";
+        case RAY_KERNEL_SSE2:   return "sse2";
+        case RAY_KERNEL_AVX2:   return "avx2";
+        default:                return "unknown";
+    }
+}
+
+void CastRays(RayKernel kernel, const Map* map, Vector2 rayPos, const float* rayDirX, const float* rayDirY, int count, RayHit* hits) {
+    switch (kernel) {
+#ifdef RAYCASTER_HAS_X86_KERNELS
+        case RAY_KERNEL_AVX2:
+            CastRaysPacketed(map, rayPos, rayDirX, rayDirY, count, hits, 8, CastRayPacketAVX2);
+            break;
+        case RAY_KERNEL_SSE2:
+            CastRaysPacketed(map, rayPos, rayDirX, rayDirY, count, hits, 4, CastRayPacketSSE2);
+            break;
+#endif
+        default:
+            CastRaysScalar(map, rayPos, rayDirX, rayDirY, count, hits);
+            break;
+    }
+}
@@ -3,20 +3,64 @@
 #include "raymath.h"
 #include "../World/map.h"
 #include "../World/player.h"
+#include "../World/pvs.h"
+#include "draw_list.h"
+#include "framebuffer.h"
+#include "raycaster.h"
+#include "resolution.h"
+#include "shading.h"
+#include "sprite_renderer.h"
+#include "wall_mesh.h"
+#include "../Core/timing.h"
+#include "../Core/profiler.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 // Global render mode
 RenderMode currentRenderMode = RENDER_MODE_CPU;
 
 // Function prototypes for internal functions
 static void InitGPURendering(void);
-static void RenderWorldCPU(Player player, Map map);
-static void RenderWorldGPU(Player player, Map map);
+static void RenderWorldCPU(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures);
+static void RenderWorldGPU(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures);
 
 // Internal variables
 static RenderTexture2D screenTexture = { 0 }; // For post-processing
 
+// Software rendering resources
+static Framebuffer framebuffer = { 0 };       // CPU-side RGBA8 frame
+static Texture2D framebufferTexture = { 0 };  // Streaming texture the frame is uploaded to
+static WorkerPool renderPool;                   // Threads for column-parallel raycasting
+static bool renderPoolInitialized = false;
+static int renderThreadCount = 0;              // 0 = one thread per core
+static RenderStats renderStats = { 0 };
+static SpriteView spriteView = { 0 };         // Sprites gathered for the current frame
+static ShadeTables shadeTables = { 0 };       // Indexed textures and colormaps, rebuilt when the images change
+static ResolutionController resolution = { 0 }; // Internal resolution of the software frame
+static float renderBudgetMs = RESOLUTION_DEFAULT_BUDGET_MS;
+static float renderPinnedScale = 0.0f;
+
+// Everything a frame's picture depends on. A frame whose key matches the last
+// one looks the same, so the software path shows its last frame again.
+typedef struct FrameKey {
+    RenderMode mode;
+    int width, height;                        // Render size
+    Vector2 position, direction, plane;       // Camera
+    const Map* map;
+    unsigned int mapRevision;
+    unsigned int doorVersion;
+    const SpriteList* sprites;
+    unsigned int spriteVersion;
+} FrameKey;
+
+static FrameKey lastFrameKey = { 0 };
+static bool lastFrameKeyValid = false;
+
+// Minimap zoom: tiles shown across the minimap per level, 0 = whole map
+static const int MINIMAP_ZOOM_SPANS[MINIMAP_ZOOM_LEVELS] = { 0, 48, 24, 12 };
+static int minimapZoom = 0;
+
 // GPU rendering resources
 static Shader wallShader = { 0 };
 static Shader floorCeilingShader = { 0 };
@@ -29,17 +73,28 @@ static Mesh ceilingMesh = { 0 };
 static bool shadersLoaded = false;
 static bool modelsLoaded = false;
 
+// Merged static wall geometry, built for the map currently being drawn
+#define GPU_WALL_CHUNK_RADIUS 1     // Chunks drawn around the player's chunk, within the WALL_MESH_DEFAULT_RADIUS kept
+static WallMesh gpuWallMesh = { 0 };
+static const Map* gpuWallMeshMap = NULL;
+static unsigned char* gpuChunkVisible = NULL; // Per-chunk draw flags for the current frame
+static WallMeshGroup gpuDoorMesh = { 0 };     // Every moving door, rebuilt each frame
+static DrawList gpuDrawList = { 0 };          // The frame's mesh draws, sorted and batched on submission
+
 // Shader uniform locations (cached for performance)
 static int wallHeightLoc = -1;
 static int fogDensityLoc = -1;
 static int darkFactorLoc = -1;
-static int applyTexOffsetLoc = -1;
-static int texOffsetLoc = -1;
 static int isCeilingLoc = -1;
 static int texScaleLoc = -1;
 static int fcFogDensityLoc = -1;
 static int fcDarknessLoc = -1;
 static int cameraPositionLoc = -1;
+static int minLightLoc = -1;
+static int fogColorLoc = -1;
+static int fcMinLightLoc = -1;
+static int skyFogColorLoc = -1;
+static int floorFogColorLoc = -1;
 
 void InitRenderer(void) {
     int screenWidth = GetScreenWidth();
@@ -48,6 +103,16 @@ void InitRenderer(void) {
     // Create a render texture for potential post-processing
     screenTexture = LoadRenderTexture(screenWidth, screenHeight);
     
+    // Allocate the software framebuffer used by the CPU path
+    InitFramebuffer(&framebuffer, screenWidth, screenHeight);
+    InitResolutionController(&resolution, renderBudgetMs);
+    PinResolutionScale(&resolution, renderPinnedScale);
+    
+    // Start the raycasting worker threads
+    InitWorkerPool(&renderPool, renderThreadCount);
+    renderPoolInitialized = true;
+    TraceLog(LOG_INFO, "CPU raycaster using %d threads", renderPool.threadCount);
+    
     // Initialize GPU rendering resources (even if we start with CPU rendering)
     InitGPURendering();
 }
@@ -79,8 +144,8 @@ void InitGPURendering(void) {
         wallHeightLoc = GetShaderLocation(wallShader, "wallHeight");
         fogDensityLoc = GetShaderLocation(wallShader, "fogDensity");
         darkFactorLoc = GetShaderLocation(wallShader, "darknessFactor");
-        applyTexOffsetLoc = GetShaderLocation(wallShader, "applyTextureOffset");
-        texOffsetLoc = GetShaderLocation(wallShader, "textureOffset");
+        minLightLoc = GetShaderLocation(wallShader, "minLight");
+        fogColorLoc = GetShaderLocation(wallShader, "fogColor");
         
         // Floor/ceiling shader uniforms
         floorCeilingShader.locs[SHADER_LOC_MATRIX_MVP] = GetShaderLocation(floorCeilingShader, "mvp");
@@ -93,24 +158,17 @@ void InitGPURendering(void) {
         fcFogDensityLoc = GetShaderLocation(floorCeilingShader, "fogDensity");
         fcDarknessLoc = GetShaderLocation(floorCeilingShader, "floorCeilingDarkness");
         cameraPositionLoc = GetShaderLocation(floorCeilingShader, "cameraPosition");
-        
-        // Set default uniform values
-        if (wallHeightLoc != -1) SetShaderValue(wallShader, wallHeightLoc, (float[1]){ 1.0f }, SHADER_UNIFORM_FLOAT);
-        if (fogDensityLoc != -1) SetShaderValue(wallShader, fogDensityLoc, (float[1]){ 0.05f }, SHADER_UNIFORM_FLOAT);
-        if (darkFactorLoc != -1) SetShaderValue(wallShader, darkFactorLoc, (float[1]){ 0.3f }, SHADER_UNIFORM_FLOAT);
-        if (applyTexOffsetLoc != -1) SetShaderValue(wallShader, applyTexOffsetLoc, (int[1]){ 0 }, SHADER_UNIFORM_INT);
-        if (texOffsetLoc != -1) SetShaderValue(wallShader, texOffsetLoc, (float[1]){ 0.0f }, SHADER_UNIFORM_FLOAT);
-        
-        if (isCeilingLoc != -1) SetShaderValue(floorCeilingShader, isCeilingLoc, (int[1]){ 0 }, SHADER_UNIFORM_INT);
-        if (texScaleLoc != -1) SetShaderValue(floorCeilingShader, texScaleLoc, (float[1]){ 0.1f }, SHADER_UNIFORM_FLOAT);
-        if (fcFogDensityLoc != -1) SetShaderValue(floorCeilingShader, fcFogDensityLoc, (float[1]){ 0.05f }, SHADER_UNIFORM_FLOAT);
-        if (fcDarknessLoc != -1) SetShaderValue(floorCeilingShader, fcDarknessLoc, (float[1]){ 0.1f }, SHADER_UNIFORM_FLOAT);
+        fcMinLightLoc = GetShaderLocation(floorCeilingShader, "minLight");
+        skyFogColorLoc = GetShaderLocation(floorCeilingShader, "skyFogColor");
+        floorFogColorLoc = GetShaderLocation(floorCeilingShader, "floorFogColor");
     }
     
-    // Create basic wall mesh (will be transformed by vertex shader)
+    // The wall model only carries the wall material; geometry comes from the merged wall mesh
     wallMesh = GenMeshCube(1.0f, 1.0f, 1.0f);
     wallModel = LoadModelFromMesh(wallMesh);
     SetMaterialTexture(&wallModel.materials[0], MATERIAL_MAP_DIFFUSE, (Texture2D){ 0 });
+    InitDoorMesh(&gpuDoorMesh, true);
+    InitDrawList(&gpuDrawList, 32);
     
     // Create floor and ceiling planes
     floorMesh = GenMeshPlane(100.0f, 100.0f, 10, 10);
@@ -131,232 +189,282 @@ void InitGPURendering(void) {
     modelsLoaded = true;
 }
 
-void RenderWorld(Player player, Map map) {
+static bool IsSameVector(Vector2 a, Vector2 b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static bool IsSameFrame(const FrameKey* a, const FrameKey* b) {
+    return a->mode == b->mode && a->width == b->width && a->height == b->height &&
+           IsSameVector(a->position, b->position) && IsSameVector(a->direction, b->direction) &&
+           IsSameVector(a->plane, b->plane) && a->map == b->map && a->mapRevision == b->mapRevision &&
+           a->doorVersion == b->doorVersion && a->sprites == b->sprites && a->spriteVersion == b->spriteVersion;
+}
+
+void RenderWorld(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures) {
     int screenWidth = GetScreenWidth();
     int screenHeight = GetScreenHeight();
+    bool gpu = currentRenderMode == RENDER_MODE_GPU && shadersLoaded && modelsLoaded;
+    
+    // Compare what this frame shows with what the last one showed
+    FrameKey key = {
+        .mode = gpu ? RENDER_MODE_GPU : RENDER_MODE_CPU,
+        .position = player->position,
+        .direction = player->direction,
+        .plane = player->plane,
+        .map = map,
+        .mapRevision = map->revision,
+        .doorVersion = map->doorVersion,
+        .sprites = sprites,
+        .spriteVersion = sprites->version
+    };
+    if (gpu) {
+        key.width = screenWidth;
+        key.height = screenHeight;
+    } else {
+        GetResolutionSize(&resolution, screenWidth, screenHeight, &key.width, &key.height);
+    }
+    renderStats.frameChanged = !lastFrameKeyValid || !IsSameFrame(&key, &lastFrameKey);
+    lastFrameKey = key;
+    lastFrameKeyValid = true;
     
     // Decide which rendering method to use
-    if (currentRenderMode == RENDER_MODE_GPU && shadersLoaded && modelsLoaded) {
-        RenderWorldGPU(player, map);
+    if (gpu) {
+        RenderWorldGPU(player, map, sprites, textures);
     } else {
-        RenderWorldCPU(player, map);
+        RenderWorldCPU(player, map, sprites, textures);
     }
 }
 
-// CPU-based raycasting rendering
-void RenderWorldCPU(Player player, Map map) {
+// Raycasts and draws sprites into the software framebuffer, then uploads it
+static void RenderSoftwareFrame(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures) {
+    // Raycast the whole frame on the CPU, split across the worker pool
+    uint64_t raycastStart = GetTimestampNs();
+    PROFILE_BEGIN(PROFILE_ZONE_RAYCAST);
+    RenderWorldSoftware(&framebuffer, player, map, &shadeTables, &renderPool);
+    PROFILE_END(PROFILE_ZONE_RAYCAST);
+    
+    renderStats.raycastMs = (GetTimestampNs() - raycastStart) / 1e6f;
+    renderStats.threadCount = renderPool.threadCount;
+    for (int i = 0; i < renderPool.threadCount; i++) {
+        renderStats.threadMs[i] = renderPool.threadTimeNs[i] / 1e6f;
+        renderStats.threadBands[i] = renderPool.threadJobs[i];
+    }
+    
+    // Billboards on top, clipped per column by the wall depth the raycast left behind
+    uint64_t spritesStart = GetTimestampNs();
+    PROFILE_BEGIN(PROFILE_ZONE_SPRITES);
+    GatherVisibleSprites(&spriteView, sprites, map, player, framebuffer.width, framebuffer.height);
+    DrawSpritesSoftware(&framebuffer, &spriteView, sprites, textures->spriteImages, &renderPool);
+    PROFILE_END(PROFILE_ZONE_SPRITES);
+    
+    renderStats.spritesDrawn = spriteView.count;
+    renderStats.spritesMs = (GetTimestampNs() - spritesStart) / 1e6f;
+    
+    // One upload per frame; the caller stretches it to the window
+    UpdateTexture(framebufferTexture, framebuffer.pixels);
+    
+    // Everything above scales with the pixel count; steer the next frame's size by it
+    renderStats.renderWidth = framebuffer.width;
+    renderStats.renderHeight = framebuffer.height;
+    UpdateResolutionController(&resolution, (GetTimestampNs() - raycastStart) / 1e6f);
+}
+
+// CPU-based raycasting rendering into the software framebuffer
+void RenderWorldCPU(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures) {
     int screenWidth = GetScreenWidth();
     int screenHeight = GetScreenHeight();
     
-    // Draw ceiling (top half of screen)
-    DrawRectangle(0, 0, screenWidth, screenHeight/2, SKYBLUE);
+    // Keep the framebuffer and its texture at the controller's share of the window size
+    int renderWidth, renderHeight;
+    GetResolutionSize(&resolution, screenWidth, screenHeight, &renderWidth, &renderHeight);
+    if (!ResizeFramebuffer(&framebuffer, renderWidth, renderHeight)) return;
     
-    // Draw floor (bottom half of screen)
-    DrawRectangle(0, screenHeight/2, screenWidth, screenHeight/2, DARKGRAY);
-    
-    // Simple raycasting loop
-    for (int x = 0; x < screenWidth; x++) {
-        // Calculate ray position and direction
-        float cameraX = 2.0f * x / (float)screenWidth - 1.0f; // x-coordinate in camera space
-        
-        // Use exact player position as ray origin to match minimap
-        Vector2 rayPos = player.position;
-        
-        Vector2 rayDir = {
-            player.direction.x + player.plane.x * cameraX,
-            player.direction.y + player.plane.y * cameraX
-        };
-        
-        // Map position - use rayPos instead of player.position directly
-        int mapX = (int)(rayPos.x / TILE_SIZE);
-        int mapY = (int)(rayPos.y / TILE_SIZE);
+    if (framebufferTexture.id == 0 ||
+        framebufferTexture.width != framebuffer.width ||
+        framebufferTexture.height != framebuffer.height) {
+        if (framebufferTexture.id > 0) UnloadTexture(framebufferTexture);
         
-        // Length of ray from current position to next x or y-side
-        Vector2 deltaDist = {
-            fabsf(rayDir.x) < 0.0001f ? 1e30f : fabsf(1.0f / rayDir.x),
-            fabsf(rayDir.y) < 0.0001f ? 1e30f : fabsf(1.0f / rayDir.y)
+        Image image = {
+            .data = framebuffer.pixels,
+            .width = framebuffer.width,
+            .height = framebuffer.height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
         };
-        
-        // Direction to step in x or y direction (either +1 or -1)
-        int stepX, stepY;
-        
-        // Length of ray from one side to next in map
-        float sideDistX, sideDistY;
-        
-        // Calculate step and initial sideDist
-        if (rayDir.x < 0) {
-            stepX = -1;
-            sideDistX = ((rayPos.x / TILE_SIZE) - mapX) * deltaDist.x;
-        } else {
-            stepX = 1;
-            sideDistX = (mapX + 1.0f - (rayPos.x / TILE_SIZE)) * deltaDist.x;
-        }
-        
-        if (rayDir.y < 0) {
-            stepY = -1;
-            sideDistY = ((rayPos.y / TILE_SIZE) - mapY) * deltaDist.y;
-        } else {
-            stepY = 1;
-            sideDistY = (mapY + 1.0f - (rayPos.y / TILE_SIZE)) * deltaDist.y;
-        }
-        
-        // DDA algorithm
-        int hit = 0; // Was a wall hit?
-        int side = 0; // Was a NS or EW wall hit?
-        
-        while (hit == 0) {
-            // Jump to next map square, either in x-direction, or in y-direction
-            if (sideDistX < sideDistY) {
-                sideDistX += deltaDist.x;
-                mapX += stepX;
-                side = 0;
-            } else {
-                sideDistY += deltaDist.y;
-                mapY += stepY;
-                side = 1;
-            }
-            
-            // Check if ray has hit a wall
-            if (GetMapTile(map, mapX, mapY) > 0) {
-                hit = 1;
-            }
-        }
-        
-        // Calculate distance projected on camera direction
-        float perpWallDist;
-        if (side == 0) {
-            perpWallDist = (mapX - rayPos.x / TILE_SIZE + (1 - stepX) / 2) / rayDir.x;
-        } else {
-            perpWallDist = (mapY - rayPos.y / TILE_SIZE + (1 - stepY) / 2) / rayDir.y;
-        }
-        
-        perpWallDist *= TILE_SIZE; // Scale by tile size
-        
-        // Apply a distance reduction factor to make walls appear closer
-        perpWallDist *= 0.4f; // Further reduce distance perception for more dramatic closeness
-        
-        // Calculate height of line to draw on screen
-        // Increase the perceived wall height by multiplying by a factor (makes walls appear closer)
-        float distanceFactor = 2.0f; // Increased from 1.5 to 2.0 for taller walls (closer appearance)
-        int lineHeight = (int)(screenHeight / perpWallDist * distanceFactor);
-        
-        // Calculate lowest and highest pixel to fill in current stripe
-        int drawStart = -lineHeight / 2 + screenHeight / 2;
-        if (drawStart < 0) drawStart = 0;
-        
-        int drawEnd = lineHeight / 2 + screenHeight / 2;
-        if (drawEnd >= screenHeight) drawEnd = screenHeight - 1;
-        
-        // Choose wall color based on map value
-        Color color;
-        switch(GetMapTile(map, mapX, mapY)) {
-            case TILE_WALL:      color = WHITE; break;
-            case TILE_DOOR:      color = RED; break;
-            case TILE_SECRET_WALL: color = GREEN; break;
-            case TILE_OBSTACLE:  color = BLUE; break;
-            default:             color = PURPLE; break;
-        }
-        
-        // Make color darker for y-sides but keep them visible enough
-        if (side == 1) {
-            color.r = (color.r * 0.7f); // Less darkening (0.7 instead of 0.5)
-            color.g = (color.g * 0.7f);
-            color.b = (color.b * 0.7f);
-        }
-        
-        // Enhance wall colors to make them more visible
-        float colorEnhancement = 1.2f; // Slight enhancement to make walls pop more
-        color.r = Clamp(color.r * colorEnhancement, 0, 255);
-        color.g = Clamp(color.g * colorEnhancement, 0, 255);
-        color.b = Clamp(color.b * colorEnhancement, 0, 255);
-        
-        // Draw the pixels of the stripe as a vertical line
-        DrawLine(x, drawStart, x, drawEnd, color);
+        framebufferTexture = LoadTextureFromImage(image);
+        SetTextureFilter(framebufferTexture, TEXTURE_FILTER_BILINEAR);
     }
     
+    // Rebuilding the shade tables changes the picture even if nothing else did
+    FlatTextures flats = { &textures->floorImage, &textures->ceilingImage };
+    bool tablesCurrent = AreShadeTablesCurrent(&shadeTables, map->wallImages, &flats);
+    if (!tablesCurrent) {
+        UnloadShadeTables(&shadeTables);
+        if (!BuildShadeTables(&shadeTables, map->wallImages, &flats)) return;
+    }
+    
+    // An unchanged frame reuses the framebuffer texture as it is
+    renderStats.frameReused = !renderStats.frameChanged && tablesCurrent;
+    if (!renderStats.frameReused) RenderSoftwareFrame(player, map, sprites, textures);
+    
+    DrawTexturePro(framebufferTexture, (Rectangle){ 0, 0, (float)framebuffer.width, (float)framebuffer.height },
+                   (Rectangle){ 0, 0, (float)screenWidth, (float)screenHeight }, (Vector2){ 0, 0 }, 0.0f, WHITE);
+    
     // Draw minimap
     RenderMinimap(player, map);
 }
 
-void RenderMinimap(Player player, Map map) {
+void RenderMinimap(const Player* player, const Map* map) {
+    PROFILE_BEGIN(PROFILE_ZONE_MINIMAP);
+    
     // Define minimap size and position
     int mapSize = 150;
     int mapPosX = GetScreenWidth() - mapSize - 10;
     int mapPosY = 10;
-    int cellSize = mapSize / MAP_WIDTH;
+    
+    // Tiles across the minimap at the current zoom; level 0 shows the whole map
+    int mapExtent = (map->width > map->height) ? map->width : map->height;
+    int span = MINIMAP_ZOOM_SPANS[minimapZoom];
+    if (span <= 0 || span > mapExtent) span = mapExtent;
+    
+    // Whole pixels per tile where possible so cells stay evenly sized
+    float scale = (float)mapSize / span;
+    if (scale >= 1.0f) scale = floorf(scale);
+    float viewTiles = mapSize / scale;
+    
+    // Scroll the window with the player, clamped to the map edges
+    float playerTileX = player->position.x / TILE_SIZE;
+    float playerTileY = player->position.y / TILE_SIZE;
+    float viewX = (map->width > viewTiles) ? Clamp(playerTileX - viewTiles / 2.0f, 0.0f, map->width - viewTiles) : 0.0f;
+    float viewY = (map->height > viewTiles) ? Clamp(playerTileY - viewTiles / 2.0f, 0.0f, map->height - viewTiles) : 0.0f;
+    float viewW = (map->width > viewTiles) ? viewTiles : (float)map->width;
+    float viewH = (map->height > viewTiles) ? viewTiles : (float)map->height;
     
     // Draw minimap background
     DrawRectangle(mapPosX, mapPosY, mapSize, mapSize, ColorAlpha(BLACK, 0.7f));
     
-    // Draw map cells
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            int cellType = GetMapTile(map, x, y);
-            Color cellColor;
-            
-            switch (cellType) {
-                case TILE_EMPTY:
-                    cellColor = BLACK;
-                    break;
-                case TILE_WALL:
-                    cellColor = WHITE;
-                    break;
-                case TILE_DOOR:
-                    cellColor = RED;
-                    break;
-                case TILE_SECRET_WALL:
-                    cellColor = GREEN;
-                    break;
-                case TILE_OBSTACLE:
-                    cellColor = BLUE;
-                    break;
-                default:
-                    cellColor = PURPLE;
-                    break;
-            }
-            
-            // Draw map cell
-            DrawRectangle(mapPosX + x * cellSize, mapPosY + y * cellSize, cellSize, cellSize, cellColor);
-        }
+    // The tile layer is the cached map texture (one texel per tile), so this is
+    // a single draw whatever the map size. It covers the occupancy window:
+    // the whole map, or only the chunks around the player when streamed, so
+    // just the part of the view it overlaps is drawn.
+    float imageX0 = fmaxf(viewX, (float)map->solidX);
+    float imageY0 = fmaxf(viewY, (float)map->solidY);
+    float imageX1 = fminf(viewX + viewW, (float)(map->solidX + map->mapTexture.width));
+    float imageY1 = fminf(viewY + viewH, (float)(map->solidY + map->mapTexture.height));
+    if (map->isMapTextureInitialized && imageX0 < imageX1 && imageY0 < imageY1) {
+        DrawTexturePro(
+            map->mapTexture,
+            (Rectangle){ imageX0 - map->solidX, imageY0 - map->solidY, imageX1 - imageX0, imageY1 - imageY0 },
+            (Rectangle){ mapPosX + (imageX0 - viewX) * scale, mapPosY + (imageY0 - viewY) * scale,
+                         (imageX1 - imageX0) * scale, (imageY1 - imageY0) * scale },
+            (Vector2){ 0, 0 },
+            0.0f,
+            WHITE
+        );
     }
     
     // Draw player position on minimap
-    int playerMapX = mapPosX + (int)((player.position.x / TILE_SIZE) * cellSize);
-    int playerMapY = mapPosY + (int)((player.position.y / TILE_SIZE) * cellSize);
+    int playerMapX = mapPosX + (int)((playerTileX - viewX) * scale);
+    int playerMapY = mapPosY + (int)((playerTileY - viewY) * scale);
+    float markerSize = (scale > 4.0f) ? scale : 4.0f;
     
     // Draw player as a circle
-    DrawCircle(playerMapX, playerMapY, cellSize / 2, YELLOW);
+    DrawCircle(playerMapX, playerMapY, markerSize / 2, YELLOW);
     
     // Draw player direction
     DrawLine(
         playerMapX, 
         playerMapY, 
-        playerMapX + (int)(player.direction.x * cellSize * 2),
-        playerMapY + (int)(player.direction.y * cellSize * 2),
+        playerMapX + (int)(player->direction.x * markerSize * 2),
+        playerMapY + (int)(player->direction.y * markerSize * 2),
         RED
     );
     
     // Draw minimap border
     DrawRectangleLines(mapPosX, mapPosY, mapSize, mapSize, RAYWHITE);
+    
+    PROFILE_END(PROFILE_ZONE_MINIMAP);
+}
+
+void SetMinimapZoom(int level) {
+    if (level < 0) level = 0;
+    if (level >= MINIMAP_ZOOM_LEVELS) level = MINIMAP_ZOOM_LEVELS - 1;
+    minimapZoom = level;
+}
+
+int GetMinimapZoom(void) {
+    return minimapZoom;
+}
+
+// Billboards for the gathered sprites, back to front so alpha blends over
+// whatever is behind them; the depth buffer handles the walls
+static void DrawSpritesGPU(Camera3D camera, const SpriteList* sprites, const GameTextures* textures) {
+    for (int i = 0; i < spriteView.count; i++) {
+        const Sprite* sprite = &sprites->sprites[spriteView.items[i].id];
+        Texture2D texture = textures->sprites[sprite->texture % SPRITE_TEXTURE_COUNT];
+        
+        float height = WALL_MESH_HEIGHT * sprite->scale;
+        float width = height * texture.width / texture.height;
+        Vector3 center = { sprite->position.x, height * 0.5f, sprite->position.y };
+        
+        DrawBillboardRec(camera, texture, (Rectangle){ 0, 0, (float)texture.width, (float)texture.height },
+                         center, (Vector2){ width, height }, WHITE);
+    }
+}
+
+// Moving doors on top of the static walls, all in one mesh with the walls'
+// material so they join the walls' batch
+static void AddActiveDoorDraws(const Map* map) {
+    if (map->activeDoorCount == 0 || gpuDoorMesh.mesh.vaoId == 0) return;
+    
+    BuildDoorMesh(&gpuDoorMesh, map, &gpuWallMesh, gpuChunkVisible);
+    if (gpuDoorMesh.faceCount == 0) return;
+    
+    Material material = wallModel.materials[0];
+    material.maps[MATERIAL_MAP_DIFFUSE].color = WHITE;
+    material.maps[MATERIAL_MAP_DIFFUSE].texture = map->wallAtlas;
+    AddDrawListMesh(&gpuDrawList, &gpuDoorMesh.mesh, material, MatrixIdentity());
 }
 
 // GPU-based rendering with shaders
-void RenderWorldGPU(Player player, Map map) {
+void RenderWorldGPU(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures) {
     int screenWidth = GetScreenWidth();
     int screenHeight = GetScreenHeight();
     
-    // Update shader parameters before rendering
+    // This frame's shader parameters go into the draw list with its draws
+    ClearDrawList(&gpuDrawList);
     UpdateShaders(player);
     
+    int playerMapX = (int)(player->position.x / TILE_SIZE);
+    int playerMapY = (int)(player->position.y / TILE_SIZE);
+    
+    // Build the wall geometry around the player once per map, afterwards only
+    // chunks with changed tiles or that came into range are rebuilt
+    if (gpuWallMeshMap != map || gpuWallMesh.mapWidth != map->width || gpuWallMesh.mapHeight != map->height) {
+        UnloadWallMesh(&gpuWallMesh);
+        gpuWallMeshMap = InitWallMesh(&gpuWallMesh, map, WALL_MESH_DEFAULT_RADIUS, true) ? map : NULL;
+        
+        free(gpuChunkVisible);
+        gpuChunkVisible = malloc((size_t)gpuWallMesh.chunksX * gpuWallMesh.chunksY);
+    }
+    SetWallMeshFocus(&gpuWallMesh, playerMapX, playerMapY);
+    UpdateWallMesh(&gpuWallMesh, map);
+    
+    // Only chunks near the player that the PVS says can be seen from the player's tile
+    
+    if (gpuChunkVisible != NULL) {
+        GetVisibleWallChunks(&gpuWallMesh, map, playerMapX, playerMapY, GPU_WALL_CHUNK_RADIUS, gpuChunkVisible);
+    }
+    
     // Set up 3D camera for the scene
     Camera3D camera = { 0 };
-    camera.position = (Vector3){ player.position.x, 0.5f, player.position.y }; // Y is up in 3D space
+    camera.position = (Vector3){ player->position.x, 0.5f, player->position.y }; // Y is up in 3D space
     
     // Calculate camera target based on player direction
     camera.target = (Vector3){ 
-        camera.position.x + player.direction.x,
+        camera.position.x + player->direction.x,
         camera.position.y,
-        camera.position.z + player.direction.y
+        camera.position.z + player->direction.y
     };
     
     camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
@@ -370,86 +478,40 @@ void RenderWorldGPU(Player player, Map map) {
         // Begin 3D mode with our camera
         BeginMode3D(camera);
             
-            // 1. Render floor
-            // Set floor shader parameters
-            if (isCeilingLoc != -1) {
-                SetShaderValue(floorCeilingShader, isCeilingLoc, (int[1]){ 0 }, SHADER_UNIFORM_INT);
-            }
-            
-            if (cameraPositionLoc != -1) {
-                SetShaderValue(floorCeilingShader, cameraPositionLoc, 
-                              (float[3]){ camera.position.x, camera.position.y, camera.position.z }, SHADER_UNIFORM_VEC3);
-            }
-            
-            // Position the floor model below the camera
+            // 1. Floor, positioned below the camera
             Matrix floorTransform = MatrixTranslate(camera.position.x, 0.0f, camera.position.z);
-            DrawMesh(floorMesh, floorModel.materials[0], floorTransform);
-            
-            // 2. Render ceiling
-            // Set ceiling shader parameters
-            if (isCeilingLoc != -1) {
-                SetShaderValue(floorCeilingShader, isCeilingLoc, (int[1]){ 1 }, SHADER_UNIFORM_INT);
-            }
+            DrawItem* floorDraw = AddDrawListMesh(&gpuDrawList, &floorMesh, floorModel.materials[0], floorTransform);
+            if (floorDraw != NULL) SetDrawItemUniform(floorDraw, isCeilingLoc, (int[1]){ 0 }, SHADER_UNIFORM_INT);
             
-            // Position the ceiling model above the camera
+            // 2. Ceiling, positioned above the camera
             Matrix ceilingTransform = MatrixTranslate(camera.position.x, 1.0f, camera.position.z);
-            DrawMesh(ceilingMesh, ceilingModel.materials[0], ceilingTransform);
-        
-            // 3. Render walls
-            // Iterate through visible map cells and render walls
-            int playerMapX = (int)(player.position.x / TILE_SIZE);
-            int playerMapY = (int)(player.position.y / TILE_SIZE);
+            DrawItem* ceilingDraw = AddDrawListMesh(&gpuDrawList, &ceilingMesh, ceilingModel.materials[0], ceilingTransform);
+            if (ceilingDraw != NULL) SetDrawItemUniform(ceilingDraw, isCeilingLoc, (int[1]){ 1 }, SHADER_UNIFORM_INT);
             
-            // Render walls in a radius around the player
-            int renderRadius = 10; // Adjust based on performance needs
+            // 3. Walls: exposed faces only, merged per chunk and textured from the wall atlas
+            AddWallMeshDraws(&gpuDrawList, &gpuWallMesh, wallModel.materials[0], map->wallAtlas, gpuChunkVisible);
+            AddActiveDoorDraws(map);
             
-            for (int y = playerMapY - renderRadius; y <= playerMapY + renderRadius; y++) {
-                for (int x = playerMapX - renderRadius; x <= playerMapX + renderRadius; x++) {
-                    // Skip if out of bounds
-                    if (x < 0 || y < 0 || x >= MAP_WIDTH || y >= MAP_HEIGHT) continue;
-                    
-                    int tileType = GetMapTile(map, x, y);
-                    
-                    // Skip empty spaces
-                    if (tileType == TILE_EMPTY) continue;
-                    
-                    // Set wall color based on type
-                    Color wallColor = WHITE;
-                    switch(tileType) {
-                        case TILE_WALL:       wallColor = WHITE; break;
-                        case TILE_DOOR:       wallColor = RED; break;
-                        case TILE_SECRET_WALL: wallColor = GREEN; break;
-                        case TILE_OBSTACLE:   wallColor = BLUE; break;
-                        default:              wallColor = PURPLE; break;
-                    }
-                    
-                    // Use different wall textures based on the wall type
-                    int texIndex = (tileType == TILE_WALL) ? (x + y) % 8 : tileType % 8;
-                    
-                    // Create wall transformation matrix
-                    Matrix wallTransform = MatrixIdentity();
-                    
-                    // Position the wall at the correct grid position
-                    wallTransform = MatrixMultiply(
-                        wallTransform, 
-                        MatrixTranslate(x * TILE_SIZE + TILE_SIZE/2, 0.5f, y * TILE_SIZE + TILE_SIZE/2)
-                    );
-                    
-                    // Scale the wall to tile size
-                    wallTransform = MatrixMultiply(
-                        wallTransform,
-                        MatrixScale(TILE_SIZE/2, 0.5f, TILE_SIZE/2)
-                    );
-                    
-                    // Render the wall with texture and color
-                    wallModel.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = map.wallTextures[texIndex];
-                    wallModel.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = wallColor;
-                    DrawMesh(wallMesh, wallModel.materials[0], wallTransform);
-                }
-            }
+            // Sorted by state, so the walls and doors are one batch
+            DrawBackend backend = GetRaylibDrawBackend();
+            SubmitDrawList(&gpuDrawList, &backend);
+            renderStats.draws = gpuDrawList.stats;
             
-        EndMode3D();
+            // 4. Render sprites, culled with a frustum as wide as the camera's
+            PROFILE_BEGIN(PROFILE_ZONE_SPRITES);
+            uint64_t spritesStart = GetTimestampNs();
+            Player cullPlayer = *player;
+            float planeScale = tanf(camera.fovy * 0.5f * DEG2RAD) * screenWidth / screenHeight /
+                               sqrtf(player->plane.x * player->plane.x + player->plane.y * player->plane.y);
+            cullPlayer.plane = (Vector2){ player->plane.x * planeScale, player->plane.y * planeScale };
+            GatherVisibleSprites(&spriteView, sprites, map, &cullPlayer, screenWidth, screenHeight);
+            DrawSpritesGPU(camera, sprites, textures);
+            renderStats.spritesDrawn = spriteView.count;
+            renderStats.spritesMs = (GetTimestampNs() - spritesStart) / 1e6f;
+            PROFILE_END(PROFILE_ZONE_SPRITES);
         
+        EndMode3D();
+    
     EndTextureMode();
     
     // Draw the final render texture to screen
@@ -464,45 +526,29 @@ void RenderWorldGPU(Player player, Map map) {
     RenderMinimap(player, map);
 }
 
-void UpdateShaders(Player player) {
+// Queues this frame's shader parameters in the draw list; its shadow copy
+// means only the ones that changed since the last frame reach GL
+void UpdateShaders(const Player* player) {
     if (!shadersLoaded) return;
     
-    // Wall shader parameters
-    if (wallHeightLoc != -1) {
-        float wallHeight = 1.0f;
-        SetShaderValue(wallShader, wallHeightLoc, &wallHeight, SHADER_UNIFORM_FLOAT);
-    }
-    
-    if (fogDensityLoc != -1) {
-        float fogDensity = 0.05f;
-        SetShaderValue(wallShader, fogDensityLoc, &fogDensity, SHADER_UNIFORM_FLOAT);
-    }
-    
-    if (darkFactorLoc != -1) {
-        float darknessFactor = 0.3f;
-        SetShaderValue(wallShader, darkFactorLoc, &darknessFactor, SHADER_UNIFORM_FLOAT);
-    }
+    // Wall shader parameters, the shading in shading.h that the software colormaps use too
+    Vector3 skyFog = SHADE_SKY_FOG;
+    Vector3 floorFog = SHADE_FLOOR_FOG;
+    SetDrawListUniform(&gpuDrawList, wallShader, wallHeightLoc, (float[1]){ 1.0f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, wallShader, fogDensityLoc, (float[1]){ SHADE_FOG_DENSITY }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, wallShader, darkFactorLoc, (float[1]){ SHADE_WALL_DARKNESS }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, wallShader, minLightLoc, (float[1]){ SHADE_MIN_LIGHT }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, wallShader, fogColorLoc, &skyFog, SHADER_UNIFORM_VEC3);
     
     // Floor/ceiling shader parameters
-    if (cameraPositionLoc != -1) {
-        float cameraPos[3] = { player.position.x, 0.5f, player.position.y };
-        SetShaderValue(floorCeilingShader, cameraPositionLoc, cameraPos, SHADER_UNIFORM_VEC3);
-    }
-    
-    if (texScaleLoc != -1) {
-        float textureScale = 0.1f;
-        SetShaderValue(floorCeilingShader, texScaleLoc, &textureScale, SHADER_UNIFORM_FLOAT);
-    }
-    
-    if (fcFogDensityLoc != -1) {
-        float fogDensity = 0.05f;
-        SetShaderValue(floorCeilingShader, fcFogDensityLoc, &fogDensity, SHADER_UNIFORM_FLOAT);
-    }
-    
-    if (fcDarknessLoc != -1) {
-        float darknessFactor = 0.1f;
-        SetShaderValue(floorCeilingShader, fcDarknessLoc, &darknessFactor, SHADER_UNIFORM_FLOAT);
-    }
+    float cameraPos[3] = { player->position.x, 0.5f, player->position.y };
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, cameraPositionLoc, cameraPos, SHADER_UNIFORM_VEC3);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, texScaleLoc, (float[1]){ 0.1f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, fcFogDensityLoc, (float[1]){ SHADE_FOG_DENSITY }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, fcDarknessLoc, (float[1]){ SHADE_FLAT_DARKNESS }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, fcMinLightLoc, (float[1]){ SHADE_MIN_LIGHT }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, skyFogColorLoc, &skyFog, SHADER_UNIFORM_VEC3);
+    SetDrawListUniform(&gpuDrawList, floorCeilingShader, floorFogColorLoc, &floorFog, SHADER_UNIFORM_VEC3);
 }
 
 void UnloadRenderer(void) {
@@ -519,10 +565,31 @@ void UnloadRenderer(void) {
         UnloadModel(ceilingModel);
     }
     
+    UnloadWallMesh(&gpuWallMesh);
+    UnloadDoorMesh(&gpuDoorMesh);
+    UnloadDrawList(&gpuDrawList);
+    gpuWallMeshMap = NULL;
+    UnloadShadeTables(&shadeTables);
+    free(gpuChunkVisible);
+    gpuChunkVisible = NULL;
+    
     // Unload render texture
     if (screenTexture.id > 0) {
         UnloadRenderTexture(screenTexture);
     }
+    
+    // Unload software framebuffer
+    if (framebufferTexture.id > 0) {
+        UnloadTexture(framebufferTexture);
+    }
+    UnloadFramebuffer(&framebuffer);
+    UnloadSpriteView(&spriteView);
+    
+    // Stop the worker threads
+    if (renderPoolInitialized) {
+        UnloadWorkerPool(&renderPool);
+        renderPoolInitialized = false;
+    }
 }
 
 void ToggleRenderMode(void) {
@@ -538,4 +605,36 @@ void ToggleRenderMode(void) {
 
 const char* GetRenderModeName(void) {
     return (currentRenderMode == RENDER_MODE_CPU) ? "CPU" : "GPU";
-}
\ No newline at end of file
+}
+void SetRenderThreadCount(int threadCount) {
+    renderThreadCount = threadCount;
+    
+    // Restart the pool if the renderer is already running
+    if (renderPoolInitialized) {
+        UnloadWorkerPool(&renderPool);
+        InitWorkerPool(&renderPool, renderThreadCount);
+        TraceLog(LOG_INFO, "CPU raycaster using %d threads", renderPool.threadCount);
+    }
+}
+
+const RenderStats* GetRenderStats(void) {
+    return &renderStats;
+}
+
+WorkerPool* GetRenderWorkerPool(void) {
+    return renderPoolInitialized ? &renderPool : NULL;
+}
+
+void SetRenderBudget(float budgetMs) {
+    renderBudgetMs = budgetMs;
+    resolution.budgetMs = budgetMs;
+}
+
+void PinRenderScale(float scale) {
+    renderPinnedScale = scale;
+    PinResolutionScale(&resolution, scale);
+}
+
+const ResolutionController* GetResolutionController(void) {
+    return &resolution;
+}
@@ -3,26 +3,57 @@
 
 #include "../World/player.h"
 #include "../World/map.h"
+#include "../World/sprites.h"
 #include "../Core/resources.h" // Add for texture access
+#include "../Core/worker_pool.h"
+#include "resolution.h"
+#include "draw_list.h"
 
 // Shader configuration constants
 #define MAX_LIGHTS 4
 
+#define MINIMAP_ZOOM_LEVELS 4 // Whole map, then progressively closer windows around the player
+
 // Render modes
 typedef enum {
     RENDER_MODE_CPU,  // CPU-based raycasting
     RENDER_MODE_GPU   // GPU-based shader rendering
 } RenderMode;
 
+// CPU renderer timing from the last frame
+typedef struct RenderStats {
+    int threadCount;                          // Threads used by the software raycaster
+    float raycastMs;                          // Wall time of the whole raycast pass
+    float threadMs[MAX_WORKER_THREADS];       // Time each thread spent raycasting
+    int threadBands[MAX_WORKER_THREADS];      // Column bands each thread rendered
+    int spritesDrawn;                         // Sprites that survived culling this frame
+    float spritesMs;                          // Gathering, sorting and drawing them
+    int renderWidth;                          // Size of the software frame before it is stretched to the window
+    int renderHeight;
+    bool frameChanged;                        // Camera, map, sprites or render size differ from the last frame
+    bool frameReused;                         // Software path: nothing changed, the last frame was shown again
+    DrawStats draws;                          // GPU path: state changes and draws of the world's mesh submission
+} RenderStats;
+
 // Renderer state
 extern RenderMode currentRenderMode;
 
 void InitRenderer(void);
-void RenderWorld(Player player, Map map);
-void RenderMinimap(Player player, Map map);
-void UpdateShaders(Player player); // For updating shader parameters
+void RenderWorld(const Player* player, const Map* map, const SpriteList* sprites, const GameTextures* textures);
+void RenderMinimap(const Player* player, const Map* map);
+void SetMinimapZoom(int level); // 0 = whole map, clamped to MINIMAP_ZOOM_LEVELS - 1
+int GetMinimapZoom(void);
+void UpdateShaders(const Player* player); // For updating shader parameters
 void UnloadRenderer(void);
 void ToggleRenderMode(void); // Switch between CPU and GPU rendering
 const char* GetRenderModeName(void); // Get current render mode name for UI
+void SetRenderThreadCount(int threadCount); // CPU raycaster threads, 0 = one per core
+const RenderStats* GetRenderStats(void);
+WorkerPool* GetRenderWorkerPool(void); // Raycaster threads, idle outside RenderWorld; NULL before InitRenderer
+
+// Dynamic resolution of the CPU renderer (see resolution.h); the GPU path always renders at window size
+void SetRenderBudget(float budgetMs);   // Raycast, sprites and upload time to hold, 0 = always full resolution
+void PinRenderScale(float scale);       // Fixed fraction of the window size, 0 = automatic
+const ResolutionController* GetResolutionController(void);
 
 #endif // RENDERER_H
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "resolution.h"
+#include "raylib.h"
+#include <math.h>
+#include <stdio.h>
+
+static float ClampScale(float scale) {
+    if (scale < RESOLUTION_SCALE_MIN) return RESOLUTION_SCALE_MIN;
+    if (scale > RESOLUTION_SCALE_MAX) return RESOLUTION_SCALE_MAX;
+    return scale;
+}
+
+// Largest step at or below scale
+static float FloorScaleStep(float scale) {
+    return ClampScale(floorf(scale / RESOLUTION_SCALE_STEP + 0.001f) * RESOLUTION_SCALE_STEP);
+}
+
+static void SetScale(ResolutionController* controller, float scale) {
+    if (fabsf(scale - controller->scale) < RESOLUTION_SCALE_STEP * 0.5f) return;
+    
+    // Carry the smoothed cost over to the new pixel count so the change does
+    // not read as a sudden surplus or deficit
+    if (controller->scale > 0.0f) controller->smoothedMs *= (scale * scale) / (controller->scale * controller->scale);
+    controller->scale = scale;
+    controller->overFrames = 0;
+    controller->underFrames = 0;
+}
+
+void InitResolutionController(ResolutionController* controller, float budgetMs) {
+    *controller = (ResolutionController){ 0 };
+    controller->budgetMs = budgetMs;
+    controller->scale = RESOLUTION_SCALE_MAX;
+}
+
+void UpdateResolutionController(ResolutionController* controller, float renderMs) {
+    int slot = controller->historyCount % RESOLUTION_HISTORY;
+    controller->scaleHistory[slot] = controller->scale;
+    controller->costHistory[slot] = renderMs;
+    controller->historyCount++;
+    
+    if (controller->smoothedMs > 0.0f) {
+        controller->smoothedMs += (renderMs - controller->smoothedMs) * RESOLUTION_SMOOTHING;
+    } else {
+        controller->smoothedMs = renderMs;
+    }
+    
+    if (controller->pinnedScale > 0.0f) {
+        SetScale(controller, controller->pinnedScale);
+        return;
+    }
+    if (controller->budgetMs <= 0.0f || controller->smoothedMs <= 0.0f) {
+        SetScale(controller, RESOLUTION_SCALE_MAX);
+        return;
+    }
+    
+    if (controller->smoothedMs > controller->budgetMs) {
+        controller->overFrames++;
+        controller->underFrames = 0;
+    } else if (controller->smoothedMs < controller->budgetMs * RESOLUTION_HEADROOM) {
+        controller->underFrames++;
+        controller->overFrames = 0;
+    } else {
+        controller->overFrames = 0;
+        controller->underFrames = 0;
+    }
+    
+    // The scale whose cost would just meet the budget
+    float fit = controller->scale * sqrtf(controller->budgetMs / controller->smoothedMs);
+    
+    if (controller->overFrames >= RESOLUTION_DOWN_FRAMES) {
+        SetScale(controller, FloorScaleStep(fit));
+    } else if (controller->underFrames >= RESOLUTION_UP_FRAMES) {
+        // One step up, and only if it is predicted to stay within budget
+        float next = ClampScale(controller->scale + RESOLUTION_SCALE_STEP);
+        if (next <= fit) SetScale(controller, next);
+        controller->underFrames = 0;
+    }
+}
+
+void PinResolutionScale(ResolutionController* controller, float scale) {
+    controller->pinnedScale = (scale > 0.0f) ? ClampScale(scale) : 0.0f;
+    controller->overFrames = 0;
+    controller->underFrames = 0;
+    if (controller->pinnedScale > 0.0f) SetScale(controller, controller->pinnedScale);
+}
+
+void GetResolutionSize(const ResolutionController* controller, int windowWidth, int windowHeight, int* width, int* height) {
+    *width = (int)(windowWidth * controller->scale + 0.5f);
+    *height = (int)(windowHeight * controller->scale + 0.5f);
+    if (*width < 1) *width = 1;
+    if (*height < 1) *height = 1;
+}
+
+void DrawResolutionOverlay(const ResolutionController* controller, int x, int y, int width) {
+    int graphHeight = 60;
+    DrawRectangle(x - 5, y - 5, width, graphHeight + 36, ColorAlpha(BLACK, 0.6f));
+    
+    char text[96];
+    const char* mode = (controller->pinnedScale > 0.0f) ? "pinned" : (controller->budgetMs > 0.0f) ? "auto" : "off";
+    sprintf(text, "Scale %3.0f%% %-6s %5.2f/%.1f ms", controller->scale * 100.0f, mode, controller->smoothedMs, controller->budgetMs);
+    DrawText(text, x, y, 16, YELLOW);
+    
+    // Scale in green against the full graph height, cost in orange with the
+    // budget halfway up
+    int top = y + 22;
+    int graphWidth = width - 10;
+    float budget = (controller->budgetMs > 0.0f) ? controller->budgetMs : 16.0f;
+    DrawLine(x, top + graphHeight / 2, x + graphWidth, top + graphHeight / 2, DARKGRAY);
+    
+    int frames = (controller->historyCount < RESOLUTION_HISTORY) ? controller->historyCount : RESOLUTION_HISTORY;
+    int first = controller->historyCount - frames;
+    for (int f = 1; f < frames; f++) {
+        int previous = (first + f - 1) % RESOLUTION_HISTORY;
+        int current = (first + f) % RESOLUTION_HISTORY;
+        float x0 = x + (f - 1) * (float)graphWidth / (RESOLUTION_HISTORY - 1);
+        float x1 = x + f * (float)graphWidth / (RESOLUTION_HISTORY - 1);
+        
+        float cost0 = fminf(controller->costHistory[previous] / (2.0f * budget), 1.0f);
+        float cost1 = fminf(controller->costHistory[current] / (2.0f * budget), 1.0f);
+        DrawLineV((Vector2){ x0, top + graphHeight * (1.0f - cost0) }, (Vector2){ x1, top + graphHeight * (1.0f - cost1) }, ORANGE);
+        
+        float scale0 = controller->scaleHistory[previous];
+        float scale1 = controller->scaleHistory[current];
+        DrawLineV((Vector2){ x0, top + graphHeight * (1.0f - scale0) }, (Vector2){ x1, top + graphHeight * (1.0f - scale1) }, GREEN);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <stdbool.h>
+
+// Dynamic resolution for the software renderer. The frame is rendered at a
+// fraction of the window size and stretched to fit; the controller picks the
+// fraction each frame so the render cost stays within a time budget.
+//
+// Render cost grows with the pixel count, i.e. with the square of the scale,
+// which gives the controller the scale that would just meet the budget. It
+// drops to that scale after a few frames over budget, but only climbs one
+// step at a time after many frames comfortably under it; in between is a dead
+// band where nothing changes, so the scale does not oscillate around the
+// budget. Scales are quantized to steps so the framebuffer is only
+// reallocated when the scale really moves.
+
+#define RESOLUTION_SCALE_MIN 0.25f
+#define RESOLUTION_SCALE_MAX 1.0f
+#define RESOLUTION_SCALE_STEP 0.05f
+#define RESOLUTION_DEFAULT_BUDGET_MS 12.0f // Render cost to hold, leaving the rest of a 60 Hz frame for everything else
+#define RESOLUTION_HEADROOM 0.7f           // Under this fraction of the budget counts as room to grow
+#define RESOLUTION_DOWN_FRAMES 3           // Frames over budget before scaling down
+#define RESOLUTION_UP_FRAMES 30            // Frames with headroom before scaling up
+#define RESOLUTION_SMOOTHING 0.2f          // Weight of the newest frame in the smoothed cost
+#define RESOLUTION_HISTORY 120             // Frames of scale and cost kept for the overlay
+
+typedef struct ResolutionController {
+    float budgetMs;                 // Render cost to hold; 0 always renders at full resolution
+    float scale;                    // Fraction of the window's width and height rendered
+    float pinnedScale;              // Held instead of the controlled scale when > 0
+    float smoothedMs;               // Moving average of the render cost at the current scale
+    int overFrames;                 // Consecutive frames over budget
+    int underFrames;                // Consecutive frames with headroom
+    float scaleHistory[RESOLUTION_HISTORY]; // Ring of the scale used by each frame
+    float costHistory[RESOLUTION_HISTORY];  // And what rendering it cost, in ms
+    int historyCount;               // Frames recorded so far, the newest at (historyCount - 1) % RESOLUTION_HISTORY
+} ResolutionController;
+
+void InitResolutionController(ResolutionController* controller, float budgetMs);
+
+// Records what rendering the last frame at controller->scale cost and picks
+// the scale for the next one
+void UpdateResolutionController(ResolutionController* controller, float renderMs);
+
+// Holds the scale at scale (clamped to the supported range); 0 returns to automatic
+void PinResolutionScale(ResolutionController* controller, float scale);
+
+// Internal size for a window, never smaller than one pixel
+void GetResolutionSize(const ResolutionController* controller, int windowWidth, int windowHeight, int* width, int* height);
+
+// Current scale, cost against budget, and a graph of the recent history
+void DrawResolutionOverlay(const ResolutionController* controller, int x, int y, int width);
+
+#endif // RESOLUTION_H
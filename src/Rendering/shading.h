@@ -0,0 +1,17 @@
+#ifndef SHADING_H
+#define SHADING_H
+
+#include "raylib.h"
+
+// Lighting shared by both renderers: renderer.c hands these to wall.frag and
+// floor_ceiling.frag as uniforms and colormap.c bakes them into the software
+// colormaps, so the two paths shade alike.
+
+#define SHADE_WALL_DARKNESS 0.3f   // Light lost per tile of distance on walls
+#define SHADE_FLAT_DARKNESS 0.1f   // The same for floor and ceiling
+#define SHADE_FOG_DENSITY 0.05f
+#define SHADE_MIN_LIGHT 0.2f       // Darkening never goes below this
+#define SHADE_SKY_FOG (Vector3){ 0.4f, 0.6f, 0.8f }    // Walls and ceiling
+#define SHADE_FLOOR_FOG (Vector3){ 0.2f, 0.2f, 0.3f }
+
+#endif // SHADING_H
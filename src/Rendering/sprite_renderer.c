@@ -0,0 +1,265 @@
+#include "sprite_renderer.h"
+#include "raycaster.h"
+#include "../World/pvs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPRITE_BAND_WIDTH 64        // Columns per worker job in the draw pass
+#define SPRITE_TILE_MARGIN 0.75f    // Half a tile diagonal plus slack for sprites overhanging their tile
+
+// On-screen height of a sprite at a given depth, using the wall projection so
+// a scale 1 sprite is exactly as tall as a wall at the same distance
+static float GetSpriteLineHeight(float depth, int screenHeight) {
+    float perpWallDist = depth * TILE_SIZE * WALL_DISTANCE_SCALE;
+    if (perpWallDist < 0.0001f) perpWallDist = 0.0001f;
+    return screenHeight / perpWallDist * WALL_HEIGHT_FACTOR;
+}
+
+static bool ReserveSpriteView(SpriteView* view, int count) {
+    if (count <= view->capacity) return true;
+    
+    int capacity = (view->capacity > 0) ? view->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    
+    VisibleSprite* items = (VisibleSprite*)realloc(view->items, (size_t)capacity * sizeof(VisibleSprite));
+    if (items == NULL) return false;
+    view->items = items;
+    
+    VisibleSprite* scratch = (VisibleSprite*)realloc(view->scratch, (size_t)capacity * sizeof(VisibleSprite));
+    if (scratch == NULL) return false;
+    view->scratch = scratch;
+    
+    view->capacity = capacity;
+    return true;
+}
+
+// LSD radix sort, one byte per pass, on a key that grows with distance
+// reversed, so the result runs from the farthest sprite to the nearest
+static void SortSpritesBackToFront(SpriteView* view) {
+    int count = view->count;
+    if (count < 2) return;
+    
+    const unsigned int maxKey = (1u << SPRITE_DEPTH_BITS) - 1;
+    const float keyScale = maxKey / SPRITE_VIEW_DISTANCE;
+    
+    VisibleSprite* source = view->items;
+    VisibleSprite* target = view->scratch;
+    
+    for (int shift = 0; shift < SPRITE_DEPTH_BITS; shift += 8) {
+        int offsets[256] = { 0 };
+        
+        for (int i = 0; i < count; i++) {
+            unsigned int key = maxKey - (unsigned int)fminf(source[i].depth * keyScale, (float)maxKey);
+            offsets[(key >> shift) & 0xff]++;
+        }
+        
+        int sum = 0;
+        for (int b = 0; b < 256; b++) {
+            int bucketCount = offsets[b];
+            offsets[b] = sum;
+            sum += bucketCount;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            unsigned int key = maxKey - (unsigned int)fminf(source[i].depth * keyScale, (float)maxKey);
+            target[offsets[(key >> shift) & 0xff]++] = source[i];
+        }
+        
+        VisibleSprite* swap = source;
+        source = target;
+        target = swap;
+    }
+    
+    // An even number of passes leaves the result back in items
+    view->items = source;
+    view->scratch = target;
+}
+
+void GatherVisibleSprites(SpriteView* view, const SpriteList* sprites, const Map* map, const Player* player,
+                          int screenWidth, int screenHeight) {
+    view->count = 0;
+    view->tilesVisited = 0;
+    view->tilesCulled = 0;
+    if (sprites->buckets == NULL || sprites->activeCount == 0) return;
+    
+    // Camera in tile units
+    float posX = player->position.x / TILE_SIZE;
+    float posY = player->position.y / TILE_SIZE;
+    float dirX = player->direction.x;
+    float dirY = player->direction.y;
+    float planeX = player->plane.x;
+    float planeY = player->plane.y;
+    float planeLength = sqrtf(planeX * planeX + planeY * planeY);
+    float invDet = 1.0f / (planeX * dirY - dirX * planeY);
+    float halfWidth = screenWidth * 0.5f;
+    
+    // Tiles covered by the frustum triangle out to the view distance
+    float farLeftX = posX + (dirX - planeX) * SPRITE_VIEW_DISTANCE;
+    float farLeftY = posY + (dirY - planeY) * SPRITE_VIEW_DISTANCE;
+    float farRightX = posX + (dirX + planeX) * SPRITE_VIEW_DISTANCE;
+    float farRightY = posY + (dirY + planeY) * SPRITE_VIEW_DISTANCE;
+    
+    int minX = (int)floorf(fminf(posX, fminf(farLeftX, farRightX))) - 1;
+    int maxX = (int)floorf(fmaxf(posX, fmaxf(farLeftX, farRightX))) + 1;
+    int minY = (int)floorf(fminf(posY, fminf(farLeftY, farRightY))) - 1;
+    int maxY = (int)floorf(fmaxf(posY, fmaxf(farLeftY, farRightY))) + 1;
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX >= sprites->width) maxX = sprites->width - 1;
+    if (maxY >= sprites->height) maxY = sprites->height - 1;
+    
+    int playerTileX = (int)posX;
+    int playerTileY = (int)posY;
+    
+    for (int ty = minY; ty <= maxY; ty++) {
+        for (int tx = minX; tx <= maxX; tx++) {
+            int id = GetFirstSpriteInTile(sprites, tx, ty);
+            if (id < 0) continue;
+            view->tilesVisited++;
+            
+            // Conservative frustum test on the tile centre
+            float relX = tx + 0.5f - posX;
+            float relY = ty + 0.5f - posY;
+            float depth = relX * dirX + relY * dirY;
+            float lateral = fabsf(relX * planeX + relY * planeY) / planeLength;
+            if (depth < -SPRITE_TILE_MARGIN || depth > SPRITE_VIEW_DISTANCE + SPRITE_TILE_MARGIN ||
+                lateral > planeLength * depth + SPRITE_TILE_MARGIN * (1.0f + planeLength)) {
+                view->tilesCulled++;
+                continue;
+            }
+            
+            // Tiles the player's tile cannot see hide all their sprites
+            if (!IsTileVisibleFrom(map->pvs, playerTileX, playerTileY, tx, ty)) {
+                view->tilesCulled++;
+                continue;
+            }
+            
+            for (; id >= 0; id = GetNextSpriteInTile(sprites, id)) {
+                const Sprite* sprite = &sprites->sprites[id];
+                float spriteX = sprite->position.x / TILE_SIZE - posX;
+                float spriteY = sprite->position.y / TILE_SIZE - posY;
+                
+                // Inverse camera matrix: transformY is the depth, transformX the offset along the plane
+                float transformX = invDet * (dirY * spriteX - dirX * spriteY);
+                float transformY = invDet * (-planeY * spriteX + planeX * spriteY);
+                if (transformY < SPRITE_NEAR_PLANE || transformY > SPRITE_VIEW_DISTANCE) continue;
+                
+                float screenX = halfWidth * (1.0f + transformX / transformY);
+                float spriteWidth = GetSpriteLineHeight(transformY, screenHeight) * sprite->scale;
+                if (screenX + spriteWidth < 0.0f || screenX - spriteWidth > screenWidth) continue;
+                
+                if (!ReserveSpriteView(view, view->count + 1)) return;
+                view->items[view->count++] = (VisibleSprite){ id, transformY, screenX };
+            }
+        }
+    }
+    
+    SortSpritesBackToFront(view);
+}
+
+// Shared state for one parallel sprite pass
+typedef struct SpriteBandJob {
+    Framebuffer* fb;
+    const SpriteView* view;
+    const SpriteList* sprites;
+    const Image* images;
+} SpriteBandJob;
+
+static void DrawSpriteBand(Framebuffer* fb, const SpriteView* view, const SpriteList* sprites, const Image* images,
+                           int bandStart, int bandEnd) {
+    int screenHeight = fb->height;
+    int columns[SPRITE_BAND_WIDTH];
+    int texColumns[SPRITE_BAND_WIDTH];
+    
+    for (int i = 0; i < view->count; i++) {
+        const VisibleSprite* visible = &view->items[i];
+        const Sprite* sprite = &sprites->sprites[visible->id];
+        const Image* image = &images[sprite->texture % SPRITE_TEXTURE_COUNT];
+        if (image->data == NULL) continue;
+        
+        // Screen rectangle: standing on the floor line of a wall at the same depth
+        float lineHeight = GetSpriteLineHeight(visible->depth, screenHeight);
+        float spriteHeight = lineHeight * sprite->scale;
+        float spriteWidth = spriteHeight * image->width / image->height;
+        if (spriteHeight < 1.0f) continue;
+        
+        float left = visible->screenX - spriteWidth * 0.5f;
+        int startX = (int)ceilf(left);
+        int endX = (int)ceilf(left + spriteWidth);
+        if (startX < bandStart) startX = bandStart;
+        if (endX > bandEnd) endX = bandEnd;
+        if (startX >= endX) continue;
+        
+        float bottom = screenHeight * 0.5f + lineHeight * 0.5f;
+        float top = bottom - spriteHeight;
+        int startY = (int)ceilf(top);
+        int endY = (int)ceilf(bottom);
+        if (startY < 0) startY = 0;
+        if (endY > screenHeight) endY = screenHeight;
+        if (startY >= endY) continue;
+        
+        // Columns in front of the wall, with their texture column
+        int columnCount = 0;
+        float texScaleX = image->width / spriteWidth;
+        for (int x = startX; x < endX; x++) {
+            if (visible->depth >= fb->depth[x]) continue;
+            
+            int texX = (int)((x - left) * texScaleX);
+            if (texX >= image->width) texX = image->width - 1;
+            columns[columnCount] = x;
+            texColumns[columnCount] = texX;
+            columnCount++;
+        }
+        if (columnCount == 0) continue;
+        
+        // Row by row so framebuffer writes stay within a cache line or two
+        const Color* texels = (const Color*)image->data;
+        float texScaleY = image->height / spriteHeight;
+        for (int y = startY; y < endY; y++) {
+            int texY = (int)((y - top) * texScaleY);
+            if (texY >= image->height) texY = image->height - 1;
+            
+            const Color* texRow = texels + texY * image->width;
+            Color* row = fb->pixels + (size_t)y * fb->width;
+            for (int c = 0; c < columnCount; c++) {
+                Color texel = texRow[texColumns[c]];
+                if (texel.a >= 128) row[columns[c]] = texel;
+            }
+        }
+    }
+}
+
+static void RunSpriteBand(void* userData, int jobIndex, int threadIndex) {
+    SpriteBandJob* job = (SpriteBandJob*)userData;
+    (void)threadIndex;
+    
+    int bandStart = jobIndex * SPRITE_BAND_WIDTH;
+    int bandEnd = bandStart + SPRITE_BAND_WIDTH;
+    if (bandEnd > job->fb->width) bandEnd = job->fb->width;
+    
+    DrawSpriteBand(job->fb, job->view, job->sprites, job->images, bandStart, bandEnd);
+}
+
+void DrawSpritesSoftware(Framebuffer* fb, const SpriteView* view, const SpriteList* sprites,
+                         const Image* images, WorkerPool* pool) {
+    if (view->count == 0) return;
+    
+    SpriteBandJob job = { fb, view, sprites, images };
+    int bandCount = (fb->width + SPRITE_BAND_WIDTH - 1) / SPRITE_BAND_WIDTH;
+    
+    if (pool == NULL) {
+        for (int band = 0; band < bandCount; band++) {
+            RunSpriteBand(&job, band, 0);
+        }
+        return;
+    }
+    
+    RunWorkerJobs(pool, RunSpriteBand, &job, bandCount);
+}
+
+void UnloadSpriteView(SpriteView* view) {
+    free(view->items);
+    free(view->scratch);
+    memset(view, 0, sizeof(*view));
+}
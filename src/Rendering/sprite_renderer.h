@@ -0,0 +1,46 @@
+#ifndef SPRITE_RENDERER_H
+#define SPRITE_RENDERER_H
+
+#include "raylib.h"
+#include "framebuffer.h"
+#include "../World/player.h"
+#include "../World/map.h"
+#include "../World/sprites.h"
+#include "../Core/worker_pool.h"
+
+#define SPRITE_VIEW_DISTANCE 32.0f  // Tiles; sprites further away are not gathered
+#define SPRITE_NEAR_PLANE 0.05f     // Tiles; closer sprites would project to infinity
+#define SPRITE_DEPTH_BITS 16        // Precision of the radix sort key
+
+// A sprite that survived culling, in camera space
+typedef struct VisibleSprite {
+    int id;             // Index into SpriteList.sprites
+    float depth;        // Distance along the view direction in tiles (comparable to RayHit.perpDist)
+    float screenX;      // Projected centre column
+} VisibleSprite;
+
+// Per-frame sprite gathering results; reused between frames to avoid allocations
+typedef struct SpriteView {
+    VisibleSprite* items;       // Sorted back to front after GatherVisibleSprites
+    VisibleSprite* scratch;     // Radix sort ping-pong buffer
+    int count;
+    int capacity;
+    int tilesVisited;           // Non-empty tiles inside the frustum bounds this frame
+    int tilesCulled;            // Of those, rejected by the frustum or the PVS
+} SpriteView;
+
+// Collects the sprites in tiles that are inside the view frustum and visible
+// from the player's tile according to the map's PVS, then sorts them back to
+// front with a two-pass radix sort on a quantized depth key (O(n), stable).
+void GatherVisibleSprites(SpriteView* view, const SpriteList* sprites, const Map* map, const Player* player,
+                          int screenWidth, int screenHeight);
+
+// Draws gathered sprites into the framebuffer, column-tested against the wall
+// depth the raycaster left in fb->depth. Texels with alpha below 128 are
+// skipped. Columns are split into bands across the pool (NULL = this thread).
+void DrawSpritesSoftware(Framebuffer* fb, const SpriteView* view, const SpriteList* sprites,
+                         const Image* images, WorkerPool* pool);
+
+void UnloadSpriteView(SpriteView* view);
+
+#endif // SPRITE_RENDERER_H
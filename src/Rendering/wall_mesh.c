@@ -0,0 +1,449 @@
+#include "wall_mesh.h"
+#include "raymath.h"
+#include "../World/pvs.h"
+#include <stdlib.h>
+#include <string.h>
+
+// One potential face per side of a tile, described in tile-local XZ corners
+// as seen from the empty neighbour (counter-clockwise front faces)
+typedef struct WallFaceDesc {
+    int dx, dy;                // Neighbour that has to be empty for the face to exist
+    float x0, z0;              // Bottom-left corner
+    float x1, z1;              // Bottom-right corner
+    float nx, nz;              // Outward normal
+} WallFaceDesc;
+
+static const WallFaceDesc WALL_FACES[4] = {
+    {  1,  0,  1.0f, 1.0f,  1.0f, 0.0f,   1.0f,  0.0f }, // East  (+X)
+    { -1,  0,  0.0f, 0.0f,  0.0f, 1.0f,  -1.0f,  0.0f }, // West  (-X)
+    {  0,  1,  0.0f, 1.0f,  1.0f, 1.0f,   0.0f,  1.0f }, // South (+Z)
+    {  0, -1,  1.0f, 0.0f,  0.0f, 0.0f,   0.0f, -1.0f }, // North (-Z)
+};
+
+// Same texture and tint selection as the software raycaster
+static int GetWallTextureIndex(int tile, int x, int y) {
+    return (tile == TILE_WALL) ? (x + y) % WALL_TEXTURE_COUNT : tile % WALL_TEXTURE_COUNT;
+}
+
+// Atlas u of position u (0..1) across wall texture texIndex
+static float GetWallAtlasU(int texIndex, float u) {
+    return (texIndex + WALL_ATLAS_INSET + u * (1.0f - 2.0f * WALL_ATLAS_INSET)) / WALL_TEXTURE_COUNT;
+}
+
+static Color GetWallTint(int tile) {
+    switch (tile) {
+        case TILE_WALL:        return WHITE;
+        case TILE_DOOR:        return RED;
+        case TILE_SECRET_WALL: return GREEN;
+        case TILE_OBSTACLE:    return BLUE;
+        default:               return PURPLE;
+    }
+}
+
+// A face is emitted only where a wall tile meets an empty tile or a door
+// (the jambs a door slides into); faces against other walls or the map
+// border can never be seen
+static bool IsWallFaceExposed(const Map* map, int x, int y, const WallFaceDesc* face) {
+    int neighbour = GetMapTile(map, x + face->dx, y + face->dy);
+    return neighbour == TILE_EMPTY || neighbour == TILE_DOOR || neighbour == TILE_DOOR_OPEN;
+}
+
+// Drops the GPU buffers of a group but keeps (or frees) the CPU arrays ourselves,
+// since UnloadMesh would otherwise free them too
+static void UnloadWallGroupGPU(WallMeshGroup* group) {
+    if (group->mesh.vaoId == 0) return;
+    
+    Mesh gpuOnly = { 0 };
+    gpuOnly.vaoId = group->mesh.vaoId;
+    gpuOnly.vboId = group->mesh.vboId;
+    UnloadMesh(gpuOnly);
+    
+    group->mesh.vaoId = 0;
+    group->mesh.vboId = NULL;
+}
+
+static void FreeWallGroup(WallMeshGroup* group) {
+    UnloadWallGroupGPU(group);
+    free(group->mesh.vertices);
+    free(group->mesh.texcoords);
+    free(group->mesh.normals);
+    free(group->mesh.colors);
+    free(group->mesh.indices);
+    memset(group, 0, sizeof(*group));
+}
+
+static bool AllocWallGroup(WallMeshGroup* group, int faceCount) {
+    int vertexCount = faceCount * 4;
+    
+    group->mesh.vertices = malloc(vertexCount * 3 * sizeof(float));
+    group->mesh.texcoords = malloc(vertexCount * 2 * sizeof(float));
+    group->mesh.normals = malloc(vertexCount * 3 * sizeof(float));
+    group->mesh.colors = malloc(vertexCount * 4 * sizeof(unsigned char));
+    group->mesh.indices = malloc(faceCount * 6 * sizeof(unsigned short));
+    
+    if (!group->mesh.vertices || !group->mesh.texcoords || !group->mesh.normals ||
+        !group->mesh.colors || !group->mesh.indices) {
+        FreeWallGroup(group);
+        return false;
+    }
+    
+    group->mesh.vertexCount = vertexCount;
+    group->mesh.triangleCount = faceCount * 2;
+    group->faceCount = 0;
+    return true;
+}
+
+// Upright quad from bottom corner (bx0, bz0) to (bx1, bz1) in world units,
+// with texture u running from u0 at the first corner to u1 at the second
+static void EmitWallQuad(WallMeshGroup* group, float bx0, float bz0, float bx1, float bz1, float u0, float u1,
+                         float nx, float nz, Color tint) {
+    int face4 = group->faceCount * 4;
+    float* v = group->mesh.vertices + face4 * 3;
+    float* t = group->mesh.texcoords + face4 * 2;
+    float* n = group->mesh.normals + face4 * 3;
+    unsigned char* c = group->mesh.colors + face4 * 4;
+    unsigned short* idx = group->mesh.indices + group->faceCount * 6;
+    
+    // Bottom-left, bottom-right, top-right, top-left
+    const float corners[4][3] = {
+        { bx0, 0.0f, bz0 },
+        { bx1, 0.0f, bz1 },
+        { bx1, WALL_MESH_HEIGHT, bz1 },
+        { bx0, WALL_MESH_HEIGHT, bz0 },
+    };
+    const float uvs[4][2] = { { u0, 1.0f }, { u1, 1.0f }, { u1, 0.0f }, { u0, 0.0f } };
+    
+    for (int i = 0; i < 4; i++) {
+        v[i * 3 + 0] = corners[i][0];
+        v[i * 3 + 1] = corners[i][1];
+        v[i * 3 + 2] = corners[i][2];
+        t[i * 2 + 0] = uvs[i][0];
+        t[i * 2 + 1] = uvs[i][1];
+        n[i * 3 + 0] = nx;
+        n[i * 3 + 1] = 0.0f;
+        n[i * 3 + 2] = nz;
+        c[i * 4 + 0] = tint.r;
+        c[i * 4 + 1] = tint.g;
+        c[i * 4 + 2] = tint.b;
+        c[i * 4 + 3] = tint.a;
+    }
+    
+    idx[0] = (unsigned short)(face4 + 0);
+    idx[1] = (unsigned short)(face4 + 1);
+    idx[2] = (unsigned short)(face4 + 2);
+    idx[3] = (unsigned short)(face4 + 0);
+    idx[4] = (unsigned short)(face4 + 2);
+    idx[5] = (unsigned short)(face4 + 3);
+    
+    group->faceCount++;
+}
+
+static void EmitWallFace(WallMeshGroup* group, int x, int y, const WallFaceDesc* face, int texIndex, Color tint) {
+    EmitWallQuad(group, (x + face->x0) * TILE_SIZE, (y + face->z0) * TILE_SIZE,
+                 (x + face->x1) * TILE_SIZE, (y + face->z1) * TILE_SIZE,
+                 GetWallAtlasU(texIndex, 0.0f), GetWallAtlasU(texIndex, 1.0f), face->nx, face->nz, tint);
+}
+
+// Both sides of a door slab covering [open, 1] of its tile, halfway through
+// the tile. The texture slides along with the slab: u runs from 0 at its
+// leading edge, like wallX - open in the raycaster.
+static void EmitDoorFaces(WallMeshGroup* group, int x, int y, bool vertical, float open, Color tint) {
+    int texIndex = GetWallTextureIndex(TILE_DOOR, x, y);
+    float uOpen = GetWallAtlasU(texIndex, 0.0f);
+    float uEnd = GetWallAtlasU(texIndex, 1.0f - open);
+    
+    if (vertical) {
+        float px = (x + 0.5f) * TILE_SIZE;
+        float z0 = (y + open) * TILE_SIZE;
+        float z1 = (y + 1.0f) * TILE_SIZE;
+        EmitWallQuad(group, px, z1, px, z0, uEnd, uOpen, 1.0f, 0.0f, tint);
+        EmitWallQuad(group, px, z0, px, z1, uOpen, uEnd, -1.0f, 0.0f, tint);
+    } else {
+        float pz = (y + 0.5f) * TILE_SIZE;
+        float x0 = (x + open) * TILE_SIZE;
+        float x1 = (x + 1.0f) * TILE_SIZE;
+        EmitWallQuad(group, x0, pz, x1, pz, uOpen, uEnd, 0.0f, 1.0f, tint);
+        EmitWallQuad(group, x1, pz, x0, pz, uEnd, uOpen, 0.0f, -1.0f, tint);
+    }
+}
+
+// Slot a map chunk is kept in
+static int GetWallChunkSlot(const WallMesh* wallMesh, int chunkX, int chunkY) {
+    return (chunkY % wallMesh->chunksY) * wallMesh->chunksX + chunkX % wallMesh->chunksX;
+}
+
+// Slot of a map chunk, -1 when it is not the one kept there
+static int FindWallChunk(const WallMesh* wallMesh, int chunkX, int chunkY) {
+    if (chunkX < 0 || chunkY < 0) return -1;
+    
+    int slot = GetWallChunkSlot(wallMesh, chunkX, chunkY);
+    const WallChunk* chunk = &wallMesh->chunks[slot];
+    return (chunk->chunkX == chunkX && chunk->chunkY == chunkY) ? slot : -1;
+}
+
+void BuildWallChunk(WallMesh* wallMesh, const Map* map, int chunkX, int chunkY) {
+    WallChunk* chunk = &wallMesh->chunks[GetWallChunkSlot(wallMesh, chunkX, chunkY)];
+    chunk->chunkX = chunkX;
+    chunk->chunkY = chunkY;
+    
+    int startX = chunkX * WALL_CHUNK_SIZE;
+    int startY = chunkY * WALL_CHUNK_SIZE;
+    int endX = (startX + WALL_CHUNK_SIZE < map->width) ? startX + WALL_CHUNK_SIZE : map->width;
+    int endY = (startY + WALL_CHUNK_SIZE < map->height) ? startY + WALL_CHUNK_SIZE : map->height;
+    
+    // First pass counts faces so the group is allocated exactly once.
+    // Closed doors are part of the static geometry, moving ones are drawn on
+    // their own and open ones not at all.
+    int count = 0;
+    for (int y = startY; y < endY; y++) {
+        for (int x = startX; x < endX; x++) {
+            int tile = GetMapTile(map, x, y);
+            if (!IsTileTypeSolid(tile)) continue;
+            
+            if (tile == TILE_DOOR) {
+                if (GetActiveDoor(map, x, y) == NULL) count += 2;
+                continue;
+            }
+            for (int f = 0; f < 4; f++) {
+                if (IsWallFaceExposed(map, x, y, &WALL_FACES[f])) count++;
+            }
+        }
+    }
+    
+    WallMeshGroup* group = &chunk->group;
+    FreeWallGroup(group);
+    chunk->dirty = false;
+    if (count == 0 || !AllocWallGroup(group, count)) return;
+    
+    // Second pass emits the geometry
+    for (int y = startY; y < endY; y++) {
+        for (int x = startX; x < endX; x++) {
+            int tile = GetMapTile(map, x, y);
+            if (!IsTileTypeSolid(tile)) continue;
+            
+            Color tint = GetWallTint(tile);
+            if (tile == TILE_DOOR) {
+                if (GetActiveDoor(map, x, y) == NULL) EmitDoorFaces(group, x, y, IsDoorVertical(map, x, y), 0.0f, tint);
+                continue;
+            }
+            int texIndex = GetWallTextureIndex(tile, x, y);
+            for (int f = 0; f < 4; f++) {
+                if (IsWallFaceExposed(map, x, y, &WALL_FACES[f])) EmitWallFace(group, x, y, &WALL_FACES[f], texIndex, tint);
+            }
+        }
+    }
+    
+    if (wallMesh->uploadToGPU) UploadMesh(&group->mesh, false);
+}
+
+// Builds the dirty chunks the slots hold, returns how many
+static int BuildDirtyWallChunks(WallMesh* wallMesh, const Map* map) {
+    int chunkCount = wallMesh->chunksX * wallMesh->chunksY;
+    int built = 0;
+    
+    for (int i = 0; i < chunkCount; i++) {
+        WallChunk* chunk = &wallMesh->chunks[i];
+        if (!chunk->dirty || chunk->chunkX < 0) continue;
+        
+        BuildWallChunk(wallMesh, map, chunk->chunkX, chunk->chunkY);
+        built++;
+    }
+    return built;
+}
+
+bool InitWallMesh(WallMesh* wallMesh, const Map* map, int radius, bool uploadToGPU) {
+    memset(wallMesh, 0, sizeof(*wallMesh));
+    
+    wallMesh->mapWidth = map->width;
+    wallMesh->mapHeight = map->height;
+    wallMesh->mapChunksX = (map->width + WALL_CHUNK_SIZE - 1) / WALL_CHUNK_SIZE;
+    wallMesh->mapChunksY = (map->height + WALL_CHUNK_SIZE - 1) / WALL_CHUNK_SIZE;
+    wallMesh->radius = (radius > 0) ? radius : 0;
+    int side = 2 * wallMesh->radius + 1;
+    wallMesh->chunksX = (side < wallMesh->mapChunksX) ? side : wallMesh->mapChunksX;
+    wallMesh->chunksY = (side < wallMesh->mapChunksY) ? side : wallMesh->mapChunksY;
+    wallMesh->uploadToGPU = uploadToGPU;
+    wallMesh->chunks = calloc((size_t)wallMesh->chunksX * wallMesh->chunksY, sizeof(WallChunk));
+    
+    if (wallMesh->chunks == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate %dx%d wall mesh chunks", wallMesh->chunksX, wallMesh->chunksY);
+        return false;
+    }
+    
+    for (int i = 0; i < wallMesh->chunksX * wallMesh->chunksY; i++) {
+        wallMesh->chunks[i].chunkX = wallMesh->chunks[i].chunkY = -1;
+    }
+    wallMesh->windowX = wallMesh->windowY = -1;
+    SetWallMeshFocus(wallMesh, (int)map->playerStart.x, (int)map->playerStart.y);
+    BuildDirtyWallChunks(wallMesh, map);
+    
+    wallMesh->mapRevision = map->revision;
+    return true;
+}
+
+void UnloadWallMesh(WallMesh* wallMesh) {
+    if (wallMesh->chunks != NULL) {
+        int chunkCount = wallMesh->chunksX * wallMesh->chunksY;
+        for (int i = 0; i < chunkCount; i++) {
+            FreeWallGroup(&wallMesh->chunks[i].group);
+        }
+        free(wallMesh->chunks);
+    }
+    
+    memset(wallMesh, 0, sizeof(*wallMesh));
+}
+
+// First chunk of a window of `count` chunks centred on `focus`, kept inside the map
+static int GetWallWindowStart(int focus, int radius, int count, int mapChunks) {
+    int start = focus - radius;
+    if (start > mapChunks - count) start = mapChunks - count;
+    return (start > 0) ? start : 0;
+}
+
+void SetWallMeshFocus(WallMesh* wallMesh, int tileX, int tileY) {
+    if (wallMesh->chunks == NULL) return;
+    
+    int windowX = GetWallWindowStart(tileX / WALL_CHUNK_SIZE, wallMesh->radius, wallMesh->chunksX, wallMesh->mapChunksX);
+    int windowY = GetWallWindowStart(tileY / WALL_CHUNK_SIZE, wallMesh->radius, wallMesh->chunksY, wallMesh->mapChunksY);
+    if (windowX == wallMesh->windowX && windowY == wallMesh->windowY) return;
+    
+    // Each map chunk of the window has a slot of its own; slots whose chunk
+    // left the window take the one that came in
+    for (int cy = windowY; cy < windowY + wallMesh->chunksY; cy++) {
+        for (int cx = windowX; cx < windowX + wallMesh->chunksX; cx++) {
+            WallChunk* chunk = &wallMesh->chunks[GetWallChunkSlot(wallMesh, cx, cy)];
+            if (chunk->chunkX == cx && chunk->chunkY == cy) continue;
+            
+            chunk->chunkX = cx;
+            chunk->chunkY = cy;
+            chunk->dirty = true;
+        }
+    }
+    wallMesh->windowX = windowX;
+    wallMesh->windowY = windowY;
+}
+
+// Marks the kept chunks overlapping tiles x0..x1, y0..y1 (inclusive, clipped
+// to the window); the others are built when they come into range anyway
+static void MarkWallChunksDirty(WallMesh* wallMesh, int x0, int y0, int x1, int y1) {
+    int windowX0 = wallMesh->windowX * WALL_CHUNK_SIZE;
+    int windowY0 = wallMesh->windowY * WALL_CHUNK_SIZE;
+    int windowX1 = (wallMesh->windowX + wallMesh->chunksX) * WALL_CHUNK_SIZE - 1;
+    int windowY1 = (wallMesh->windowY + wallMesh->chunksY) * WALL_CHUNK_SIZE - 1;
+    if (x0 < windowX0) x0 = windowX0;
+    if (y0 < windowY0) y0 = windowY0;
+    if (x1 > windowX1) x1 = windowX1;
+    if (y1 > windowY1) y1 = windowY1;
+    
+    for (int cy = y0 / WALL_CHUNK_SIZE; cy <= y1 / WALL_CHUNK_SIZE && y0 <= y1; cy++) {
+        for (int cx = x0 / WALL_CHUNK_SIZE; cx <= x1 / WALL_CHUNK_SIZE && x0 <= x1; cx++) {
+            int slot = FindWallChunk(wallMesh, cx, cy);
+            if (slot >= 0) wallMesh->chunks[slot].dirty = true;
+        }
+    }
+}
+
+void UpdateWallMesh(WallMesh* wallMesh, const Map* map) {
+    wallMesh->rebuiltChunks = 0;
+    if (wallMesh->chunks == NULL) return;
+    
+    int chunkCount = wallMesh->chunksX * wallMesh->chunksY;
+    
+    for (unsigned int r = wallMesh->mapRevision; r != map->revision; r++) {
+        const MapChange* change = GetMapChange(map, r);
+        
+        if (change == NULL) {
+            // Too many changes to replay, rebuild everything
+            for (int i = 0; i < chunkCount; i++) wallMesh->chunks[i].dirty = true;
+            break;
+        }
+        
+        // A tile change can expose or hide faces of its four neighbours,
+        // which may live in adjacent chunks
+        int x1 = change->x + change->width - 1;
+        int y1 = change->y + change->height - 1;
+        MarkWallChunksDirty(wallMesh, change->x - 1, change->y, x1 + 1, y1);
+        MarkWallChunksDirty(wallMesh, change->x, change->y - 1, x1, y1 + 1);
+    }
+    
+    wallMesh->rebuiltChunks = BuildDirtyWallChunks(wallMesh, map);
+    wallMesh->mapRevision = map->revision;
+}
+
+void GetVisibleWallChunks(const WallMesh* wallMesh, const Map* map, int tileX, int tileY, int radius,
+                          unsigned char* chunkVisible) {
+    int chunkX = tileX / WALL_CHUNK_SIZE;
+    int chunkY = tileY / WALL_CHUNK_SIZE;
+    
+    for (int i = 0; i < wallMesh->chunksX * wallMesh->chunksY; i++) {
+        int cx = wallMesh->chunks[i].chunkX;
+        int cy = wallMesh->chunks[i].chunkY;
+        bool nearby = cx >= 0 && abs(cx - chunkX) <= radius && abs(cy - chunkY) <= radius;
+        
+        chunkVisible[i] = nearby && IsRegionVisibleFrom(map->pvs, tileX, tileY,
+            cx * WALL_CHUNK_SIZE, cy * WALL_CHUNK_SIZE,
+            (cx + 1) * WALL_CHUNK_SIZE - 1, (cy + 1) * WALL_CHUNK_SIZE - 1);
+    }
+}
+
+void AddWallMeshDraws(DrawList* list, const WallMesh* wallMesh, Material material, Texture2D atlas,
+                      const unsigned char* chunkVisible) {
+    int chunkCount = wallMesh->chunksX * wallMesh->chunksY;
+    
+    // Tints are baked into the vertex colours, textures all live in the atlas
+    material.maps[MATERIAL_MAP_DIFFUSE].color = WHITE;
+    material.maps[MATERIAL_MAP_DIFFUSE].texture = atlas;
+    
+    for (int i = 0; i < chunkCount; i++) {
+        if (chunkVisible != NULL && !chunkVisible[i]) continue;
+        
+        const WallMeshGroup* group = &wallMesh->chunks[i].group;
+        if (group->faceCount == 0 || (wallMesh->uploadToGPU && group->mesh.vaoId == 0)) continue;
+        
+        AddDrawListMesh(list, &group->mesh, material, MatrixIdentity());
+    }
+}
+
+bool InitDoorMesh(WallMeshGroup* group, bool uploadToGPU) {
+    memset(group, 0, sizeof(*group));
+    if (!AllocWallGroup(group, MAP_MAX_ACTIVE_DOORS * 2)) return false;
+    
+    // Fill every slot once so colours and indices, which never change, are
+    // uploaded in full; nothing is drawn until the first BuildDoorMesh
+    for (int i = 0; i < MAP_MAX_ACTIVE_DOORS; i++) {
+        EmitDoorFaces(group, 0, 0, false, 0.0f, GetWallTint(TILE_DOOR));
+    }
+    if (uploadToGPU) UploadMesh(&group->mesh, true);
+    
+    group->faceCount = 0;
+    group->mesh.triangleCount = 0;
+    return true;
+}
+
+void BuildDoorMesh(WallMeshGroup* group, const Map* map, const WallMesh* wallMesh, const unsigned char* chunkVisible) {
+    group->faceCount = 0;
+    
+    for (int i = 0; i < map->activeDoorCount; i++) {
+        const MapDoor* door = &map->activeDoors[i];
+        
+        // Same chunk culling as the walls around it
+        if (chunkVisible != NULL) {
+            int slot = FindWallChunk(wallMesh, door->x / WALL_CHUNK_SIZE, door->y / WALL_CHUNK_SIZE);
+            if (slot < 0 || !chunkVisible[slot]) continue;
+        }
+        
+        EmitDoorFaces(group, door->x, door->y, IsDoorVertical(map, door->x, door->y), door->open, GetWallTint(TILE_DOOR));
+    }
+    
+    group->mesh.triangleCount = group->faceCount * 2;
+    if (group->mesh.vaoId == 0 || group->faceCount == 0) return;
+    
+    int vertexCount = group->faceCount * 4;
+    UpdateMeshBuffer(group->mesh, 0, group->mesh.vertices, vertexCount * 3 * sizeof(float), 0);
+    UpdateMeshBuffer(group->mesh, 1, group->mesh.texcoords, vertexCount * 2 * sizeof(float), 0);
+    UpdateMeshBuffer(group->mesh, 2, group->mesh.normals, vertexCount * 3 * sizeof(float), 0);
+}
+
+void UnloadDoorMesh(WallMeshGroup* group) {
+    FreeWallGroup(group);
+}
@@ -0,0 +1,86 @@
+#ifndef WALL_MESH_H
+#define WALL_MESH_H
+
+#include "raylib.h"
+#include "../World/map.h"
+#include "draw_list.h"
+
+// Tiles per side of a wall mesh chunk; a chunk is rebuilt as a whole when one of its tiles changes
+#define WALL_CHUNK_SIZE 16
+#define WALL_TEXTURE_COUNT 8       // Cells of the wall atlas (Map.wallAtlas)
+#define WALL_ATLAS_INSET (0.5f / 64.0f) // Half a texel of a 64 px wall texture, keeps neighbouring cells from bleeding in
+#define WALL_MESH_HEIGHT 1.0f      // Walls span the floor (y = 0) to the ceiling (y = 1)
+#define WALL_MESH_DEFAULT_RADIUS 2 // Chunks kept built each way around the focus
+
+// Faces of one chunk, textured from the wall atlas. The vertex arrays are
+// owned here and shared with the GPU mesh, which only owns its buffer objects.
+typedef struct WallMeshGroup {
+    Mesh mesh;                 // CPU arrays always valid, vaoId != 0 once uploaded
+    int faceCount;
+} WallMeshGroup;
+
+typedef struct WallChunk {
+    WallMeshGroup group;
+    int chunkX, chunkY;        // Map chunk held, -1 while the slot is empty
+    bool dirty;                // Needs rebuilding from the map
+} WallChunk;
+
+// Static wall geometry for the GPU path: only faces that border an empty or
+// door tile are emitted, plus the slabs of closed doors, merged per chunk so a
+// frame is one draw per visible chunk.
+//
+// Only the chunks within `radius` of a focus chunk (the player's) are kept,
+// so memory follows the view distance rather than the map. They live in a
+// ring of chunksX * chunksY slots: map chunk (cx, cy) goes in slot
+// (cx % chunksX, cy % chunksY), so when the focus moves the chunks coming
+// into range take over the slots of the ones going out of it.
+typedef struct WallMesh {
+    int chunksX, chunksY;      // Slots, 2 * radius + 1 each way or the map's chunks if fewer
+    int mapWidth, mapHeight;
+    int mapChunksX, mapChunksY;
+    int radius;
+    int windowX, windowY;      // First map chunk held each way
+    WallChunk* chunks;         // Slots, row-major
+    unsigned int mapRevision;  // Map revision the chunks reflect
+    bool uploadToGPU;          // False for headless use (builder only)
+    int rebuiltChunks;         // Chunks rebuilt by the last UpdateWallMesh call
+} WallMesh;
+
+// Builds the chunks within radius chunks of the player start; uploadToGPU
+// needs a GL context
+bool InitWallMesh(WallMesh* wallMesh, const Map* map, int radius, bool uploadToGPU);
+void UnloadWallMesh(WallMesh* wallMesh);
+
+// Centres the kept chunks on the chunk of tile (tileX, tileY). Chunks that
+// come into range are built by the next UpdateWallMesh.
+void SetWallMeshFocus(WallMesh* wallMesh, int tileX, int tileY);
+
+// Consumes the map change log and rebuilds only the chunks touched since the
+// last call, plus those that came into range
+void UpdateWallMesh(WallMesh* wallMesh, const Map* map);
+
+// Rebuilds the CPU geometry of one map chunk into its slot (and re-uploads it
+// when on the GPU)
+void BuildWallChunk(WallMesh* wallMesh, const Map* map, int chunkX, int chunkY);
+
+// Flags the kept chunks within radius chunks of tile (tileX, tileY) that the
+// map's PVS says can be seen from it; chunkVisible holds a byte per slot,
+// chunksX * chunksY
+void GetVisibleWallChunks(const WallMesh* wallMesh, const Map* map, int tileX, int tileY, int radius,
+                          unsigned char* chunkVisible);
+
+// Queues one draw per chunk flagged in chunkVisible (NULL draws all), all
+// with the same state so they submit as a single batch
+void AddWallMeshDraws(DrawList* list, const WallMesh* wallMesh, Material material, Texture2D atlas,
+                      const unsigned char* chunkVisible);
+
+// Geometry of the moving doors, rebuilt every frame: both sides of each slab
+// over the part of its tile it still covers, with the texture slid along.
+// All doors share one mesh and the walls' material, so they join the walls'
+// batch as a single extra draw.
+bool InitDoorMesh(WallMeshGroup* group, bool uploadToGPU); // uploadToGPU needs a GL context
+// Doors in the chunks flagged in chunkVisible (wallMesh's slots, NULL builds all); re-uploads when on the GPU
+void BuildDoorMesh(WallMeshGroup* group, const Map* map, const WallMesh* wallMesh, const unsigned char* chunkVisible);
+void UnloadDoorMesh(WallMeshGroup* group);
+
+#endif // WALL_MESH_H
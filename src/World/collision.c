@@ -0,0 +1,217 @@
+#include "collision.h"
+#include <math.h>
+
+// A side of a blocking tile is exposed when the tile across it is open, or is
+// the tile the moving circle's centre started in (see SweepCircle)
+static bool IsSideOpen(const Map* map, int x, int y, int startX, int startY) {
+    return (x == startX && y == startY) || !IsMapCellBlocking(map, x, y);
+}
+
+// Tests one blocking tile against the motion, keeping the earliest contact in
+// *bestTime / *normal. Times are fractions of delta; a circle that already
+// touches a face it is moving into gets time 0.
+static void SweepCircleTile(const Map* map, int tileX, int tileY, int startX, int startY, Vector2 start, Vector2 delta,
+                            float radius, float* bestTime, Vector2* normal) {
+    float minX = tileX * TILE_SIZE;
+    float minY = tileY * TILE_SIZE;
+    float maxX = minX + TILE_SIZE;
+    float maxY = minY + TILE_SIZE;
+    
+    bool openLeft = IsSideOpen(map, tileX - 1, tileY, startX, startY);
+    bool openRight = IsSideOpen(map, tileX + 1, tileY, startX, startY);
+    bool openTop = IsSideOpen(map, tileX, tileY - 1, startX, startY);
+    bool openBottom = IsSideOpen(map, tileX, tileY + 1, startX, startY);
+    
+    // Faces along x: the centre has to reach the face plane pushed out by the radius
+    if (delta.x != 0.0f) {
+        bool movingRight = delta.x > 0.0f;
+        float distance = movingRight ? minX - start.x : start.x - maxX;
+        if ((movingRight ? openLeft : openRight) && distance >= 0.0f) {
+            float time = fmaxf((distance - radius) / fabsf(delta.x), 0.0f);
+            float y = start.y + delta.y * time;
+            if (time < *bestTime && y >= minY && y <= maxY) {
+                *bestTime = time;
+                *normal = (Vector2){ movingRight ? -1.0f : 1.0f, 0.0f };
+            }
+        }
+    }
+    
+    // Faces along y
+    if (delta.y != 0.0f) {
+        bool movingDown = delta.y > 0.0f;
+        float distance = movingDown ? minY - start.y : start.y - maxY;
+        if ((movingDown ? openTop : openBottom) && distance >= 0.0f) {
+            float time = fmaxf((distance - radius) / fabsf(delta.y), 0.0f);
+            float x = start.x + delta.x * time;
+            if (time < *bestTime && x >= minX && x <= maxX) {
+                *bestTime = time;
+                *normal = (Vector2){ 0.0f, movingDown ? -1.0f : 1.0f };
+            }
+        }
+    }
+    
+    // Convex corners: ray against a circle of the collision radius
+    const Vector2 corners[4] = { { minX, minY }, { maxX, minY }, { minX, maxY }, { maxX, maxY } };
+    const bool exposed[4] = {
+        openLeft && openTop, openRight && openTop, openLeft && openBottom, openRight && openBottom
+    };
+    
+    for (int i = 0; i < 4; i++) {
+        if (!exposed[i]) continue;
+        
+        Vector2 offset = { start.x - corners[i].x, start.y - corners[i].y };
+        float b = offset.x * delta.x + offset.y * delta.y;
+        if (b >= 0.0f) continue; // Moving away from the corner
+        
+        float c = offset.x * offset.x + offset.y * offset.y - radius * radius;
+        float time = 0.0f;
+        if (c > 0.0f) {
+            float a = delta.x * delta.x + delta.y * delta.y;
+            float discriminant = b * b - a * c;
+            if (discriminant < 0.0f) continue;
+            time = (-b - sqrtf(discriminant)) / a;
+        }
+        if (time >= *bestTime) continue;
+        
+        // Normal from the corner to the centre at contact
+        Vector2 contact = { offset.x + delta.x * time, offset.y + delta.y * time };
+        float length = sqrtf(contact.x * contact.x + contact.y * contact.y);
+        if (length == 0.0f) continue;
+        
+        *bestTime = time;
+        *normal = (Vector2){ contact.x / length, contact.y / length };
+    }
+}
+
+// A centre that starts inside a blocking tile (a door shut on it) may leave
+// through any side that leads to an open tile, or move along the nearest one.
+// Otherwise the motion is blocked, with the normal of that side to slide
+// along (or against the motion when every side is closed).
+static bool IsBuriedMotionBlocked(const Map* map, int tileX, int tileY, Vector2 start, Vector2 delta, Vector2* normal) {
+    const int sides[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    float nearest = INFINITY;
+    float length = sqrtf(delta.x * delta.x + delta.y * delta.y);
+    *normal = (Vector2){ -delta.x / length, -delta.y / length };
+    
+    for (int i = 0; i < 4; i++) {
+        if (IsMapCellBlocking(map, tileX + sides[i][0], tileY + sides[i][1])) continue;
+        if (delta.x * sides[i][0] + delta.y * sides[i][1] > 0.0f) return false;
+        
+        // Distance from the centre to this side
+        float face = (sides[i][0] != 0) ? (tileX + (sides[i][0] > 0)) * TILE_SIZE : (tileY + (sides[i][1] > 0)) * TILE_SIZE;
+        float distance = fabsf(((sides[i][0] != 0) ? start.x : start.y) - face);
+        if (distance < nearest) {
+            nearest = distance;
+            *normal = (Vector2){ (float)sides[i][0], (float)sides[i][1] };
+        }
+    }
+    return nearest == INFINITY || delta.x * normal->x + delta.y * normal->y < 0.0f;
+}
+
+CollisionHit SweepCircle(const Map* map, Vector2 start, Vector2 delta, float radius) {
+    float length = sqrtf(delta.x * delta.x + delta.y * delta.y);
+    CollisionHit result = { false, 1.0f, length, { start.x + delta.x, start.y + delta.y }, { 0.0f, 0.0f } };
+    if (length == 0.0f) return result;
+    
+    float bestTime = 2.0f;
+    Vector2 normal = { 0.0f, 0.0f };
+    
+    // A centre buried in a blocking tile ignores that tile, and the tiles
+    // around it treat the sides they share with it as exposed
+    int startX = (int)floorf(start.x / TILE_SIZE);
+    int startY = (int)floorf(start.y / TILE_SIZE);
+    if (IsMapCellBlocking(map, startX, startY) && IsBuriedMotionBlocked(map, startX, startY, start, delta, &normal)) {
+        bestTime = 0.0f;
+    }
+    
+    // Walk the motion in steps of at most one tile so the tiles examined hug
+    // the swept shape instead of its bounding box. A contact at time t is
+    // always found by the step covering t, so the first step that ends after
+    // the best contact so far settles it.
+    int steps = (int)ceilf(length / TILE_SIZE);
+    if (steps < 1) steps = 1;
+    
+    for (int s = 0; s < steps && bestTime > 0.0f; s++) {
+        float t0 = (float)s / steps;
+        float t1 = (float)(s + 1) / steps;
+        float x0 = start.x + delta.x * t0;
+        float y0 = start.y + delta.y * t0;
+        float x1 = start.x + delta.x * t1;
+        float y1 = start.y + delta.y * t1;
+        
+        int minTileX = (int)floorf((fminf(x0, x1) - radius) / TILE_SIZE);
+        int maxTileX = (int)floorf((fmaxf(x0, x1) + radius) / TILE_SIZE);
+        int minTileY = (int)floorf((fminf(y0, y1) - radius) / TILE_SIZE);
+        int maxTileY = (int)floorf((fmaxf(y0, y1) + radius) / TILE_SIZE);
+        
+        for (int ty = minTileY; ty <= maxTileY; ty++) {
+            for (int tx = minTileX; tx <= maxTileX; tx++) {
+                if ((tx != startX || ty != startY) && IsMapCellBlocking(map, tx, ty)) {
+                    SweepCircleTile(map, tx, ty, startX, startY, start, delta, radius, &bestTime, &normal);
+                }
+            }
+        }
+        
+        if (bestTime <= t1) break;
+    }
+    
+    if (bestTime > 1.0f) return result;
+    
+    // Stop short of the contact by the skin so the next query starts outside
+    float time = fmaxf(bestTime - COLLISION_SKIN / length, 0.0f);
+    result.hit = true;
+    result.time = bestTime;
+    result.distance = length * time;
+    result.position = (Vector2){ start.x + delta.x * time, start.y + delta.y * time };
+    result.normal = normal;
+    return result;
+}
+
+Vector2 SlideCircle(const Map* map, Vector2 start, Vector2 delta, float radius, CollisionHit* lastHit) {
+    Vector2 position = start;
+    CollisionHit contact = { false, 1.0f, 0.0f, start, { 0.0f, 0.0f } };
+    
+    for (int i = 0; i < COLLISION_SLIDE_ITERATIONS; i++) {
+        CollisionHit hit = SweepCircle(map, position, delta, radius);
+        position = hit.position;
+        if (!hit.hit) break;
+        contact = hit;
+        
+        // Carry on with what is left of the motion, minus the part into the wall
+        float remaining = 1.0f - hit.time;
+        delta.x *= remaining;
+        delta.y *= remaining;
+        float into = delta.x * hit.normal.x + delta.y * hit.normal.y;
+        if (into < 0.0f) {
+            delta.x -= hit.normal.x * into;
+            delta.y -= hit.normal.y * into;
+        }
+        
+        if (fabsf(delta.x) + fabsf(delta.y) < 1e-4f) break;
+    }
+    
+    if (lastHit != NULL) *lastHit = contact;
+    return position;
+}
+
+bool IsCircleBlocked(const Map* map, Vector2 center, float radius) {
+    int minTileX = (int)floorf((center.x - radius) / TILE_SIZE);
+    int maxTileX = (int)floorf((center.x + radius) / TILE_SIZE);
+    int minTileY = (int)floorf((center.y - radius) / TILE_SIZE);
+    int maxTileY = (int)floorf((center.y + radius) / TILE_SIZE);
+    
+    for (int ty = minTileY; ty <= maxTileY; ty++) {
+        for (int tx = minTileX; tx <= maxTileX; tx++) {
+            if (!IsMapCellBlocking(map, tx, ty)) continue;
+            
+            // Closest point of the tile to the centre
+            float nearestX = fminf(fmaxf(center.x, tx * TILE_SIZE), (tx + 1) * TILE_SIZE);
+            float nearestY = fminf(fmaxf(center.y, ty * TILE_SIZE), (ty + 1) * TILE_SIZE);
+            float dx = center.x - nearestX;
+            float dy = center.y - nearestY;
+            if (dx * dx + dy * dy < radius * radius) return true;
+        }
+    }
+    
+    return false;
+}
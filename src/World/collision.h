@@ -0,0 +1,52 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "raylib.h"
+#include "map.h"
+#include <stddef.h>
+
+// Swept circle against the tile grid. Blocking tiles are treated as the
+// Minkowski sum of the tile and the circle: exposed tile faces pushed out by
+// the radius plus quarter circles at convex corners. Faces shared by two
+// blocking tiles and concave corners are skipped, so sliding along a wall made
+// of many tiles never snags on the seams.
+//
+// All positions and distances are in world units (TILE_SIZE per tile).
+
+#define COLLISION_SKIN 0.1f          // Gap kept between a stopped circle and the wall (world units)
+#define COLLISION_SLIDE_ITERATIONS 3 // Contacts resolved per move before giving up
+
+typedef struct CollisionHit {
+    bool hit;
+    float time;         // Fraction of the motion that is free, 0..1 (1 when nothing was hit)
+    float distance;     // Distance the circle can travel before touching, minus the skin
+    Vector2 position;   // Centre after travelling `distance`
+    Vector2 normal;     // Contact normal pointing out of the wall, zero when nothing was hit
+} CollisionHit;
+
+// Tiles that stop movement; a door blocks the whole tile until it is fully
+// open. Out of bounds counts as blocking so nothing can leave the map.
+static inline bool IsMapCellBlocking(const Map* map, int x, int y) {
+    if ((unsigned int)x >= (unsigned int)map->width || (unsigned int)y >= (unsigned int)map->height) return true;
+    int tile = (map->tiles != NULL) ? map->tiles[y * map->width + x] : GetMapTile(map, x, y);
+    return tile == TILE_WALL || tile == TILE_DOOR || tile == TILE_SECRET_WALL || tile == TILE_OBSTACLE;
+}
+
+// First contact of a circle moving from start by delta. Only the tiles under
+// the swept shape are visited, in tile-sized steps along the motion.
+//
+// A circle that starts with its centre inside a blocking tile (a door closed
+// on it) ignores that tile while it leaves through a side that leads to an
+// open tile or moves along the nearest such side; motion deeper in is a
+// contact at time 0 with that side's normal. The tiles around it stay solid,
+// their sides facing the buried centre included.
+CollisionHit SweepCircle(const Map* map, Vector2 start, Vector2 delta, float radius);
+
+// Moves a circle by delta, sliding along walls it touches. Returns the final
+// centre; lastHit (optional) receives the last contact of the move.
+Vector2 SlideCircle(const Map* map, Vector2 start, Vector2 delta, float radius, CollisionHit* lastHit);
+
+// Exact overlap test between a circle and the blocking tiles
+bool IsCircleBlocked(const Map* map, Vector2 center, float radius);
+
+#endif // COLLISION_H
@@ -0,0 +1,117 @@
+#include "enemies.h"
+#include "collision.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define ENEMY_INITIAL_CAPACITY 64
+
+void InitEnemyList(EnemyList* list) {
+    list->enemies = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->sightQueries = NULL;
+    list->sightResults = NULL;
+    list->alertedCount = 0;
+}
+
+void UnloadEnemyList(EnemyList* list, SpriteList* sprites) {
+    if (sprites != NULL) {
+        for (int i = 0; i < list->count; i++) {
+            RemoveSprite(sprites, list->enemies[i].sprite);
+        }
+    }
+    
+    free(list->enemies);
+    free(list->sightQueries);
+    free(list->sightResults);
+    InitEnemyList(list);
+}
+
+int AddEnemy(EnemyList* list, SpriteList* sprites, Vector2 position) {
+    if (list->count == list->capacity) {
+        int capacity = (list->capacity > 0) ? list->capacity * 2 : ENEMY_INITIAL_CAPACITY;
+        Enemy* enemies = (Enemy*)realloc(list->enemies, (size_t)capacity * sizeof(Enemy));
+        if (enemies != NULL) list->enemies = enemies;
+        LOSQuery* queries = (LOSQuery*)realloc(list->sightQueries, (size_t)capacity * sizeof(LOSQuery));
+        if (queries != NULL) list->sightQueries = queries;
+        bool* results = (bool*)realloc(list->sightResults, (size_t)capacity * sizeof(bool));
+        if (results != NULL) list->sightResults = results;
+        
+        if (enemies == NULL || queries == NULL || results == NULL) {
+            TraceLog(LOG_WARNING, "Failed to grow the enemy list to %d enemies", capacity);
+            return -1;
+        }
+        list->capacity = capacity;
+    }
+    
+    int sprite = AddSprite(sprites, position, ENEMY_SPRITE_TEXTURE, ENEMY_SPRITE_SCALE);
+    if (sprite < 0) return -1;
+    
+    list->enemies[list->count] = (Enemy){ position, sprite, false, false };
+    return list->count++;
+}
+
+void SpawnMapEnemies(EnemyList* list, SpriteList* sprites, const Map* map) {
+    // Fixed pattern like the sprites, so replays see the same enemies
+    unsigned int seed = 1337u;
+    
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            if (GetMapTile(map, x, y) != TILE_EMPTY) continue;
+            
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 24) % 24 != 0) continue;
+            
+            AddEnemy(list, sprites, (Vector2){ (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE });
+        }
+    }
+    
+    TraceLog(LOG_INFO, "Spawned %d enemies", list->count);
+}
+
+void UpdateEnemyAwareness(EnemyList* list, const Map* map, Vector2 playerPosition, WorkerPool* pool) {
+    for (int i = 0; i < list->count; i++) {
+        list->sightQueries[i] = (LOSQuery){ list->enemies[i].position, playerPosition };
+    }
+    
+    CheckLineOfSight(map, list->sightQueries, list->count, list->sightResults, GetBestLOSKernel(), pool, NULL);
+    
+    list->alertedCount = 0;
+    for (int i = 0; i < list->count; i++) {
+        Enemy* enemy = &list->enemies[i];
+        enemy->seesPlayer = list->sightResults[i];
+        enemy->alerted = enemy->alerted || enemy->seesPlayer;
+        list->alertedCount += enemy->alerted;
+    }
+}
+
+void UpdateEnemies(EnemyList* list, SpriteList* sprites, const FlowField* field, const Map* map, float deltaTime) {
+    float step = ENEMY_MOVE_SPEED * TILE_SIZE * deltaTime;
+    float radius = ENEMY_COLLISION_RADIUS * TILE_SIZE;
+    
+    for (int i = 0; i < list->count; i++) {
+        Enemy* enemy = &list->enemies[i];
+        if (!enemy->alerted) continue;
+        
+        int tileX = (int)(enemy->position.x / TILE_SIZE);
+        int tileY = (int)(enemy->position.y / TILE_SIZE);
+        
+        // Close enough, or no path within range: hold position
+        if (GetFlowDistance(field, tileX, tileY) <= ENEMY_STOP_DISTANCE) continue;
+        int direction = GetFlowDirection(field, tileX, tileY);
+        if (direction == FLOW_DIRECTION_NONE) continue;
+        
+        // Head for the centre of the next tile, which keeps agents off wall
+        // corners better than following the raw grid direction
+        float targetX = (tileX + FLOW_DIRECTION_OFFSETS[direction][0] + 0.5f) * TILE_SIZE;
+        float targetY = (tileY + FLOW_DIRECTION_OFFSETS[direction][1] + 0.5f) * TILE_SIZE;
+        float toX = targetX - enemy->position.x;
+        float toY = targetY - enemy->position.y;
+        float length = sqrtf(toX * toX + toY * toY);
+        if (length < 0.0001f) continue;
+        
+        Vector2 delta = { toX / length * step, toY / length * step };
+        enemy->position = SlideCircle(map, enemy->position, delta, radius, NULL);
+        MoveSprite(sprites, enemy->sprite, enemy->position);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef ENEMIES_H
+#define ENEMIES_H
+
+#include "raylib.h"
+#include "map.h"
+#include "sprites.h"
+#include "flow_field.h"
+#include "los.h"
+
+#define ENEMY_MOVE_SPEED 2.0f        // Tiles per second
+#define ENEMY_COLLISION_RADIUS 0.25f // Tiles
+#define ENEMY_STOP_DISTANCE 1        // Flow steps from the player where enemies hold position
+#define ENEMY_SPRITE_TEXTURE 7       // Sprite texture enemies are drawn with
+#define ENEMY_SPRITE_SCALE 0.8f
+
+// An agent chasing the player along the shared flow field, drawn as a sprite.
+// Enemies stand still until they first see the player.
+typedef struct Enemy {
+    Vector2 position;   // World units
+    int sprite;         // Id in the SpriteList
+    bool seesPlayer;    // Line of sight to the player this tick
+    bool alerted;       // Has seen the player, chases from now on
+} Enemy;
+
+typedef struct EnemyList {
+    Enemy* enemies;
+    int count;
+    int capacity;
+    LOSQuery* sightQueries; // Scratch for the per-tick visibility batch, capacity entries
+    bool* sightResults;
+    int alertedCount;
+} EnemyList;
+
+void InitEnemyList(EnemyList* list);
+void UnloadEnemyList(EnemyList* list, SpriteList* sprites); // sprites may be NULL when already unloaded
+int AddEnemy(EnemyList* list, SpriteList* sprites, Vector2 position); // Returns the enemy index or -1
+void SpawnMapEnemies(EnemyList* list, SpriteList* sprites, const Map* map);
+
+// Checks every enemy's line of sight to the player in one batch (pool may be
+// NULL) and alerts the ones that see it
+void UpdateEnemyAwareness(EnemyList* list, const Map* map, Vector2 playerPosition, WorkerPool* pool);
+
+// Steps every alerted enemy toward the centre of the tile its flow cell points
+// to and keeps its sprite in place; one field lookup and one collision slide each
+void UpdateEnemies(EnemyList* list, SpriteList* sprites, const FlowField* field, const Map* map, float deltaTime);
+
+#endif // ENEMIES_H
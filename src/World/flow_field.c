@@ -0,0 +1,515 @@
+#include "flow_field.h"
+#include "collision.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Orthogonal neighbours, the steps the search takes
+static const int FLOW_STEPS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+static inline void SetFlowDistance(FlowField* field, int tile, int distance) {
+    field->cells[tile] = (FlowCell){ (uint16_t)distance, FLOW_DIRECTION_NONE, field->generation };
+}
+
+static inline int GetTileDistance(const FlowField* field, int tile) {
+    FlowCell cell = field->cells[tile];
+    return (cell.generation == field->generation) ? cell.distance : FLOW_DISTANCE_UNREACHED;
+}
+
+// Cells are indexed by window coordinates; this tests the map tile underneath
+static inline bool IsFlowCellBlocking(const FlowField* field, const Map* map, int x, int y) {
+    return IsMapCellBlocking(map, field->originX + x, field->originY + y);
+}
+
+// Distance by window coordinates, unreached outside the window
+static inline int GetCellDistance(const FlowField* field, int x, int y) {
+    if ((unsigned int)x >= (unsigned int)field->size || (unsigned int)y >= (unsigned int)field->size) {
+        return FLOW_DISTANCE_UNREACHED;
+    }
+    return GetTileDistance(field, y * field->size + x);
+}
+
+// Centres the window on the goal. Every reached tile is within `range` steps
+// of it, and a tile one further still decides diagonal steps, so the window
+// reaches range + 1 tiles each way.
+static inline void PlaceFlowWindow(FlowField* field) {
+    field->originX = field->goalX - field->range - 1;
+    field->originY = field->goalY - field->range - 1;
+}
+
+// Window cell of the goal
+static inline int GetFlowGoalCell(const FlowField* field) {
+    return (field->range + 1) * field->size + field->range + 1;
+}
+
+// Picks the neighbour closest to the goal. Diagonal steps are only taken when
+// both orthogonal tiles beside them are open, so agents never cut corners;
+// ties go to the orthogonal step, which comes first in the table.
+static void UpdateFlowDirection(FlowField* field, const Map* map, int x, int y) {
+    if ((unsigned int)x >= (unsigned int)field->size || (unsigned int)y >= (unsigned int)field->size) return;
+    
+    int tile = y * field->size + x;
+    int best = GetTileDistance(field, tile);
+    if (best == FLOW_DISTANCE_UNREACHED) return;
+    
+    int bestDirection = FLOW_DIRECTION_NONE;
+    static const int ORDER[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    for (int i = 0; i < 8; i++) {
+        int d = ORDER[i];
+        int nx = x + FLOW_DIRECTION_OFFSETS[d][0];
+        int ny = y + FLOW_DIRECTION_OFFSETS[d][1];
+        int distance = GetCellDistance(field, nx, ny);
+        if (distance >= best) continue;
+        if ((d & 1) && (IsFlowCellBlocking(field, map, nx, y) || IsFlowCellBlocking(field, map, x, ny))) continue;
+        
+        best = distance;
+        bestDirection = d;
+    }
+    
+    field->cells[tile].direction = (uint8_t)bestDirection;
+}
+
+// Directions of a tile and its eight neighbours, whose best step may have changed
+static void UpdateFlowDirectionsAround(FlowField* field, const Map* map, int tile) {
+    int x = tile % field->size;
+    int y = tile / field->size;
+    
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            UpdateFlowDirection(field, map, x + dx, y + dy);
+        }
+    }
+}
+
+// Smallest open neighbour distance plus one, or FLOW_DISTANCE_UNREACHED.
+// Blocking tiles are skipped, their distance may be stale until repaired.
+static int GetFlowCandidate(const FlowField* field, const Map* map, int tile) {
+    int x = tile % field->size;
+    int y = tile / field->size;
+    int best = FLOW_DISTANCE_UNREACHED;
+    
+    for (int s = 0; s < 4; s++) {
+        int nx = x + FLOW_STEPS[s][0];
+        int ny = y + FLOW_STEPS[s][1];
+        if (IsFlowCellBlocking(field, map, nx, ny)) continue;
+        
+        int distance = GetCellDistance(field, nx, ny);
+        if (distance < best) best = distance;
+    }
+    
+    return (best < field->range) ? best + 1 : FLOW_DISTANCE_UNREACHED;
+}
+
+// Relaxes the open neighbours of a tile, queueing the ones that got closer.
+// Only tiles short of the range are expanded, so the neighbours are within
+// range of the goal and inside the window. Returns false when the queue is
+// full.
+static bool ExpandFlowTile(FlowField* field, const Map* map, int tile, int* tail) {
+    int distance = GetTileDistance(field, tile);
+    if (distance >= field->range) return true;
+    
+    int x = tile % field->size;
+    int y = tile / field->size;
+    for (int s = 0; s < 4; s++) {
+        int nx = x + FLOW_STEPS[s][0];
+        int ny = y + FLOW_STEPS[s][1];
+        if (IsFlowCellBlocking(field, map, nx, ny)) continue;
+        
+        int neighbour = ny * field->size + nx;
+        if (GetTileDistance(field, neighbour) <= distance + 1) continue;
+        if (*tail == field->queueCapacity) return false;
+        
+        SetFlowDistance(field, neighbour, distance + 1);
+        field->queue[(*tail)++] = neighbour;
+    }
+    
+    return true;
+}
+
+bool InitFlowField(FlowField* field, int width, int height, int range) {
+    memset(field, 0, sizeof(*field));
+    field->width = width;
+    field->height = height;
+    field->range = (range > 0 && range < FLOW_DISTANCE_UNREACHED) ? range : FLOW_FIELD_DEFAULT_RANGE;
+    field->goalX = field->goalY = -1;
+    field->generation = 1;
+    field->searchGoalX = field->searchGoalY = -1;
+    field->searchGeneration = 1;
+    field->searchBudget = FLOW_SEARCH_BUDGET;
+    field->size = 2 * field->range + 3;
+    
+    // Tiles within `range` orthogonal steps of the goal: a diamond of 2r^2 + 2r + 1
+    long long tiles = (long long)width * height;
+    long long diamond = 2ll * field->range * field->range + 2ll * field->range + 1;
+    field->queueCapacity = (int)((tiles < diamond) ? tiles : diamond);
+    
+    size_t cells = (size_t)field->size * field->size;
+    field->cells = (FlowCell*)calloc(cells, sizeof(FlowCell));
+    field->queue = (int*)malloc((size_t)field->queueCapacity * sizeof(int));
+    field->seeds = (FlowSeed*)malloc((size_t)field->queueCapacity * sizeof(FlowSeed));
+    field->searchCells = (FlowCell*)calloc(cells, sizeof(FlowCell));
+    field->searchQueue = (int*)malloc((size_t)field->queueCapacity * sizeof(int));
+    if (field->cells == NULL || field->queue == NULL || field->seeds == NULL || field->searchCells == NULL ||
+        field->searchQueue == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate a flow field of range %d", field->range);
+        UnloadFlowField(field);
+        return false;
+    }
+    
+    return true;
+}
+
+void UnloadFlowField(FlowField* field) {
+    free(field->cells);
+    free(field->queue);
+    free(field->seeds);
+    free(field->searchCells);
+    free(field->searchQueue);
+    memset(field, 0, sizeof(*field));
+    field->goalX = field->goalY = -1;
+    field->searchGoalX = field->searchGoalY = -1;
+}
+
+// Exchanges the field agents follow with the one being searched, so the
+// search can use the same helpers; a finished search is simply left in place
+static void SwapFlowSearch(FlowField* field) {
+    FlowCell* cells = field->cells;
+    field->cells = field->searchCells;
+    field->searchCells = cells;
+    
+    int* queue = field->queue;
+    field->queue = field->searchQueue;
+    field->searchQueue = queue;
+    
+    uint8_t generation = field->generation;
+    field->generation = field->searchGeneration;
+    field->searchGeneration = generation;
+    
+    int goalX = field->goalX, goalY = field->goalY;
+    field->goalX = field->searchGoalX;
+    field->goalY = field->searchGoalY;
+    field->searchGoalX = goalX;
+    field->searchGoalY = goalY;
+    
+    int originX = field->originX, originY = field->originY;
+    field->originX = field->searchOriginX;
+    field->originY = field->searchOriginY;
+    field->searchOriginX = originX;
+    field->searchOriginY = originY;
+}
+
+// A new generation makes every cell stale at once; clear for real on wrap-around
+static void NextFlowGeneration(FlowField* field) {
+    field->generation++;
+    if (field->generation == 0) {
+        memset(field->cells, 0, (size_t)field->size * field->size * sizeof(FlowCell));
+        field->generation = 1;
+    }
+}
+
+void RebuildFlowField(FlowField* field, const Map* map) {
+    field->rebuilt = true;
+    field->tilesTouched = 0;
+    if (field->cells == NULL) return;
+    
+    NextFlowGeneration(field);
+    PlaceFlowWindow(field);
+    if (IsMapCellBlocking(map, field->goalX, field->goalY)) return;
+    
+    int goal = GetFlowGoalCell(field);
+    SetFlowDistance(field, goal, 0);
+    field->queue[0] = goal;
+    int tail = 1;
+    
+    for (int head = 0; head < tail; head++) {
+        ExpandFlowTile(field, map, field->queue[head], &tail);
+    }
+    
+    // Every reached tile has all its neighbours' distances final now
+    for (int i = 0; i < tail; i++) {
+        int tile = field->queue[i];
+        UpdateFlowDirection(field, map, tile % field->size, tile / field->size);
+    }
+    
+    field->tilesTouched = tail;
+}
+
+// A tile became passable: spread the shorter distances it opens up outward.
+// Distances only shrink, so a plain breadth-first pass from the tile settles
+// each improved tile once. The tile may already have been reached through
+// another tile opened in the same update, so it is re-checked either way.
+static bool RepairOpenedTile(FlowField* field, const Map* map, int tile) {
+    int distance = GetFlowCandidate(field, map, tile);
+    if (distance >= GetTileDistance(field, tile)) {
+        UpdateFlowDirectionsAround(field, map, tile);
+        return true;
+    }
+    
+    SetFlowDistance(field, tile, distance);
+    field->queue[0] = tile;
+    int tail = 1;
+    
+    for (int head = 0; head < tail; head++) {
+        if (!ExpandFlowTile(field, map, field->queue[head], &tail)) return false;
+    }
+    
+    for (int i = 0; i < tail; i++) {
+        UpdateFlowDirectionsAround(field, map, field->queue[i]);
+    }
+    
+    field->tilesTouched += tail;
+    return true;
+}
+
+// Invalidates a tile whose old distance was `expected` if no remaining
+// neighbour still offers that distance minus one
+static bool InvalidateFlowTile(FlowField* field, const Map* map, int x, int y, int expected, int* count) {
+    if (IsFlowCellBlocking(field, map, x, y)) return true;
+    
+    int tile = y * field->size + x;
+    if (GetTileDistance(field, tile) != expected) return true;
+    
+    for (int s = 0; s < 4; s++) {
+        int nx = x + FLOW_STEPS[s][0];
+        int ny = y + FLOW_STEPS[s][1];
+        if (IsFlowCellBlocking(field, map, nx, ny)) continue;
+        if (GetCellDistance(field, nx, ny) == expected - 1) return true;
+    }
+    
+    if (*count == field->queueCapacity) return false;
+    SetFlowDistance(field, tile, FLOW_DISTANCE_UNREACHED);
+    field->seeds[(*count)++] = (FlowSeed){ tile, expected };
+    return true;
+}
+
+static int CompareFlowSeeds(const void* a, const void* b) {
+    return ((const FlowSeed*)a)->distance - ((const FlowSeed*)b)->distance;
+}
+
+// A reached tile became blocking. Tiles whose every shortest path ran through
+// it are invalidated level by level (a tile is only dropped once no neighbour
+// one step closer survives), then re-seeded from the untouched tiles around
+// them and settled in distance order. Tiles with another equally short route
+// keep their distance and are never visited.
+static bool RepairBlockedTile(FlowField* field, const Map* map, int tile) {
+    int x = tile % field->size;
+    int y = tile / field->size;
+    int oldDistance = GetTileDistance(field, tile);
+    SetFlowDistance(field, tile, FLOW_DISTANCE_UNREACHED);
+    
+    // Invalidate breadth first; each level is fully marked before the next is tested
+    int count = 0;
+    for (int s = 0; s < 4; s++) {
+        if (!InvalidateFlowTile(field, map, x + FLOW_STEPS[s][0], y + FLOW_STEPS[s][1], oldDistance + 1, &count)) return false;
+    }
+    for (int i = 0; i < count; i++) {
+        FlowSeed seed = field->seeds[i];
+        int sx = seed.tile % field->size;
+        int sy = seed.tile / field->size;
+        for (int s = 0; s < 4; s++) {
+            if (!InvalidateFlowTile(field, map, sx + FLOW_STEPS[s][0], sy + FLOW_STEPS[s][1], seed.distance + 1, &count)) return false;
+        }
+    }
+    
+    // Best distance each invalidated tile can get from the surviving tiles
+    for (int i = 0; i < count; i++) {
+        field->seeds[i].distance = GetFlowCandidate(field, map, field->seeds[i].tile);
+    }
+    qsort(field->seeds, (size_t)count, sizeof(FlowSeed), CompareFlowSeeds);
+    
+    // Settle in distance order, merging the sorted seeds with the queue
+    int next = 0;
+    int head = 0, tail = 0;
+    for (;;) {
+        bool takeSeed = next < count && field->seeds[next].distance != FLOW_DISTANCE_UNREACHED &&
+                        (head == tail || field->seeds[next].distance <= GetTileDistance(field, field->queue[head]));
+        int current;
+        if (takeSeed) {
+            FlowSeed seed = field->seeds[next++];
+            if (GetTileDistance(field, seed.tile) <= seed.distance) continue;
+            SetFlowDistance(field, seed.tile, seed.distance);
+            current = seed.tile;
+        } else if (head < tail) {
+            current = field->queue[head++];
+        } else {
+            break;
+        }
+        
+        if (!ExpandFlowTile(field, map, current, &tail)) return false;
+    }
+    
+    UpdateFlowDirectionsAround(field, map, tile);
+    for (int i = 0; i < count; i++) {
+        UpdateFlowDirectionsAround(field, map, field->seeds[i].tile);
+    }
+    
+    // Tiles settled through the queue are invalidated ones, unless another
+    // pending change opened a shortcut that is being spread at the same time
+    for (int i = 0; i < tail; i++) {
+        UpdateFlowDirectionsAround(field, map, field->queue[i]);
+    }
+    
+    field->tilesTouched += count + 1;
+    return true;
+}
+
+// Brings the field in line with one changed tile. Blocked tiles are repaired
+// in a first pass and opened ones in a second, so an opening never spreads a
+// distance through a wall whose repair is still pending. Returns false when
+// the change cannot be repaired locally (the goal tile itself changed, or the
+// repair outgrew the queues) and the field needs a full search. Tiles outside
+// the window are too far from the goal to matter.
+static bool RepairFlowTile(FlowField* field, const Map* map, int x, int y, bool blockedPass) {
+    if (x == field->goalX && y == field->goalY) return false;
+    
+    int cellX = x - field->originX;
+    int cellY = y - field->originY;
+    if ((unsigned int)cellX >= (unsigned int)field->size || (unsigned int)cellY >= (unsigned int)field->size) return true;
+    
+    int tile = cellY * field->size + cellX;
+    bool reached = GetTileDistance(field, tile) != FLOW_DISTANCE_UNREACHED;
+    bool blocking = IsMapCellBlocking(map, x, y);
+    if (blocking != blockedPass) return true;
+    
+    if (!blocking) return RepairOpenedTile(field, map, tile);
+    if (reached) return RepairBlockedTile(field, map, tile);
+    
+    // A wall appeared where no path went; it can still forbid diagonal steps
+    // next to it
+    UpdateFlowDirectionsAround(field, map, tile);
+    return true;
+}
+
+// Brings the field in line with a region that changed at once (a streamed
+// chunk arriving or leaving) by repairing the tiles that need it. A region
+// further from the goal than the range (plus one, for diagonal steps along
+// its edge) cannot change any reached tile. Inside that, blocking tiles that
+// are still reached and open tiles that are not are the ones whose
+// passability may have changed. An open tile that is reached already kept
+// its passability, or was opened and reached by an earlier repair of this
+// update; either way it only needs one if a neighbour offers a shorter way.
+static bool RepairFlowRegion(FlowField* field, const Map* map, const MapChange* change, bool blockedPass) {
+    int reach = field->range + 1;
+    int x0 = (change->x > field->goalX - reach) ? change->x : field->goalX - reach;
+    int y0 = (change->y > field->goalY - reach) ? change->y : field->goalY - reach;
+    int x1 = (change->x + change->width - 1 < field->goalX + reach) ? change->x + change->width - 1 : field->goalX + reach;
+    int y1 = (change->y + change->height - 1 < field->goalY + reach) ? change->y + change->height - 1 : field->goalY + reach;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= field->width) x1 = field->width - 1;
+    if (y1 >= field->height) y1 = field->height - 1;
+    
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (IsMapCellBlocking(map, x, y) != blockedPass) continue;
+            
+            int tile = (y - field->originY) * field->size + x - field->originX;
+            int distance = GetTileDistance(field, tile);
+            if (!blockedPass && distance != FLOW_DISTANCE_UNREACHED && GetFlowCandidate(field, map, tile) >= distance) continue;
+            if (!RepairFlowTile(field, map, x, y, blockedPass)) return false;
+        }
+    }
+    return true;
+}
+
+// Starts a search toward a goal tile in the second buffer
+static void StartFlowSearch(FlowField* field, const Map* map, int goalX, int goalY) {
+    SwapFlowSearch(field);
+    field->goalX = goalX;
+    field->goalY = goalY;
+    NextFlowGeneration(field);
+    PlaceFlowWindow(field);
+    
+    field->searchTail = 0;
+    if (!IsMapCellBlocking(map, goalX, goalY)) {
+        int goal = GetFlowGoalCell(field);
+        SetFlowDistance(field, goal, 0);
+        field->queue[field->searchTail++] = goal;
+    }
+    SwapFlowSearch(field);
+    
+    field->searchHead = 0;
+    field->searchExpanded = false;
+    field->searchRevision = map->revision;
+}
+
+// Handles up to `budget` tiles of the running search: the same breadth-first
+// pass as RebuildFlowField, then the directions of every reached tile. Swaps
+// the finished field in and returns the tiles handled.
+static int StepFlowSearch(FlowField* field, const Map* map, int budget) {
+    SwapFlowSearch(field);
+    
+    int head = field->searchHead;
+    int tail = field->searchTail;
+    int handled = 0;
+    if (!field->searchExpanded) {
+        for (; head < tail && handled < budget; head++, handled++) {
+            ExpandFlowTile(field, map, field->queue[head], &tail);
+        }
+        if (head == tail) {
+            field->searchExpanded = true;
+            head = 0;
+        }
+    }
+    if (field->searchExpanded) {
+        for (; head < tail && handled < budget; head++, handled++) {
+            int tile = field->queue[head];
+            UpdateFlowDirection(field, map, tile % field->size, tile / field->size);
+        }
+    }
+    field->searchHead = head;
+    field->searchTail = tail;
+    
+    if (field->searchExpanded && head == tail) {
+        field->searchGoalX = field->searchGoalY = -1;
+        field->rerooted = true;
+    } else {
+        SwapFlowSearch(field);
+    }
+    return handled;
+}
+
+void UpdateFlowField(FlowField* field, const Map* map, int goalX, int goalY) {
+    field->rebuilt = false;
+    field->rerooted = false;
+    field->tilesTouched = 0;
+    if (field->cells == NULL) return;
+    
+    // Nothing to follow yet, search in one go
+    if (field->goalX < 0) {
+        field->goalX = goalX;
+        field->goalY = goalY;
+        RebuildFlowField(field, map);
+        field->mapRevision = map->revision;
+        return;
+    }
+    
+    for (int pass = 0; pass < 2 && !field->rebuilt; pass++) {
+        for (unsigned int r = field->mapRevision; r != map->revision; r++) {
+            const MapChange* change = GetMapChange(map, r);
+            
+            // Too many changes to replay, or a change that needs a full search
+            bool repaired = false;
+            if (change != NULL && change->width == 1 && change->height == 1) {
+                repaired = RepairFlowTile(field, map, change->x, change->y, pass == 0);
+            } else if (change != NULL) {
+                repaired = RepairFlowRegion(field, map, change, pass == 0);
+            }
+            if (!repaired) {
+                RebuildFlowField(field, map);
+                break;
+            }
+        }
+    }
+    
+    field->mapRevision = map->revision;
+    
+    // A search that saw a different map, or whose goal is no longer wanted,
+    // is dropped. One toward an older goal keeps going though: a player
+    // walking on would otherwise restart it before it ever finished.
+    bool moved = goalX != field->goalX || goalY != field->goalY;
+    if (field->searchGoalX >= 0 && (field->searchRevision != map->revision || !moved)) {
+        field->searchGoalX = field->searchGoalY = -1;
+    }
+    if (field->searchGoalX < 0 && moved) StartFlowSearch(field, map, goalX, goalY);
+    if (field->searchGoalX >= 0) field->tilesTouched += StepFlowSearch(field, map, field->searchBudget);
+}
@@ -0,0 +1,111 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include "raylib.h"
+#include "map.h"
+#include <stdint.h>
+
+// Shared path to one goal (the player) for every agent on the map. A
+// breadth-first search from the goal over the tile grid stores, per tile, the
+// step count to the goal and the neighbour to step into next, so following
+// the field costs an agent one lookup per tick no matter how many agents
+// there are.
+//
+// The search is capped at `range` steps, which bounds the work of a rebuild
+// and the memory of the field by the range instead of the map size: cells
+// are kept for a square window of 2 * range + 3 tiles centred on the goal,
+// and everything outside it reads as unreached. Tile
+// changes such as a door opening, or a streamed chunk arriving within range,
+// are repaired locally, touching only the tiles whose distance actually
+// changes.
+//
+// A goal that changes tile shifts the distance of nearly every reached tile,
+// so it takes a new search. That search runs into a second buffer, at most
+// FLOW_SEARCH_BUDGET tiles per update, while agents keep following the field
+// to the previous goal tile (one step away for a walking player); once done
+// the buffers swap. Only the very first search runs in one go.
+
+#define FLOW_FIELD_DEFAULT_RANGE 256     // Steps searched from the goal
+#define FLOW_DISTANCE_UNREACHED 0xffff   // No path within range
+#define FLOW_DIRECTION_NONE 8            // At the goal, or no path
+#define FLOW_SEARCH_BUDGET 16384         // Tiles a search toward a new goal handles per update
+
+// Next-step offsets indexed by direction; even entries are the four
+// orthogonal neighbours, odd ones the diagonals
+static const int FLOW_DIRECTION_OFFSETS[8][2] = {
+    { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+};
+
+typedef struct FlowCell {
+    uint16_t distance;   // Steps to the goal, FLOW_DISTANCE_UNREACHED when out of range
+    uint8_t direction;   // Index into FLOW_DIRECTION_OFFSETS, FLOW_DIRECTION_NONE at the goal
+    uint8_t generation;  // The cell is only valid while this matches FlowField.generation
+} FlowCell;
+
+// Tile and distance pair used while repairing
+typedef struct FlowSeed {
+    int tile;
+    int distance;
+} FlowSeed;
+
+typedef struct FlowField {
+    int width, height;          // Grid size in tiles
+    int range;                  // Maximum distance searched
+    int size;                   // Window side in tiles, 2 * range + 3
+    int originX, originY;       // Map tile of the window's first cell, range + 1 up and left of the goal
+    FlowCell* cells;            // size * size window cells, row-major
+    int* queue;                 // Search queue of window cells, also the ones touched by the last update
+    FlowSeed* seeds;            // Invalidated tiles while repairing a blocked tile
+    int queueCapacity;          // Tiles within range of the goal, the most any update touches
+    int goalX, goalY;           // Tile the field leads to, -1 before the first build
+    uint8_t generation;         // Bumped per rebuild so old cells go stale without clearing
+    unsigned int mapRevision;   // Map revision the field was last brought up to date with
+    
+    // Search toward a new goal tile, swapped with the fields above once complete
+    int searchBudget;             // Tiles handled per update, FLOW_SEARCH_BUDGET unless changed
+    FlowCell* searchCells;
+    int* searchQueue;
+    int searchOriginX, searchOriginY;
+    uint8_t searchGeneration;
+    int searchGoalX, searchGoalY; // -1 while no search is running
+    int searchHead, searchTail;   // Queue progress, then directions set up to searchHead again
+    bool searchExpanded;          // All reached tiles are in the queue, directions are next
+    unsigned int searchRevision;  // Map revision the search runs against; a change restarts it
+    
+    // Statistics for the last UpdateFlowField call
+    int tilesTouched;
+    bool rebuilt;               // A full search ran in one go (first build, or a repair fell back)
+    bool rerooted;              // A search toward a new goal finished and took over
+} FlowField;
+
+bool InitFlowField(FlowField* field, int width, int height, int range);
+void UnloadFlowField(FlowField* field);
+
+// Brings the field up to date with any map changes since the last call, which
+// are repaired locally, and advances the search toward goalX, goalY when that
+// is not the field's goal yet. goalX, goalY (the fields) say where the field
+// leads at the moment.
+void UpdateFlowField(FlowField* field, const Map* map, int goalX, int goalY);
+
+// Full search from the current goal in one go, discarding everything else
+void RebuildFlowField(FlowField* field, const Map* map);
+
+// Steps to the goal from a tile, FLOW_DISTANCE_UNREACHED when out of range
+static inline int GetFlowDistance(const FlowField* field, int x, int y) {
+    unsigned int cellX = (unsigned int)(x - field->originX);
+    unsigned int cellY = (unsigned int)(y - field->originY);
+    if (cellX >= (unsigned int)field->size || cellY >= (unsigned int)field->size) return FLOW_DISTANCE_UNREACHED;
+    FlowCell cell = field->cells[cellY * field->size + cellX];
+    return (cell.generation == field->generation) ? cell.distance : FLOW_DISTANCE_UNREACHED;
+}
+
+// Direction to step in from a tile, FLOW_DIRECTION_NONE at the goal or out of range
+static inline int GetFlowDirection(const FlowField* field, int x, int y) {
+    unsigned int cellX = (unsigned int)(x - field->originX);
+    unsigned int cellY = (unsigned int)(y - field->originY);
+    if (cellX >= (unsigned int)field->size || cellY >= (unsigned int)field->size) return FLOW_DIRECTION_NONE;
+    FlowCell cell = field->cells[cellY * field->size + cellX];
+    return (cell.generation == field->generation) ? cell.direction : FLOW_DIRECTION_NONE;
+}
+
+#endif // FLOW_FIELD_H
@@ -0,0 +1,67 @@
+#ifndef GRID_RAY_H
+#define GRID_RAY_H
+
+#include <math.h>
+
+// Grid DDA shared by the raycaster and line-of-sight queries. Works in cell
+// units: pass tile coordinates to walk tiles, or tile coordinates divided by
+// MAP_BLOCK_SIZE to walk coarse blocks. sideDistX/Y are the ray lengths (in
+// cells, along the direction) at which the next x and y boundaries are
+// crossed, so min(sideDistX, sideDistY) is where the current cell is left.
+//
+// The raycaster's packet kernels repeat these operations lane by lane and
+// rely on them staying exactly as they are.
+typedef struct GridRay {
+    int mapX, mapY;           // Current cell
+    int stepX, stepY;         // +1 or -1
+    float sideDistX, sideDistY;
+    float deltaDistX, deltaDistY; // Ray length between two x (or y) boundaries
+    int side;                 // 0 = last step crossed an x boundary, 1 = a y boundary
+} GridRay;
+
+static inline void InitGridRay(GridRay* ray, float posX, float posY, float dirX, float dirY) {
+    ray->mapX = (int)posX;
+    ray->mapY = (int)posY;
+    
+    // Near-axis directions never cross that axis
+    ray->deltaDistX = fabsf(dirX) < 0.0001f ? 1e30f : fabsf(1.0f / dirX);
+    ray->deltaDistY = fabsf(dirY) < 0.0001f ? 1e30f : fabsf(1.0f / dirY);
+    
+    if (dirX < 0) {
+        ray->stepX = -1;
+        ray->sideDistX = (posX - ray->mapX) * ray->deltaDistX;
+    } else {
+        ray->stepX = 1;
+        ray->sideDistX = (ray->mapX + 1.0f - posX) * ray->deltaDistX;
+    }
+    
+    if (dirY < 0) {
+        ray->stepY = -1;
+        ray->sideDistY = (posY - ray->mapY) * ray->deltaDistY;
+    } else {
+        ray->stepY = 1;
+        ray->sideDistY = (ray->mapY + 1.0f - posY) * ray->deltaDistY;
+    }
+    
+    ray->side = 0;
+}
+
+// Jump to the next cell, either in x or in y
+static inline void StepGridRay(GridRay* ray) {
+    if (ray->sideDistX < ray->sideDistY) {
+        ray->sideDistX += ray->deltaDistX;
+        ray->mapX += ray->stepX;
+        ray->side = 0;
+    } else {
+        ray->sideDistY += ray->deltaDistY;
+        ray->mapY += ray->stepY;
+        ray->side = 1;
+    }
+}
+
+// Ray length at which the current cell is left
+static inline float GetGridRayExit(const GridRay* ray) {
+    return (ray->sideDistX < ray->sideDistY) ? ray->sideDistX : ray->sideDistY;
+}
+
+#endif // GRID_RAY_H
@@ -0,0 +1,303 @@
+#include "level.h"
+#include "map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+// No mmap: the file is read into memory, which costs the whole file up front
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+_Static_assert(sizeof(LevelHeader) == LEVEL_HEADER_SIZE, "LevelHeader must match the file layout");
+
+#define LEVEL_MAX_REPORTED_PROBLEMS 8
+
+static uint32_t HashLevelBytes(const unsigned char* data, uint64_t size) {
+    uint32_t hash = 2166136261u;
+    for (uint64_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t AlignLevelOffset(uint64_t offset) {
+    return (offset + LEVEL_SECTION_ALIGN - 1) & ~(uint64_t)(LEVEL_SECTION_ALIGN - 1);
+}
+
+// Section sizes a width x height level must have
+static void GetLevelSectionSizes(int width, int height, uint64_t sizes[LEVEL_SECTION_COUNT]) {
+    uint64_t tileCount = (uint64_t)width * (uint64_t)height;
+    uint64_t blockCount = (uint64_t)((width + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT) * ((height + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT);
+    sizes[LEVEL_SECTION_TILES] = tileCount;
+    sizes[LEVEL_SECTION_SOLID] = (tileCount + 63) / 64 * sizeof(uint64_t);
+    sizes[LEVEL_SECTION_BLOCKS] = blockCount * sizeof(uint64_t);
+}
+
+//----------------------------------------------------------------------------------
+// File mapping
+//----------------------------------------------------------------------------------
+
+static void* MapLevelData(const char* path, size_t* size) {
+#ifdef _WIN32
+    unsigned int dataSize = 0;
+    unsigned char* data = LoadFileData(path, &dataSize);
+    *size = (size_t)dataSize;
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
+    
+    struct stat info;
+    void* data = NULL;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        // Private and writable: tile changes land in copy-on-write pages
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) data = NULL;
+        *size = (size_t)info.st_size;
+    }
+    
+    // The mapping keeps the file alive
+    close(file);
+    return data;
+#endif
+}
+
+static void UnmapLevelData(void* data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnloadFileData(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+//----------------------------------------------------------------------------------
+// Loading
+//----------------------------------------------------------------------------------
+
+static bool CheckLevelHeader(const LevelHeader* header, size_t fileSize, const char* path) {
+    if (memcmp(header->magic, LEVEL_MAGIC, 4) != 0) {
+        TraceLog(LOG_WARNING, "%s is not a level file", path);
+        return false;
+    }
+    if (header->byteOrder != LEVEL_BYTE_ORDER_MARK) {
+        TraceLog(LOG_WARNING, "%s was written with a different byte order", path);
+        return false;
+    }
+    if (header->version != LEVEL_VERSION || header->headerSize != LEVEL_HEADER_SIZE || header->sectionCount != LEVEL_SECTION_COUNT) {
+        TraceLog(LOG_WARNING, "%s is a version %u level, expected version %d", path, header->version, LEVEL_VERSION);
+        return false;
+    }
+    if (header->width <= 0 || header->height <= 0 || header->width > MAP_MAX_SIZE || header->height > MAP_MAX_SIZE) {
+        TraceLog(LOG_WARNING, "%s has an invalid size %dx%d (max %d)", path, header->width, header->height, MAP_MAX_SIZE);
+        return false;
+    }
+    if (header->fileSize != fileSize) {
+        TraceLog(LOG_WARNING, "%s is %zu bytes, its header says %llu (truncated?)", path, fileSize,
+                 (unsigned long long)header->fileSize);
+        return false;
+    }
+    
+    uint64_t sizes[LEVEL_SECTION_COUNT];
+    GetLevelSectionSizes(header->width, header->height, sizes);
+    
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        const LevelSection* section = &header->sections[i];
+        bool inside = section->offset >= LEVEL_HEADER_SIZE && section->offset <= fileSize && section->size <= fileSize - section->offset;
+        if (section->size != sizes[i] || section->offset % LEVEL_SECTION_ALIGN != 0 || !inside) {
+            TraceLog(LOG_WARNING, "%s has a broken section table (section %d)", path, i);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool OpenLevel(LevelFile* level, const char* path) {
+    memset(level, 0, sizeof(*level));
+    
+    size_t size = 0;
+    void* data = MapLevelData(path, &size);
+    if (data == NULL) {
+        TraceLog(LOG_WARNING, "Failed to open level %s", path);
+        return false;
+    }
+    
+    const LevelHeader* header = (const LevelHeader*)data;
+    if (size < LEVEL_HEADER_SIZE || !CheckLevelHeader(header, size, path)) {
+        if (size < LEVEL_HEADER_SIZE) TraceLog(LOG_WARNING, "%s is too small to be a level file", path);
+        UnmapLevelData(data, size);
+        return false;
+    }
+    
+    unsigned char* base = (unsigned char*)data;
+    level->data = data;
+    level->size = size;
+    level->header = header;
+    level->tiles = base + header->sections[LEVEL_SECTION_TILES].offset;
+    level->solid = (uint64_t*)(base + header->sections[LEVEL_SECTION_SOLID].offset);
+    level->blocks = (uint64_t*)(base + header->sections[LEVEL_SECTION_BLOCKS].offset);
+    return true;
+}
+
+void CloseLevel(LevelFile* level) {
+    if (level->data != NULL) UnmapLevelData(level->data, level->size);
+    memset(level, 0, sizeof(*level));
+}
+
+//----------------------------------------------------------------------------------
+// Validation
+//----------------------------------------------------------------------------------
+
+// Logs the first few problems, then just counts them
+static void ReportLevelProblem(int* problems, const char* text) {
+    if (*problems < LEVEL_MAX_REPORTED_PROBLEMS) TraceLog(LOG_WARNING, "Level: %s", text);
+    (*problems)++;
+}
+
+bool ValidateLevel(const LevelFile* level) {
+    const LevelHeader* header = level->header;
+    const unsigned char* base = (const unsigned char*)level->data;
+    int width = header->width;
+    int height = header->height;
+    int problems = 0;
+    char text[128];
+    
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        const LevelSection* section = &header->sections[i];
+        if (HashLevelBytes(base + section->offset, section->size) != section->checksum) {
+            snprintf(text, sizeof(text), "section %d checksum mismatch", i);
+            ReportLevelProblem(&problems, text);
+        }
+    }
+    
+    // Rebuild the acceleration sections from the tiles and compare
+    int blocksX = (width + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    int blocksY = (height + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    size_t solidWords = ((size_t)width * height + 63) / 64;
+    uint64_t* solid = (uint64_t*)calloc(solidWords, sizeof(uint64_t));
+    uint64_t* blocks = (uint64_t*)calloc((size_t)blocksX * blocksY, sizeof(uint64_t));
+    if (solid == NULL || blocks == NULL) {
+        TraceLog(LOG_WARNING, "Level: not enough memory to validate a %dx%d level", width, height);
+        free(solid);
+        free(blocks);
+        return false;
+    }
+    
+    for (int y = 0; y < blocksY * MAP_BLOCK_SIZE; y++) {
+        for (int x = 0; x < blocksX * MAP_BLOCK_SIZE; x++) {
+            bool occupied = true;
+            if (x < width && y < height) {
+                size_t index = (size_t)y * width + x;
+                int tile = level->tiles[index];
+                if (tile > TILE_DOOR_OPEN) {
+                    snprintf(text, sizeof(text), "unknown tile type %d at %d,%d", tile, x, y);
+                    ReportLevelProblem(&problems, text);
+                }
+                occupied = IsTileTypeSolid(tile);
+                if (occupied) solid[index >> 6] |= 1ull << (index & 63);
+            }
+            if (occupied) {
+                int block = (y >> MAP_BLOCK_SHIFT) * blocksX + (x >> MAP_BLOCK_SHIFT);
+                blocks[block] |= 1ull << (((y & (MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_SHIFT) | (x & (MAP_BLOCK_SIZE - 1)));
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < solidWords; i++) {
+        if (level->solid[i] != solid[i]) {
+            snprintf(text, sizeof(text), "solid bits disagree with the tiles around tile %zu", i * 64);
+            ReportLevelProblem(&problems, text);
+        }
+    }
+    for (int i = 0; i < blocksX * blocksY; i++) {
+        if (level->blocks[i] != blocks[i]) {
+            snprintf(text, sizeof(text), "block %d,%d disagrees with the tiles", i % blocksX, i / blocksX);
+            ReportLevelProblem(&problems, text);
+        }
+    }
+    free(solid);
+    free(blocks);
+    
+    // The player has to start on a tile it can stand on
+    int startX = (int)header->startX;
+    int startY = (int)header->startY;
+    if (header->startX < 0.0f || header->startY < 0.0f || startX >= width || startY >= height) {
+        ReportLevelProblem(&problems, "player start is outside the map");
+    } else if (IsTileTypeSolid(level->tiles[(size_t)startY * width + startX])) {
+        ReportLevelProblem(&problems, "player starts inside a wall");
+    }
+    
+    if (problems > LEVEL_MAX_REPORTED_PROBLEMS) {
+        TraceLog(LOG_WARNING, "Level: %d more problems not shown", problems - LEVEL_MAX_REPORTED_PROBLEMS);
+    }
+    return problems == 0;
+}
+
+//----------------------------------------------------------------------------------
+// Saving
+//----------------------------------------------------------------------------------
+
+bool SaveLevel(const Map* map, const char* name, const char* path) {
+    if (map->tiles == NULL) {
+        TraceLog(LOG_WARNING, "A streamed map cannot be saved as a level");
+        return false;
+    }
+    
+    const void* sectionData[LEVEL_SECTION_COUNT] = { map->tiles, map->solid, map->blocks };
+    uint64_t sizes[LEVEL_SECTION_COUNT];
+    GetLevelSectionSizes(map->width, map->height, sizes);
+    
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_VERSION;
+    header.headerSize = LEVEL_HEADER_SIZE;
+    header.byteOrder = LEVEL_BYTE_ORDER_MARK;
+    header.width = map->width;
+    header.height = map->height;
+    header.startX = map->playerStart.x;
+    header.startY = map->playerStart.y;
+    header.startAngle = map->playerStartAngle;
+    header.sectionCount = LEVEL_SECTION_COUNT;
+    if (name != NULL) {
+        // Always leaves a terminating zero; longer names are cut short
+        size_t length = strlen(name);
+        if (length > LEVEL_NAME_SIZE - 1) length = LEVEL_NAME_SIZE - 1;
+        memcpy(header.name, name, length);
+    }
+    
+    uint64_t offset = LEVEL_HEADER_SIZE;
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        offset = AlignLevelOffset(offset);
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        header.sections[i].checksum = HashLevelBytes((const unsigned char*)sectionData[i], sizes[i]);
+        offset += sizes[i];
+    }
+    header.fileSize = offset;
+    
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "Failed to open level %s for writing", path);
+        return false;
+    }
+    
+    static const unsigned char padding[LEVEL_SECTION_ALIGN] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = LEVEL_HEADER_SIZE;
+    for (int i = 0; i < LEVEL_SECTION_COUNT && ok; i++) {
+        uint64_t gap = header.sections[i].offset - written;
+        ok = fwrite(padding, 1, (size_t)gap, file) == gap && fwrite(sectionData[i], 1, (size_t)sizes[i], file) == sizes[i];
+        written = header.sections[i].offset + sizes[i];
+    }
+    
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) TraceLog(LOG_WARNING, "Failed to write level %s", path);
+    return ok;
+}
@@ -0,0 +1,89 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary level files (.w3dl), built from text layouts by wolf3d_levelc.
+//
+// The file is laid out so it can be memory-mapped and used in place: the
+// grid arrays a Map works on are stored exactly as the Map holds them, so
+// loading is a header check plus pointer setup and only the pages a frame
+// actually touches are ever read from disk. Tile changes at run time go to
+// private copy-on-write pages and never reach the file.
+//
+// File layout (little endian, native struct layout):
+//   header   LevelHeader, LEVEL_HEADER_SIZE bytes
+//   sections each at a LEVEL_SECTION_ALIGN boundary, found through the
+//            header's section table (offset, size, FNV-1a checksum):
+//     tiles  width * height tile types, row-major
+//     solid  occupancy bitset as Map.solid, (width * height + 63) / 64 u64
+//     blocks 8x8 block occupancy as Map.blocks, blocksX * blocksY u64,
+//            outside tiles of edge blocks set
+//
+// Loading never reads past the header; checksums and the consistency of the
+// acceleration sections with the tiles are left to ValidateLevel.
+
+#define LEVEL_MAGIC "W3DL"
+#define LEVEL_VERSION 1
+#define LEVEL_BYTE_ORDER_MARK 0x01020304u // Reads back differently on a foreign-endian machine
+#define LEVEL_HEADER_SIZE 160
+#define LEVEL_SECTION_ALIGN 64
+#define LEVEL_NAME_SIZE 32
+
+typedef enum {
+    LEVEL_SECTION_TILES,
+    LEVEL_SECTION_SOLID,
+    LEVEL_SECTION_BLOCKS,
+    LEVEL_SECTION_COUNT
+} LevelSectionType;
+
+typedef struct LevelSection {
+    uint64_t offset;            // From the start of the file
+    uint64_t size;              // Bytes
+    uint32_t checksum;          // FNV-1a over the section's bytes
+    uint32_t reserved;
+} LevelSection;
+
+typedef struct LevelHeader {
+    char magic[4];              // LEVEL_MAGIC
+    uint32_t version;           // LEVEL_VERSION
+    uint32_t headerSize;        // LEVEL_HEADER_SIZE
+    uint32_t byteOrder;         // LEVEL_BYTE_ORDER_MARK
+    int32_t width;              // Grid size in tiles
+    int32_t height;
+    float startX, startY;       // Player start in tiles
+    float startAngle;           // Radians, 0 = facing east
+    uint32_t sectionCount;      // LEVEL_SECTION_COUNT
+    char name[LEVEL_NAME_SIZE]; // Zero padded; files written by older builds may lack the terminator
+    uint64_t fileSize;
+    LevelSection sections[LEVEL_SECTION_COUNT];
+    uint8_t reserved[LEVEL_HEADER_SIZE - 80 - LEVEL_SECTION_COUNT * sizeof(LevelSection)];
+} LevelHeader;
+
+// An open level file. The grid pointers point into data.
+typedef struct LevelFile {
+    void* data;                 // Whole file, mapped copy-on-write; NULL when closed
+    size_t size;
+    const LevelHeader* header;
+    unsigned char* tiles;
+    uint64_t* solid;
+    uint64_t* blocks;
+} LevelFile;
+
+struct Map;
+
+// Maps a level file and checks its header and section table; logs and
+// returns false for anything that does not look like a level of this version
+bool OpenLevel(LevelFile* level, const char* path);
+void CloseLevel(LevelFile* level);
+
+// Reads every section: checksums, tile types, the player start and the
+// acceleration sections against the tiles. Logs each problem it finds.
+bool ValidateLevel(const LevelFile* level);
+
+// Writes the map's grid and player start as a level file
+bool SaveLevel(const struct Map* map, const char* name, const char* path);
+
+#endif // LEVEL_H
@@ -0,0 +1,269 @@
+#include "los.h"
+#include "grid_ray.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOS_HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// One query set up for the tile walk, in tile units
+typedef struct LOSSegment {
+    GridRay ray;        // Tile DDA from the near endpoint
+    float limit;        // Ray length to the far endpoint, 0 when both share a tile
+    int endX, endY;     // Tile of the far endpoint, never tested
+} LOSSegment;
+
+// Sets up the walk of one query. Endpoints in the same tile get a limit of 0
+// and side distances of 0, so the walk answers visible before its first step.
+static void InitLOSSegment(Vector2 from, Vector2 to, LOSSegment* segment) {
+    float ax = from.x / TILE_SIZE;
+    float ay = from.y / TILE_SIZE;
+    segment->endX = (int)floorf(to.x / TILE_SIZE);
+    segment->endY = (int)floorf(to.y / TILE_SIZE);
+    if ((int)ax == segment->endX && (int)ay == segment->endY) {
+        segment->ray = (GridRay){ (int)ax, (int)ay, 1, 1, 0.0f, 0.0f, 1e30f, 1e30f, 0 };
+        segment->limit = 0.0f;
+        return;
+    }
+    
+    float dx = to.x / TILE_SIZE - ax;
+    float dy = to.y / TILE_SIZE - ay;
+    float length = sqrtf(dx * dx + dy * dy);
+    InitGridRay(&segment->ray, ax, ay, dx / length, dy / length);
+    segment->limit = length;
+}
+
+// Tile DDA from the near endpoint until an occupied tile, the far endpoint's
+// tile, or the end of the segment
+static bool WalkLOSSegment(const Map* map, const LOSSegment* segment) {
+    GridRay ray = segment->ray;
+    
+    for (;;) {
+        if (GetGridRayExit(&ray) >= segment->limit) return true;
+        StepGridRay(&ray);
+        if (ray.mapX == segment->endX && ray.mapY == segment->endY) return true;
+        if (IsMapCellSolid(map, ray.mapX, ray.mapY)) return false;
+    }
+}
+
+#ifdef LOS_HAS_X86_KERNELS
+
+// Lane-wise select: mask ? a : b (mask lanes are all ones or all zeros)
+__attribute__((target("sse2")))
+static inline __m128 SelectLanePs(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i SelectLaneEpi32(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// InitLOSSegment for four queries at a time. The square root and the three
+// divisions per query are the bulk of a short query's cost; here they run
+// on four lanes at once, with the same single precision operations in the
+// same order, so the segments are bit for bit the scalar ones. Dividing by
+// TILE_SIZE is a multiplication by its reciprocal, exact for a power of two.
+__attribute__((target("sse2")))
+static void InitLOSSegmentsSSE2(const LOSQuery* queries, int count, LOSSegment* segments) {
+    const __m128 invTile = _mm_set1_ps(1.0f / TILE_SIZE);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 axisEpsilon = _mm_set1_ps(0.0001f);
+    const __m128 farAway = _mm_set1_ps(1e30f);
+    const __m128i oneI = _mm_set1_epi32(1);
+    
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 fromX = _mm_loadu_ps(&queries[i].from.x);
+        __m128 fromY = _mm_loadu_ps(&queries[i + 1].from.x);
+        __m128 toX = _mm_loadu_ps(&queries[i + 2].from.x);
+        __m128 toY = _mm_loadu_ps(&queries[i + 3].from.x);
+        _MM_TRANSPOSE4_PS(fromX, fromY, toX, toY);
+        
+        __m128 ax = _mm_mul_ps(fromX, invTile);
+        __m128 ay = _mm_mul_ps(fromY, invTile);
+        __m128 bx = _mm_mul_ps(toX, invTile);
+        __m128 by = _mm_mul_ps(toY, invTile);
+        
+        // floorf by truncating and stepping down where that rounded up
+        __m128i endX = _mm_cvttps_epi32(bx);
+        __m128i endY = _mm_cvttps_epi32(by);
+        endX = _mm_add_epi32(endX, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(endX), bx)));
+        endY = _mm_add_epi32(endY, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(endY), by)));
+        __m128i mapX = _mm_cvttps_epi32(ax);
+        __m128i mapY = _mm_cvttps_epi32(ay);
+        __m128 sameTile = _mm_castsi128_ps(_mm_and_si128(_mm_cmpeq_epi32(mapX, endX), _mm_cmpeq_epi32(mapY, endY)));
+        
+        __m128 dx = _mm_sub_ps(bx, ax);
+        __m128 dy = _mm_sub_ps(by, ay);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 dirX = _mm_div_ps(dx, length);
+        __m128 dirY = _mm_div_ps(dy, length);
+        
+        // InitGridRay, lane by lane
+        __m128 deltaX = SelectLanePs(_mm_cmplt_ps(_mm_and_ps(dirX, absMask), axisEpsilon), farAway,
+                                     _mm_and_ps(_mm_div_ps(one, dirX), absMask));
+        __m128 deltaY = SelectLanePs(_mm_cmplt_ps(_mm_and_ps(dirY, absMask), axisEpsilon), farAway,
+                                     _mm_and_ps(_mm_div_ps(one, dirY), absMask));
+        __m128 negX = _mm_cmplt_ps(dirX, zero);
+        __m128 negY = _mm_cmplt_ps(dirY, zero);
+        __m128 mapXf = _mm_cvtepi32_ps(mapX);
+        __m128 mapYf = _mm_cvtepi32_ps(mapY);
+        __m128 sideDistX = SelectLanePs(negX, _mm_mul_ps(_mm_sub_ps(ax, mapXf), deltaX),
+                                        _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapXf, one), ax), deltaX));
+        __m128 sideDistY = SelectLanePs(negY, _mm_mul_ps(_mm_sub_ps(ay, mapYf), deltaY),
+                                        _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapYf, one), ay), deltaY));
+        __m128i stepX = SelectLaneEpi32(_mm_castps_si128(negX), _mm_set1_epi32(-1), oneI);
+        __m128i stepY = SelectLaneEpi32(_mm_castps_si128(negY), _mm_set1_epi32(-1), oneI);
+        
+        // Lanes with both endpoints in one tile get the scalar placeholder
+        sideDistX = _mm_andnot_ps(sameTile, sideDistX);
+        sideDistY = _mm_andnot_ps(sameTile, sideDistY);
+        deltaX = SelectLanePs(sameTile, farAway, deltaX);
+        deltaY = SelectLanePs(sameTile, farAway, deltaY);
+        stepX = SelectLaneEpi32(_mm_castps_si128(sameTile), oneI, stepX);
+        stepY = SelectLaneEpi32(_mm_castps_si128(sameTile), oneI, stepY);
+        length = _mm_andnot_ps(sameTile, length);
+        
+        float laneSideX[4], laneSideY[4], laneDeltaX[4], laneDeltaY[4], laneLimit[4];
+        int laneMapX[4], laneMapY[4], laneStepX[4], laneStepY[4], laneEndX[4], laneEndY[4];
+        _mm_storeu_ps(laneSideX, sideDistX);
+        _mm_storeu_ps(laneSideY, sideDistY);
+        _mm_storeu_ps(laneDeltaX, deltaX);
+        _mm_storeu_ps(laneDeltaY, deltaY);
+        _mm_storeu_ps(laneLimit, length);
+        _mm_storeu_si128((__m128i*)laneMapX, mapX);
+        _mm_storeu_si128((__m128i*)laneMapY, mapY);
+        _mm_storeu_si128((__m128i*)laneStepX, stepX);
+        _mm_storeu_si128((__m128i*)laneStepY, stepY);
+        _mm_storeu_si128((__m128i*)laneEndX, endX);
+        _mm_storeu_si128((__m128i*)laneEndY, endY);
+        for (int lane = 0; lane < 4; lane++) {
+            segments[i + lane] = (LOSSegment){
+                { laneMapX[lane], laneMapY[lane], laneStepX[lane], laneStepY[lane], laneSideX[lane], laneSideY[lane],
+                  laneDeltaX[lane], laneDeltaY[lane], 0 },
+                laneLimit[lane], laneEndX[lane], laneEndY[lane]
+            };
+        }
+    }
+    
+    for (; i < count; i++) {
+        InitLOSSegment(queries[i].from, queries[i].to, &segments[i]);
+    }
+}
+
+#endif // LOS_HAS_X86_KERNELS
+
+// The scalar kernel sets up and walks one query at a time, the SSE2 kernel
+// sets up all of them first. count is at most LOS_BATCH_SIZE.
+static void AnswerLOSQueries(const Map* map, const LOSQuery* queries, int count, bool* visible, LOSKernel kernel) {
+#ifdef LOS_HAS_X86_KERNELS
+    if (kernel == LOS_KERNEL_SSE2) {
+        LOSSegment segments[LOS_BATCH_SIZE];
+        InitLOSSegmentsSSE2(queries, count, segments);
+        for (int i = 0; i < count; i++) {
+            visible[i] = WalkLOSSegment(map, &segments[i]);
+        }
+        return;
+    }
+#else
+    (void)kernel;
+#endif
+    
+    for (int i = 0; i < count; i++) {
+        LOSSegment segment;
+        InitLOSSegment(queries[i].from, queries[i].to, &segment);
+        visible[i] = WalkLOSSegment(map, &segment);
+    }
+}
+
+bool IsLOSKernelSupported(LOSKernel kernel) {
+    switch (kernel) {
+        case LOS_KERNEL_SCALAR: return true;
+#ifdef LOS_HAS_X86_KERNELS
+        case LOS_KERNEL_SSE2:   return __builtin_cpu_supports("sse2");
+#endif
+        default:                return false;
+    }
+}
+
+LOSKernel GetBestLOSKernel(void) {
+    return IsLOSKernelSupported(LOS_KERNEL_SSE2) ? LOS_KERNEL_SSE2 : LOS_KERNEL_SCALAR;
+}
+
+const char* GetLOSKernelName(LOSKernel kernel) {
+    switch (kernel) {
+        case LOS_KERNEL_SCALAR: return "scalar";
+        case LOS_KERNEL_SSE2:   return "sse2";
+        default:                return "unknown";
+    }
+}
+
+bool HasLineOfSight(const Map* map, Vector2 from, Vector2 to) {
+    LOSSegment segment;
+    InitLOSSegment(from, to, &segment);
+    return WalkLOSSegment(map, &segment);
+}
+
+// Shared state for one batch
+typedef struct LOSJob {
+    const Map* map;
+    const LOSQuery* queries;
+    int count;
+    bool* visible;
+    LOSKernel kernel;
+    LOSStats threadStats[MAX_WORKER_THREADS];
+} LOSJob;
+
+// Runs one job's slice of queries and counts what it saw
+static void RunLOSJob(void* userData, int jobIndex, int threadIndex) {
+    LOSJob* job = (LOSJob*)userData;
+    LOSStats* stats = &job->threadStats[threadIndex];
+    
+    int start = jobIndex * LOS_BATCH_SIZE;
+    int end = start + LOS_BATCH_SIZE;
+    if (end > job->count) end = job->count;
+    
+    AnswerLOSQueries(job->map, job->queries + start, end - start, job->visible + start, job->kernel);
+    
+    stats->queries += end - start;
+    for (int i = start; i < end; i++) {
+        stats->visible += job->visible[i];
+    }
+}
+
+void CheckLineOfSight(const Map* map, const LOSQuery* queries, int count, bool* visible, LOSKernel kernel,
+                      WorkerPool* pool, LOSStats* stats) {
+    if (stats != NULL) memset(stats, 0, sizeof(*stats));
+    if (count <= 0) return;
+    if (!IsLOSKernelSupported(kernel)) kernel = LOS_KERNEL_SCALAR;
+    
+    LOSJob job;
+    job.map = map;
+    job.queries = queries;
+    job.count = count;
+    job.visible = visible;
+    job.kernel = kernel;
+    int threadCount = (pool != NULL) ? pool->threadCount : 1;
+    memset(job.threadStats, 0, (size_t)threadCount * sizeof(LOSStats));
+    
+    int jobCount = (count + LOS_BATCH_SIZE - 1) / LOS_BATCH_SIZE;
+    if (pool == NULL || jobCount == 1) {
+        threadCount = 1;
+        for (int j = 0; j < jobCount; j++) {
+            RunLOSJob(&job, j, 0);
+        }
+    } else {
+        RunWorkerJobs(pool, RunLOSJob, &job, jobCount);
+    }
+    
+    if (stats == NULL) return;
+    for (int t = 0; t < threadCount; t++) {
+        stats->queries += job.threadStats[t].queries;
+        stats->visible += job.threadStats[t].visible;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef LOS_H
+#define LOS_H
+
+#include "raylib.h"
+#include "map.h"
+#include "../Core/worker_pool.h"
+
+// Line-of-sight queries for AI perception, hitscan and sound occlusion.
+//
+// A segment is visible when no occupied tile lies on it, using the same
+// occupancy and grid DDA as the raycaster, so an enemy sees the player exactly
+// when the renderer would show it. A door blocks sight until it is fully
+// open. The tiles holding the two endpoints are ignored, so agents standing
+// in doorways still see and are seen.
+//
+// Each query is one tile DDA from the near endpoint, the same walk as a
+// plain single query. Most queries a tick asks for (enemies looking at the
+// player) are a few tiles long, so setting up the walk (a square root and
+// three divisions) costs about as much as walking it; the SSE2 kernel sets up
+// four queries at a time before walking them one by one.
+
+#define LOS_BATCH_SIZE 256 // Queries per worker job
+
+typedef struct LOSQuery {
+    Vector2 from;   // World units
+    Vector2 to;
+} LOSQuery;
+
+// Query setup kernels; both give the answers of a plain tile DDA
+typedef enum {
+    LOS_KERNEL_SCALAR,
+    LOS_KERNEL_SSE2,
+    LOS_KERNEL_COUNT
+} LOSKernel;
+
+// What a batch saw
+typedef struct LOSStats {
+    int queries;
+    int visible;
+} LOSStats;
+
+bool IsLOSKernelSupported(LOSKernel kernel);
+LOSKernel GetBestLOSKernel(void);    // Fastest supported kernel, SSE2 on x86
+const char* GetLOSKernelName(LOSKernel kernel);
+
+// Single query
+bool HasLineOfSight(const Map* map, Vector2 from, Vector2 to);
+
+// Answers count queries into visible[]. Jobs of LOS_BATCH_SIZE queries run on
+// the pool's threads; pass NULL to run on the calling thread. stats may be NULL.
+void CheckLineOfSight(const Map* map, const LOSQuery* queries, int count, bool* visible, LOSKernel kernel,
+                      WorkerPool* pool, LOSStats* stats);
+
+#endif // LOS_H
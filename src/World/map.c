@@ -1,8 +1,15 @@
 #include "map.h"
+#include "map_stream.h"
+#include "pvs.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAP_WIDTH 24
+#define TEST_MAP_HEIGHT 24
 
 // A more detailed test map with different wall types
-const int TEST_MAP[MAP_HEIGHT][MAP_WIDTH] = {
+const unsigned char TEST_MAP[TEST_MAP_HEIGHT][TEST_MAP_WIDTH] = {
     {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
     {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1},
     {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1},
@@ -29,14 +36,45 @@ const int TEST_MAP[MAP_HEIGHT][MAP_WIDTH] = {
     {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1}
 };
 
-void InitMap(Map* map) {
-    // Initialize map texture flag
+void InitMap(Map* map, const char* levelPath) {
+    // Build the grid and wall images on the CPU first
+    InitMapHeadless(map, levelPath);
+    
+    // The GPU path draws every wall from one atlas texture
+    map->wallAtlasHandle = AcquireImageAtlas(map->wallHandles, 8, RESOURCE_ATLAS);
+    map->wallAtlas = GetResourceTexture(map->wallAtlasHandle);
+    map->hasGPUResources = true;
+    
+    // Build the CPU tile image and upload it as the map texture; a streamed
+    // level shows the chunks around the player, and redraws as they move
+    RebuildMapImage(map);
+    UpdateMapGPUTexture(map);
+    
+    // Level-compile step: precompute what every tile can see
+    if (map->width * map->height <= PVS_MAX_LOAD_TILES) {
+        BuildMapPVS(map, NULL);
+    } else {
+        TraceLog(LOG_INFO, "Skipping the PVS for a %dx%d map", map->width, map->height);
+    }
+}
+
+void InitMapHeadless(Map* map, const char* levelPath) {
+    // Initialize map texture flags
+    map->tileImage = (Image){ 0 };
     map->isMapTextureInitialized = false;
+    map->hasGPUResources = false;
+    map->wallAtlasHandle = 0;
+    map->wallAtlas = (Texture2D){ 0 };
+    
+    // Map the level file if there is one, else copy the test map to the grid
+    bool loaded = levelPath != NULL && LoadMapGrid(map, levelPath);
+    if (levelPath != NULL && !loaded) TraceLog(LOG_WARNING, "Falling back to the built-in map");
     
-    // Copy test map to map grid
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            map->grid[x][y] = TEST_MAP[y][x];
+    if (!loaded && InitMapGrid(map, TEST_MAP_WIDTH, TEST_MAP_HEIGHT)) {
+        for (int y = 0; y < TEST_MAP_HEIGHT; y++) {
+            for (int x = 0; x < TEST_MAP_WIDTH; x++) {
+                SetMapTile(map, x, y, TEST_MAP[y][x]);
+            }
         }
     }
     
@@ -55,125 +93,479 @@ void InitMap(Map* map) {
             case 7: color1 = SKYBLUE; color2 = DARKBLUE; break;
         }
         
-        Image img;
+        // Different patterns for different walls: checkerboards of 8, 16 and 32 pixel squares
+        ImageRecipe recipe = { IMAGE_RECIPE_CHECKED, 64, 64, 8 << (i % 3), { 0, 0, 0, 0 }, color1, color2 };
+        map->wallHandles[i] = AcquireGeneratedImage(&recipe, RESOURCE_WALL);
         
-        // Create different patterns for different walls - use variations of checkerboard
-        if (i % 3 == 0) {
-            img = GenImageChecked(64, 64, 8, 8, color1, color2);
-        } else if (i % 3 == 1) {
-            img = GenImageChecked(64, 64, 16, 16, color1, color2);
-        } else {
-            img = GenImageChecked(64, 64, 32, 32, color1, color2);
+        // The software renderer samples the shared image directly
+        const Image* image = GetResourceImage(map->wallHandles[i]);
+        map->wallImages[i] = (image != NULL) ? *image : (Image){ 0 };
+    }
+}
+
+// Empty grid state shared by InitMapGrid and LoadMapGrid
+static void ResetMapGrid(Map* map) {
+    map->width = 0;
+    map->height = 0;
+    map->tiles = NULL;
+    map->solid = NULL;
+    map->blocks = NULL;
+    map->solidX = map->solidY = 0;
+    map->solidWidth = map->solidHeight = 0;
+    map->blocksX = map->blocksY = 0;
+    map->level = (LevelFile){ 0 };
+    map->stream = NULL;
+    map->playerStart = (Vector2){ 2.5f, 2.5f };
+    map->playerStartAngle = 0.0f;
+    map->revision = 0;
+    map->activeDoorCount = 0;
+    map->doorVersion = 0;
+    map->pvs = NULL;
+    map->dirtyMinX = map->dirtyMinY = 0;
+    map->dirtyMaxX = map->dirtyMaxY = -1;
+}
+
+bool InitMapGrid(Map* map, int width, int height) {
+    ResetMapGrid(map);
+    
+    if (width <= 0 || height <= 0 || width > MAP_MAX_SIZE || height > MAP_MAX_SIZE) {
+        TraceLog(LOG_WARNING, "Invalid map size %dx%d (max %d)", width, height, MAP_MAX_SIZE);
+        return false;
+    }
+    
+    size_t tileCount = (size_t)width * (size_t)height;
+    map->tiles = (unsigned char*)calloc(tileCount, 1);
+    map->solid = (uint64_t*)calloc((tileCount + 63) / 64, sizeof(uint64_t));
+    
+    // Blocks hanging over the right or bottom edge get their outside tiles
+    // marked solid, matching out of bounds tiles everywhere else
+    int blocksX = (width + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    int blocksY = (height + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    map->blocks = (uint64_t*)calloc((size_t)blocksX * blocksY, sizeof(uint64_t));
+    
+    if (map->tiles == NULL || map->solid == NULL || map->blocks == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate %dx%d map", width, height);
+        free(map->tiles);
+        free(map->solid);
+        free(map->blocks);
+        map->tiles = NULL;
+        map->solid = NULL;
+        map->blocks = NULL;
+        return false;
+    }
+    
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            uint64_t outside = 0;
+            for (int i = 0; i < MAP_BLOCK_SIZE * MAP_BLOCK_SIZE; i++) {
+                int x = (bx << MAP_BLOCK_SHIFT) + (i & (MAP_BLOCK_SIZE - 1));
+                int y = (by << MAP_BLOCK_SHIFT) + (i >> MAP_BLOCK_SHIFT);
+                if (x >= width || y >= height) outside |= 1ull << i;
+            }
+            map->blocks[by * blocksX + bx] = outside;
         }
-        
-        map->wallTextures[i] = LoadTextureFromImage(img);
-        UnloadImage(img);
     }
     
-    // Initialize GPU map texture
-    UpdateMapGPUTexture(map);
+    map->width = width;
+    map->height = height;
+    map->solidWidth = width;
+    map->solidHeight = height;
+    map->blocksX = blocksX;
+    map->blocksY = blocksY;
+    return true;
+}
+
+bool LoadMapGrid(Map* map, const char* path) {
+    ResetMapGrid(map);
+    
+    double start = GetTime();
+    if (!OpenLevel(&map->level, path)) return false;
+    
+    // Too big to keep whole: page chunks in around the player instead
+    const LevelHeader* header = map->level.header;
+    if ((int64_t)header->width * header->height > MAP_STREAM_MIN_TILES) {
+        CloseLevel(&map->level);
+        return StreamMapGrid(map, path);
+    }
+    
+    // The file holds the grid arrays exactly as the map uses them
+    map->tiles = map->level.tiles;
+    map->solid = map->level.solid;
+    map->blocks = map->level.blocks;
+    map->width = header->width;
+    map->height = header->height;
+    map->solidWidth = map->width;
+    map->solidHeight = map->height;
+    map->blocksX = (map->width + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    map->blocksY = (map->height + MAP_BLOCK_SIZE - 1) >> MAP_BLOCK_SHIFT;
+    map->playerStart = (Vector2){ header->startX, header->startY };
+    map->playerStartAngle = header->startAngle;
+    
+    TraceLog(LOG_INFO, "Loaded level '%.*s' (%dx%d) from %s in %.2f ms", LEVEL_NAME_SIZE, header->name,
+             map->width, map->height, path, (GetTime() - start) * 1000.0);
+    return true;
+}
+
+bool StreamMapGrid(Map* map, const char* path) {
+    ResetMapGrid(map);
+    
+    double start = GetTime();
+    LevelFile level;
+    if (!OpenLevel(&level, path)) return false;
+    
+    // Only the header is needed here, the loader reads chunks straight from the file
+    const LevelHeader* header = level.header;
+    char name[LEVEL_NAME_SIZE + 1] = { 0 };
+    memcpy(name, header->name, LEVEL_NAME_SIZE);
+    uint64_t tilesOffset = header->sections[LEVEL_SECTION_TILES].offset;
+    map->width = header->width;
+    map->height = header->height;
+    map->playerStart = (Vector2){ header->startX, header->startY };
+    map->playerStartAngle = header->startAngle;
+    CloseLevel(&level);
+    
+    if (!InitMapStream(map, path, tilesOffset)) {
+        ResetMapGrid(map);
+        return false;
+    }
+    
+    TraceLog(LOG_INFO, "Streaming level '%s' (%dx%d) from %s, start area loaded in %.2f ms", name,
+             map->width, map->height, path, (GetTime() - start) * 1000.0);
+    return true;
+}
+
+void UnloadMapGrid(Map* map) {
+    // The PVS describes this grid, so it goes with it
+    if (map->pvs != NULL) {
+        UnloadPVS(map->pvs);
+        free(map->pvs);
+        map->pvs = NULL;
+    }
+    
+    if (map->stream != NULL) {
+        UnloadMapStream(map);
+    } else if (map->level.data != NULL) {
+        CloseLevel(&map->level);
+    } else {
+        free(map->tiles);
+        free(map->solid);
+        free(map->blocks);
+    }
+    map->tiles = NULL;
+    map->solid = NULL;
+    map->blocks = NULL;
+    map->width = 0;
+    map->height = 0;
+    map->solidX = map->solidY = 0;
+    map->solidWidth = map->solidHeight = 0;
+    map->blocksX = map->blocksY = 0;
 }
 
 void UnloadMap(Map* map) {
-    // Unload all wall textures
+    // Free the tile grid
+    UnloadMapGrid(map);
+    
+    // Hand the wall images and the atlas back to the resource manager
     for (int i = 0; i < 8; i++) {
-        UnloadTexture(map->wallTextures[i]);
+        ReleaseResource(map->wallHandles[i]);
+        map->wallHandles[i] = 0;
+        map->wallImages[i] = (Image){ 0 };
     }
+    ReleaseResource(map->wallAtlasHandle);
+    map->wallAtlasHandle = 0;
+    map->wallAtlas = (Texture2D){ 0 };
     
     // Unload map texture if initialized
     if (map->isMapTextureInitialized) {
-        UnloadRenderTexture(map->mapTexture);
+        UnloadTexture(map->mapTexture);
+    }
+    if (map->tileImage.data != NULL) {
+        UnloadImage(map->tileImage);
+        map->tileImage = (Image){ 0 };
+    }
+}
+
+// Records a change for incremental consumers (meshes, caches, ...)
+void LogMapRegion(Map* map, int x, int y, int width, int height) {
+    map->changeLog[map->revision % MAP_CHANGE_LOG_SIZE] = (MapChange){ x, y, width, height };
+    map->revision++;
+}
+
+static void LogMapChange(Map* map, int x, int y) {
+    LogMapRegion(map, x, y, 1, 1);
+}
+
+static int FindActiveDoor(const Map* map, int x, int y) {
+    for (int i = 0; i < map->activeDoorCount; i++) {
+        if (map->activeDoors[i].x == x && map->activeDoors[i].y == y) return i;
     }
+    return -1;
+}
+
+static void RemoveActiveDoor(Map* map, int index) {
+    map->activeDoors[index] = map->activeDoors[--map->activeDoorCount];
 }
 
 void UpdateMap(Map* map, float deltaTime) {
-    // This would handle door animations, etc.
-    // For now, we don't have any animations
+    // Only moving doors are visited, however many doors the map has
+    if (map->activeDoorCount > 0) map->doorVersion++;
+    for (int i = 0; i < map->activeDoorCount;) {
+        MapDoor* door = &map->activeDoors[i];
+        door->open += door->speed * deltaTime;
+        if (door->open > 0.0f && door->open < 1.0f) {
+            i++;
+            continue;
+        }
+        
+        // Settled: leave the active list, then hand the tile back to the grid
+        MapDoor settled = *door;
+        RemoveActiveDoor(map, i);
+        if (settled.open >= 1.0f) {
+            SetMapTile(map, settled.x, settled.y, TILE_DOOR_OPEN);
+        } else {
+            // Still a TILE_DOOR, but static geometry draws it again
+            LogMapChange(map, settled.x, settled.y);
+        }
+    }
+    
+    // Spread recomputation of visibility invalidated by tile changes over frames
+    UpdatePVS(map->pvs, map, PVS_REBUILD_BUDGET);
+}
+
+bool ToggleDoor(Map* map, int x, int y) {
+    int tile = GetMapTile(map, x, y);
+    if (tile != TILE_DOOR && tile != TILE_DOOR_OPEN) return false;
+    
+    int index = FindActiveDoor(map, x, y);
+    if (index >= 0) {
+        map->activeDoors[index].speed = -map->activeDoors[index].speed;
+        return true;
+    }
     
-    // Avoid unused parameter warnings
-    (void)map;
-    (void)deltaTime;
+    if (map->activeDoorCount == MAP_MAX_ACTIVE_DOORS) {
+        TraceLog(LOG_WARNING, "Too many moving doors, door at %d,%d stays put", x, y);
+        return false;
+    }
     
-    // TODO: Animate doors and update map texture if needed
+    if (tile == TILE_DOOR_OPEN) {
+        // Solid again from the first moment it starts closing
+        map->activeDoors[map->activeDoorCount++] = (MapDoor){ x, y, 1.0f, -DOOR_MOVE_SPEED };
+        SetMapTile(map, x, y, TILE_DOOR);
+    } else {
+        map->activeDoors[map->activeDoorCount++] = (MapDoor){ x, y, 0.0f, DOOR_MOVE_SPEED };
+        LogMapChange(map, x, y);
+    }
+    return true;
+}
+
+const MapDoor* GetActiveDoor(const Map* map, int x, int y) {
+    int index = FindActiveDoor(map, x, y);
+    return (index >= 0) ? &map->activeDoors[index] : NULL;
 }
 
-int GetMapTile(Map map, int x, int y) {
+bool IsDoorVertical(const Map* map, int x, int y) {
+    return IsTileTypeSolid(GetMapTile(map, x, y - 1)) && IsTileTypeSolid(GetMapTile(map, x, y + 1));
+}
+
+int GetMapTile(const Map* map, int x, int y) {
     // Boundary check
-    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+    if (x < 0 || x >= map->width || y < 0 || y >= map->height) {
         return TILE_WALL; // Treat out of bounds as walls
     }
     
-    return map.grid[x][y];
+    if (map->stream != NULL) return GetStreamedTile(map->stream, x, y);
+    return map->tiles[y * map->width + x];
 }
 
-bool IsWall(Map map, float x, float y) {
+bool IsWall(const Map* map, float x, float y) {
     // Convert world coordinates to map coordinates
     int mapX = (int)(x / TILE_SIZE);
     int mapY = (int)(y / TILE_SIZE);
     
     // Check if position is inside a wall
     int tileType = GetMapTile(map, mapX, mapY);
-    return tileType == TILE_WALL || tileType == TILE_SECRET_WALL || tileType == TILE_OBSTACLE;
+    return tileType == TILE_WALL || tileType == TILE_DOOR || tileType == TILE_SECRET_WALL || tileType == TILE_OBSTACLE;
 }
 
-bool IsDoor(Map map, int x, int y) {
+bool IsDoor(const Map* map, int x, int y) {
     return GetMapTile(map, x, y) == TILE_DOOR;
 }
 
 void SetMapTile(Map* map, int x, int y, int value) {
     // Boundary check
-    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
+    if (x < 0 || x >= map->width || y < 0 || y >= map->height) {
         return;
     }
     
-    map->grid[x][y] = value;
+    // A streamed chunk that is not resident is read back from the file later,
+    // so a change to it would be lost; it is solid until then anyway
+    unsigned char* tile = (map->stream != NULL) ? EditStreamedTile(map->stream, x, y) : &map->tiles[y * map->width + x];
+    if (tile == NULL) return;
     
-    // Update the GPU texture when map changes
-    UpdateMapGPUTexture(map);
+    int previous = *tile;
+    if (previous == value) return;
+    *tile = (unsigned char)value;
+    
+    // A door replaced by something else stops moving
+    if (previous == TILE_DOOR) {
+        int door = FindActiveDoor(map, x, y);
+        if (door >= 0) RemoveActiveDoor(map, door);
+    }
+    
+    LogMapChange(map, x, y);
+    
+    // The PVS sees through doors, so opening or closing one leaves it valid
+    bool doorToggle = (previous == TILE_DOOR && value == TILE_DOOR_OPEN) || (previous == TILE_DOOR_OPEN && value == TILE_DOOR);
+    if (!doorToggle) InvalidatePVSTile(map->pvs, x, y);
+    
+    // Keep the occupancy bits in sync; a streamed tile that can be edited is
+    // inside their window, and the window starts on a block boundary
+    int cellX = x - map->solidX;
+    int cellY = y - map->solidY;
+    int index = cellY * map->solidWidth + cellX;
+    uint64_t bit = 1ull << (index & 63);
+    uint64_t* block = &map->blocks[(cellY >> MAP_BLOCK_SHIFT) * map->blocksX + (cellX >> MAP_BLOCK_SHIFT)];
+    uint64_t blockBit = 1ull << (((y & (MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_SHIFT) | (x & (MAP_BLOCK_SIZE - 1)));
+    if (IsTileTypeSolid(value)) {
+        map->solid[index >> 6] |= bit;
+        *block |= blockBit;
+    } else {
+        map->solid[index >> 6] &= ~bit;
+        *block &= ~blockBit;
+    }
+    
+    UpdateMapImage(map, x, y, 1, 1);
+}
+
+bool BuildMapPVS(Map* map, WorkerPool* pool) {
+    if (map->pvs == NULL) {
+        map->pvs = calloc(1, sizeof(PVS));
+        if (map->pvs == NULL) return false;
+    } else {
+        UnloadPVS(map->pvs);
+    }
+    
+    double start = GetTime();
+    if (!BuildPVS(map->pvs, map, pool)) {
+        free(map->pvs);
+        map->pvs = NULL;
+        return false;
+    }
+    
+    TraceLog(LOG_INFO, "Built PVS for %dx%d map in %.1f ms", map->width, map->height, (GetTime() - start) * 1000.0);
+    return true;
+}
+
+const MapChange* GetMapChange(const Map* map, unsigned int revision) {
+    // Unsigned arithmetic keeps this correct across revision wrap-around
+    unsigned int age = map->revision - revision;
+    if (age == 0 || age > MAP_CHANGE_LOG_SIZE) return NULL;
+    
+    return &map->changeLog[revision % MAP_CHANGE_LOG_SIZE];
+}
+
+void RebuildMapImage(Map* map) {
+    if (!map->hasGPUResources) return;
+    
+    // A streamed level's window can change size with its radius; the texture
+    // then has to be created again at the new size
+    if (map->tileImage.width != map->solidWidth || map->tileImage.height != map->solidHeight) {
+        if (map->tileImage.data != NULL) UnloadImage(map->tileImage);
+        if (map->isMapTextureInitialized) UnloadTexture(map->mapTexture);
+        map->isMapTextureInitialized = false;
+        map->tileImage = GenImageColor(map->solidWidth, map->solidHeight, BLACK);
+    }
+    
+    UpdateMapImage(map, map->solidX, map->solidY, map->solidWidth, map->solidHeight);
+}
+
+// Patches the tile image now and grows the dirty rectangle; the GPU copy is
+// updated once per frame by UpdateMapGPUTexture however many tiles changed
+void UpdateMapImage(Map* map, int x, int y, int width, int height) {
+    if (map->tileImage.data == NULL) return;
+    
+    // Image pixels, clipped to the image
+    int x0 = (x > map->solidX) ? x - map->solidX : 0;
+    int y0 = (y > map->solidY) ? y - map->solidY : 0;
+    int x1 = (x + width - map->solidX < map->tileImage.width) ? x + width - map->solidX : map->tileImage.width;
+    int y1 = (y + height - map->solidY < map->tileImage.height) ? y + height - map->solidY : map->tileImage.height;
+    if (x0 >= x1 || y0 >= y1) return;
+    
+    Color* pixels = (Color*)map->tileImage.data;
+    for (int py = y0; py < y1; py++) {
+        for (int px = x0; px < x1; px++) {
+            pixels[py * map->tileImage.width + px] = GetMapTileColor(GetMapTile(map, map->solidX + px, map->solidY + py));
+        }
+    }
+    
+    if (map->dirtyMaxX < map->dirtyMinX) {
+        map->dirtyMinX = x0;
+        map->dirtyMinY = y0;
+        map->dirtyMaxX = x1 - 1;
+        map->dirtyMaxY = y1 - 1;
+    } else {
+        if (x0 < map->dirtyMinX) map->dirtyMinX = x0;
+        if (y0 < map->dirtyMinY) map->dirtyMinY = y0;
+        if (x1 - 1 > map->dirtyMaxX) map->dirtyMaxX = x1 - 1;
+        if (y1 - 1 > map->dirtyMaxY) map->dirtyMaxY = y1 - 1;
+    }
 }
 
 void UpdateMapGPUTexture(Map* map) {
-    // Create or update the GPU texture for the map
+    if (!map->hasGPUResources || map->tileImage.data == NULL) return;
+    
+    // First call uploads the whole tile image
     if (!map->isMapTextureInitialized) {
-        map->mapTexture = LoadRenderTexture(MAP_WIDTH, MAP_HEIGHT);
+        map->mapTexture = LoadTextureFromImage(map->tileImage);
         map->isMapTextureInitialized = true;
+        map->dirtyMinX = map->dirtyMinY = 0;
+        map->dirtyMaxX = map->dirtyMaxY = -1;
+        return;
     }
     
-    // Begin drawing to the texture
-    BeginTextureMode(map->mapTexture);
-    
-    // Clear with black
-    ClearBackground(BLACK);
-    
-    // Draw each tile as a colored pixel
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            Color color;
-            
-            switch (map->grid[x][y]) {
-                case TILE_EMPTY:
-                    color = BLACK;
-                    break;
-                case TILE_WALL:
-                    color = WHITE;
-                    break;
-                case TILE_DOOR:
-                    color = RED;
-                    break;
-                case TILE_SECRET_WALL:
-                    color = GREEN;
-                    break;
-                case TILE_OBSTACLE:
-                    color = BLUE;
-                    break;
-                default:
-                    color = PURPLE;
-                    break;
-            }
-            
-            DrawPixel(x, y, color);
+    if (map->dirtyMaxX < map->dirtyMinX) return;
+    
+    int rectWidth = map->dirtyMaxX - map->dirtyMinX + 1;
+    int rectHeight = map->dirtyMaxY - map->dirtyMinY + 1;
+    const Color* pixels = (const Color*)map->tileImage.data;
+    Rectangle rect = { (float)map->dirtyMinX, (float)map->dirtyMinY, (float)rectWidth, (float)rectHeight };
+    
+    if (rectWidth == map->tileImage.width) {
+        // Full rows are already contiguous in the tile image
+        UpdateTextureRec(map->mapTexture, rect, pixels + map->dirtyMinY * map->tileImage.width);
+    } else {
+        // Pack the dirty rectangle so only changed tiles are uploaded
+        Color* packed = malloc((size_t)rectWidth * rectHeight * sizeof(Color));
+        if (packed == NULL) return; // Stay dirty and retry next frame
+        
+        for (int y = 0; y < rectHeight; y++) {
+            memcpy(packed + y * rectWidth,
+                   pixels + (map->dirtyMinY + y) * map->tileImage.width + map->dirtyMinX,
+                   rectWidth * sizeof(Color));
         }
+        UpdateTextureRec(map->mapTexture, rect, packed);
+        free(packed);
     }
     
-    EndTextureMode();
+    map->dirtyMinX = map->dirtyMinY = 0;
+    map->dirtyMaxX = map->dirtyMaxY = -1;
+}
+
+Color GetMapTileColor(int tile) {
+    switch (tile) {
+        case TILE_EMPTY:
+            return BLACK;
+        case TILE_WALL:
+            return WHITE;
+        case TILE_DOOR:
+            return RED;
+        case TILE_SECRET_WALL:
+            return GREEN;
+        case TILE_OBSTACLE:
+            return BLUE;
+        case TILE_DOOR_OPEN:
+            return MAROON;
+        default:
+            return PURPLE;
+    }
 }
\ No newline at end of file
@@ -2,9 +2,11 @@
 #define MAP_H
 
 #include "raylib.h"
+#include "level.h"
+#include "../Core/resources.h"
+#include <stdint.h>
 
-#define MAP_WIDTH 24
-#define MAP_HEIGHT 24
+#define MAP_MAX_SIZE 4096 // Largest supported width/height in tiles
 #define TILE_SIZE 64.0f
 
 // Map tile types
@@ -13,6 +15,7 @@
 #define TILE_DOOR 2
 #define TILE_SECRET_WALL 3
 #define TILE_OBSTACLE 4
+#define TILE_DOOR_OPEN 5 // Fully open door: passable and transparent until it closes again
 
 // Direction constants
 #define NORTH 0
@@ -20,28 +23,131 @@
 #define SOUTH 2
 #define WEST 3
 
-typedef struct {
-    int x, y;           // Position in grid
-    int type;           // Type of tile
-    int textureID;      // Texture ID for walls
-    bool isAnimated;    // Whether this tile should be animated (e.g., doors)
-    float animState;    // Animation state (0.0 to 1.0)
-} MapTile;
+// Coarse occupancy blocks are 8x8 tiles, so one block fits a uint64_t
+#define MAP_BLOCK_SHIFT 3
+#define MAP_BLOCK_SIZE (1 << MAP_BLOCK_SHIFT)
 
+// Number of recent tile changes kept for consumers that update incrementally
+#define MAP_CHANGE_LOG_SIZE 256
+
+#define MAP_MAX_ACTIVE_DOORS 64 // Doors that can be moving at the same time
+#define DOOR_MOVE_SPEED 1.0f    // Tile widths a door slides per second
+
+// One SetMapTile call that changed a tile, or a whole region that changed at
+// once (a streamed chunk arriving or leaving)
+typedef struct MapChange {
+    int x, y;
+    int width, height;  // 1 x 1 for a single tile
+} MapChange;
+
+struct PVS;
+struct WorkerPool;
+struct MapStream;
+
+// A door that is opening or closing. Closed doors are plain TILE_DOOR tiles
+// and fully open ones TILE_DOOR_OPEN tiles, so only moving doors cost anything
+// per tick. The door slab sits recessed in the middle of its tile and slides
+// sideways into the wall; `open` is how far it has slid, in tile widths.
+typedef struct MapDoor {
+    int x, y;
+    float open;         // 0 = closed, 1 = fully open
+    float speed;        // Signed: positive while opening, negative while closing
+} MapDoor;
+
+// Tile grid sized at load time. Tiles are stored one byte each in row-major
+// order (tiles[y * width + x]), which matches how rays and collision walk the
+// grid. The solid bitset mirrors it with one bit per tile (bit y * width + x)
+// set for every non-empty tile, i.e. everything that stops a ray. The block
+// grid holds the same bits regrouped per 8x8 tiles, so a traversal can skip a
+// whole empty block with one test.
+//
+// Very large levels are streamed instead (see map_stream.h): tiles is NULL,
+// the tile types of the chunks around the player live in the stream's cache
+// and every tile outside them reads as a wall. The occupancy bits then only
+// cover a window of chunks around the player (solidWidth x solidHeight tiles
+// from solidX, solidY) and everything outside it counts as solid, so rays,
+// sight lines and collision stop at the edge of what is loaded.
 typedef struct Map {
-    int grid[MAP_WIDTH][MAP_HEIGHT];
-    Texture2D wallTextures[8]; // Different wall textures
-    RenderTexture2D mapTexture; // GPU texture representation of the map
+    int width;                 // Grid size in tiles
+    int height;
+    unsigned char* tiles;      // width * height tile types, NULL when streamed (use GetMapTile)
+    uint64_t* solid;           // Occupancy bitset, (solidWidth * solidHeight + 63) / 64 words
+    uint64_t* blocks;          // Occupancy per 8x8 block, bit (y & 7) * 8 + (x & 7)
+    int solidX, solidY;        // First tile the occupancy bits cover, 0, 0 unless streamed
+    int solidWidth, solidHeight; // Tiles they cover, the whole grid unless streamed
+    int blocksX, blocksY;      // Block grid size
+    LevelFile level;           // Level file the grid arrays live in, level.data == NULL when heap allocated
+    struct MapStream* stream;  // Chunk cache of a streamed level, NULL otherwise
+    Vector2 playerStart;       // In tiles
+    float playerStartAngle;    // Radians
+    unsigned int revision;     // Bumped by every tile change
+    MapChange changeLog[MAP_CHANGE_LOG_SIZE]; // changeLog[r % size] took the map from revision r to r + 1
+    MapDoor activeDoors[MAP_MAX_ACTIVE_DOORS]; // Moving doors, in no particular order
+    int activeDoorCount;
+    unsigned int doorVersion;  // Bumped whenever a moving door advances
+    struct PVS* pvs;           // Potentially visible set, NULL until BuildMapPVS
+    Image wallImages[8];       // CPU copies of the wall textures (RGBA8, for software rendering), owned by wallHandles
+    ResourceHandle wallHandles[8];
+    Texture2D wallAtlas;       // The wall textures side by side, for the GPU path
+    ResourceHandle wallAtlasHandle;
+    Image tileImage;           // CPU side of mapTexture, one RGBA8 pixel per tile of the occupancy window
+    Texture2D mapTexture;      // GPU texture representation of the map
+    int dirtyMinX, dirtyMinY;  // Pixels changed since the last upload (empty when max < min)
+    int dirtyMaxX, dirtyMaxY;
     bool isMapTextureInitialized;
+    bool hasGPUResources;      // False when initialized headless (no textures uploaded)
 } Map;
 
-void InitMap(Map* map);
+void InitMap(Map* map, const char* levelPath);         // levelPath NULL = built-in test map
+void InitMapHeadless(Map* map, const char* levelPath); // Grid and wall images only, no GPU calls
+bool InitMapGrid(Map* map, int width, int height); // Allocates an empty width x height grid
+bool LoadMapGrid(Map* map, const char* path);      // Maps a level file's grid instead (see level.h), streams big ones
+bool StreamMapGrid(Map* map, const char* path);    // Streams a level file's grid whatever its size
+void UnloadMapGrid(Map* map);                      // Frees or unmaps the grid, keeps textures
 void UnloadMap(Map* map);
-void UpdateMap(Map* map, float deltaTime);
-int GetMapTile(Map map, int x, int y);
-bool IsWall(Map map, float x, float y);
-bool IsDoor(Map map, int x, int y);
+void UpdateMap(Map* map, float deltaTime); // Moves the active doors, then spends the PVS rebuild budget
+int GetMapTile(const Map* map, int x, int y);
+bool IsWall(const Map* map, float x, float y);
+bool IsDoor(const Map* map, int x, int y);
 void SetMapTile(Map* map, int x, int y, int value);
-void UpdateMapGPUTexture(Map* map);
+
+// Starts a closed or open door moving the other way, or reverses a moving
+// one. Returns false when (x, y) is not a door or too many doors are moving.
+bool ToggleDoor(Map* map, int x, int y);
+const MapDoor* GetActiveDoor(const Map* map, int x, int y); // NULL unless the door is moving
+bool IsDoorVertical(const Map* map, int x, int y); // Slab along y (walls north and south), else along x
+void UpdateMapGPUTexture(Map* map); // Uploads the tiles changed since the last call, once per frame
+void RebuildMapImage(Map* map);     // Sizes the tile image to the occupancy window and redraws it
+void UpdateMapImage(Map* map, int x, int y, int width, int height); // Redraws the tiles of a region
+Color GetMapTileColor(int tile);     // Colour of a tile type in the map texture and minimap
+bool BuildMapPVS(Map* map, struct WorkerPool* pool); // pool may be NULL
+
+// Change that took the map from `revision` to `revision + 1`, or NULL if it has
+// already dropped out of the log (the caller should then rebuild everything)
+const MapChange* GetMapChange(const Map* map, unsigned int revision);
+void LogMapRegion(Map* map, int x, int y, int width, int height); // Records a change made without SetMapTile
+
+// Tile types that stop rays and fill the occupancy bits; a door stays solid
+// until it is fully open
+static inline bool IsTileTypeSolid(int tile) {
+    return tile != TILE_EMPTY && tile != TILE_DOOR_OPEN;
+}
+
+// Hot-path occupancy test used by the raycaster; out of bounds counts as solid
+static inline bool IsMapCellSolid(const Map* map, int x, int y) {
+    unsigned int cellX = (unsigned int)(x - map->solidX);
+    unsigned int cellY = (unsigned int)(y - map->solidY);
+    if (cellX >= (unsigned int)map->solidWidth || cellY >= (unsigned int)map->solidHeight) return true;
+    unsigned int bit = cellY * (unsigned int)map->solidWidth + cellX;
+    return (map->solid[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// Occupancy bits of an 8x8 block; out of bounds blocks are fully solid
+static inline uint64_t GetMapBlock(const Map* map, int blockX, int blockY) {
+    unsigned int cellX = (unsigned int)(blockX - (map->solidX >> MAP_BLOCK_SHIFT));
+    unsigned int cellY = (unsigned int)(blockY - (map->solidY >> MAP_BLOCK_SHIFT));
+    if (cellX >= (unsigned int)map->blocksX || cellY >= (unsigned int)map->blocksY) return ~0ull;
+    return map->blocks[cellY * map->blocksX + cellX];
+}
 
 #endif // MAP_H
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "map_stream.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_TILE_COUNT (MAP_CHUNK_SIZE * MAP_CHUNK_SIZE)
+#define CHUNK_BLOCKS (MAP_CHUNK_SIZE / MAP_BLOCK_SIZE) // 8x8 tile blocks across a chunk
+
+// The wanted square plus a ring of slack, so walking back and forth over a
+// chunk border does not evict and reload the same chunks; the window is the
+// same size, so it is as wide as the cache
+static int GetStreamWindowSide(int radius) {
+    return 2 * radius + 3;
+}
+
+static int GetStreamCapacity(int radius) {
+    int side = GetStreamWindowSide(radius);
+    return side * side;
+}
+
+// Window entry of chunk cx, cy, -1 when the window does not cover it
+static int GetWindowEntry(const MapStream* stream, int cx, int cy) {
+    unsigned int wx = (unsigned int)(cx - stream->windowX);
+    unsigned int wy = (unsigned int)(cy - stream->windowY);
+    if (wx >= (unsigned int)stream->windowWidth || wy >= (unsigned int)stream->windowHeight) return -1;
+    return (int)(wy * (unsigned int)stream->windowWidth + wx);
+}
+
+// Cache slot of chunk cx, cy, MAP_CHUNK_ABSENT unless it is resident and in the window
+static int GetResidentSlot(const MapStream* stream, int cx, int cy) {
+    int entry = GetWindowEntry(stream, cx, cy);
+    return (entry >= 0) ? stream->windowSlots[entry] : MAP_CHUNK_ABSENT;
+}
+
+// Logs a chunk appearing or disappearing. A chunk that is not resident reads
+// as walls, so only its tiles that are something else change; the region
+// logged is their bounding box, and nothing is logged for a chunk of walls only.
+static void LogChunkChange(Map* map, int chunk, const unsigned char* tiles) {
+    int minX = MAP_CHUNK_SIZE, minY = MAP_CHUNK_SIZE, maxX = -1, maxY = -1;
+    for (int y = 0; y < MAP_CHUNK_SIZE; y++) {
+        for (int x = 0; x < MAP_CHUNK_SIZE; x++) {
+            if (tiles[(y << MAP_CHUNK_SHIFT) + x] == TILE_WALL) continue;
+            if (x < minX) minX = x;
+            if (x > maxX) maxX = x;
+            if (y < minY) minY = y;
+            maxY = y;
+        }
+    }
+    if (maxX < 0) return;
+    
+    int x0 = (chunk % map->stream->chunksX) << MAP_CHUNK_SHIFT;
+    int y0 = (chunk / map->stream->chunksX) << MAP_CHUNK_SHIFT;
+    LogMapRegion(map, x0 + minX, y0 + minY, maxX - minX + 1, maxY - minY + 1);
+}
+
+// Rewrites the occupancy bits of a window entry from its chunk's tiles; NULL
+// tiles make it all solid. A chunk row is one word of Map.solid, and byte b
+// of that word is one row of the chunk's block b.
+static void WriteChunkOccupancy(Map* map, int entry, const unsigned char* tiles) {
+    const MapStream* stream = map->stream;
+    int wx = entry % stream->windowWidth;
+    int wy = entry / stream->windowWidth;
+    
+    for (int row = 0; row < MAP_CHUNK_SIZE; row++) {
+        uint64_t word = ~0ull;
+        if (tiles != NULL) {
+            const unsigned char* rowTiles = &tiles[row << MAP_CHUNK_SHIFT];
+            word = 0;
+            for (int x = 0; x < MAP_CHUNK_SIZE; x++) {
+                word |= (uint64_t)IsTileTypeSolid(rowTiles[x]) << x;
+            }
+        }
+        map->solid[((size_t)wy * MAP_CHUNK_SIZE + row) * stream->windowWidth + wx] = word;
+        
+        uint64_t* blocks = &map->blocks[((size_t)wy * CHUNK_BLOCKS + (row >> MAP_BLOCK_SHIFT)) * map->blocksX + wx * CHUNK_BLOCKS];
+        int shift = (row & (MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_SHIFT;
+        for (int b = 0; b < CHUNK_BLOCKS; b++) {
+            uint64_t bits = (word >> (b * MAP_BLOCK_SIZE)) & 0xff;
+            blocks[b] = (blocks[b] & ~(0xffull << shift)) | (bits << shift);
+        }
+    }
+}
+
+// A resident chunk inside the window becomes visible: its occupancy bits,
+// tile image and a logged change
+static void ShowChunk(Map* map, int entry, int slotIndex) {
+    MapStream* stream = map->stream;
+    const MapChunk* slot = &stream->slots[slotIndex];
+    
+    stream->windowSlots[entry] = slotIndex;
+    WriteChunkOccupancy(map, entry, slot->tiles);
+    LogChunkChange(map, slot->chunk, slot->tiles);
+    UpdateMapImage(map, (slot->chunk % stream->chunksX) << MAP_CHUNK_SHIFT, (slot->chunk / stream->chunksX) << MAP_CHUNK_SHIFT,
+                   MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+}
+
+// The chunk at a window entry turns back into walls
+static void HideChunk(Map* map, int entry) {
+    MapStream* stream = map->stream;
+    const MapChunk* slot = &stream->slots[stream->windowSlots[entry]];
+    
+    stream->windowSlots[entry] = MAP_CHUNK_ABSENT;
+    WriteChunkOccupancy(map, entry, NULL);
+    LogChunkChange(map, slot->chunk, slot->tiles);
+    UpdateMapImage(map, (slot->chunk % stream->chunksX) << MAP_CHUNK_SHIFT, (slot->chunk / stream->chunksX) << MAP_CHUNK_SHIFT,
+                   MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+}
+
+// Centres a width x height chunk window on the focus chunk, clamped to the
+// level, and fills it from the cache. Resident chunks that come into view or
+// drop out of it are logged; the others read the same as before. Returns
+// false, leaving the window as it was, when a new size cannot be allocated.
+static bool PlaceStreamWindow(Map* map, int width, int height) {
+    MapStream* stream = map->stream;
+    int x = stream->focusX - width / 2;
+    int y = stream->focusY - height / 2;
+    if (x > stream->chunksX - width) x = stream->chunksX - width;
+    if (y > stream->chunksY - height) y = stream->chunksY - height;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    
+    bool resized = width != stream->windowWidth || height != stream->windowHeight;
+    if (!resized && x == stream->windowX && y == stream->windowY) return true;
+    
+    if (resized) {
+        size_t chunkCount = (size_t)width * height;
+        int* windowSlots = (int*)malloc(chunkCount * sizeof(int));
+        uint64_t* solid = (uint64_t*)malloc(chunkCount * MAP_CHUNK_SIZE * sizeof(uint64_t));
+        uint64_t* blocks = (uint64_t*)malloc(chunkCount * CHUNK_BLOCKS * CHUNK_BLOCKS * sizeof(uint64_t));
+        if (windowSlots == NULL || solid == NULL || blocks == NULL) {
+            TraceLog(LOG_WARNING, "Failed to allocate a %dx%d chunk window", width, height);
+            free(windowSlots);
+            free(solid);
+            free(blocks);
+            return false;
+        }
+        
+        free(stream->windowSlots);
+        free(map->solid);
+        free(map->blocks);
+        stream->windowSlots = windowSlots;
+        map->solid = solid;
+        map->blocks = blocks;
+    }
+    
+    for (int i = 0; i < stream->capacity; i++) {
+        const MapChunk* slot = &stream->slots[i];
+        if (slot->chunk == MAP_CHUNK_ABSENT) continue;
+        
+        int cx = slot->chunk % stream->chunksX;
+        int cy = slot->chunk / stream->chunksX;
+        bool wasVisible = GetWindowEntry(stream, cx, cy) >= 0;
+        bool visible = cx >= x && cy >= y && cx < x + width && cy < y + height;
+        if (visible != wasVisible) LogChunkChange(map, slot->chunk, slot->tiles);
+    }
+    
+    stream->windowX = x;
+    stream->windowY = y;
+    stream->windowWidth = width;
+    stream->windowHeight = height;
+    map->solidX = x << MAP_CHUNK_SHIFT;
+    map->solidY = y << MAP_CHUNK_SHIFT;
+    map->solidWidth = width << MAP_CHUNK_SHIFT;
+    map->solidHeight = height << MAP_CHUNK_SHIFT;
+    map->blocksX = width * CHUNK_BLOCKS;
+    map->blocksY = height * CHUNK_BLOCKS;
+    
+    // Everything solid, then the resident chunks it covers
+    for (int i = 0; i < width * height; i++) stream->windowSlots[i] = MAP_CHUNK_ABSENT;
+    memset(map->solid, 0xff, (size_t)width * height * MAP_CHUNK_SIZE * sizeof(uint64_t));
+    memset(map->blocks, 0xff, (size_t)width * height * CHUNK_BLOCKS * CHUNK_BLOCKS * sizeof(uint64_t));
+    for (int i = 0; i < stream->capacity; i++) {
+        const MapChunk* slot = &stream->slots[i];
+        if (slot->chunk == MAP_CHUNK_ABSENT) continue;
+        
+        int entry = GetWindowEntry(stream, slot->chunk % stream->chunksX, slot->chunk / stream->chunksX);
+        if (entry < 0) continue;
+        stream->windowSlots[entry] = i;
+        WriteChunkOccupancy(map, entry, slot->tiles);
+    }
+    
+    RebuildMapImage(map);
+    stream->windowMoves++;
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Cache
+//----------------------------------------------------------------------------------
+
+static int FindEditedChunk(const MapStream* stream, int chunk) {
+    for (int i = 0; i < stream->editedCount; i++) {
+        if (stream->edited[i].chunk == chunk) return i;
+    }
+    return -1;
+}
+
+static void EvictChunk(Map* map, int slotIndex) {
+    MapStream* stream = map->stream;
+    MapChunk* slot = &stream->slots[slotIndex];
+    int chunk = slot->chunk;
+    
+    // Keep the game's changes; everything else can be read again
+    if (slot->edited) {
+        if (stream->editedCount == stream->editedCapacity) {
+            int capacity = (stream->editedCapacity > 0) ? stream->editedCapacity * 2 : 4;
+            EditedChunk* edited = (EditedChunk*)realloc(stream->edited, (size_t)capacity * sizeof(EditedChunk));
+            if (edited != NULL) {
+                stream->edited = edited;
+                stream->editedCapacity = capacity;
+            }
+        }
+        if (stream->editedCount < stream->editedCapacity) {
+            EditedChunk* copy = &stream->edited[stream->editedCount++];
+            copy->chunk = chunk;
+            memcpy(copy->tiles, slot->tiles, CHUNK_TILE_COUNT);
+        } else {
+            TraceLog(LOG_WARNING, "Out of memory, changes to chunk %d are lost", chunk);
+        }
+    }
+    
+    int entry = GetWindowEntry(stream, chunk % stream->chunksX, chunk / stream->chunksX);
+    if (entry >= 0) HideChunk(map, entry);
+    
+    slot->chunk = MAP_CHUNK_ABSENT;
+    stream->residentChunks--;
+    stream->evictions++;
+}
+
+// A free slot, else the least recently wanted one that is not wanted now.
+// Ties go to the lowest chunk index rather than the lowest slot, since slots
+// are handed out in whatever order the loader finishes its reads.
+static int AcquireChunkSlot(Map* map) {
+    MapStream* stream = map->stream;
+    int victim = -1;
+    unsigned int victimAge = 0;
+    
+    for (int i = 0; i < stream->capacity; i++) {
+        const MapChunk* slot = &stream->slots[i];
+        if (slot->chunk == MAP_CHUNK_ABSENT) return i;
+        
+        unsigned int age = stream->updateCount - slot->lastWanted;
+        if (age > victimAge || (age > 0 && age == victimAge && slot->chunk < stream->slots[victim].chunk)) {
+            victim = i;
+            victimAge = age;
+        }
+    }
+    
+    if (victim >= 0) EvictChunk(map, victim);
+    return victim;
+}
+
+// Puts a chunk in the cache; it shows up at once if the window covers it
+static bool InstallChunk(Map* map, int chunk, const unsigned char* tiles, bool edited) {
+    MapStream* stream = map->stream;
+    int slotIndex = AcquireChunkSlot(map);
+    if (slotIndex < 0) return false;
+    
+    MapChunk* slot = &stream->slots[slotIndex];
+    memcpy(slot->tiles, tiles, CHUNK_TILE_COUNT);
+    slot->chunk = chunk;
+    slot->lastWanted = stream->updateCount;
+    slot->edited = edited;
+    stream->residentChunks++;
+    
+    int entry = GetWindowEntry(stream, chunk % stream->chunksX, chunk / stream->chunksX);
+    if (entry >= 0) ShowChunk(map, entry, slotIndex);
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Loader thread
+//----------------------------------------------------------------------------------
+
+// Reads one chunk from the tile section; tiles past the map edge are walls
+static void ReadChunk(MapStream* stream, ChunkLoad* load) {
+    int x0 = (load->chunk % stream->chunksX) << MAP_CHUNK_SHIFT;
+    int y0 = (load->chunk / stream->chunksX) << MAP_CHUNK_SHIFT;
+    int width = (stream->mapWidth - x0 < MAP_CHUNK_SIZE) ? stream->mapWidth - x0 : MAP_CHUNK_SIZE;
+    int height = (stream->mapHeight - y0 < MAP_CHUNK_SIZE) ? stream->mapHeight - y0 : MAP_CHUNK_SIZE;
+    
+    memset(load->tiles, TILE_WALL, CHUNK_TILE_COUNT);
+    
+    for (int row = 0; row < height; row++) {
+        uint64_t offset = stream->tilesOffset + (uint64_t)(y0 + row) * stream->mapWidth + x0;
+        if (fseek(stream->file, (long)offset, SEEK_SET) != 0 ||
+            fread(&load->tiles[row << MAP_CHUNK_SHIFT], 1, (size_t)width, stream->file) != (size_t)width) {
+            TraceLog(LOG_WARNING, "Failed to read chunk %d of the streamed level", load->chunk);
+            memset(load->tiles, TILE_WALL, CHUNK_TILE_COUNT);
+            return;
+        }
+    }
+}
+
+static void* ChunkLoaderMain(void* arg) {
+    MapStream* stream = (MapStream*)arg;
+    
+    pthread_mutex_lock(&stream->mutex);
+    while (!stream->quit) {
+        if (stream->queueCount == 0) {
+            pthread_cond_wait(&stream->wakeCond, &stream->mutex);
+            continue;
+        }
+        
+        ChunkLoad* load = &stream->loads[stream->queue[stream->queueHead]];
+        stream->queueHead = (stream->queueHead + 1) % MAP_STREAM_MAX_LOADS;
+        stream->queueCount--;
+        
+        // The main thread leaves a queued load alone until it is done
+        pthread_mutex_unlock(&stream->mutex);
+        ReadChunk(stream, load);
+        pthread_mutex_lock(&stream->mutex);
+        
+        load->state = CHUNK_LOAD_DONE;
+        pthread_cond_broadcast(&stream->doneCond);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    
+    return NULL;
+}
+
+static bool QueueChunkLoad(MapStream* stream, int chunk) {
+    for (int i = 0; i < MAP_STREAM_MAX_LOADS; i++) {
+        ChunkLoad* load = &stream->loads[i];
+        if (load->state != CHUNK_LOAD_FREE) continue;
+        
+        load->chunk = chunk;
+        load->state = CHUNK_LOAD_QUEUED;
+        stream->queue[(stream->queueHead + stream->queueCount) % MAP_STREAM_MAX_LOADS] = i;
+        stream->queueCount++;
+        return true;
+    }
+    
+    return false;
+}
+
+// Called with the mutex held, like everything that reads the load states
+static bool IsChunkLoading(const MapStream* stream, int chunk) {
+    for (int i = 0; i < MAP_STREAM_MAX_LOADS; i++) {
+        if (stream->loads[i].state != CHUNK_LOAD_FREE && stream->loads[i].chunk == chunk) return true;
+    }
+    return false;
+}
+
+// Installs finished loads and queues missing wanted chunks, nearest first.
+// Called with the mutex held; returns how many wanted chunks are not resident.
+static int PumpMapStream(Map* map) {
+    MapStream* stream = map->stream;
+    int radius = stream->radius;
+    stream->updateCount++;
+    
+    // Mark the wanted chunks first so installing below never evicts them
+    for (int cy = stream->focusY - radius; cy <= stream->focusY + radius; cy++) {
+        for (int cx = stream->focusX - radius; cx <= stream->focusX + radius; cx++) {
+            int slot = GetResidentSlot(stream, cx, cy);
+            if (slot >= 0) stream->slots[slot].lastWanted = stream->updateCount;
+        }
+    }
+    
+    for (int i = 0; i < MAP_STREAM_MAX_LOADS; i++) {
+        ChunkLoad* load = &stream->loads[i];
+        if (load->state != CHUNK_LOAD_DONE) continue;
+        
+        if (InstallChunk(map, load->chunk, load->tiles, false)) stream->chunkLoads++;
+        load->state = CHUNK_LOAD_FREE;
+    }
+    
+    // Rings of growing distance around the focus chunk; the window covers
+    // all of them, so a wanted chunk is either in it or not in the cache
+    int missing = 0;
+    bool queued = false;
+    for (int r = 0; r <= radius; r++) {
+        for (int dy = -r; dy <= r; dy++) {
+            // Whole rows at the top and bottom of the ring, its two ends in between
+            int step = (dy == -r || dy == r) ? 1 : 2 * r;
+            for (int dx = -r; dx <= r; dx += step) {
+                int cx = stream->focusX + dx;
+                int cy = stream->focusY + dy;
+                if (cx < 0 || cy < 0 || cx >= stream->chunksX || cy >= stream->chunksY) continue;
+                
+                int chunk = cy * stream->chunksX + cx;
+                if (GetResidentSlot(stream, cx, cy) >= 0) continue;
+                missing++;
+                if (IsChunkLoading(stream, chunk)) continue;
+                
+                // Edited chunks come back from memory at once. Their tiles are
+                // copied out first: making room may evict another edited chunk,
+                // which can move the array.
+                int editedIndex = FindEditedChunk(stream, chunk);
+                if (editedIndex >= 0) {
+                    unsigned char tiles[CHUNK_TILE_COUNT];
+                    memcpy(tiles, stream->edited[editedIndex].tiles, CHUNK_TILE_COUNT);
+                    if (InstallChunk(map, chunk, tiles, true)) {
+                        stream->edited[editedIndex] = stream->edited[--stream->editedCount];
+                        missing--;
+                    }
+                    continue;
+                }
+                
+                queued |= QueueChunkLoad(stream, chunk);
+            }
+        }
+    }
+    
+    if (queued) pthread_cond_signal(&stream->wakeCond);
+    stream->missingChunks = missing;
+    return missing;
+}
+
+//----------------------------------------------------------------------------------
+// Streaming
+//----------------------------------------------------------------------------------
+
+static void FreeMapStream(Map* map) {
+    MapStream* stream = map->stream;
+    
+    if (stream->file != NULL) fclose(stream->file);
+    free(stream->edited);
+    free(stream->windowSlots);
+    free(stream->slots);
+    free(stream);
+    
+    // The occupancy bits belong to the window
+    free(map->solid);
+    free(map->blocks);
+    map->solid = NULL;
+    map->blocks = NULL;
+    map->stream = NULL;
+}
+
+bool InitMapStream(Map* map, const char* path, uint64_t tilesOffset) {
+    MapStream* stream = (MapStream*)calloc(1, sizeof(MapStream));
+    if (stream == NULL) return false;
+    map->stream = stream;
+    
+    stream->mapWidth = map->width;
+    stream->mapHeight = map->height;
+    stream->chunksX = (map->width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    stream->chunksY = (map->height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    stream->radius = MAP_STREAM_DEFAULT_RADIUS;
+    stream->capacity = GetStreamCapacity(stream->radius);
+    stream->tilesOffset = tilesOffset;
+    stream->focusX = (int)map->playerStart.x >> MAP_CHUNK_SHIFT;
+    stream->focusY = (int)map->playerStart.y >> MAP_CHUNK_SHIFT;
+    
+    stream->slots = (MapChunk*)malloc((size_t)stream->capacity * sizeof(MapChunk));
+    if (stream->slots != NULL) {
+        for (int i = 0; i < stream->capacity; i++) stream->slots[i].chunk = MAP_CHUNK_ABSENT;
+    }
+    
+    // Unbuffered: every chunk row is one small read at its own offset
+    stream->file = fopen(path, "rb");
+    if (stream->file != NULL) setvbuf(stream->file, NULL, _IONBF, 0);
+    
+    // Nothing is resident yet, so the window starts out all solid
+    int side = GetStreamWindowSide(stream->radius);
+    if (stream->slots == NULL || stream->file == NULL ||
+        !PlaceStreamWindow(map, (side < stream->chunksX) ? side : stream->chunksX, (side < stream->chunksY) ? side : stream->chunksY)) {
+        TraceLog(LOG_WARNING, "Failed to set up streaming for a %dx%d level", map->width, map->height);
+        FreeMapStream(map);
+        return false;
+    }
+    
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->wakeCond, NULL);
+    pthread_cond_init(&stream->doneCond, NULL);
+    if (pthread_create(&stream->thread, NULL, ChunkLoaderMain, stream) != 0) {
+        TraceLog(LOG_WARNING, "Failed to start the chunk loader thread");
+        pthread_mutex_destroy(&stream->mutex);
+        pthread_cond_destroy(&stream->wakeCond);
+        pthread_cond_destroy(&stream->doneCond);
+        FreeMapStream(map);
+        return false;
+    }
+    
+    // The start area has to be there before anything is spawned in it
+    UpdateMapStream(map, (Vector2){ map->playerStart.x * TILE_SIZE, map->playerStart.y * TILE_SIZE });
+    FlushMapStream(map);
+    return true;
+}
+
+void UnloadMapStream(Map* map) {
+    MapStream* stream = map->stream;
+    if (stream == NULL) return;
+    
+    pthread_mutex_lock(&stream->mutex);
+    stream->quit = true;
+    pthread_cond_signal(&stream->wakeCond);
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->thread, NULL);
+    
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->wakeCond);
+    pthread_cond_destroy(&stream->doneCond);
+    FreeMapStream(map);
+}
+
+void UpdateMapStream(Map* map, Vector2 position) {
+    MapStream* stream = map->stream;
+    if (stream == NULL) return;
+    
+    stream->focusX = (int)(position.x / TILE_SIZE) >> MAP_CHUNK_SHIFT;
+    stream->focusY = (int)(position.y / TILE_SIZE) >> MAP_CHUNK_SHIFT;
+    PlaceStreamWindow(map, stream->windowWidth, stream->windowHeight);
+    
+    pthread_mutex_lock(&stream->mutex);
+    PumpMapStream(map);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+void FlushMapStream(Map* map) {
+    MapStream* stream = map->stream;
+    if (stream == NULL) return;
+    
+    pthread_mutex_lock(&stream->mutex);
+    while (PumpMapStream(map) > 0) {
+        pthread_cond_wait(&stream->doneCond, &stream->mutex);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+bool SetMapStreamRadius(Map* map, int radius) {
+    MapStream* stream = map->stream;
+    if (stream == NULL || radius < 0) return false;
+    
+    // The window needs to cover the new wanted square before anything else changes
+    int side = GetStreamWindowSide(radius);
+    if (!PlaceStreamWindow(map, (side < stream->chunksX) ? side : stream->chunksX, (side < stream->chunksY) ? side : stream->chunksY)) {
+        return false;
+    }
+    
+    // Slots only move on the main thread, so growing needs no lock
+    int capacity = GetStreamCapacity(radius);
+    if (capacity > stream->capacity) {
+        MapChunk* slots = (MapChunk*)realloc(stream->slots, (size_t)capacity * sizeof(MapChunk));
+        if (slots == NULL) {
+            TraceLog(LOG_WARNING, "Failed to grow the chunk cache to %d chunks", capacity);
+            return false;
+        }
+        for (int i = stream->capacity; i < capacity; i++) slots[i].chunk = MAP_CHUNK_ABSENT;
+        stream->slots = slots;
+        stream->capacity = capacity;
+    }
+    
+    stream->radius = radius;
+    return true;
+}
+
+size_t GetMapStreamMemory(const Map* map) {
+    const MapStream* stream = map->stream;
+    if (stream == NULL) return 0;
+    
+    // Per window chunk: its slot, one occupancy word per row and one block word per block
+    size_t windowChunks = (size_t)stream->windowWidth * stream->windowHeight;
+    return sizeof(MapStream) + (size_t)stream->capacity * sizeof(MapChunk) +
+           (size_t)stream->editedCapacity * sizeof(EditedChunk) +
+           windowChunks * (sizeof(int) + (MAP_CHUNK_SIZE + CHUNK_BLOCKS * CHUNK_BLOCKS) * sizeof(uint64_t));
+}
+
+int GetStreamedTile(const MapStream* stream, int x, int y) {
+    int slot = GetResidentSlot(stream, x >> MAP_CHUNK_SHIFT, y >> MAP_CHUNK_SHIFT);
+    if (slot < 0) return TILE_WALL;
+    
+    return stream->slots[slot].tiles[((y & (MAP_CHUNK_SIZE - 1)) << MAP_CHUNK_SHIFT) | (x & (MAP_CHUNK_SIZE - 1))];
+}
+
+unsigned char* EditStreamedTile(MapStream* stream, int x, int y) {
+    int slot = GetResidentSlot(stream, x >> MAP_CHUNK_SHIFT, y >> MAP_CHUNK_SHIFT);
+    if (slot < 0) return NULL;
+    
+    stream->slots[slot].edited = true;
+    return &stream->slots[slot].tiles[((y & (MAP_CHUNK_SIZE - 1)) << MAP_CHUNK_SHIFT) | (x & (MAP_CHUNK_SIZE - 1))];
+}
@@ -0,0 +1,127 @@
+#ifndef MAP_STREAM_H
+#define MAP_STREAM_H
+
+#include "raylib.h"
+#include "map.h"
+#include <pthread.h>
+#include <stdio.h>
+
+// Streams the tile grid of a very large level in fixed-size chunks.
+//
+// Only the chunks within `radius` chunks of the player are wanted. Missing
+// ones are read from the level file by a background thread, nearest first,
+// and installed into a bounded cache on the main thread; when the cache is
+// full the least recently wanted chunk is evicted.
+//
+// What the game sees is a window of chunks centred on the player, one chunk
+// wider than the wanted square on every side: its resident chunks read as
+// their tiles, everything else as walls. The window holds the occupancy bits
+// (Map.solid, Map.blocks, one 64-bit word per chunk row) and the cache slot
+// of each of its chunks, and is filled again from the cache whenever the
+// player crosses into another chunk. Nothing is kept per chunk of the whole
+// level, so memory depends on the radius, not on the level size.
+//
+// A chunk entering or leaving the window, or arriving or being evicted inside
+// it, logs one region change covering its tiles that are not walls (the rest
+// read the same either way), which wall meshes and the flow field pick up
+// like any other tile change. Chunks the game has edited (doors) are copied
+// aside when evicted and come back from that copy.
+//
+// Which chunks are resident depends on when the loader's reads finish. A run
+// that has to play out the same every time (replays, headless runs) calls
+// FlushMapStream after UpdateMapStream each tick.
+
+#define MAP_CHUNK_SHIFT 6
+#define MAP_CHUNK_SIZE (1 << MAP_CHUNK_SHIFT) // 64x64 tiles, one 4 KB page of tile types
+#define MAP_STREAM_MIN_TILES (1024 * 1024)    // LoadMapGrid streams levels with more tiles than this
+#define MAP_STREAM_DEFAULT_RADIUS 4           // Chunks wanted around the player in each direction
+#define MAP_STREAM_MAX_LOADS 32               // Chunk reads queued or in flight at once
+
+#define MAP_CHUNK_ABSENT -1 // Chunk of a free cache slot, window entry without a resident chunk
+
+typedef struct MapChunk {
+    int chunk;                  // cy * chunksX + cx, MAP_CHUNK_ABSENT when the slot is free
+    unsigned int lastWanted;    // UpdateMapStream call that last wanted it
+    bool edited;                // Changed since it was read from the file
+    unsigned char tiles[MAP_CHUNK_SIZE * MAP_CHUNK_SIZE];
+} MapChunk;
+
+typedef enum {
+    CHUNK_LOAD_FREE,            // Owned by the main thread
+    CHUNK_LOAD_QUEUED,          // Waiting for the loader
+    CHUNK_LOAD_DONE             // Read, waiting to be installed
+} ChunkLoadState;
+
+typedef struct ChunkLoad {
+    int chunk;
+    ChunkLoadState state;
+    unsigned char tiles[MAP_CHUNK_SIZE * MAP_CHUNK_SIZE];
+} ChunkLoad;
+
+// Tiles of an edited chunk while it is evicted
+typedef struct EditedChunk {
+    int chunk;
+    unsigned char tiles[MAP_CHUNK_SIZE * MAP_CHUNK_SIZE];
+} EditedChunk;
+
+typedef struct MapStream {
+    int mapWidth, mapHeight;    // Tiles
+    int chunksX, chunksY;       // Chunks across the level
+    MapChunk* slots;            // The cache
+    int capacity;
+    int radius;
+    int focusX, focusY;         // Chunk the wanted square is centred on
+    unsigned int updateCount;
+    
+    // Window the game sees; Map.solidX, solidY and the occupancy bits follow it
+    int windowX, windowY;       // First chunk
+    int windowWidth, windowHeight; // Chunks across
+    int* windowSlots;           // Per window chunk, row-major: cache slot or MAP_CHUNK_ABSENT
+    
+    EditedChunk* edited;        // Evicted edited chunks, in no particular order
+    int editedCount, editedCapacity;
+    
+    // Background loader; the mutex guards loads[].state, the queue and quit
+    FILE* file;                 // Only used by the loader thread
+    uint64_t tilesOffset;       // Tile section in the file
+    ChunkLoad loads[MAP_STREAM_MAX_LOADS];
+    int queue[MAP_STREAM_MAX_LOADS]; // Queued load indices, oldest first
+    int queueHead, queueCount;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeCond;    // Signalled when a load is queued or on shutdown
+    pthread_cond_t doneCond;    // Signalled when a load finishes
+    bool quit;
+    
+    // Statistics
+    int residentChunks;
+    int missingChunks;          // Wanted chunks not resident after the last update
+    unsigned long long chunkLoads; // Chunks installed from the file
+    unsigned long long evictions;
+    unsigned long long windowMoves; // Times the window was filled again around a new focus
+} MapStream;
+
+// Called by StreamMapGrid: sets up the cache, the window and the loader thread
+// for a width x height level whose tiles start at tilesOffset in the file,
+// then loads the chunks around the player start
+bool InitMapStream(Map* map, const char* path, uint64_t tilesOffset);
+void UnloadMapStream(Map* map);
+
+// Wants the chunks around position (world units), installs the chunks the
+// loader has finished and queues the missing ones. No-op for maps that are
+// not streamed. Call once per tick or frame.
+void UpdateMapStream(Map* map, Vector2 position);
+
+// Waits until every wanted chunk is resident
+void FlushMapStream(Map* map);
+
+// Changes the wanted radius (in chunks), growing the cache and resizing the window to fit
+bool SetMapStreamRadius(Map* map, int radius);
+
+size_t GetMapStreamMemory(const Map* map); // Bytes held for tiles, occupancy and bookkeeping
+
+// Tile access for GetMapTile and SetMapTile; x, y must be inside the map
+int GetStreamedTile(const MapStream* stream, int x, int y);       // TILE_WALL when not resident in the window
+unsigned char* EditStreamedTile(MapStream* stream, int x, int y); // NULL when not resident in the window
+
+#endif // MAP_STREAM_H
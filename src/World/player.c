@@ -1,9 +1,10 @@
 #include "player.h"
+#include "collision.h"
 #include "math.h"
 
-void InitPlayer(Player* player, Map map) {
-    // Start player in a good starting position (in an empty area)
-    player->position = (Vector2){ 2.5f * TILE_SIZE, 2.5f * TILE_SIZE };
+void InitPlayer(Player* player, const Map* map) {
+    // Start where the level says (the built-in map starts at 2.5, 2.5 facing east)
+    player->position = (Vector2){ map->playerStart.x * TILE_SIZE, map->playerStart.y * TILE_SIZE };
     player->angle = 0.0f;
     
     // Initial direction vector - player starts facing east (1,0)
@@ -18,6 +19,9 @@ void InitPlayer(Player* player, Map map) {
     player->rotateSpeed = PLAYER_ROTATE_SPEED;
     player->collisionRadius = PLAYER_COLLISION_RADIUS * TILE_SIZE;
     
+    // Turn from east to the level's start angle
+    RotatePlayer(player, map->playerStartAngle);
+    
     // Find a valid starting position if the player is in a wall
     int attempts = 0;
     while (IsWall(map, player->position.x, player->position.y) && attempts < 100) {
@@ -30,68 +34,67 @@ void InitPlayer(Player* player, Map map) {
     }
 }
 
-void UpdatePlayer(Player* player, Map map, float deltaTime) {
+void UpdatePlayer(Player* player, const Map* map, const PlayerInput* input, float deltaTime) {
     float moveAmount = 0.0f;
     float strafeAmount = 0.0f;
     float rotateAmount = 0.0f;
     
     // Process input for movement
-    if (IsKeyDown(KEY_W)) moveAmount += player->moveSpeed * deltaTime;
-    if (IsKeyDown(KEY_S)) moveAmount -= player->moveSpeed * deltaTime;
-    if (IsKeyDown(KEY_A)) strafeAmount -= player->moveSpeed * deltaTime;
-    if (IsKeyDown(KEY_D)) strafeAmount += player->moveSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_FORWARD) moveAmount += player->moveSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_BACKWARD) moveAmount -= player->moveSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_STRAFE_LEFT) strafeAmount -= player->moveSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_STRAFE_RIGHT) strafeAmount += player->moveSpeed * deltaTime;
     
     // Process input for rotation with keyboard
-    if (IsKeyDown(KEY_LEFT)) rotateAmount -= player->rotateSpeed * deltaTime;
-    if (IsKeyDown(KEY_RIGHT)) rotateAmount += player->rotateSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_TURN_LEFT) rotateAmount -= player->rotateSpeed * deltaTime;
+    if (input->buttons & PLAYER_INPUT_TURN_RIGHT) rotateAmount += player->rotateSpeed * deltaTime;
     
     // Apply movement and rotation
     MovePlayer(player, map, moveAmount, strafeAmount);
-    RotatePlayer(player, rotateAmount);
+    RotatePlayer(player, rotateAmount + input->mouseTurn);
 }
 
-void MovePlayer(Player* player, Map map, float moveAmount, float strafeAmount) {
+Player LerpPlayer(const Player* from, const Player* to, float t) {
+    Player result = *to;
+    
+    result.position.x = from->position.x + (to->position.x - from->position.x) * t;
+    result.position.y = from->position.y + (to->position.y - from->position.y) * t;
+    
+    // Blend the view direction and rebuild the camera plane perpendicular to it
+    float dirX = from->direction.x + (to->direction.x - from->direction.x) * t;
+    float dirY = from->direction.y + (to->direction.y - from->direction.y) * t;
+    float dirLen = sqrtf(dirX * dirX + dirY * dirY);
+    if (dirLen > 0.0f) {
+        float planeLen = sqrtf(to->plane.x * to->plane.x + to->plane.y * to->plane.y);
+        result.direction = (Vector2){ dirX / dirLen, dirY / dirLen };
+        result.plane = (Vector2){ -result.direction.y * planeLen, result.direction.x * planeLen };
+    }
+    
+    // Shortest way around for the angle
+    float delta = to->angle - from->angle;
+    if (delta > PI) delta -= 2 * PI;
+    if (delta < -PI) delta += 2 * PI;
+    result.angle = from->angle + delta * t;
+    if (result.angle < 0) result.angle += 2 * PI;
+    if (result.angle >= 2 * PI) result.angle -= 2 * PI;
+    
+    return result;
+}
+
+void MovePlayer(Player* player, const Map* map, float moveAmount, float strafeAmount) {
     // Early exit if no movement
     if (moveAmount == 0 && strafeAmount == 0) return;
     
-    Vector2 newPos = player->position;
-    
-    // Forward/backward movement
-    if (moveAmount != 0) {
-        float moveDist = moveAmount * TILE_SIZE;
-        float newX = player->position.x + player->direction.x * moveDist;
-        float newY = player->position.y + player->direction.y * moveDist;
-        
-        // Apply collision detection with a sliding effect
-        if (!IsWallWithRadius(map, newX, player->position.y, player->collisionRadius)) {
-            newPos.x = newX;
-        }
-        
-        if (!IsWallWithRadius(map, player->position.x, newY, player->collisionRadius)) {
-            newPos.y = newY;
-        }
-    }
-    
-    // Strafe movement (perpendicular to direction)
-    if (strafeAmount != 0) {
-        float strafeDist = strafeAmount * TILE_SIZE;
-        float perpX = -player->direction.y;
-        float perpY = player->direction.x;
-        
-        float newX = newPos.x + perpX * strafeDist;
-        float newY = newPos.y + perpY * strafeDist;
-        
-        // Apply collision detection with a sliding effect
-        if (!IsWallWithRadius(map, newX, newPos.y, player->collisionRadius)) {
-            newPos.x = newX;
-        }
-        
-        if (!IsWallWithRadius(map, newPos.x, newY, player->collisionRadius)) {
-            newPos.y = newY;
-        }
-    }
+    // Forward/backward along the view direction, strafe perpendicular to it
+    float moveDist = moveAmount * TILE_SIZE;
+    float strafeDist = strafeAmount * TILE_SIZE;
+    Vector2 delta = {
+        player->direction.x * moveDist - player->direction.y * strafeDist,
+        player->direction.y * moveDist + player->direction.x * strafeDist
+    };
     
-    player->position = newPos;
+    // Sweep the collision circle along the whole motion, sliding along walls
+    player->position = SlideCircle(map, player->position, delta, player->collisionRadius, NULL);
 }
 
 void RotatePlayer(Player* player, float angle) {
@@ -124,23 +127,7 @@ void RotatePlayer(Player* player, float angle) {
     while (player->angle >= 2 * PI) player->angle -= 2 * PI;
 }
 
-// Additional helper function for collision detection with a radius
-bool IsWallWithRadius(Map map, float x, float y, float radius) {
-    // Check the center point
-    if (IsWall(map, x, y)) return true;
-    
-    // Check cardinal directions at radius distance
-    if (IsWall(map, x + radius, y)) return true;
-    if (IsWall(map, x - radius, y)) return true;
-    if (IsWall(map, x, y + radius)) return true;
-    if (IsWall(map, x, y - radius)) return true;
-    
-    // Check diagonals at 0.7 * radius (approximately 1/sqrt(2) * radius)
-    float diag = 0.7f * radius;
-    if (IsWall(map, x + diag, y + diag)) return true;
-    if (IsWall(map, x - diag, y + diag)) return true;
-    if (IsWall(map, x + diag, y - diag)) return true;
-    if (IsWall(map, x - diag, y - diag)) return true;
-    
-    return false;
+// Exact test: does a circle of the given radius overlap a blocking tile
+bool IsWallWithRadius(const Map* map, float x, float y, float radius) {
+    return IsCircleBlocked(map, (Vector2){ x, y }, radius);
 }
\ No newline at end of file
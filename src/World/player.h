@@ -8,6 +8,22 @@
 #define PLAYER_ROTATE_SPEED 2.0f
 #define PLAYER_COLLISION_RADIUS 0.2f
 
+// Controls for one simulation tick (PlayerInput.buttons)
+#define PLAYER_INPUT_FORWARD      (1 << 0)
+#define PLAYER_INPUT_BACKWARD     (1 << 1)
+#define PLAYER_INPUT_STRAFE_LEFT  (1 << 2)
+#define PLAYER_INPUT_STRAFE_RIGHT (1 << 3)
+#define PLAYER_INPUT_TURN_LEFT    (1 << 4)
+#define PLAYER_INPUT_TURN_RIGHT   (1 << 5)
+#define PLAYER_INPUT_USE          (1 << 6) // Pressed since the last tick: open/close the door in front
+
+// Everything the simulation reads from the user in one tick, so a tick is a
+// pure function of the previous state and this struct
+typedef struct PlayerInput {
+    unsigned int buttons;   // PLAYER_INPUT_* flags
+    float mouseTurn;        // Mouse look rotation to apply this tick, in radians
+} PlayerInput;
+
 typedef struct Player {
     Vector2 position;  // Position in the world (x, y)
     float angle;       // View angle in radians
@@ -18,10 +34,11 @@ typedef struct Player {
     float collisionRadius; // Collision radius
 } Player;
 
-void InitPlayer(Player* player, Map map);
-void UpdatePlayer(Player* player, Map map, float deltaTime);
-void MovePlayer(Player* player, Map map, float moveAmount, float strafeAmount);
+void InitPlayer(Player* player, const Map* map);
+void UpdatePlayer(Player* player, const Map* map, const PlayerInput* input, float deltaTime);
+Player LerpPlayer(const Player* from, const Player* to, float t); // View state between two ticks
+void MovePlayer(Player* player, const Map* map, float moveAmount, float strafeAmount);
 void RotatePlayer(Player* player, float angle);
-bool IsWallWithRadius(Map map, float x, float y, float radius);
+bool IsWallWithRadius(const Map* map, float x, float y, float radius);
 
 #endif // PLAYER_H
\ No newline at end of file
@@ -0,0 +1,424 @@
+#include "pvs.h"
+#include "map.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A slope dy/dx in an octant's local frame, compared exactly; den == 0 is +infinity
+typedef struct PVSSlope {
+    int num, den;
+} PVSSlope;
+
+// Range of slopes of the sight lines still unblocked; an open end excludes its slope
+typedef struct PVSSlopeRange {
+    PVSSlope lo, hi;
+    bool loOpen, hiOpen;
+} PVSSlopeRange;
+
+// Full-map scratch bitset a thread marks visible tiles into before they are
+// compacted into the source's bounding rectangle, plus the slope ranges of the
+// current and next column of the shadow cast
+typedef struct PVSScratch {
+    uint64_t* bits;
+    int minX, minY, maxX, maxY;
+    PVSSlopeRange* ranges[2];
+    int rangeCapacity;
+} PVSScratch;
+
+typedef struct PVSBuildJob {
+    PVS* pvs;
+    const Map* map;
+    PVSScratch* scratch;       // One per thread
+} PVSBuildJob;
+
+// The 8 octants as (local x, local y) -> world axis maps: xx, xy, yx, yy
+static const int PVS_OCTANTS[8][4] = {
+    {  1,  0,  0,  1 }, {  0,  1,  1,  0 }, {  0, -1,  1,  0 }, { -1,  0,  0,  1 },
+    { -1,  0,  0, -1 }, {  0, -1, -1,  0 }, {  0,  1, -1,  0 }, {  1,  0,  0, -1 },
+};
+
+static void MarkScratchTile(PVSScratch* scratch, int width, int x, int y) {
+    int index = y * width + x;
+    scratch->bits[index >> 6] |= 1ull << (index & 63);
+    
+    if (x < scratch->minX) scratch->minX = x;
+    if (y < scratch->minY) scratch->minY = y;
+    if (x > scratch->maxX) scratch->maxX = x;
+    if (y > scratch->maxY) scratch->maxY = y;
+}
+
+// Doors hide nothing for good, so sight lines pass through them whatever
+// state they are in and opening or closing one leaves the PVS valid
+static bool IsPVSOccluder(const Map* map, int x, int y) {
+    return IsMapCellSolid(map, x, y) && GetMapTile(map, x, y) != TILE_DOOR;
+}
+
+static int CompareSlopes(PVSSlope a, PVSSlope b) {
+    int64_t difference = (int64_t)a.num * b.den - (int64_t)b.num * a.den;
+    return (difference > 0) - (difference < 0);
+}
+
+static bool IsSlopeRangeEmpty(const PVSSlopeRange* range) {
+    int order = CompareSlopes(range->lo, range->hi);
+    return order > 0 || (order == 0 && (range->loOpen || range->hiOpen));
+}
+
+// True when the range shares a slope with the closed range [lo, hi]
+static bool SlopeRangeMeets(const PVSSlopeRange* range, PVSSlope lo, PVSSlope hi) {
+    int below = CompareSlopes(hi, range->lo);
+    int above = CompareSlopes(lo, range->hi);
+    return (below > 0 || (below == 0 && !range->loOpen)) && (above < 0 || (above == 0 && !range->hiOpen));
+}
+
+static bool GrowPVSRanges(PVSScratch* scratch, int needed) {
+    if (needed <= scratch->rangeCapacity) return true;
+    
+    int capacity = (scratch->rangeCapacity > 0) ? scratch->rangeCapacity * 2 : 64;
+    while (capacity < needed) capacity *= 2;
+    for (int i = 0; i < 2; i++) {
+        PVSSlopeRange* ranges = realloc(scratch->ranges[i], (size_t)capacity * sizeof(PVSSlopeRange));
+        if (ranges == NULL) return false;
+        scratch->ranges[i] = ranges;
+    }
+    scratch->rangeCapacity = capacity;
+    return true;
+}
+
+static bool PushSlopeRange(PVSScratch* scratch, int list, int* count, PVSSlopeRange range) {
+    if (IsSlopeRangeEmpty(&range)) return true;
+    if (!GrowPVSRanges(scratch, *count + 1)) return false;
+    scratch->ranges[list][(*count)++] = range;
+    return true;
+}
+
+// Removes the closed range [lo, hi] of slopes from *range, which must meet it:
+// the part below is pushed to list, *range keeps the part above (possibly empty)
+static bool BlockSlopes(PVSScratch* scratch, int list, int* count, PVSSlopeRange* range, PVSSlope lo, PVSSlope hi) {
+    PVSSlopeRange below = *range;
+    below.hi = lo;
+    below.hiOpen = true;
+    if (CompareSlopes(lo, range->hi) > 0) below.hi = range->hi;
+    if (!PushSlopeRange(scratch, list, count, below)) return false;
+    
+    range->lo = hi;
+    range->loOpen = true;
+    return true;
+}
+
+// Out of the map counts as an occluder; the source tile never blocks its own sight lines
+static bool BlocksPVSSight(const Map* map, int x, int y, int sourceX, int sourceY) {
+    if ((unsigned int)x >= (unsigned int)map->width || (unsigned int)y >= (unsigned int)map->height) return true;
+    return !(x == sourceX && y == sourceY) && IsPVSOccluder(map, x, y);
+}
+
+// Local tile (i, j) of an octant, counted from the source tile
+static bool BlocksOctantSight(const Map* map, const int* octant, int sourceX, int sourceY, int i, int j) {
+    return BlocksPVSSight(map, sourceX + i * octant[0] + j * octant[1], sourceY + i * octant[2] + j * octant[3],
+                          sourceX, sourceY);
+}
+
+// Shadow cast of one octant from the centre of the source tile against the
+// walls shrunk by half a tile: what is left of them are the wall centres and
+// the segments joining the centres of neighbouring walls (occluder shrinking).
+// Whatever those hide from the centre is hidden from every point of the source
+// tile, since any sight line from elsewhere in the tile passes within half a
+// tile of the same blocking point and so through the inside of the walls.
+//
+// Local coordinates are doubled so tile centres sit on even and tile borders
+// on odd coordinates. Column m is the strip [m, m + 1]; a line of slope s
+// crosses it between heights s * m and s * (m + 1), touching tile row j (heights
+// 2j - 1 .. 2j + 1) for s in [(2j - 1) / (m + 1), (2j + 1) / m]. Every tile a
+// remaining line touches is marked, then the lines meeting a shrunk wall are
+// removed: segments along y = 2j inside the column, row by row as the lines
+// climb, and the centres and segments on x = m + 1 at the column's end.
+// Returns false if out of memory.
+static bool CastPVSOctant(const Map* map, PVSScratch* scratch, const int* octant, int sourceX, int sourceY) {
+    int current = 0;
+    int count = 0;
+    PVSSlopeRange all = { { 0, 1 }, { 1, 1 }, false, false };
+    if (!PushSlopeRange(scratch, current, &count, all)) return false;
+    
+    for (int m = 0; count > 0; m++) {
+        int tileColumn = (m + 1) / 2;
+        int leftCentre = m / 2;    // Horizontal segments crossing the column join this column of centres to the next
+        int nextCount = 0;
+        
+        for (int r = 0; r < count; r++) {
+            PVSSlopeRange range = scratch->ranges[current][r];
+            
+            int jFirst = (int)(((int64_t)range.lo.num * m) / (2 * (int64_t)range.lo.den)) - 1;
+            int jLast = (int)(((int64_t)range.hi.num * (m + 1)) / (2 * (int64_t)range.hi.den)) + 1;
+            if (jFirst < 0) jFirst = 0;
+            
+            for (int j = jFirst; j <= jLast && !IsSlopeRangeEmpty(&range); j++) {
+                PVSSlope tileLo = { 2 * j - 1, m + 1 };
+                PVSSlope tileHi = { 2 * j + 1, m };
+                if (!SlopeRangeMeets(&range, tileLo, tileHi)) {
+                    if (CompareSlopes(tileLo, range.hi) > 0) break;
+                    continue;
+                }
+                
+                int x = sourceX + tileColumn * octant[0] + j * octant[1];
+                int y = sourceY + tileColumn * octant[2] + j * octant[3];
+                if ((unsigned int)x < (unsigned int)map->width && (unsigned int)y < (unsigned int)map->height) {
+                    MarkScratchTile(scratch, map->width, x, y);
+                }
+                if (!BlocksPVSSight(map, x, y, sourceX, sourceY)) continue;
+                
+                // The lines crossing height 2j inside the column, if a segment runs there
+                // (the tile just marked is one of its two ends)
+                int otherEnd = (tileColumn == leftCentre) ? leftCentre + 1 : leftCentre;
+                PVSSlope crossLo = { 2 * j, m + 1 };
+                PVSSlope crossHi = { 2 * j, m };
+                if ((m > 0 || j > 0) && BlocksOctantSight(map, octant, sourceX, sourceY, otherEnd, j) &&
+                    SlopeRangeMeets(&range, crossLo, crossHi) &&
+                    !BlockSlopes(scratch, current ^ 1, &nextCount, &range, crossLo, crossHi)) {
+                    return false;
+                }
+            }
+            
+            if (!PushSlopeRange(scratch, current ^ 1, &nextCount, range)) return false;
+        }
+        
+        // Column m ends on a column of wall centres when m + 1 is even
+        if ((m + 1) % 2 == 0) {
+            int centreColumn = (m + 1) / 2;
+            count = 0;
+            
+            for (int r = 0; r < nextCount; r++) {
+                PVSSlopeRange range = scratch->ranges[current ^ 1][r];
+                
+                int jFirst = (int)(((int64_t)range.lo.num * (m + 1)) / (2 * (int64_t)range.lo.den)) - 1;
+                int jLast = (int)(((int64_t)range.hi.num * (m + 1)) / (2 * (int64_t)range.hi.den)) + 1;
+                if (jFirst < 0) jFirst = 0;
+                
+                for (int j = jFirst; j <= jLast && !IsSlopeRangeEmpty(&range); j++) {
+                    if (!BlocksOctantSight(map, octant, sourceX, sourceY, centreColumn, j)) continue;
+                    
+                    // The segment up to the next centre when that is a wall too. A lone
+                    // centre only stops the single line through it, which would split the
+                    // range for nothing; it is only applied where it trims the range's end.
+                    PVSSlope blockLo = { 2 * j, m + 1 };
+                    PVSSlope blockHi = blockLo;
+                    if (BlocksOctantSight(map, octant, sourceX, sourceY, centreColumn, j + 1)) {
+                        blockHi.num += 2;
+                    } else if (CompareSlopes(blockLo, range.lo) != 0) {
+                        continue;
+                    }
+                    
+                    if (SlopeRangeMeets(&range, blockLo, blockHi) &&
+                        !BlockSlopes(scratch, current, &count, &range, blockLo, blockHi)) {
+                        return false;
+                    }
+                }
+                
+                if (!PushSlopeRange(scratch, current, &count, range)) return false;
+            }
+        } else {
+            current ^= 1;
+            count = nextCount;
+        }
+    }
+    
+    return true;
+}
+
+static void ComputePVSSource(PVS* pvs, const Map* map, PVSScratch* scratch, int sourceX, int sourceY) {
+    PVSSource* source = &pvs->sources[sourceY * pvs->width + sourceX];
+    
+    scratch->minX = scratch->minY = 0x7fffffff;
+    scratch->maxX = scratch->maxY = -1;
+    MarkScratchTile(scratch, map->width, sourceX, sourceY);
+    
+    bool ok = true;
+    for (int o = 0; o < 8 && ok; o++) {
+        ok = CastPVSOctant(map, scratch, PVS_OCTANTS[o], sourceX, sourceY);
+    }
+    
+    // Compact into the bounding rectangle and clear the scratch rows we touched
+    int w = scratch->maxX - scratch->minX + 1;
+    int h = scratch->maxY - scratch->minY + 1;
+    uint64_t* bits = ok ? calloc(((size_t)w * h + 63) / 64, sizeof(uint64_t)) : NULL;
+    
+    for (int y = scratch->minY; y <= scratch->maxY; y++) {
+        for (int x = scratch->minX; x <= scratch->maxX; x++) {
+            int index = y * map->width + x;
+            uint64_t mask = 1ull << (index & 63);
+            if (!(scratch->bits[index >> 6] & mask)) continue;
+            
+            scratch->bits[index >> 6] &= ~mask;
+            if (bits != NULL) {
+                int bit = (y - scratch->minY) * w + (x - scratch->minX);
+                bits[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+    }
+    
+    free(source->bits);
+    if (bits == NULL) {
+        // Out of memory: leave the source dirty so queries stay conservative
+        source->bits = NULL;
+        source->w = source->h = 0;
+        source->dirty = true;
+        return;
+    }
+    
+    source->x0 = scratch->minX;
+    source->y0 = scratch->minY;
+    source->w = w;
+    source->h = h;
+    source->bits = bits;
+    source->dirty = false;
+}
+
+static void BuildPVSRow(void* userData, int jobIndex, int threadIndex) {
+    PVSBuildJob* job = (PVSBuildJob*)userData;
+    
+    for (int x = 0; x < job->pvs->width; x++) {
+        ComputePVSSource(job->pvs, job->map, &job->scratch[threadIndex], x, jobIndex);
+    }
+}
+
+static bool AllocPVSScratch(PVSScratch* scratch, const Map* map) {
+    memset(scratch, 0, sizeof(*scratch));
+    scratch->bits = calloc(((size_t)map->width * map->height + 63) / 64, sizeof(uint64_t));
+    return scratch->bits != NULL;
+}
+
+static void FreePVSScratch(PVSScratch* scratch) {
+    free(scratch->bits);
+    free(scratch->ranges[0]);
+    free(scratch->ranges[1]);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+bool BuildPVS(PVS* pvs, const Map* map, WorkerPool* pool) {
+    memset(pvs, 0, sizeof(*pvs));
+    
+    if (map->width <= 0 || map->height <= 0) return false;
+    
+    pvs->sources = calloc((size_t)map->width * map->height, sizeof(PVSSource));
+    if (pvs->sources == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate PVS for %dx%d map", map->width, map->height);
+        return false;
+    }
+    pvs->width = map->width;
+    pvs->height = map->height;
+    
+    int threadCount = (pool != NULL) ? pool->threadCount : 1;
+    PVSScratch scratch[MAX_WORKER_THREADS] = { 0 };
+    bool ok = true;
+    
+    for (int i = 0; i < threadCount && ok; i++) {
+        ok = AllocPVSScratch(&scratch[i], map);
+    }
+    
+    if (ok) {
+        PVSBuildJob job = { pvs, map, scratch };
+        
+        if (pool != NULL) {
+            RunWorkerJobs(pool, BuildPVSRow, &job, map->height);
+        } else {
+            for (int y = 0; y < map->height; y++) BuildPVSRow(&job, y, 0);
+        }
+    } else {
+        TraceLog(LOG_WARNING, "Failed to allocate PVS scratch buffers");
+    }
+    
+    for (int i = 0; i < threadCount; i++) FreePVSScratch(&scratch[i]);
+    
+    if (!ok) {
+        UnloadPVS(pvs);
+        return false;
+    }
+    
+    // Sources whose bitset could not be allocated were left dirty
+    for (int i = 0; i < pvs->width * pvs->height; i++) {
+        if (pvs->sources[i].dirty) pvs->dirtyCount++;
+    }
+    
+    return true;
+}
+
+void UnloadPVS(PVS* pvs) {
+    if (pvs->sources != NULL) {
+        for (int i = 0; i < pvs->width * pvs->height; i++) {
+            free(pvs->sources[i].bits);
+        }
+        free(pvs->sources);
+    }
+    
+    memset(pvs, 0, sizeof(*pvs));
+}
+
+void InvalidatePVSTile(PVS* pvs, int x, int y) {
+    if (pvs == NULL || pvs->sources == NULL) return;
+    if (x < 0 || y < 0 || x >= pvs->width || y >= pvs->height) return;
+    
+    // A shrunk wall reaches halfway into its neighbours, so a source that sees
+    // neither the changed tile nor its neighbours cannot see past it either;
+    // only sources with one of them in their set (and the tile itself) change
+    for (int sy = 0; sy < pvs->height; sy++) {
+        for (int sx = 0; sx < pvs->width; sx++) {
+            PVSSource* source = &pvs->sources[sy * pvs->width + sx];
+            if (source->dirty) continue;
+            
+            bool affected = (sx == x && sy == y) || IsRegionVisibleFrom(pvs, sx, sy, x - 1, y - 1, x + 1, y + 1);
+            if (!affected) continue;
+            
+            source->dirty = true;
+            pvs->dirtyCount++;
+        }
+    }
+}
+
+int UpdatePVS(PVS* pvs, const Map* map, int budget) {
+    if (pvs == NULL || pvs->dirtyCount == 0) return 0;
+    if (pvs->width != map->width || pvs->height != map->height) return 0;
+    
+    PVSScratch scratch;
+    if (!AllocPVSScratch(&scratch, map)) return 0;
+    
+    int rebuilt = 0;
+    int sourceCount = pvs->width * pvs->height;
+    
+    for (int i = 0; i < sourceCount && rebuilt < budget && pvs->dirtyCount > 0; i++) {
+        if (!pvs->sources[i].dirty) continue;
+        
+        ComputePVSSource(pvs, map, &scratch, i % pvs->width, i / pvs->width);
+        if (!pvs->sources[i].dirty) pvs->dirtyCount--;
+        rebuilt++;
+    }
+    
+    FreePVSScratch(&scratch);
+    return rebuilt;
+}
+
+bool IsRegionVisibleFrom(const PVS* pvs, int fromX, int fromY, int x0, int y0, int x1, int y1) {
+    if (pvs == NULL) return true;
+    if ((unsigned int)fromX >= (unsigned int)pvs->width || (unsigned int)fromY >= (unsigned int)pvs->height) return true;
+    
+    const PVSSource* source = &pvs->sources[fromY * pvs->width + fromX];
+    if (source->dirty) return true;
+    
+    // Clip the region to the source's visible rectangle
+    if (x0 < source->x0) x0 = source->x0;
+    if (y0 < source->y0) y0 = source->y0;
+    if (x1 > source->x0 + source->w - 1) x1 = source->x0 + source->w - 1;
+    if (y1 > source->y0 + source->h - 1) y1 = source->y0 + source->h - 1;
+    if (x0 > x1 || y0 > y1) return false;
+    
+    for (int y = y0; y <= y1; y++) {
+        // Each clipped row is a contiguous bit range
+        int first = (y - source->y0) * source->w + (x0 - source->x0);
+        int last = first + (x1 - x0);
+        
+        for (int word = first >> 6; word <= (last >> 6); word++) {
+            uint64_t mask = ~0ull;
+            if (word == (first >> 6)) mask &= ~0ull << (first & 63);
+            if (word == (last >> 6)) mask &= ~0ull >> (63 - (last & 63));
+            if (source->bits[word] & mask) return true;
+        }
+    }
+    
+    return false;
+}
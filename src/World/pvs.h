@@ -0,0 +1,63 @@
+#ifndef PVS_H
+#define PVS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../Core/worker_pool.h"
+
+struct Map;
+
+#define PVS_REBUILD_BUDGET 16      // Invalidated source tiles recomputed per UpdatePVS call
+#define PVS_MAX_LOAD_TILES 16384   // Bigger levels skip the build at load (seconds on open layouts) and go without
+
+// Visibility from one source tile, stored as a bitset over the bounding
+// rectangle of everything it can see (bit (y - y0) * w + (x - x0))
+typedef struct PVSSource {
+    int x0, y0;                // Top-left of the visible rectangle
+    int w, h;                  // Size of the visible rectangle, 0 when nothing is visible
+    uint64_t* bits;
+    bool dirty;                // Invalidated by a tile change; treated as "sees everything"
+} PVSSource;
+
+// Potentially visible set: for every tile, the tiles a sight line starting
+// anywhere inside it can reach. Built by an exact shadow cast from the tile's
+// centre against the walls shrunk by half a tile, which hides nothing that a
+// point of the tile can see, so the set is conservative: it may hold a few
+// tiles no sight line reaches (lone pillars hide nothing at all), but never
+// leaves out one that some sight line does. tests/test_pvs.c checks this
+// against brute-force sight lines on the built-in map.
+typedef struct PVS {
+    int width, height;
+    PVSSource* sources;        // width * height, row-major
+    int dirtyCount;
+} PVS;
+
+bool BuildPVS(PVS* pvs, const struct Map* map, WorkerPool* pool); // pool may be NULL to build inline
+void UnloadPVS(PVS* pvs);
+
+// Marks every source that could see the tile or a neighbour as dirty; called by SetMapTile
+void InvalidatePVSTile(PVS* pvs, int x, int y);
+
+// Recomputes up to `budget` dirty sources, returns how many were rebuilt
+int UpdatePVS(PVS* pvs, const struct Map* map, int budget);
+
+// True when any tile of the inclusive rectangle is visible from the source tile
+bool IsRegionVisibleFrom(const PVS* pvs, int fromX, int fromY, int x0, int y0, int x1, int y1);
+
+// O(1) visibility test; unknown or dirty sources conservatively see everything
+static inline bool IsTileVisibleFrom(const PVS* pvs, int fromX, int fromY, int toX, int toY) {
+    if (pvs == NULL) return true;
+    if ((unsigned int)fromX >= (unsigned int)pvs->width || (unsigned int)fromY >= (unsigned int)pvs->height) return true;
+    
+    const PVSSource* source = &pvs->sources[fromY * pvs->width + fromX];
+    if (source->dirty) return true;
+    
+    int localX = toX - source->x0;
+    int localY = toY - source->y0;
+    if ((unsigned int)localX >= (unsigned int)source->w || (unsigned int)localY >= (unsigned int)source->h) return false;
+    
+    int bit = localY * source->w + localX;
+    return (source->bits[bit >> 6] >> (bit & 63)) & 1;
+}
+
+#endif // PVS_H
@@ -0,0 +1,177 @@
+#include "sprites.h"
+#include <stdlib.h>
+
+#define SPRITE_INITIAL_CAPACITY 256
+
+// Bucket for a world position, clamped to the grid
+static int GetSpriteTile(const SpriteList* list, Vector2 position) {
+    int x = (int)(position.x / TILE_SIZE);
+    int y = (int)(position.y / TILE_SIZE);
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x >= list->width) x = list->width - 1;
+    if (y >= list->height) y = list->height - 1;
+    return y * list->width + x;
+}
+
+static void LinkSprite(SpriteList* list, int id, int tile) {
+    Sprite* sprite = &list->sprites[id];
+    int bucket = GetSpriteBucket(list, tile);
+    int head = list->buckets[bucket];
+    
+    sprite->tile = tile;
+    sprite->prev = -1;
+    sprite->next = head;
+    if (head >= 0) list->sprites[head].prev = id;
+    list->buckets[bucket] = id;
+}
+
+static void UnlinkSprite(SpriteList* list, int id) {
+    Sprite* sprite = &list->sprites[id];
+    
+    if (sprite->prev >= 0) {
+        list->sprites[sprite->prev].next = sprite->next;
+    } else {
+        list->buckets[GetSpriteBucket(list, sprite->tile)] = sprite->next;
+    }
+    if (sprite->next >= 0) list->sprites[sprite->next].prev = sprite->prev;
+}
+
+// Sizes the bucket table to count (a power of two) and relinks every sprite
+static bool ResizeSpriteBuckets(SpriteList* list, int count) {
+    int* buckets = (int*)malloc((size_t)count * sizeof(int));
+    if (buckets == NULL) {
+        TraceLog(LOG_WARNING, "Failed to allocate %d sprite buckets", count);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        buckets[i] = -1;
+    }
+    
+    free(list->buckets);
+    list->buckets = buckets;
+    list->bucketCount = count;
+    list->bucketShift = 32;
+    for (int i = count; i > 1; i >>= 1) {
+        list->bucketShift--;
+    }
+    
+    for (int id = 0; id < list->used; id++) {
+        if (list->sprites[id].texture >= 0) LinkSprite(list, id, list->sprites[id].tile);
+    }
+    return true;
+}
+
+bool InitSpriteList(SpriteList* list, int width, int height) {
+    list->sprites = NULL;
+    list->capacity = 0;
+    list->used = 0;
+    list->activeCount = 0;
+    list->freeHead = -1;
+    list->version = 0;
+    list->width = width;
+    list->height = height;
+    list->buckets = NULL;
+    list->bucketCount = 0;
+    
+    if (!ResizeSpriteBuckets(list, SPRITE_INITIAL_CAPACITY)) {
+        list->width = list->height = 0;
+        return false;
+    }
+    return true;
+}
+
+void UnloadSpriteList(SpriteList* list) {
+    free(list->sprites);
+    free(list->buckets);
+    list->sprites = NULL;
+    list->buckets = NULL;
+    list->bucketCount = 0;
+    list->capacity = list->used = list->activeCount = 0;
+    list->freeHead = -1;
+}
+
+int AddSprite(SpriteList* list, Vector2 position, int texture, float scale) {
+    if (list->buckets == NULL) return -1;
+    
+    int id;
+    if (list->freeHead >= 0) {
+        id = list->freeHead;
+        list->freeHead = list->sprites[id].next;
+    } else {
+        if (list->used == list->capacity) {
+            int capacity = (list->capacity > 0) ? list->capacity * 2 : SPRITE_INITIAL_CAPACITY;
+            Sprite* sprites = (Sprite*)realloc(list->sprites, (size_t)capacity * sizeof(Sprite));
+            if (sprites == NULL) {
+                TraceLog(LOG_WARNING, "Failed to grow the sprite list to %d sprites", capacity);
+                return -1;
+            }
+            list->sprites = sprites;
+            list->capacity = capacity;
+            
+            // Keep the buckets about one sprite deep; the old table still
+            // works if the bigger one cannot be had
+            if (capacity > list->bucketCount) ResizeSpriteBuckets(list, capacity);
+        }
+        id = list->used++;
+    }
+    
+    Sprite* sprite = &list->sprites[id];
+    sprite->position = position;
+    sprite->scale = scale;
+    sprite->texture = texture;
+    LinkSprite(list, id, GetSpriteTile(list, position));
+    
+    list->activeCount++;
+    list->version++;
+    return id;
+}
+
+void RemoveSprite(SpriteList* list, int id) {
+    if (id < 0 || id >= list->used || list->sprites[id].texture < 0) return;
+    
+    UnlinkSprite(list, id);
+    list->sprites[id].texture = -1;
+    list->sprites[id].next = list->freeHead;
+    list->freeHead = id;
+    list->activeCount--;
+    list->version++;
+}
+
+void MoveSprite(SpriteList* list, int id, Vector2 position) {
+    if (id < 0 || id >= list->used || list->sprites[id].texture < 0) return;
+    
+    Sprite* sprite = &list->sprites[id];
+    if (sprite->position.x == position.x && sprite->position.y == position.y) return;
+    sprite->position = position;
+    list->version++;
+    
+    int tile = GetSpriteTile(list, position);
+    if (tile != sprite->tile) {
+        UnlinkSprite(list, id);
+        LinkSprite(list, id, tile);
+    }
+}
+
+void SpawnMapSprites(SpriteList* list, const Map* map) {
+    // Fixed pattern so every run (and replay) sees the same layout
+    unsigned int seed = 2024u;
+    
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            if (GetMapTile(map, x, y) != TILE_EMPTY) continue;
+            
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 24) % 6 != 0) continue;
+            
+            // Somewhere inside the tile, away from the walls
+            float offsetX = 0.25f + ((seed >> 8) & 0xff) / 512.0f;
+            float offsetY = 0.25f + ((seed >> 16) & 0xff) / 512.0f;
+            int texture = (seed >> 4) % SPRITE_TEXTURE_COUNT;
+            
+            AddSprite(list, (Vector2){ (x + offsetX) * TILE_SIZE, (y + offsetY) * TILE_SIZE }, texture, 0.6f);
+        }
+    }
+    
+    TraceLog(LOG_INFO, "Spawned %d sprites", list->activeCount);
+}
@@ -0,0 +1,68 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include "raylib.h"
+#include "map.h"
+
+#define SPRITE_TEXTURE_COUNT 8   // Matches GameTextures.sprites
+
+// A billboard in the world: pickup, decoration or enemy
+typedef struct Sprite {
+    Vector2 position;   // World units
+    float scale;        // 1 = as tall as a wall
+    int texture;        // Index into the sprite textures, -1 for a free slot
+    int tile;           // Tile the sprite stands on (y * width + x)
+    int prev, next;     // Neighbours in the bucket list (next also links the free list)
+} Sprite;
+
+// Sprites bucketed by the tile they stand on. The tiles are hashed into a
+// table with at least as many buckets as sprite slots, each heading an
+// intrusive doubly linked list, so adding, removing and moving a sprite are
+// O(1), the renderer only visits the sprites of tiles it can see, and the
+// table grows with the sprites instead of the map.
+typedef struct SpriteList {
+    Sprite* sprites;    // Slots, indices stay stable for the sprite's lifetime
+    int capacity;
+    int used;           // Slots handed out so far (high-water mark)
+    int activeCount;
+    int freeHead;       // First recycled slot, -1 when none
+    int* buckets;       // Bucket heads, -1 when empty
+    int bucketCount;    // Power of two, at least the capacity
+    int bucketShift;    // 32 - log2(bucketCount), for the hash
+    int width, height;  // Grid size in tiles
+    unsigned int version; // Bumped by every add, remove and move
+} SpriteList;
+
+bool InitSpriteList(SpriteList* list, int width, int height);
+void UnloadSpriteList(SpriteList* list);
+int AddSprite(SpriteList* list, Vector2 position, int texture, float scale); // Returns the sprite id or -1
+void RemoveSprite(SpriteList* list, int id);
+void MoveSprite(SpriteList* list, int id, Vector2 position);                  // Relinks only when the tile changes
+void SpawnMapSprites(SpriteList* list, const Map* map);                     // Scatter placeholder pickups and decorations
+
+// Bucket of a tile. Fibonacci hashing spreads neighbouring tiles, which are
+// visited together, over the whole table.
+static inline int GetSpriteBucket(const SpriteList* list, int tile) {
+    return (int)(((uint32_t)tile * 2654435769u) >> list->bucketShift);
+}
+
+// First sprite at or after id in its bucket that stands on tile, -1 when none
+static inline int FindSpriteInTile(const SpriteList* list, int id, int tile) {
+    while (id >= 0 && list->sprites[id].tile != tile) id = list->sprites[id].next;
+    return id;
+}
+
+// First sprite on a tile, -1 when empty or out of bounds; continue with
+// GetNextSpriteInTile
+static inline int GetFirstSpriteInTile(const SpriteList* list, int x, int y) {
+    if ((unsigned int)x >= (unsigned int)list->width || (unsigned int)y >= (unsigned int)list->height) return -1;
+    int tile = y * list->width + x;
+    return FindSpriteInTile(list, list->buckets[GetSpriteBucket(list, tile)], tile);
+}
+
+// Next sprite on the same tile as id, -1 after the last
+static inline int GetNextSpriteInTile(const SpriteList* list, int id) {
+    return FindSpriteInTile(list, list->sprites[id].next, list->sprites[id].tile);
+}
+
+#endif // SPRITES_H
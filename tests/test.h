@@ -0,0 +1,63 @@
+#ifndef TEST_H
+#define TEST_H
+
+// Minimal helpers shared by the headless tests in this directory. Each test is
+// its own executable that returns non-zero when a check failed; ctest (or
+// make test) runs them all. No window or GL context is ever created.
+
+#include "World/map.h"
+#include <stdio.h>
+#include <string.h>
+
+static int testFailures = 0;
+
+// Reports a failed condition and keeps going, so one run shows every failure
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        testFailures++; \
+    } \
+} while (0)
+
+#define CHECK_INT(actual, expected) do { \
+    long long checkActual = (long long)(actual); \
+    long long checkExpected = (long long)(expected); \
+    if (checkActual != checkExpected) { \
+        fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, checkActual, checkExpected); \
+        testFailures++; \
+    } \
+} while (0)
+
+// Ends main: prints a summary line and turns the failure count into the exit code
+static inline int FinishTest(const char* name) {
+    if (testFailures > 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+// Builds a map from rows of a text layout, one character per tile:
+// '#' wall, '.' empty, 'D' door, 'S' secret wall, 'O' obstacle
+static inline bool InitTestMap(Map* map, const char* const* rows, int rowCount) {
+    int width = (int)strlen(rows[0]);
+    if (!InitMapGrid(map, width, rowCount)) return false;
+    
+    for (int y = 0; y < rowCount; y++) {
+        for (int x = 0; x < width; x++) {
+            int tile = TILE_EMPTY;
+            switch (rows[y][x]) {
+                case '#': tile = TILE_WALL; break;
+                case 'D': tile = TILE_DOOR; break;
+                case 'S': tile = TILE_SECRET_WALL; break;
+                case 'O': tile = TILE_OBSTACLE; break;
+                default: break;
+            }
+            SetMapTile(map, x, y, tile);
+        }
+    }
+    return true;
+}
+
+#endif // TEST_H
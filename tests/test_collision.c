@@ -0,0 +1,229 @@
+// Checks swept circle collision (World/collision.h): contact with a convex
+// corner, sliding along a wall made of many tiles, a fast move that clips a
+// corner without its centre line ever entering the tile, a circle whose
+// centre starts inside a door that shut on it, and the exact overlap test.
+// A random run then sweeps circles of many sizes across a cluttered map and
+// checks that no point of any path overlaps a wall.
+
+#include "test.h"
+#include "World/collision.h"
+#include <math.h>
+
+#define RADIUS (0.2f * TILE_SIZE)
+#define SWEEP_COUNT 20000
+#define MAP_WIDTH 40
+#define MAP_HEIGHT 32
+
+static const char* const ROOM[] = {
+    "####################",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#.....#............#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "#..................#",
+    "####################",
+};
+
+// A door between two rooms, a door opening only upwards and a door walled
+// in on every side
+static const char* const DOORS[] = {
+    "#########",
+    "#.......#",
+    "###D#####",
+    "#.......#",
+    "#####D###",
+    "#######D#",
+    "#########",
+};
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static Vector2 TilePoint(float x, float y) {
+    return (Vector2){ x * TILE_SIZE, y * TILE_SIZE };
+}
+
+static bool Near(float a, float b, float tolerance) {
+    return fabsf(a - b) <= tolerance;
+}
+
+// A circle heading straight at the top-left corner of the pillar at (6, 5)
+// touches it on the diagonal, one radius from the corner
+static void CheckCornerContact(const Map* map) {
+    Vector2 start = TilePoint(4.0f, 3.0f);
+    CollisionHit hit = SweepCircle(map, start, TilePoint(3.0f, 3.0f), RADIUS);
+    CHECK(hit.hit);
+    CHECK(Near(hit.normal.x, -sqrtf(0.5f), 1e-3f));
+    CHECK(Near(hit.normal.y, -sqrtf(0.5f), 1e-3f));
+    
+    Vector2 corner = TilePoint(6.0f, 5.0f);
+    Vector2 contact = { start.x + 3.0f * TILE_SIZE * hit.time, start.y + 3.0f * TILE_SIZE * hit.time };
+    CHECK(Near(hypotf(contact.x - corner.x, contact.y - corner.y), RADIUS, 1e-2f));
+    CHECK(!IsCircleBlocked(map, hit.position, RADIUS));
+    
+    // Passing the same corner a little over one radius away touches nothing
+    CollisionHit miss = SweepCircle(map, TilePoint(2.0f, 5.0f - 0.21f), TilePoint(3.5f, 0.0f), RADIUS);
+    CHECK(!miss.hit);
+}
+
+// Pushing into the top wall at a slant slides along it: all of the motion
+// along the wall survives, none of the motion into it, and the seams between
+// its tiles do not catch the circle
+static void CheckWallSlide(const Map* map) {
+    Vector2 start = TilePoint(2.5f, 1.5f);
+    Vector2 delta = TilePoint(12.0f, -2.0f);
+    CollisionHit hit;
+    Vector2 end = SlideCircle(map, start, delta, RADIUS, &hit);
+    CHECK(hit.hit);
+    CHECK(Near(hit.normal.x, 0.0f, 0.0f) && Near(hit.normal.y, 1.0f, 0.0f));
+    CHECK(Near(end.x, start.x + delta.x, 0.5f));
+    CHECK(Near(end.y, TILE_SIZE + RADIUS, 2.0f * COLLISION_SKIN));
+    CHECK(!IsCircleBlocked(map, end, RADIUS));
+}
+
+// One tick moving 12 tiles diagonally: the centre line passes 0.1 tiles
+// beside the top-right corner of the pillar at (6, 5) and never enters it, so
+// only the swept circle meets it, before its closest approach at x = 7.07
+static void CheckCornerTunnelling(const Map* map) {
+    Vector2 start = TilePoint(3.5f, 3.5f - 2.14f);
+    Vector2 delta = TilePoint(12.0f, 12.0f);
+    CollisionHit hit = SweepCircle(map, start, delta, RADIUS);
+    CHECK(hit.hit);
+    CHECK(hit.position.x < 7.07f * TILE_SIZE);
+    CHECK(!IsCircleBlocked(map, hit.position, RADIUS));
+    
+    Vector2 end = SlideCircle(map, start, delta, RADIUS, NULL);
+    CHECK(!IsCircleBlocked(map, end, RADIUS));
+}
+
+// A door closes on a circle standing in its tile (3, 2): it can walk out
+// either open side, walking along the door stops at the walls beside it,
+// and a dead-end door only lets it out the open way
+static void CheckBuriedStart(Map* map) {
+    Vector2 start = TilePoint(3.5f, 2.4f);
+    CHECK(IsCircleBlocked(map, start, RADIUS));
+    
+    Vector2 up = SlideCircle(map, start, TilePoint(0.0f, -0.8f), RADIUS, NULL);
+    CHECK(Near(up.y, TilePoint(0.0f, 1.6f).y, 1e-3f));
+    CHECK(!IsCircleBlocked(map, up, RADIUS));
+    Vector2 down = SlideCircle(map, start, TilePoint(0.3f, 1.0f), RADIUS, NULL);
+    CHECK(!IsCircleBlocked(map, down, RADIUS));
+    
+    // Along the door the walls stop it a radius short of their faces
+    Vector2 left = SlideCircle(map, start, TilePoint(-2.0f, 0.0f), RADIUS, NULL);
+    CHECK(left.x >= 3.0f * TILE_SIZE + RADIUS - 1e-3f);
+    CHECK(Near(left.y, start.y, 0.0f));
+    Vector2 right = SlideCircle(map, start, TilePoint(2.0f, 0.0f), RADIUS, NULL);
+    CHECK(right.x <= 4.0f * TILE_SIZE - RADIUS + 1e-3f);
+    
+    // The door at (5, 4) only opens upwards: a push down stays put, a push
+    // down and to the right only moves along the door, a push up gets out
+    Vector2 deadEnd = TilePoint(5.5f, 4.7f);
+    Vector2 blocked = SlideCircle(map, deadEnd, TilePoint(0.0f, 0.5f), RADIUS, NULL);
+    CHECK(Near(blocked.x, deadEnd.x, 0.0f) && Near(blocked.y, deadEnd.y, 0.0f));
+    CollisionHit hit = SweepCircle(map, deadEnd, TilePoint(0.0f, 0.5f), RADIUS);
+    CHECK(hit.hit);
+    CHECK_INT((int)hit.normal.y, -1);
+    Vector2 slanted = SlideCircle(map, deadEnd, TilePoint(0.2f, 0.5f), RADIUS, NULL);
+    CHECK(Near(slanted.y, deadEnd.y, 0.0f));
+    CHECK(slanted.x > deadEnd.x);
+    Vector2 out = SlideCircle(map, deadEnd, TilePoint(0.0f, -1.2f), RADIUS, NULL);
+    CHECK(Near(out.y, TilePoint(0.0f, 3.5f).y, 1e-3f));
+    
+    // Walled in on every side at (7, 5): nothing moves it
+    Vector2 sealed = TilePoint(7.5f, 5.5f);
+    Vector2 stuck = SlideCircle(map, sealed, TilePoint(0.7f, 0.3f), RADIUS, NULL);
+    CHECK(Near(stuck.x, sealed.x, 0.0f) && Near(stuck.y, sealed.y, 0.0f));
+}
+
+static void CheckOverlap(const Map* map) {
+    // Just clear of a face or a corner is no overlap, just past it is
+    CHECK(!IsCircleBlocked(map, (Vector2){ 6.0f * TILE_SIZE - RADIUS - 0.01f, 5.5f * TILE_SIZE }, RADIUS));
+    CHECK(IsCircleBlocked(map, (Vector2){ 6.0f * TILE_SIZE - RADIUS + 0.01f, 5.5f * TILE_SIZE }, RADIUS));
+    float diagonal = RADIUS * sqrtf(0.5f);
+    CHECK(!IsCircleBlocked(map, (Vector2){ 7.0f * TILE_SIZE + diagonal + 0.01f, 6.0f * TILE_SIZE + diagonal + 0.01f }, RADIUS));
+    CHECK(IsCircleBlocked(map, (Vector2){ 7.0f * TILE_SIZE + diagonal - 0.01f, 6.0f * TILE_SIZE + diagonal - 0.01f }, RADIUS));
+}
+
+// Random walls, then random sweeps of up to six tiles from free spots: every
+// point up to the stop (sampled a unit apart) is clear of the walls, and so
+// is the end of the slide that follows
+static void CheckRandomSweeps(void) {
+    unsigned int seed = 555u;
+    Map map;
+    InitMapGrid(&map, MAP_WIDTH, MAP_HEIGHT);
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            bool border = x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1;
+            SetMapTile(&map, x, y, (border || NextRandom(&seed) % 100 < 15) ? TILE_WALL : TILE_EMPTY);
+        }
+    }
+    
+    int hits = 0, overlaps = 0, slideOverlaps = 0;
+    for (int i = 0; i < SWEEP_COUNT; i++) {
+        float radius = (0.1f + (float)(NextRandom(&seed) % 36) / 100.0f) * TILE_SIZE;
+        Vector2 start = {
+            (float)(NextRandom(&seed) % (MAP_WIDTH * 256)) / 256.0f * TILE_SIZE,
+            (float)(NextRandom(&seed) % (MAP_HEIGHT * 256)) / 256.0f * TILE_SIZE
+        };
+        if (IsCircleBlocked(&map, start, radius)) continue;
+        
+        float angle = (float)(NextRandom(&seed) % 3600) / 3600.0f * 2.0f * PI;
+        float length = (float)(NextRandom(&seed) % 600) / 100.0f * TILE_SIZE;
+        Vector2 delta = { cosf(angle) * length, sinf(angle) * length };
+        
+        CollisionHit hit = SweepCircle(&map, start, delta, radius);
+        hits += hit.hit;
+        int samples = (int)hit.distance + 1;
+        for (int s = 0; s <= samples; s++) {
+            float t = (float)s / samples;
+            Vector2 point = { start.x + (hit.position.x - start.x) * t, start.y + (hit.position.y - start.y) * t };
+            if (IsCircleBlocked(&map, point, radius - 0.01f)) {
+                if (overlaps++ == 0) {
+                    fprintf(stderr, "sweep from (%g, %g) by (%g, %g) radius %g overlaps a wall at (%g, %g)\n",
+                            start.x, start.y, delta.x, delta.y, radius, point.x, point.y);
+                }
+                break;
+            }
+        }
+        
+        Vector2 end = SlideCircle(&map, start, delta, radius, NULL);
+        slideOverlaps += IsCircleBlocked(&map, end, radius - 0.01f);
+    }
+    CHECK_INT(overlaps, 0);
+    CHECK_INT(slideOverlaps, 0);
+    CHECK(hits > SWEEP_COUNT / 10);
+    printf("random sweeps: %d of %d hit a wall\n", hits, SWEEP_COUNT);
+    
+    UnloadMapGrid(&map);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    Map room, doors;
+    CHECK(InitTestMap(&room, ROOM, sizeof(ROOM) / sizeof(ROOM[0])));
+    CHECK(InitTestMap(&doors, DOORS, sizeof(DOORS) / sizeof(DOORS[0])));
+    
+    CheckCornerContact(&room);
+    CheckWallSlide(&room);
+    CheckCornerTunnelling(&room);
+    CheckBuriedStart(&doors);
+    CheckOverlap(&room);
+    CheckRandomSweeps();
+    
+    UnloadMapGrid(&room);
+    UnloadMapGrid(&doors);
+    return FinishTest("test_collision");
+}
@@ -0,0 +1,205 @@
+// Records one GPU frame through the draw list (Rendering/draw_list.h) with the
+// recording backend: the floor, the ceiling and the wall chunks of a small
+// map, queued out of order. Checks that submission sorts the draws by state
+// (each shader and texture bound once, in one contiguous run) and that the
+// uniform shadow copy suppresses uploads of values the shader already holds.
+
+#include "test.h"
+#include "Rendering/draw_list.h"
+#include "Rendering/wall_mesh.h"
+#include "raymath.h"
+
+// Two chunks of walls (WALL_CHUNK_SIZE is 16), so the walls are several draws
+static const char* const LAYOUT[] = {
+    "######################",
+    "#....................#",
+    "#....##........##....#",
+    "#....................#",
+    "######################",
+};
+
+// Uniform locations past the standard ones
+enum { LOC_FOG = SHADER_LOC_MAP_EMISSION + 1, LOC_CAMERA, LOC_IS_CEILING };
+
+#define MAX_TRACED_DRAWS 64
+
+// Wraps the recorder and also notes the state of every draw, in submission order
+typedef struct DrawTrace {
+    DrawRecorder recorder;
+    DrawBackend inner;
+    unsigned int shader[MAX_TRACED_DRAWS];
+    unsigned int texture[MAX_TRACED_DRAWS];
+    int count;
+} DrawTrace;
+
+static void TraceBegin(void* context) {
+    DrawTrace* trace = (DrawTrace*)context;
+    trace->inner.begin(trace->inner.context);
+}
+
+static void TraceBindShader(void* context, Shader shader) {
+    DrawTrace* trace = (DrawTrace*)context;
+    trace->inner.bindShader(trace->inner.context, shader);
+}
+
+static void TraceBindTexture(void* context, Texture2D texture) {
+    DrawTrace* trace = (DrawTrace*)context;
+    trace->inner.bindTexture(trace->inner.context, texture);
+}
+
+static void TraceSetUniform(void* context, int location, const void* value, int type) {
+    DrawTrace* trace = (DrawTrace*)context;
+    trace->inner.setUniform(trace->inner.context, location, value, type);
+}
+
+static void TraceDrawMesh(void* context, Shader shader, const Mesh* mesh, Matrix transform) {
+    DrawTrace* trace = (DrawTrace*)context;
+    if (trace->count < MAX_TRACED_DRAWS) {
+        trace->shader[trace->count] = trace->recorder.boundShader;
+        trace->texture[trace->count] = trace->recorder.boundTexture;
+        trace->count++;
+    }
+    trace->inner.drawMesh(trace->inner.context, shader, mesh, transform);
+}
+
+static void TraceEnd(void* context) {
+    DrawTrace* trace = (DrawTrace*)context;
+    trace->inner.end(trace->inner.context);
+}
+
+static DrawBackend GetTraceBackend(DrawTrace* trace) {
+    memset(trace, 0, sizeof(*trace));
+    trace->inner = GetRecordingDrawBackend(&trace->recorder);
+    return (DrawBackend){
+        .context = trace,
+        .begin = TraceBegin,
+        .bindShader = TraceBindShader,
+        .bindTexture = TraceBindTexture,
+        .setUniform = TraceSetUniform,
+        .drawMesh = TraceDrawMesh,
+        .end = TraceEnd,
+    };
+}
+
+typedef struct TestScene {
+    int wallLocs[32];
+    int flatLocs[32];
+    MaterialMap wallMap, floorMap, ceilingMap;
+    Material wallMaterial, floorMaterial, ceilingMaterial;
+    Mesh plane;                // Stands in for the floor and ceiling planes, never drawn
+} TestScene;
+
+static void InitTestScene(TestScene* scene) {
+    memset(scene, 0, sizeof(*scene));
+    for (int i = 0; i < 32; i++) {
+        scene->wallLocs[i] = (i <= SHADER_LOC_MAP_EMISSION) ? i : -1;
+        scene->flatLocs[i] = (i <= SHADER_LOC_MAP_EMISSION) ? i : -1;
+    }
+    
+    // The wall shader gets the higher id so sorting has to move the walls behind the flats
+    scene->wallMap = (MaterialMap){ .texture = { .id = 7 }, .color = WHITE };
+    scene->floorMap = (MaterialMap){ .texture = { .id = 5 }, .color = WHITE };
+    scene->ceilingMap = (MaterialMap){ .texture = { .id = 6 }, .color = WHITE };
+    scene->wallMaterial = (Material){ .shader = { 4, scene->wallLocs }, .maps = &scene->wallMap };
+    scene->floorMaterial = (Material){ .shader = { 3, scene->flatLocs }, .maps = &scene->floorMap };
+    scene->ceilingMaterial = (Material){ .shader = { 3, scene->flatLocs }, .maps = &scene->ceilingMap };
+    scene->plane = (Mesh){ .vertexCount = 4, .triangleCount = 2 };
+}
+
+// A frame like RenderWorldGPU's, but with half the walls queued before the
+// floor and the rest between the floor and the ceiling
+static void BuildFrame(DrawList* list, TestScene* scene, const WallMesh* walls, Vector3 camera) {
+    ClearDrawList(list);
+    
+    Shader wallShader = scene->wallMaterial.shader;
+    Shader flatShader = scene->floorMaterial.shader;
+    SetDrawListUniform(list, wallShader, LOC_FOG, (float[1]){ 0.05f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, LOC_FOG, (float[1]){ 0.05f }, SHADER_UNIFORM_FLOAT);
+    SetDrawListUniform(list, flatShader, LOC_CAMERA, &camera, SHADER_UNIFORM_VEC3);
+    
+    unsigned char firstChunk[2] = { 1, 0 };
+    unsigned char secondChunk[2] = { 0, 1 };
+    AddWallMeshDraws(list, walls, scene->wallMaterial, scene->wallMap.texture, firstChunk);
+    
+    DrawItem* floorDraw = AddDrawListMesh(list, &scene->plane, scene->floorMaterial, MatrixIdentity());
+    CHECK(floorDraw != NULL);
+    if (floorDraw != NULL) SetDrawItemUniform(floorDraw, LOC_IS_CEILING, (int[1]){ 0 }, SHADER_UNIFORM_INT);
+    
+    AddWallMeshDraws(list, walls, scene->wallMaterial, scene->wallMap.texture, secondChunk);
+    
+    DrawItem* ceilingDraw = AddDrawListMesh(list, &scene->plane, scene->ceilingMaterial, MatrixIdentity());
+    CHECK(ceilingDraw != NULL);
+    if (ceilingDraw != NULL) SetDrawItemUniform(ceilingDraw, LOC_IS_CEILING, (int[1]){ 1 }, SHADER_UNIFORM_INT);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    static Map map = { 0 };
+    CHECK(InitTestMap(&map, LAYOUT, (int)(sizeof(LAYOUT) / sizeof(LAYOUT[0]))));
+    WallMesh walls;
+    CHECK(InitWallMesh(&walls, &map, WALL_MESH_DEFAULT_RADIUS, false));
+    CHECK_INT(walls.chunksX * walls.chunksY, 2);
+    
+    TestScene scene;
+    InitTestScene(&scene);
+    DrawList list;
+    CHECK(InitDrawList(&list, 4));
+    DrawTrace trace;
+    
+    // First frame: the 3 list uniforms, one sampler and one colDiffuse per
+    // shader, and isCeiling for the floor and again for the ceiling. The
+    // ceiling's colDiffuse is the floor's and is skipped.
+    BuildFrame(&list, &scene, &walls, (Vector3){ 2.0f, 0.5f, 2.0f });
+    DrawBackend backend = GetTraceBackend(&trace);
+    SubmitDrawList(&list, &backend);
+    
+    CHECK_INT(list.stats.draws, 4);
+    CHECK_INT(trace.recorder.draws, 4);
+    CHECK_INT(list.stats.batches, 3);
+    CHECK_INT(trace.recorder.shaderBinds, 2);
+    CHECK_INT(trace.recorder.textureBinds, 3);
+    CHECK_INT(trace.recorder.redundantBinds, 0);
+    CHECK_INT(list.stats.uniformUploads, 9);
+    CHECK_INT(list.stats.uniformsSkipped, 1);
+    CHECK_INT(trace.recorder.uniformUploads, list.stats.uniformUploads);
+    
+    // Sorted by shader, then texture: the flats first, then both wall chunks together
+    CHECK_INT(trace.count, 4);
+    const unsigned int expectedShader[4] = { 3, 3, 4, 4 };
+    const unsigned int expectedTexture[4] = { 5, 6, 7, 7 };
+    for (int i = 0; i < trace.count; i++) {
+        CHECK_INT(trace.shader[i], expectedShader[i]);
+        CHECK_INT(trace.texture[i], expectedTexture[i]);
+    }
+    
+    // Same frame again: the shaders still hold every value except isCeiling,
+    // which the floor and the ceiling keep flipping
+    BuildFrame(&list, &scene, &walls, (Vector3){ 2.0f, 0.5f, 2.0f });
+    backend = GetTraceBackend(&trace);
+    SubmitDrawList(&list, &backend);
+    CHECK_INT(list.stats.uniformUploads, 2);
+    CHECK_INT(list.stats.uniformsSkipped, 8);
+    CHECK_INT(trace.recorder.uniformUploads, 2);
+    
+    // The camera moved: only its value is uploaded on top of that
+    BuildFrame(&list, &scene, &walls, (Vector3){ 3.0f, 0.5f, 2.0f });
+    backend = GetTraceBackend(&trace);
+    SubmitDrawList(&list, &backend);
+    CHECK_INT(list.stats.uniformUploads, 3);
+    
+    // In order with all state per draw, as plain DrawMesh calls would do it
+    list.batch = false;
+    BuildFrame(&list, &scene, &walls, (Vector3){ 3.0f, 0.5f, 2.0f });
+    backend = GetTraceBackend(&trace);
+    SubmitDrawList(&list, &backend);
+    CHECK_INT(trace.recorder.shaderBinds, 4);
+    CHECK_INT(trace.recorder.textureBinds, 4);
+    CHECK_INT(list.stats.uniformsSkipped, 0);
+    CHECK(list.stats.uniformUploads > 9);
+    
+    UnloadDrawList(&list);
+    UnloadWallMesh(&walls);
+    UnloadMapGrid(&map);
+    return FinishTest("test_draw_list");
+}
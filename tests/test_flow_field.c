@@ -0,0 +1,162 @@
+// Checks that the flow field (World/flow_field.h) stays exactly what a full
+// search would give through a long run of random edits: walls appearing and
+// disappearing, doors opening and closing, the goal walking around and now
+// and then jumping. After every update each tile's distance and direction is
+// compared with a fresh RebuildFlowField toward the goal the field leads to.
+// Searches toward a new goal run on a small budget so they span updates.
+// Some edits rewrite a whole rectangle and are logged as one region change,
+// the way a streamed chunk arrives or leaves.
+
+#include "test.h"
+#include "World/flow_field.h"
+#include "World/collision.h"
+
+#define EDIT_COUNT 60000
+#define MAP_WIDTH 40
+#define MAP_HEIGHT 32
+#define SEARCH_BUDGET 150
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static void InitRandomMap(Map* map, unsigned int* seed) {
+    InitMapGrid(map, MAP_WIDTH, MAP_HEIGHT);
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            bool border = x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1;
+            unsigned int roll = NextRandom(seed) % 100;
+            SetMapTile(map, x, y, (border || roll < 22) ? TILE_WALL : (roll < 27) ? TILE_DOOR : TILE_EMPTY);
+        }
+    }
+}
+
+// Tiles whose distance or direction differ from a full search toward the same goal
+static int CountMismatches(const FlowField* field, FlowField* reference, const Map* map) {
+    reference->goalX = field->goalX;
+    reference->goalY = field->goalY;
+    RebuildFlowField(reference, map);
+    
+    int mismatches = 0;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            if (GetFlowDistance(field, x, y) != GetFlowDistance(reference, x, y) ||
+                GetFlowDirection(field, x, y) != GetFlowDirection(reference, x, y)) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// One edit: a wall knocked out or put up (at rates that keep about a quarter
+// of the map walled), a door toggled, or the goal moved (mostly a step,
+// sometimes anywhere open)
+static void ApplyRandomEdit(Map* map, int* goalX, int* goalY, unsigned int* seed) {
+    unsigned int kind = NextRandom(seed) % 100;
+    int x = 1 + (int)(NextRandom(seed) % (MAP_WIDTH - 2));
+    int y = 1 + (int)(NextRandom(seed) % (MAP_HEIGHT - 2));
+    int tile = GetMapTile(map, x, y);
+    
+    if (kind < 20) {
+        if (tile == TILE_WALL) SetMapTile(map, x, y, TILE_EMPTY);
+    } else if (kind < 27) {
+        if (tile == TILE_EMPTY) SetMapTile(map, x, y, TILE_WALL);
+    } else if (kind < 45) {
+        if (tile == TILE_DOOR || tile == TILE_DOOR_OPEN) SetMapTile(map, x, y, (tile == TILE_DOOR) ? TILE_DOOR_OPEN : TILE_DOOR);
+    } else if (kind < 95) {
+        static const int STEPS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+        int s = (int)(NextRandom(seed) % 4);
+        if (!IsMapCellBlocking(map, *goalX + STEPS[s][0], *goalY + STEPS[s][1])) {
+            *goalX += STEPS[s][0];
+            *goalY += STEPS[s][1];
+        }
+    } else if (!IsMapCellBlocking(map, x, y)) {
+        *goalX = x;
+        *goalY = y;
+    }
+}
+
+// Rewrites a rectangle of up to 12x12 tiles and logs it as one region, like
+// map_stream.c does for a chunk
+static void ApplyRegionEdit(Map* map, unsigned int* seed) {
+    int width = 1 + (int)(NextRandom(seed) % 12);
+    int height = 1 + (int)(NextRandom(seed) % 12);
+    int x0 = 1 + (int)(NextRandom(seed) % (MAP_WIDTH - 1 - width));
+    int y0 = 1 + (int)(NextRandom(seed) % (MAP_HEIGHT - 1 - height));
+    
+    unsigned int revision = map->revision;
+    for (int y = y0; y < y0 + height; y++) {
+        for (int x = x0; x < x0 + width; x++) {
+            SetMapTile(map, x, y, (NextRandom(seed) % 100 < 25) ? TILE_WALL : TILE_EMPTY);
+        }
+    }
+    map->revision = revision;
+    LogMapRegion(map, x0, y0, width, height);
+}
+
+static void RunEdits(int range, unsigned int seed) {
+    Map map;
+    InitRandomMap(&map, &seed);
+    
+    FlowField field, reference;
+    CHECK(InitFlowField(&field, MAP_WIDTH, MAP_HEIGHT, range));
+    CHECK(InitFlowField(&reference, MAP_WIDTH, MAP_HEIGHT, range));
+    field.searchBudget = SEARCH_BUDGET;
+    
+    int goalX = MAP_WIDTH / 2, goalY = MAP_HEIGHT / 2;
+    SetMapTile(&map, goalX, goalY, TILE_EMPTY);
+    
+    int failedUpdates = 0, reroots = 0, longestWait = 0, wait = 0;
+    for (int edit = 0; edit < EDIT_COUNT; edit++) {
+        // Now and then several edits land between two updates
+        int edits = (NextRandom(&seed) % 8 == 0) ? 3 : 1;
+        for (int i = 0; i < edits; i++) {
+            ApplyRandomEdit(&map, &goalX, &goalY, &seed);
+        }
+        if (NextRandom(&seed) % 50 == 0) ApplyRegionEdit(&map, &seed);
+        
+        UpdateFlowField(&field, &map, goalX, goalY);
+        reroots += field.rerooted;
+        wait = (field.goalX == goalX && field.goalY == goalY) ? 0 : wait + 1;
+        if (wait > longestWait) longestWait = wait;
+        
+        int mismatches = CountMismatches(&field, &reference, &map);
+        if (mismatches > 0 && failedUpdates++ == 0) {
+            fprintf(stderr, "range %d, edit %d: %d tiles differ from a full search\n", range, edit, mismatches);
+        }
+    }
+    CHECK_INT(failedUpdates, 0);
+    CHECK(reroots > 0);
+    
+    // Once the map holds still a search toward the goal finishes within the
+    // updates its budget allows: every reached tile is expanded, then pointed
+    int updates = 0;
+    int limit = 2 * (MAP_WIDTH * MAP_HEIGHT + SEARCH_BUDGET - 1) / SEARCH_BUDGET + 1;
+    goalX = (field.goalX == 1) ? 2 : 1;
+    goalY = 1;
+    SetMapTile(&map, goalX, goalY, TILE_EMPTY);
+    do {
+        UpdateFlowField(&field, &map, goalX, goalY);
+        updates++;
+    } while ((field.goalX != goalX || field.goalY != goalY) && updates <= limit);
+    CHECK(updates <= limit);
+    CHECK_INT(CountMismatches(&field, &reference, &map), 0);
+    
+    printf("range %d: %d searches took over, longest wait %d updates\n", range, reroots, longestWait);
+    
+    UnloadFlowField(&field);
+    UnloadFlowField(&reference);
+    UnloadMapGrid(&map);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    // A short range leaves much of the map unreached, a long one reaches it all
+    RunEdits(12, 1234u);
+    RunEdits(FLOW_FIELD_DEFAULT_RANGE, 98765u);
+    
+    return FinishTest("test_flow_field");
+}
@@ -0,0 +1,238 @@
+// Checks level files (World/level.h): a map saved with SaveLevel opens, passes
+// ValidateLevel and loads back tile for tile with its player start and name,
+// while files that are truncated, have a damaged header or section table, or
+// hold sections that no longer match their checksums or their tiles are
+// turned away by OpenLevel or ValidateLevel.
+
+#include "test.h"
+#include "World/level.h"
+#include <stddef.h>
+
+#define LEVEL_PATH "test_level.w3dl"
+#define EDITED_PATH "test_level_edited.w3dl"
+
+// 37 x 11: the right edge blocks are partly outside the map
+static const char* const LAYOUT[] = {
+    "#####################################",
+    "#......#.......O.........S.........##",
+    "#......D.......O.........S..........#",
+    "#......#.................S..........#",
+    "####D###########.....################",
+    "#..............#.....#..............#",
+    "#..O...........D.....D......O.......#",
+    "#..............#.....#..............#",
+    "#..............#######..............#",
+    "#...................................#",
+    "#####################################",
+};
+
+// Copies the saved level to EDITED_PATH, cut to size bytes (or all of it
+// when size is 0) with count bytes at offset replaced
+static bool WriteEditedLevel(unsigned int size, size_t offset, const void* bytes, size_t count) {
+    unsigned int fileSize = 0;
+    unsigned char* data = LoadFileData(LEVEL_PATH, &fileSize);
+    if (data == NULL) return false;
+    
+    if (size == 0) size = fileSize;
+    bool saved = size <= fileSize && offset + count <= size;
+    if (saved) {
+        if (count > 0) memcpy(data + offset, bytes, count);
+        saved = SaveFileData(EDITED_PATH, data, size);
+    }
+    UnloadFileData(data);
+    return saved;
+}
+
+static bool OpensEdited(void) {
+    LevelFile level;
+    bool opened = OpenLevel(&level, EDITED_PATH);
+    CloseLevel(&level);
+    return opened;
+}
+
+// Opens the edited file, which has to open, and validates it
+static bool ValidatesEdited(void) {
+    LevelFile level;
+    if (!OpenLevel(&level, EDITED_PATH)) return false;
+    bool valid = ValidateLevel(&level);
+    CloseLevel(&level);
+    return valid;
+}
+
+// FNV-1a, as the section checksums are computed
+static uint32_t HashBytes(const unsigned char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Writes one changed tile byte and the tiles checksum that goes with it, so
+// only the comparison with the solid and block sections can catch it
+static bool WriteRetiledLevel(const LevelHeader* header, int x, int y, unsigned char tile) {
+    const LevelSection* section = &header->sections[LEVEL_SECTION_TILES];
+    unsigned int fileSize = 0;
+    unsigned char* data = LoadFileData(LEVEL_PATH, &fileSize);
+    if (data == NULL) return false;
+    
+    data[section->offset + (size_t)y * header->width + x] = tile;
+    uint32_t checksum = HashBytes(data + section->offset, (size_t)section->size);
+    memcpy(data + offsetof(LevelHeader, sections) + offsetof(LevelSection, checksum), &checksum, sizeof(checksum));
+    bool saved = SaveFileData(EDITED_PATH, data, fileSize);
+    UnloadFileData(data);
+    return saved;
+}
+
+static void CheckRoundTrip(const Map* map) {
+    CHECK(SaveLevel(map, "round trip", LEVEL_PATH));
+    
+    LevelFile level;
+    CHECK(OpenLevel(&level, LEVEL_PATH));
+    if (level.data == NULL) return;
+    CHECK(ValidateLevel(&level));
+    
+    const LevelHeader* header = level.header;
+    CHECK_INT(header->width, map->width);
+    CHECK_INT(header->height, map->height);
+    CHECK(header->startX == map->playerStart.x && header->startY == map->playerStart.y);
+    CHECK(header->startAngle == map->playerStartAngle);
+    CHECK(strcmp(header->name, "round trip") == 0);
+    CHECK_INT(header->fileSize, level.size);
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        CHECK_INT(header->sections[i].offset % LEVEL_SECTION_ALIGN, 0);
+    }
+    
+    // The sections are the map's own arrays
+    size_t tileCount = (size_t)map->width * map->height;
+    CHECK(memcmp(level.tiles, map->tiles, tileCount) == 0);
+    CHECK(memcmp(level.solid, map->solid, (tileCount + 63) / 64 * sizeof(uint64_t)) == 0);
+    CHECK(memcmp(level.blocks, map->blocks, (size_t)map->blocksX * map->blocksY * sizeof(uint64_t)) == 0);
+    CloseLevel(&level);
+    
+    // And a map loaded from the file has the same grid and start
+    Map loaded;
+    CHECK(LoadMapGrid(&loaded, LEVEL_PATH));
+    CHECK_INT(loaded.width, map->width);
+    CHECK_INT(loaded.height, map->height);
+    int mismatches = 0;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            mismatches += GetMapTile(&loaded, x, y) != GetMapTile(map, x, y);
+            mismatches += IsMapCellSolid(&loaded, x, y) != IsMapCellSolid(map, x, y);
+        }
+    }
+    CHECK_INT(mismatches, 0);
+    CHECK(loaded.playerStart.x == map->playerStart.x && loaded.playerStart.y == map->playerStart.y);
+    CHECK(loaded.playerStartAngle == map->playerStartAngle);
+    UnloadMapGrid(&loaded);
+    
+    // A name too long for the header is cut short but still terminated
+    CHECK(SaveLevel(map, "a level name well over thirty-two characters long", EDITED_PATH));
+    CHECK(OpenLevel(&level, EDITED_PATH));
+    if (level.data != NULL) CHECK_INT(strlen(level.header->name), LEVEL_NAME_SIZE - 1);
+    CloseLevel(&level);
+}
+
+// Files cut short or with a header that does not describe them never open
+static void CheckRejectedHeaders(const LevelHeader* header) {
+    unsigned int fileSize = (unsigned int)header->fileSize;
+    CHECK(WriteEditedLevel(fileSize - 1, 0, NULL, 0));
+    CHECK(!OpensEdited());
+    CHECK(WriteEditedLevel(LEVEL_HEADER_SIZE - 8, 0, NULL, 0));
+    CHECK(!OpensEdited());
+    CHECK(WriteEditedLevel((unsigned int)header->sections[LEVEL_SECTION_BLOCKS].offset, 0, NULL, 0));
+    CHECK(!OpensEdited());
+    
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, magic), "W3DX", 4));
+    CHECK(!OpensEdited());
+    
+    uint32_t version = LEVEL_VERSION + 1;
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, version), &version, sizeof(version)));
+    CHECK(!OpensEdited());
+    
+    uint32_t byteOrder = 0x04030201u;
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, byteOrder), &byteOrder, sizeof(byteOrder)));
+    CHECK(!OpensEdited());
+    
+    int32_t badSizes[] = { 0, -5, MAP_MAX_SIZE + 1 };
+    for (int i = 0; i < 3; i++) {
+        CHECK(WriteEditedLevel(0, offsetof(LevelHeader, height), &badSizes[i], sizeof(int32_t)));
+        CHECK(!OpensEdited());
+    }
+    
+    // A taller map with the same file size has sections of the wrong size
+    int32_t taller = header->height + 1;
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, height), &taller, sizeof(taller)));
+    CHECK(!OpensEdited());
+    
+    uint64_t longer = header->fileSize + LEVEL_SECTION_ALIGN;
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, fileSize), &longer, sizeof(longer)));
+    CHECK(!OpensEdited());
+    
+    // Section table entries that are misaligned, overlap the header, are the
+    // wrong size or run past the end of the file
+    size_t blocksEntry = offsetof(LevelHeader, sections) + LEVEL_SECTION_BLOCKS * sizeof(LevelSection);
+    uint64_t offsets[] = { header->sections[LEVEL_SECTION_BLOCKS].offset + 8, 0, header->fileSize };
+    for (int i = 0; i < 3; i++) {
+        CHECK(WriteEditedLevel(0, blocksEntry + offsetof(LevelSection, offset), &offsets[i], sizeof(uint64_t)));
+        CHECK(!OpensEdited());
+    }
+    uint64_t size = header->sections[LEVEL_SECTION_BLOCKS].size - sizeof(uint64_t);
+    CHECK(WriteEditedLevel(0, blocksEntry + offsetof(LevelSection, size), &size, sizeof(size)));
+    CHECK(!OpensEdited());
+}
+
+// Files that open but whose contents are damaged fail validation
+static void CheckRejectedContents(const LevelHeader* header) {
+    // One flipped byte in each section breaks its checksum
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        unsigned char flipped = 0x5a;
+        CHECK(WriteEditedLevel(0, (size_t)header->sections[i].offset + 3, &flipped, 1));
+        CHECK(!ValidatesEdited());
+    }
+    
+    // Tiles rewritten with a matching checksum: a wall where the solid and
+    // block bits say empty, a tile type that does not exist
+    CHECK(WriteRetiledLevel(header, 10, 9, TILE_WALL));
+    CHECK(!ValidatesEdited());
+    CHECK(WriteRetiledLevel(header, 10, 9, 200));
+    CHECK(!ValidatesEdited());
+    
+    // A player start inside a wall or off the map
+    float wallX = 0.5f, offMapY = -1.0f;
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, startX), &wallX, sizeof(float)));
+    CHECK(!ValidatesEdited());
+    CHECK(WriteEditedLevel(0, offsetof(LevelHeader, startY), &offMapY, sizeof(float)));
+    CHECK(!ValidatesEdited());
+    
+    // The unchanged file still passes
+    CHECK(WriteEditedLevel(0, 0, NULL, 0));
+    CHECK(ValidatesEdited());
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_ERROR);
+    
+    Map map;
+    CHECK(InitTestMap(&map, LAYOUT, sizeof(LAYOUT) / sizeof(LAYOUT[0])));
+    SetMapTile(&map, 21, 6, TILE_DOOR_OPEN);
+    map.playerStart = (Vector2){ 2.5f, 2.25f };
+    map.playerStartAngle = 1.25f;
+    
+    CheckRoundTrip(&map);
+    
+    LevelFile level;
+    CHECK(OpenLevel(&level, LEVEL_PATH));
+    if (level.data != NULL) {
+        LevelHeader header = *level.header;
+        CloseLevel(&level);
+        CheckRejectedHeaders(&header);
+        CheckRejectedContents(&header);
+    }
+    
+    UnloadMapGrid(&map);
+    remove(LEVEL_PATH);
+    remove(EDITED_PATH);
+    return FinishTest("test_level");
+}
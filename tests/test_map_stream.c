@@ -0,0 +1,192 @@
+// Checks streamed levels (World/map_stream.h): walking across a level saved
+// with SaveLevel, the chunks around the player read exactly as the level's
+// tiles, with occupancy bits and blocks to match, while every tile outside
+// the window of loaded chunks reads as a solid wall. A door opened by the
+// game survives its chunk being evicted and read back, packet rays cast in a
+// moved window hit what CastRay hits, and the memory held does not grow with
+// the level.
+
+#include "test.h"
+#include "World/map_stream.h"
+#include "World/level.h"
+#include "Rendering/raycaster.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define LEVEL_PATH "test_map_stream.w3dl"
+#define BIG_LEVEL_PATH "test_map_stream_big.w3dl"
+#define STREAM_RADIUS 2
+#define RAY_COUNT 67
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Random walls and doors inside a solid border, saved to path; the source
+// grid stays loaded in map for comparison
+static bool SaveRandomLevel(Map* map, int width, int height, const char* path) {
+    if (!InitMapGrid(map, width, height)) return false;
+    
+    unsigned int seed = 99u;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            bool border = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            unsigned int roll = NextRandom(&seed) % 100;
+            SetMapTile(map, x, y, (border || roll < 10) ? TILE_WALL : (roll < 12) ? TILE_DOOR : TILE_EMPTY);
+        }
+    }
+    SetMapTile(map, 70, 70, TILE_EMPTY);
+    map->playerStart = (Vector2){ 70.5f, 70.5f };
+    return SaveLevel(map, "streamed", path);
+}
+
+static Vector2 TileCentre(int x, int y) {
+    return (Vector2){ (x + 0.5f) * TILE_SIZE, (y + 0.5f) * TILE_SIZE };
+}
+
+// Compares every tile of the streamed map with the source grid. Wanted
+// chunks have to be resident; every tile reads as its own type or, when not
+// resident, as a wall, and its occupancy and block bits agree with that.
+static void CheckStreamedTiles(const Map* streamed, const Map* source) {
+    const MapStream* stream = streamed->stream;
+    int mismatches = 0, missing = 0, resident = 0;
+    
+    for (int y = 0; y < source->height; y++) {
+        for (int x = 0; x < source->width; x++) {
+            int tile = GetMapTile(streamed, x, y);
+            int expected = GetMapTile(source, x, y);
+            bool wanted = abs((x >> MAP_CHUNK_SHIFT) - stream->focusX) <= stream->radius &&
+                          abs((y >> MAP_CHUNK_SHIFT) - stream->focusY) <= stream->radius;
+            
+            if (tile == expected) {
+                resident += tile != TILE_WALL;
+            } else if (tile != TILE_WALL || wanted) {
+                mismatches++;
+            }
+            missing += wanted && tile != expected;
+            
+            bool solid = IsMapCellSolid(streamed, x, y);
+            uint64_t block = GetMapBlock(streamed, x >> MAP_BLOCK_SHIFT, y >> MAP_BLOCK_SHIFT);
+            bool blockSolid = (block >> (((y & (MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_SHIFT) | (x & (MAP_BLOCK_SIZE - 1)))) & 1;
+            if (solid != IsTileTypeSolid(tile) || blockSolid != solid) {
+                if (mismatches++ == 0) fprintf(stderr, "tile %d,%d: type %d, solid %d, block %d\n", x, y, tile, solid, blockSolid);
+            }
+        }
+    }
+    CHECK_INT(mismatches, 0);
+    CHECK_INT(missing, 0);
+    CHECK(resident > 0);
+    
+    // Just past the map edge everything is solid too
+    CHECK(IsMapCellSolid(streamed, -1, source->height / 2));
+    CHECK(IsMapCellSolid(streamed, source->width, source->height / 2));
+}
+
+// Fans of packet rays from the player's spot against CastRay
+static void CheckStreamedRays(const Map* map, Vector2 origin) {
+    float dirX[RAY_COUNT], dirY[RAY_COUNT];
+    RayHit hits[RAY_COUNT];
+    int mismatches = 0;
+    
+    for (int turn = 0; turn < 8; turn++) {
+        float angle = turn * (PI / 4.0f) + 0.1f;
+        for (int i = 0; i < RAY_COUNT; i++) {
+            float cameraX = 2.0f * i / (float)RAY_COUNT - 1.0f;
+            dirX[i] = cosf(angle) - sinf(angle) * 0.66f * cameraX;
+            dirY[i] = sinf(angle) + cosf(angle) * 0.66f * cameraX;
+        }
+        
+        for (int k = 0; k < RAY_KERNEL_COUNT; k++) {
+            if (!IsRayKernelSupported((RayKernel)k)) continue;
+            CastRays((RayKernel)k, map, origin, dirX, dirY, RAY_COUNT, hits);
+            for (int i = 0; i < RAY_COUNT; i++) {
+                RayHit expected;
+                CastRay(map, origin, (Vector2){ dirX[i], dirY[i] }, &expected);
+                mismatches += hits[i].mapX != expected.mapX || hits[i].mapY != expected.mapY || hits[i].side != expected.side;
+            }
+        }
+    }
+    CHECK_INT(mismatches, 0);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    // 23.4 x 15.6 chunks, so the window is clamped against partial edge chunks
+    Map source;
+    CHECK(SaveRandomLevel(&source, 1500, 1000, LEVEL_PATH));
+    
+    Map map;
+    CHECK(StreamMapGrid(&map, LEVEL_PATH));
+    if (map.stream == NULL) return FinishTest("test_map_stream");
+    CHECK(map.tiles == NULL);
+    CHECK(SetMapStreamRadius(&map, STREAM_RADIUS));
+    
+    // Walk a loop across the level: through the middle, into the far corner
+    // and back to where the door is opened
+    static const int PATH[][2] = { { 70, 70 }, { 400, 150 }, { 750, 500 }, { 1480, 980 }, { 1000, 20 }, { 70, 70 } };
+    int pathLength = (int)(sizeof(PATH) / sizeof(PATH[0]));
+    for (int i = 0; i < pathLength; i++) {
+        Vector2 position = TileCentre(PATH[i][0], PATH[i][1]);
+        UpdateMapStream(&map, position);
+        FlushMapStream(&map);
+        CheckStreamedTiles(&map, &source);
+        CheckStreamedRays(&map, position);
+        
+        // The window never covers more than the chunks around the player
+        CHECK(map.solidWidth <= (2 * STREAM_RADIUS + 3) * MAP_CHUNK_SIZE);
+        CHECK(map.solidHeight <= (2 * STREAM_RADIUS + 3) * MAP_CHUNK_SIZE);
+    }
+    CHECK(map.stream->windowMoves > 1);
+    size_t memory = GetMapStreamMemory(&map);
+    
+    // An opened door is kept while its chunk is evicted, and comes back
+    int doorX = -1, doorY = -1;
+    for (int i = 0; i < 64 * 64 && doorX < 0; i++) {
+        if (GetMapTile(&map, 64 + i % 64, 64 + i / 64) == TILE_DOOR) {
+            doorX = 64 + i % 64;
+            doorY = 64 + i / 64;
+        }
+    }
+    CHECK(doorX >= 0);
+    SetMapTile(&map, doorX, doorY, TILE_DOOR_OPEN);
+    SetMapTile(&source, doorX, doorY, TILE_DOOR_OPEN);
+    CHECK(!IsMapCellSolid(&map, doorX, doorY));
+    
+    // Far enough, often enough, that the least recently wanted chunks go
+    static const int AWAY[][2] = { { 1400, 900 }, { 1000, 900 }, { 1400, 400 }, { 650, 850 }, { 1100, 150 } };
+    for (int i = 0; i < 5; i++) {
+        UpdateMapStream(&map, TileCentre(AWAY[i][0], AWAY[i][1]));
+        FlushMapStream(&map);
+    }
+    CHECK(map.stream->evictions > 0);
+    CHECK_INT(GetMapTile(&map, doorX, doorY), TILE_WALL);
+    CHECK_INT(map.stream->editedCount, 1);
+    
+    UpdateMapStream(&map, TileCentre(70, 70));
+    FlushMapStream(&map);
+    CHECK_INT(GetMapTile(&map, doorX, doorY), TILE_DOOR_OPEN);
+    CHECK_INT(map.stream->editedCount, 0);
+    CheckStreamedTiles(&map, &source);
+    UnloadMapGrid(&map);
+    UnloadMapGrid(&source);
+    
+    // Four times the tiles, the same memory for the same radius
+    Map big;
+    CHECK(SaveRandomLevel(&source, 3000, 2000, BIG_LEVEL_PATH));
+    UnloadMapGrid(&source);
+    CHECK(StreamMapGrid(&big, BIG_LEVEL_PATH));
+    if (big.stream != NULL) {
+        CHECK(SetMapStreamRadius(&big, STREAM_RADIUS));
+        UpdateMapStream(&big, TileCentre(1500, 1000));
+        FlushMapStream(&big);
+        CHECK_INT(GetMapStreamMemory(&big), memory);
+        printf("streamed 1500x1000 and 3000x2000 levels in %zu bytes each\n", memory);
+    }
+    UnloadMapGrid(&big);
+    
+    remove(LEVEL_PATH);
+    remove(BIG_LEVEL_PATH);
+    return FinishTest("test_map_stream");
+}
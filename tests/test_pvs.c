@@ -0,0 +1,122 @@
+// Checks that the potentially visible set (World/pvs.h) is conservative on the
+// built-in map: for every tile it leaves out of a source's set, brute force
+// finds no clear sight line between points spread over the two tiles. Then
+// knocks a hole in a wall, lets UpdatePVS catch up and checks again.
+
+#include "test.h"
+#include "Core/resources.h"
+#include "World/pvs.h"
+#include <math.h>
+
+// Sample points per tile side, off the grid lines so no sight line between
+// two of them grazes a wall corner or runs along a wall face
+#define SIGHT_SAMPLES 4
+static const double SAMPLE_OFFSETS[SIGHT_SAMPLES] = { 0.0131, 0.3467, 0.6521, 0.9873 };
+
+// What stops sight in the PVS: walls and out of the map, but not doors
+static bool IsSightBlocker(const Map* map, int x, int y) {
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) return true;
+    return IsMapCellSolid(map, x, y) && GetMapTile(map, x, y) != TILE_DOOR;
+}
+
+// Walks the tiles the segment passes through, from (px, py) in the source
+// tile until it enters the target tile or passes through a blocker first
+static bool IsSightLineClear(const Map* map, double px, double py, double qx, double qy, int targetX, int targetY) {
+    int x = (int)floor(px);
+    int y = (int)floor(py);
+    int sourceX = x, sourceY = y;
+    double dx = qx - px;
+    double dy = qy - py;
+    int stepX = (dx < 0) ? -1 : 1;
+    int stepY = (dy < 0) ? -1 : 1;
+    double deltaX = (dx == 0) ? 1e30 : fabs(1.0 / dx);
+    double deltaY = (dy == 0) ? 1e30 : fabs(1.0 / dy);
+    double sideX = (dx < 0) ? (px - x) * deltaX : (x + 1 - px) * deltaX;
+    double sideY = (dy < 0) ? (py - y) * deltaY : (y + 1 - py) * deltaY;
+    
+    for (;;) {
+        if (x == targetX && y == targetY) return true;
+        if (!(x == sourceX && y == sourceY) && IsSightBlocker(map, x, y)) return false;
+        
+        if (sideX < sideY) {
+            sideX += deltaX;
+            x += stepX;
+        } else {
+            sideY += deltaY;
+            y += stepY;
+        }
+    }
+}
+
+static bool CanSeeTile(const Map* map, int sourceX, int sourceY, int targetX, int targetY) {
+    for (int a = 0; a < SIGHT_SAMPLES * SIGHT_SAMPLES; a++) {
+        for (int b = 0; b < SIGHT_SAMPLES * SIGHT_SAMPLES; b++) {
+            // The target's points are nudged so no line is exactly axis aligned or diagonal
+            if (IsSightLineClear(map, sourceX + SAMPLE_OFFSETS[a % SIGHT_SAMPLES], sourceY + SAMPLE_OFFSETS[a / SIGHT_SAMPLES],
+                                 targetX + SAMPLE_OFFSETS[b % SIGHT_SAMPLES] + 0.00007,
+                                 targetY + SAMPLE_OFFSETS[b / SIGHT_SAMPLES] + 0.00011, targetX, targetY)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Counts the tiles some sight line reaches that the PVS leaves out, from every open source tile
+static int CountMissedTiles(const Map* map, int* hidden) {
+    int missed = 0;
+    *hidden = 0;
+    
+    for (int sy = 0; sy < map->height; sy++) {
+        for (int sx = 0; sx < map->width; sx++) {
+            if (IsSightBlocker(map, sx, sy)) continue;
+            
+            for (int ty = 0; ty < map->height; ty++) {
+                for (int tx = 0; tx < map->width; tx++) {
+                    if (IsTileVisibleFrom(map->pvs, sx, sy, tx, ty)) continue;
+                    
+                    (*hidden)++;
+                    if (!CanSeeTile(map, sx, sy, tx, ty)) continue;
+                    
+                    if (missed < 8) fprintf(stderr, "PVS misses (%d,%d) -> (%d,%d)\n", sx, sy, tx, ty);
+                    missed++;
+                }
+            }
+        }
+    }
+    return missed;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    InitResources(NULL);
+    
+    static Map map = { 0 };
+    InitMapHeadless(&map, NULL);
+    CHECK(BuildMapPVS(&map, NULL));
+    CHECK(map.pvs != NULL && map.pvs->dirtyCount == 0);
+    if (map.pvs == NULL) return FinishTest("test_pvs");
+    
+    // Sight lines the old ray-sampled build dropped
+    CHECK(IsTileVisibleFrom(map.pvs, 2, 22, 20, 21));
+    CHECK(IsTileVisibleFrom(map.pvs, 22, 15, 17, 1));
+    
+    int hidden = 0;
+    CHECK_INT(CountMissedTiles(&map, &hidden), 0);
+    
+    // Still worth having: most of the map is hidden from most of it
+    int pairs = map.width * map.height * map.width * map.height;
+    CHECK(hidden > pairs / 2);
+    
+    // A gap in the wall of the inner room opens new sight lines
+    SetMapTile(&map, 10, 7, TILE_EMPTY);
+    CHECK(map.pvs->dirtyCount > 0);
+    while (UpdatePVS(map.pvs, &map, PVS_REBUILD_BUDGET) > 0) {}
+    CHECK_INT(map.pvs->dirtyCount, 0);
+    CHECK(IsTileVisibleFrom(map.pvs, 10, 5, 10, 10));
+    CHECK_INT(CountMissedTiles(&map, &hidden), 0);
+    
+    UnloadMap(&map);
+    UnloadResources();
+    return FinishTest("test_pvs");
+}
@@ -0,0 +1,132 @@
+// Checks that the packet DDA kernels (Rendering/raycaster.h) give exactly the
+// hits of CastRay: perpendicular distance bit for bit, side, tile, hit cell
+// and door opening, with every kernel the CPU supports. Rays fan out like a
+// camera's columns from random spots, plus axis-aligned and near-axis
+// directions; batches of odd sizes exercise the partial last packet. Some
+// doors are closed, some half open, so lanes that stop on a door are handed
+// back to CastRay.
+
+#include "test.h"
+#include "Rendering/raycaster.h"
+#include <math.h>
+
+#define POSE_COUNT 4000
+#define RAYS_PER_POSE 67
+#define MAP_WIDTH 64
+#define MAP_HEIGHT 48
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Walls around the border and scattered inside, doors in corridors between walls
+static void InitRayMap(Map* map, unsigned int* seed) {
+    InitMapGrid(map, MAP_WIDTH, MAP_HEIGHT);
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            bool border = x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1;
+            unsigned int roll = NextRandom(seed) % 100;
+            SetMapTile(map, x, y, (border || roll < 12) ? TILE_WALL : (roll < 14) ? TILE_SECRET_WALL : TILE_EMPTY);
+        }
+    }
+    
+    // Doors between two walls, then set a few of them sliding
+    for (int y = 2; y < MAP_HEIGHT - 2; y += 3) {
+        for (int x = 2; x < MAP_WIDTH - 2; x += 5) {
+            SetMapTile(map, x, y, TILE_DOOR);
+            SetMapTile(map, x - 1, y, TILE_WALL);
+            SetMapTile(map, x + 1, y, TILE_WALL);
+            if (NextRandom(seed) % 3 == 0) ToggleDoor(map, x, y);
+        }
+    }
+    UpdateMap(map, 0.4f);
+}
+
+// A spot in an empty tile, sometimes exactly on a tile edge
+static Vector2 RandomOrigin(const Map* map, unsigned int* seed) {
+    for (;;) {
+        float x = 1.0f + (float)(NextRandom(seed) % ((MAP_WIDTH - 2) * 256)) / 256.0f;
+        float y = 1.0f + (float)(NextRandom(seed) % ((MAP_HEIGHT - 2) * 256)) / 256.0f;
+        if (NextRandom(seed) % 8 == 0) x = floorf(x);
+        if (GetMapTile(map, (int)x, (int)y) == TILE_EMPTY) return (Vector2){ x * TILE_SIZE, y * TILE_SIZE };
+    }
+}
+
+// Camera columns for a random heading, the way RenderColumns builds them;
+// every few poses the heading is snapped to an axis or just off it
+static void BuildRayFan(float* dirX, float* dirY, int count, unsigned int* seed) {
+    float angle = (float)(NextRandom(seed) % 36000) / 36000.0f * 2.0f * PI;
+    unsigned int snap = NextRandom(seed) % 6;
+    if (snap == 0) angle = (float)(NextRandom(seed) % 4) * (PI / 2.0f);
+    if (snap == 1) angle = (float)(NextRandom(seed) % 4) * (PI / 2.0f) + 0.00005f;
+    
+    float cx = cosf(angle), cy = sinf(angle);
+    float planeX = -cy * 0.66f, planeY = cx * 0.66f;
+    for (int i = 0; i < count; i++) {
+        float cameraX = 2.0f * i / (float)count - 1.0f;
+        dirX[i] = cx + planeX * cameraX;
+        dirY[i] = cy + planeY * cameraX;
+    }
+    
+    // A centre column pointing straight down an axis, whatever the heading
+    if (snap == 2) {
+        dirX[count / 2] = 0.0f;
+        dirY[count / 2] = (cy < 0.0f) ? -1.0f : 1.0f;
+    }
+}
+
+static bool SameHit(const RayHit* a, const RayHit* b) {
+    return memcmp(&a->perpDist, &b->perpDist, sizeof(float)) == 0 && a->side == b->side && a->tile == b->tile &&
+           a->mapX == b->mapX && a->mapY == b->mapY && memcmp(&a->doorOpen, &b->doorOpen, sizeof(float)) == 0;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    unsigned int seed = 31337u;
+    Map map;
+    InitRayMap(&map, &seed);
+    CHECK(map.activeDoorCount > 0);
+    
+    int packetKernels = 0;
+    for (int k = 0; k < RAY_KERNEL_COUNT; k++) {
+        if (!IsRayKernelSupported((RayKernel)k)) continue;
+        if (k != RAY_KERNEL_SCALAR) packetKernels++;
+        
+        unsigned int poseSeed = 4242u;
+        int mismatches = 0, rays = 0, doorHits = 0;
+        for (int p = 0; p < POSE_COUNT; p++) {
+            float dirX[RAYS_PER_POSE], dirY[RAYS_PER_POSE];
+            RayHit hits[RAYS_PER_POSE];
+            Vector2 origin = RandomOrigin(&map, &poseSeed);
+            int count = 1 + (int)(NextRandom(&poseSeed) % RAYS_PER_POSE);
+            BuildRayFan(dirX, dirY, count, &poseSeed);
+            
+            CastRays((RayKernel)k, &map, origin, dirX, dirY, count, hits);
+            for (int i = 0; i < count; i++) {
+                RayHit expected;
+                CastRay(&map, origin, (Vector2){ dirX[i], dirY[i] }, &expected);
+                if (!SameHit(&hits[i], &expected) && mismatches++ == 0) {
+                    fprintf(stderr, "%s: ray (%g, %g) from (%g, %g) hit %d,%d side %d dist %.9g, expected %d,%d side %d dist %.9g\n",
+                            GetRayKernelName((RayKernel)k), dirX[i], dirY[i], origin.x, origin.y, hits[i].mapX, hits[i].mapY,
+                            hits[i].side, hits[i].perpDist, expected.mapX, expected.mapY, expected.side, expected.perpDist);
+                }
+                doorHits += expected.tile == TILE_DOOR;
+                rays++;
+            }
+        }
+        CHECK_INT(mismatches, 0);
+        CHECK(doorHits > 0);
+        printf("%s: %d rays, %d on doors\n", GetRayKernelName((RayKernel)k), rays, doorHits);
+    }
+    
+#if defined(__GNUC__) && defined(__x86_64__)
+    // Every x86-64 CPU has SSE2, so at least one packet kernel was checked
+    CHECK(packetKernels > 0);
+#endif
+    (void)packetKernels;
+    
+    UnloadMapGrid(&map);
+    return FinishTest("test_raycaster");
+}
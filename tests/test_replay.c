@@ -0,0 +1,105 @@
+// Checks that a run recorded headless (Core/replay.h) plays back to exactly
+// the recorded final state, and that replays which cannot reproduce it are
+// turned away: a bad tick rate, another start pose, an edited input run.
+
+#include "test.h"
+#include "Core/game.h"
+#include "Core/replay.h"
+#include <math.h>
+
+#define RECORD_TICKS 3000
+#define REPLAY_PATH "test_replay.w3dr"
+#define EDITED_PATH "test_replay_edited.w3dr"
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Holds a random set of buttons for a while, with the odd mouse turn and door use
+static PlayerInput NextInput(PlayerInput input, unsigned int* seed) {
+    if (NextRandom(seed) % 40 == 0) input.buttons = NextRandom(seed) & 0x3f;
+    input.buttons &= ~PLAYER_INPUT_USE;
+    if (NextRandom(seed) % 90 == 0) input.buttons |= PLAYER_INPUT_USE;
+    input.mouseTurn = (NextRandom(seed) % 6 == 0) ? ((float)(NextRandom(seed) % 201) - 100.0f) / 2000.0f : 0.0f;
+    return input;
+}
+
+// Plays a random run into REPLAY_PATH and returns the state it ended in
+static ReplayFinalState RecordRun(void) {
+    GameState state;
+    InitGameHeadless(&state, NULL);
+    CHECK(StartGameRecording(&state, REPLAY_PATH));
+    
+    unsigned int seed = 777u;
+    PlayerInput input = { 0 };
+    for (int tick = 0; tick < RECORD_TICKS; tick++) {
+        input = NextInput(input, &seed);
+        SimulateGameTick(&state, &input);
+    }
+    
+    ReplayFinalState finalState = GetReplayFinalState(&state.player, &state.map, state.tickCount);
+    UnloadGame(&state);
+    return finalState;
+}
+
+// Copies the recording to EDITED_PATH with count bytes at offset replaced
+static bool WriteEditedReplay(int offset, const void* bytes, int count) {
+    unsigned int size = 0;
+    unsigned char* data = LoadFileData(REPLAY_PATH, &size);
+    if (data == NULL) return false;
+    
+    bool saved = (unsigned int)(offset + count) <= size;
+    if (saved) {
+        memcpy(data + offset, bytes, count);
+        saved = SaveFileData(EDITED_PATH, data, size);
+    }
+    UnloadFileData(data);
+    return saved;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_ERROR);
+    
+    ReplayFinalState recorded = RecordRun();
+    CHECK_INT(recorded.tickCount, RECORD_TICKS);
+    
+    // The footer holds the state the live run ended in
+    ReplayPlayback playback;
+    CHECK(LoadReplay(&playback, REPLAY_PATH));
+    ReplayHeader header = playback.header;
+    PlayerInput input;
+    unsigned long long ticks = 0;
+    while (NextReplayInput(&playback, &input)) ticks++;
+    CHECK_INT(ticks, RECORD_TICKS);
+    CHECK(playback.hasFinalState);
+    CHECK(CompareReplayFinalState(&recorded, &playback.finalState));
+    UnloadReplay(&playback);
+    
+    // Played back headless, the run ends in exactly that state
+    CHECK_INT(RunReplayHeadless(REPLAY_PATH, NULL, true), 0);
+    
+    // A tick rate of zero, below zero, NaN or infinite is refused on load
+    static const float BAD_RATES[] = { 0.0f, -120.0f, NAN, INFINITY };
+    for (int i = 0; i < 4; i++) {
+        CHECK(WriteEditedReplay(8, &BAD_RATES[i], sizeof(float)));
+        CHECK(!LoadReplay(&playback, EDITED_PATH));
+        CHECK_INT(RunReplayHeadless(EDITED_PATH, NULL, true), 1);
+    }
+    
+    // A run recorded from another start pose (as on another level of the
+    // same size) is refused rather than left to diverge
+    float startX = header.startPosition.x + TILE_SIZE;
+    CHECK(WriteEditedReplay(20, &startX, sizeof(float)));
+    CHECK_INT(RunReplayHeadless(EDITED_PATH, NULL, true), 1);
+    
+    // An input run changed after recording plays, but fails verification:
+    // the first run's flags become a full turn to the left
+    unsigned char turn = PLAYER_INPUT_TURN_LEFT;
+    CHECK(WriteEditedReplay(32, &turn, 1));
+    CHECK_INT(RunReplayHeadless(EDITED_PATH, NULL, true), 2);
+    
+    remove(REPLAY_PATH);
+    remove(EDITED_PATH);
+    return FinishTest("test_replay");
+}
@@ -0,0 +1,183 @@
+// Headless test of the GPU wall mesh builder (Rendering/wall_mesh.h): builds
+// the chunks of a small map without uploading them and checks the face
+// counts, the buffer sizes and that only faces that can be seen are emitted.
+// On a larger map, a mesh that only keeps the chunks around a moving focus
+// holds the same geometry for them as one that keeps the whole map.
+
+#include "test.h"
+#include "Rendering/wall_mesh.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Two chunks wide (WALL_CHUNK_SIZE is 16). The two walls in row 2 sit on
+// either side of the chunk border, so the face between them has to be culled
+// across chunks; the door in the corner adds its slab.
+static const char* const LAYOUT[] = {
+    "####################",
+    "#D.................#",
+    "#..............##..#",
+    "#..................#",
+    "#..................#",
+    "####################",
+};
+
+static int CountWallFaces(const WallMesh* wallMesh) {
+    int faces = 0;
+    for (int i = 0; i < wallMesh->chunksX * wallMesh->chunksY; i++) {
+        faces += wallMesh->chunks[i].group.faceCount;
+    }
+    return faces;
+}
+
+// Buffer sizes match the face count and every index stays inside its chunk
+static void CheckWallBuffers(const WallMesh* wallMesh) {
+    for (int i = 0; i < wallMesh->chunksX * wallMesh->chunksY; i++) {
+        const WallMeshGroup* group = &wallMesh->chunks[i].group;
+        CHECK(group->mesh.vaoId == 0);
+        if (group->faceCount == 0) continue;
+        
+        CHECK_INT(group->mesh.vertexCount, group->faceCount * 4);
+        CHECK_INT(group->mesh.triangleCount, group->faceCount * 2);
+        for (int j = 0; j < group->faceCount * 6; j++) {
+            CHECK(group->mesh.indices[j] < group->mesh.vertexCount);
+        }
+    }
+}
+
+// Every face has a solid tile behind it and an open one (empty or door) in
+// front, so no face is buried between walls or turned toward the map border
+static void CheckFacesExposed(const WallMesh* wallMesh, const Map* map) {
+    for (int i = 0; i < wallMesh->chunksX * wallMesh->chunksY; i++) {
+        const WallMeshGroup* group = &wallMesh->chunks[i].group;
+        
+        for (int f = 0; f < group->faceCount; f++) {
+            const float* v = group->mesh.vertices + f * 4 * 3;
+            const float* n = group->mesh.normals + f * 4 * 3;
+            float midX = (v[0] + v[3] + v[6] + v[9]) * 0.25f;
+            float midZ = (v[2] + v[5] + v[8] + v[11]) * 0.25f;
+            float step = TILE_SIZE * 0.25f;
+            
+            int front = GetMapTile(map, (int)floorf((midX + n[0] * step) / TILE_SIZE),
+                                   (int)floorf((midZ + n[2] * step) / TILE_SIZE));
+            int back = GetMapTile(map, (int)floorf((midX - n[0] * step) / TILE_SIZE),
+                                  (int)floorf((midZ - n[2] * step) / TILE_SIZE));
+            CHECK(front == TILE_EMPTY || front == TILE_DOOR);
+            CHECK(IsTileTypeSolid(back));
+        }
+    }
+}
+
+#define WIDE_WIDTH 160     // 10 x 6 chunks
+#define WIDE_HEIGHT 96
+#define WINDOW_RADIUS 1
+
+static unsigned int NextRandom(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Every slot of the windowed mesh holds a chunk around the focus, each one
+// once, with the vertices the full mesh has for it
+static void CheckWindowChunks(const WallMesh* window, const WallMesh* full, int focusX, int focusY) {
+    int mismatches = 0;
+    for (int i = 0; i < window->chunksX * window->chunksY; i++) {
+        const WallChunk* chunk = &window->chunks[i];
+        CHECK(abs(chunk->chunkX - focusX / WALL_CHUNK_SIZE) <= 2 * WINDOW_RADIUS);
+        CHECK(abs(chunk->chunkY - focusY / WALL_CHUNK_SIZE) <= 2 * WINDOW_RADIUS);
+        CHECK(chunk->chunkX >= window->windowX && chunk->chunkX < window->windowX + window->chunksX);
+        CHECK(chunk->chunkY >= window->windowY && chunk->chunkY < window->windowY + window->chunksY);
+        
+        const WallMeshGroup* group = &chunk->group;
+        const WallMeshGroup* expected = &full->chunks[chunk->chunkY * full->chunksX + chunk->chunkX].group;
+        if (group->faceCount != expected->faceCount ||
+            memcmp(group->mesh.vertices, expected->mesh.vertices, (size_t)group->faceCount * 4 * 3 * sizeof(float)) != 0) {
+            mismatches++;
+        }
+    }
+    CHECK_INT(mismatches, 0);
+}
+
+// Walks the focus across a random map, editing tiles inside and outside the
+// kept chunks on the way
+static void CheckWindow(void) {
+    Map map;
+    CHECK(InitMapGrid(&map, WIDE_WIDTH, WIDE_HEIGHT));
+    unsigned int seed = 31u;
+    for (int y = 0; y < WIDE_HEIGHT; y++) {
+        for (int x = 0; x < WIDE_WIDTH; x++) {
+            bool border = x == 0 || y == 0 || x == WIDE_WIDTH - 1 || y == WIDE_HEIGHT - 1;
+            SetMapTile(&map, x, y, (border || NextRandom(&seed) % 100 < 20) ? TILE_WALL : TILE_EMPTY);
+        }
+    }
+    
+    WallMesh window, full;
+    CHECK(InitWallMesh(&window, &map, WINDOW_RADIUS, false));
+    CHECK(InitWallMesh(&full, &map, WIDE_WIDTH / WALL_CHUNK_SIZE, false));
+    CHECK_INT(window.chunksX, 2 * WINDOW_RADIUS + 1);
+    CHECK_INT(window.chunksY, 2 * WINDOW_RADIUS + 1);
+    CHECK_INT(full.chunksX * full.chunksY, 60);
+    
+    static const int PATH[][2] = { { 2, 2 }, { 40, 20 }, { 100, 50 }, { 157, 93 }, { 150, 5 }, { 70, 60 }, { 2, 2 } };
+    int moved = 0;
+    for (int i = 0; i < (int)(sizeof(PATH) / sizeof(PATH[0])); i++) {
+        for (int edit = 0; edit < 20; edit++) {
+            int x = 1 + (int)(NextRandom(&seed) % (WIDE_WIDTH - 2));
+            int y = 1 + (int)(NextRandom(&seed) % (WIDE_HEIGHT - 2));
+            SetMapTile(&map, x, y, (GetMapTile(&map, x, y) == TILE_WALL) ? TILE_EMPTY : TILE_WALL);
+        }
+        
+        SetWallMeshFocus(&window, PATH[i][0], PATH[i][1]);
+        UpdateWallMesh(&window, &map);
+        UpdateWallMesh(&full, &map);
+        moved += window.rebuiltChunks > 0;
+        CheckWindowChunks(&window, &full, PATH[i][0], PATH[i][1]);
+    }
+    CHECK(moved > 1);
+    
+    UnloadWallMesh(&window);
+    UnloadWallMesh(&full);
+    UnloadMapGrid(&map);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    static Map map = { 0 };
+    CHECK(InitTestMap(&map, LAYOUT, (int)(sizeof(LAYOUT) / sizeof(LAYOUT[0]))));
+    
+    WallMesh wallMesh;
+    CHECK(InitWallMesh(&wallMesh, &map, WALL_MESH_DEFAULT_RADIUS, false));
+    CHECK_INT(wallMesh.chunksX, 2);
+    CHECK_INT(wallMesh.chunksY, 1);
+    
+    // 44 faces around the 18x4 room, 6 around the wall pair, 2 for the door slab
+    CHECK_INT(CountWallFaces(&wallMesh), 52);
+    CHECK(wallMesh.chunks[0].group.faceCount > 0 && wallMesh.chunks[1].group.faceCount > 0);
+    CheckWallBuffers(&wallMesh);
+    CheckFacesExposed(&wallMesh, &map);
+    
+    // Removing the wall on the border exposes its neighbour in the other chunk
+    SetMapTile(&map, 16, 2, TILE_EMPTY);
+    UpdateWallMesh(&wallMesh, &map);
+    CHECK_INT(wallMesh.rebuiltChunks, 2);
+    CHECK_INT(CountWallFaces(&wallMesh), 50);
+    CheckWallBuffers(&wallMesh);
+    CheckFacesExposed(&wallMesh, &map);
+    
+    // A new pillar in the middle of the first chunk touches only that chunk
+    SetMapTile(&map, 8, 3, TILE_WALL);
+    UpdateWallMesh(&wallMesh, &map);
+    CHECK_INT(wallMesh.rebuiltChunks, 1);
+    CHECK_INT(CountWallFaces(&wallMesh), 54);
+    CheckFacesExposed(&wallMesh, &map);
+    
+    // Nothing changed, nothing rebuilt
+    UpdateWallMesh(&wallMesh, &map);
+    CHECK_INT(wallMesh.rebuiltChunks, 0);
+    
+    UnloadWallMesh(&wallMesh);
+    UnloadMapGrid(&map);
+    
+    CheckWindow();
+    return FinishTest("test_wall_mesh");
+}
@@ -0,0 +1,291 @@
+// wolf3d_levelc: builds, checks and inspects binary level files (World/level.h).
+//
+// A text layout has one row of tiles per line, one character per tile:
+//   '#' wall   '.' or ' ' empty   'D' door   'S' secret wall   'O' obstacle
+//   'P' empty tile the player starts on   '0'-'5' tile type by number
+// A line containing commas is read as CSV instead: tile type numbers, or 'P'
+// for the player start. Lines starting with ';' are comments. Rows shorter
+// than the longest one are padded with walls.
+//
+// Usage: wolf3d_levelc build <layout.txt|layout.csv> <out.w3dl> [--name NAME] [--angle DEGREES]
+//        wolf3d_levelc validate <level.w3dl>
+//        wolf3d_levelc info <level.w3dl>
+
+#include "raylib.h"
+#include "Core/timing.h"
+#include "World/map.h"
+#include "World/level.h"
+#include "World/map_stream.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage(void) {
+    fprintf(stderr, "Usage: wolf3d_levelc build <layout.txt|layout.csv> <out.w3dl> [--name NAME] [--angle DEGREES]\n"
+                    "       wolf3d_levelc validate <level.w3dl>\n"
+                    "       wolf3d_levelc info <level.w3dl>\n");
+}
+
+//----------------------------------------------------------------------------------
+// Text layouts
+//----------------------------------------------------------------------------------
+
+// Tile type of one layout cell, or -1 if it means nothing
+static int ParseLayoutCell(const char* cell, int length, bool* isStart) {
+    while (length > 0 && isspace((unsigned char)*cell)) {
+        cell++;
+        length--;
+    }
+    while (length > 0 && isspace((unsigned char)cell[length - 1])) length--;
+    
+    *isStart = false;
+    if (length == 0) return TILE_EMPTY;
+    
+    if (isdigit((unsigned char)cell[0])) {
+        int tile = 0;
+        for (int i = 0; i < length; i++) {
+            if (!isdigit((unsigned char)cell[i])) return -1;
+            tile = tile * 10 + (cell[i] - '0');
+            if (tile > TILE_DOOR_OPEN) return -1;
+        }
+        return tile;
+    }
+    if (length != 1) return -1;
+    
+    switch (cell[0]) {
+        case '.': return TILE_EMPTY;
+        case '#': return TILE_WALL;
+        case 'D': return TILE_DOOR;
+        case 'S': return TILE_SECRET_WALL;
+        case 'O': return TILE_OBSTACLE;
+        case 'P': *isStart = true; return TILE_EMPTY;
+        default: return -1;
+    }
+}
+
+// Calls visit for every cell of a layout line; returns the cell count
+static int ForEachLayoutCell(const char* line, int length, void (*visit)(void*, int, const char*, int), void* userData) {
+    bool csv = length > 0 && memchr(line, ',', (size_t)length) != NULL;
+    if (csv && line[length - 1] == ',') length--; // Trailing comma
+    if (!csv) {
+        for (int i = 0; i < length; i++) {
+            if (visit != NULL) visit(userData, i, line + i, 1);
+        }
+        return length;
+    }
+    
+    int count = 0;
+    const char* start = line;
+    const char* end = line + length;
+    while (start <= end) {
+        const char* comma = memchr(start, ',', (size_t)(end - start));
+        const char* cellEnd = comma ? comma : end;
+        if (visit != NULL) visit(userData, count, start, (int)(cellEnd - start));
+        count++;
+        start = cellEnd + 1;
+    }
+    return count;
+}
+
+typedef struct LayoutRow {
+    Map* map;
+    int y;
+    int line;
+    bool hasStart;
+    bool ok;
+} LayoutRow;
+
+static void StoreLayoutCell(void* userData, int x, const char* cell, int length) {
+    LayoutRow* row = (LayoutRow*)userData;
+    bool isStart;
+    int tile = ParseLayoutCell(cell, length, &isStart);
+    
+    if (tile < 0) {
+        fprintf(stderr, "line %d: unknown tile '%.*s'\n", row->line, length, cell);
+        row->ok = false;
+        return;
+    }
+    if (isStart) {
+        if (row->hasStart) fprintf(stderr, "line %d: second player start, using this one\n", row->line);
+        row->map->playerStart = (Vector2){ x + 0.5f, row->y + 0.5f };
+        row->hasStart = true;
+    }
+    SetMapTile(row->map, x, row->y, tile);
+}
+
+// Next non-comment line without its line break; NULL at the end
+static const char* NextLayoutLine(const char** cursor, const char* end, int* length, int* lineNumber) {
+    while (*cursor < end) {
+        const char* line = *cursor;
+        const char* lineEnd = memchr(line, '\n', (size_t)(end - line));
+        if (lineEnd == NULL) lineEnd = end;
+        *cursor = lineEnd + 1;
+        (*lineNumber)++;
+        
+        int lineLength = (int)(lineEnd - line);
+        if (lineLength > 0 && line[lineLength - 1] == '\r') lineLength--;
+        if (lineLength > 0 && line[0] == ';') continue;
+        
+        *length = lineLength;
+        return line;
+    }
+    return NULL;
+}
+
+static bool LoadLayout(Map* map, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)size + 1);
+    bool read = text != NULL && fread(text, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!read) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        free(text);
+        return false;
+    }
+    const char* end = text + size;
+    
+    // Size the grid first: rows, and cells in the longest row. Trailing
+    // empty lines do not count as rows.
+    int width = 0;
+    int height = 0;
+    int rows = 0;
+    int lineNumber = 0;
+    int length;
+    const char* cursor = text;
+    for (const char* line; (line = NextLayoutLine(&cursor, end, &length, &lineNumber)) != NULL;) {
+        rows++;
+        if (length > 0) height = rows;
+        int cells = ForEachLayoutCell(line, length, NULL, NULL);
+        if (cells > width) width = cells;
+    }
+    
+    bool ok = InitMapGrid(map, width, height);
+    LayoutRow row = { map, 0, 0, false, ok };
+    
+    cursor = text;
+    for (const char* line; ok && row.y < height && (line = NextLayoutLine(&cursor, end, &length, &row.line)) != NULL; row.y++) {
+        int cells = ForEachLayoutCell(line, length, StoreLayoutCell, &row);
+        for (int x = cells; x < width; x++) SetMapTile(map, x, row.y, TILE_WALL);
+        ok = row.ok;
+    }
+    free(text);
+    
+    if (ok && !row.hasStart) {
+        // Like InitPlayer: the first tile the player can stand on
+        for (int i = 0; i < width * height; i++) {
+            if (IsTileTypeSolid(map->tiles[i])) continue;
+            map->playerStart = (Vector2){ i % width + 0.5f, i / width + 0.5f };
+            break;
+        }
+        fprintf(stderr, "%s has no player start ('P'), starting at %.1f, %.1f\n", path, map->playerStart.x, map->playerStart.y);
+    }
+    return ok;
+}
+
+//----------------------------------------------------------------------------------
+// Commands
+//----------------------------------------------------------------------------------
+
+static int BuildLevel(int argc, char* argv[]) {
+    if (argc < 4) {
+        PrintUsage();
+        return 1;
+    }
+    const char* name = NULL;
+    float angle = 0.0f;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--angle") == 0 && i + 1 < argc) {
+            angle = (float)atof(argv[++i]) * DEG2RAD;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    // Default name: the layout's file name without its extension
+    char defaultName[LEVEL_NAME_SIZE + 1];
+    if (name == NULL) {
+        const char* base = strrchr(argv[2], '/');
+        base = base ? base + 1 : argv[2];
+        size_t length = strcspn(base, ".");
+        if (length > LEVEL_NAME_SIZE) length = LEVEL_NAME_SIZE;
+        memcpy(defaultName, base, length);
+        defaultName[length] = '\0';
+        name = defaultName;
+    }
+    
+    Map map = { 0 };
+    bool ok = LoadLayout(&map, argv[2]);
+    if (ok) {
+        map.playerStartAngle = angle;
+        ok = SaveLevel(&map, name, argv[3]);
+    }
+    if (ok) printf("%s: %dx%d level '%s' written to %s\n", argv[2], map.width, map.height, name, argv[3]);
+    
+    UnloadMapGrid(&map);
+    return ok ? 0 : 1;
+}
+
+static int CheckLevel(const char* path) {
+    LevelFile level;
+    if (!OpenLevel(&level, path)) return 1;
+    
+    uint64_t start = GetTimestampNs();
+    bool ok = ValidateLevel(&level);
+    double ms = (GetTimestampNs() - start) / 1e6;
+    printf("%s: %s (checked %zu bytes in %.2f ms)\n", path, ok ? "OK" : "INVALID", level.size, ms);
+    
+    CloseLevel(&level);
+    return ok ? 0 : 2;
+}
+
+static int PrintLevelInfo(const char* path) {
+    // What mapping the file costs, then what touching every tile page costs on top
+    uint64_t start = GetTimestampNs();
+    LevelFile level;
+    bool ok = OpenLevel(&level, path);
+    double loadMs = (GetTimestampNs() - start) / 1e6;
+    if (!ok) return 1;
+    
+    const LevelHeader* header = level.header;
+    start = GetTimestampNs();
+    unsigned int sum = 0;
+    for (size_t i = 0; i < (size_t)header->width * header->height; i++) sum += level.tiles[i];
+    double touchMs = (GetTimestampNs() - start) / 1e6;
+    
+    bool streamed = (int64_t)header->width * header->height > MAP_STREAM_MIN_TILES;
+    printf("%s: version %u, '%.*s', %dx%d tiles, %zu bytes%s\n", path, header->version, LEVEL_NAME_SIZE, header->name,
+           header->width, header->height, level.size, streamed ? " (streamed by the game)" : "");
+    printf("player start: %.2f, %.2f facing %.1f degrees\n", header->startX, header->startY, header->startAngle * RAD2DEG);
+    static const char* SECTION_NAMES[LEVEL_SECTION_COUNT] = { "tiles", "solid", "blocks" };
+    for (int i = 0; i < LEVEL_SECTION_COUNT; i++) {
+        const LevelSection* section = &header->sections[i];
+        printf("  %-6s offset %10llu size %10llu checksum %08x\n", SECTION_NAMES[i],
+               (unsigned long long)section->offset, (unsigned long long)section->size, section->checksum);
+    }
+    printf("load: %.3f ms, first pass over every tile: %.3f ms (tile sum %u)\n", loadMs, touchMs, sum);
+    
+    CloseLevel(&level);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    SetTraceLogLevel(LOG_WARNING);
+    
+    if (argc >= 2 && strcmp(argv[1], "build") == 0) return BuildLevel(argc, argv);
+    if (argc == 3 && strcmp(argv[1], "validate") == 0) return CheckLevel(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "info") == 0) return PrintLevelInfo(argv[2]);
+    
+    PrintUsage();
+    return 1;
+}